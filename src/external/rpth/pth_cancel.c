@@ -86,6 +86,12 @@ int pth_cancel(pth_t thread)
             return pth_error(FALSE, ESRCH);
         pth_pqueue_delete(q, thread);
 
+        /* a waiting thread will not get to remove its events from epoll itself */
+        if (thread->state == PTH_STATE_WAITING && thread->events != NULL) {
+            pth_event_unwatch(thread->events);
+            thread->events = NULL;
+        }
+
         /* execute cleanups */
         pth_thread_cleanup(thread);
 
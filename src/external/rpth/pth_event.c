@@ -53,6 +53,14 @@ struct pth_event_st {
     } ev_args;
 };
 
+/* the events waiting on one fd, which main_efd watches for all of them */
+struct pth_fdwatch_st {
+    uint32_t evset;        /* epoll events the fd is registered for, 0 if it is not */
+    int nevents;
+    int maxevents;
+    pth_event_t *events;
+};
+
 #endif /* cpp */
 
 /* event structure destructor */
@@ -140,6 +148,7 @@ pth_event_t pth_event(unsigned long spec, ...)
         ev->ev_type = PTH_EVENT_TIME;
         ev->ev_goal = (int)(spec & (PTH_UNTIL_OCCURRED));
         ev->ev_args.TIME.tv = tv;
+        ev->ev_args.TIME.fd = -1;
     }
     else if (spec & PTH_EVENT_MSG) {
         /* message port event */
@@ -187,6 +196,7 @@ pth_event_t pth_event(unsigned long spec, ...)
         ev->ev_args.FUNC.func  = va_arg(ap, pth_event_func_t);
         ev->ev_args.FUNC.arg   = va_arg(ap, void *);
         ev->ev_args.FUNC.tv    = va_arg(ap, pth_time_t);
+        ev->ev_args.FUNC.fd    = -1;
     }
     else
         return pth_error((pth_event_t)NULL, EINVAL);
@@ -366,32 +376,129 @@ int pth_event_free(pth_event_t ev, int mode)
     return TRUE;
 }
 
+/* the epoll events that satisfy the goal of an fd event */
+static uint32_t _pth_event_epoll_goal(pth_event_t pth_ev) {
+    uint32_t evset = 0;
+    if (pth_ev->ev_goal & PTH_UNTIL_FD_READABLE)
+        evset |= EPOLLIN;
+    if (pth_ev->ev_goal & PTH_UNTIL_FD_WRITEABLE)
+        evset |= EPOLLOUT;
+    if (pth_ev->ev_goal & PTH_UNTIL_FD_EXCEPTION)
+        evset |= EPOLLERR;
+    return evset;
+}
+
+static struct pth_fdwatch_st *_pth_event_fdwatch(int fd, int create) {
+    pth_gctx_t gctx = pth_gctx_get();
+
+    if (fd < 0)
+        return NULL;
+
+    if (fd >= gctx->fdwatch_size) {
+        if (!create)
+            return NULL;
+
+        int size = gctx->fdwatch_size > 0 ? gctx->fdwatch_size : 64;
+        while (size <= fd)
+            size *= 2;
+
+        struct pth_fdwatch_st *fdwatch = realloc(gctx->fdwatch, size * sizeof(struct pth_fdwatch_st));
+        if (fdwatch == NULL)
+            return NULL;
+        memset(&fdwatch[gctx->fdwatch_size], 0,
+               (size - gctx->fdwatch_size) * sizeof(struct pth_fdwatch_st));
+
+        gctx->fdwatch = fdwatch;
+        gctx->fdwatch_size = size;
+    }
+
+    return &gctx->fdwatch[fd];
+}
+
+/* make main_efd watch the fd for the given events, or not at all if there are none */
+static int _pth_event_fdwatch_update(int fd, struct pth_fdwatch_st *watch, uint32_t evset) {
+    pth_gctx_t gctx = pth_gctx_get();
+    struct epoll_event epoll_ev;
+    int rc = 0;
+
+    if (evset == watch->evset)
+        return 0;
+
+    memset(&epoll_ev, 0, sizeof(struct epoll_event));
+    epoll_ev.events = evset;
+    epoll_ev.data.fd = fd;
+
+    if (evset == 0) {
+        /* this fails if the fd was closed, but then epoll dropped it already */
+        pth_sc(epoll_ctl)(gctx->main_efd, EPOLL_CTL_DEL, fd, NULL);
+        gctx->fdwatch_registered--;
+    }
+    else if (watch->evset == 0) {
+        rc = pth_sc(epoll_ctl)(gctx->main_efd, EPOLL_CTL_ADD, fd, &epoll_ev);
+        if (rc == 0)
+            gctx->fdwatch_registered++;
+    }
+    else {
+        rc = pth_sc(epoll_ctl)(gctx->main_efd, EPOLL_CTL_MOD, fd, &epoll_ev);
+        if (rc < 0) {
+            /* leave it to the remaining waiters to find out what went wrong */
+            pth_sc(epoll_ctl)(gctx->main_efd, EPOLL_CTL_DEL, fd, NULL);
+            gctx->fdwatch_registered--;
+        }
+    }
+
+    watch->evset = (rc == 0) ? evset : 0;
+    return rc;
+}
+
+static int _pth_event_fdwatch_add(struct pth_fdwatch_st *watch, pth_event_t pth_ev) {
+    if (watch->nevents == watch->maxevents) {
+        int maxevents = watch->maxevents > 0 ? watch->maxevents * 2 : 2;
+        pth_event_t *events = realloc(watch->events, maxevents * sizeof(pth_event_t));
+        if (events == NULL)
+            return -1;
+        watch->events = events;
+        watch->maxevents = maxevents;
+    }
+    watch->events[watch->nevents++] = pth_ev;
+    return 0;
+}
+
+/* returns the events that the remaining waiters of the fd want */
+static uint32_t _pth_event_fdwatch_remove(struct pth_fdwatch_st *watch, pth_event_t pth_ev) {
+    uint32_t evset = 0;
+    int i = 0;
+    while (i < watch->nevents) {
+        if (watch->events[i] == pth_ev) {
+            watch->events[i] = watch->events[--watch->nevents];
+            continue;
+        }
+        if (watch->events[i]->ev_type == PTH_EVENT_FD)
+            evset |= _pth_event_epoll_goal(watch->events[i]);
+        else
+            evset |= EPOLLIN;
+        i++;
+    }
+    return evset;
+}
+
 static void _pth_event_register(pth_event_t pth_ev) {
 	if(!pth_ev) {
 		return;
 	}
 
-	struct epoll_event epoll_ev;
-	memset(&epoll_ev, 0, sizeof(struct epoll_event));
-	epoll_ev.data.ptr = pth_ev;
-
-	int target_fd = 0;
+	uint32_t evset = 0;
+	int target_fd = -1;
 
 	if (pth_ev->ev_type == PTH_EVENT_FD) {
-		if (pth_ev->ev_goal & PTH_UNTIL_FD_READABLE) {
-			epoll_ev.events |= EPOLLIN;
-		}
-		if (pth_ev->ev_goal & PTH_UNTIL_FD_WRITEABLE) {
-			epoll_ev.events |= EPOLLOUT;
-		}
-		if (pth_ev->ev_goal & PTH_UNTIL_FD_EXCEPTION) {
-			epoll_ev.events |= EPOLLERR;
-		}
-
-		if(epoll_ev.events != 0) {
+		evset = _pth_event_epoll_goal(pth_ev);
+		if(evset != 0) {
 		    target_fd = pth_ev->ev_args.FD.fd;
 		}
-	} else if(pth_ev->ev_type == PTH_EVENT_TIME || pth_ev->ev_type == PTH_EVENT_FUNC) {
+	} else if((pth_ev->ev_type == PTH_EVENT_TIME || pth_ev->ev_type == PTH_EVENT_FUNC)
+	        && pth_gctx_get()->pth_is_async) {
+	    /* the blocking event manager checks timers itself when it scans the waiting
+	     * threads, so only the async one needs them in epoll */
 	    pth_time_t* target_tv = NULL;
 	    target_fd = pth_sc(timerfd_create)(CLOCK_MONOTONIC, TFD_NONBLOCK);
 
@@ -418,24 +525,18 @@ static void _pth_event_register(pth_event_t pth_ev) {
             }
 
             /* the timer is readable once it expires */
-            epoll_ev.events |= EPOLLIN;
+            evset = EPOLLIN;
 	    }
 	}
 
-	if(target_fd > 0) {
-        int rc = pth_sc(epoll_ctl)(pth_gctx_get()->main_efd, EPOLL_CTL_ADD, target_fd, &epoll_ev);
+	if(target_fd >= 0) {
+        /* other threads may already wait on this fd, so we watch it for all of them */
+        struct pth_fdwatch_st *watch = _pth_event_fdwatch(target_fd, TRUE);
 
-        if(rc < 0) {
-            if(errno == EEXIST) {
-                /* this didnt get added because it was already there. so try to mod it instead */
-                rc = pth_sc(epoll_ctl)(pth_gctx_get()->main_efd, EPOLL_CTL_MOD, target_fd, &epoll_ev);
-            }
-            if (rc < 0) {
-                /* this didnt get added because of some other error, or the mod failed too */
-                pth_ev->ev_status = PTH_STATUS_FAILED;
-                pth_debug3("_pth_event_register: epoll failed for thread \"%s\" fd %d", pth_gctx_get()->pth_current->name, target_fd);
-                abort();
-            }
+        if(watch == NULL || _pth_event_fdwatch_add(watch, pth_ev) < 0 ||
+                _pth_event_fdwatch_update(target_fd, watch, watch->evset | evset) < 0) {
+            pth_ev->ev_status = PTH_STATUS_FAILED;
+            pth_debug3("_pth_event_register: epoll failed for thread \"%s\" fd %d", pth_gctx_get()->pth_current->name, target_fd);
         }
 	}
 }
@@ -445,26 +546,96 @@ static void _pth_event_deregister(pth_event_t pth_ev) {
         return;
     }
 
-    int target_fd = 0;
+    int target_fd = -1;
 
     if (pth_ev->ev_type == PTH_EVENT_FD) {
-        target_fd = pth_ev->ev_args.FD.fd;
+        if(_pth_event_epoll_goal(pth_ev) != 0) {
+            target_fd = pth_ev->ev_args.FD.fd;
+        }
     } else if(pth_ev->ev_type == PTH_EVENT_TIME) {
         target_fd = pth_ev->ev_args.TIME.fd;
     } else if(pth_ev->ev_type == PTH_EVENT_FUNC) {
         target_fd = pth_ev->ev_args.FUNC.fd;
     }
 
-    if(target_fd > 0) {
-        pth_sc(epoll_ctl)(pth_gctx_get()->main_efd, EPOLL_CTL_DEL, target_fd, NULL);
+    struct pth_fdwatch_st *watch = _pth_event_fdwatch(target_fd, FALSE);
+    if(watch != NULL) {
+        /* keep watching the fd while other threads still wait on it */
+        _pth_event_fdwatch_update(target_fd, watch, _pth_event_fdwatch_remove(watch, pth_ev));
+    }
+
+    /* do we need to delete the timer we created in _pth_event_register()? */
+    if(target_fd >= 0 && (pth_ev->ev_type == PTH_EVENT_TIME || pth_ev->ev_type == PTH_EVENT_FUNC)) {
+        pth_sc(close)(target_fd);
+        if(pth_ev->ev_type == PTH_EVENT_TIME) {
+            pth_ev->ev_args.TIME.fd = -1;
+        } else {
+            pth_ev->ev_args.FUNC.fd = -1;
+        }
+    }
+}
+
+/* stop watching the fds of all events in a waiting ring */
+intern void pth_event_unwatch(pth_event_t ev_ring)
+{
+    pth_event_t ev = ev_ring;
+    if (ev == NULL)
+        return;
+    do {
+        _pth_event_deregister(ev);
+        ev = ev->ev_next;
+    } while (ev != ev_ring);
+}
+
+/* mark the events waiting on an fd that main_efd reported as ready */
+intern void pth_event_dispatch(int fd, uint32_t revents)
+{
+    struct pth_fdwatch_st *watch = _pth_event_fdwatch(fd, FALSE);
+    int i;
+
+    if (watch == NULL)
+        return;
 
-        /* do we need to delete the timer we created in _pth_event_register()? */
-        if(pth_ev->ev_type == PTH_EVENT_TIME || pth_ev->ev_type == PTH_EVENT_FUNC) {
-            pth_sc(close)(target_fd);
+    for (i = 0; i < watch->nevents; i++) {
+        pth_event_t ev = watch->events[i];
+        if (ev->ev_status != PTH_STATUS_PENDING)
+            continue;
+
+        /* Filedescriptor I/O */
+        if (ev->ev_type == PTH_EVENT_FD) {
+            /* like poll, errors and hangups wake up every waiter so it sees them */
+            if ((_pth_event_epoll_goal(ev) & revents) || (revents & (EPOLLERR|EPOLLHUP))) {
+                pth_debug2("pth_event_dispatch: [I/O] event occurred on fd %d", fd);
+                ev->ev_status = PTH_STATUS_OCCURRED;
+            }
+        }
+        /* Timer and Custom Event Function */
+        else if (ev->ev_type == PTH_EVENT_TIME || ev->ev_type == PTH_EVENT_FUNC) {
+            uint64_t n_expirations = 0;
+            ssize_t rc = pth_sc(read)(fd, &n_expirations, 8);
+            if (rc > 0 && n_expirations > 0)
+                ev->ev_status = PTH_STATUS_OCCURRED;
         }
     }
 }
 
+/* forget all watched fds, when the gctx goes away */
+intern void pth_event_fdwatch_free(void)
+{
+    pth_gctx_t gctx = pth_gctx_get();
+    int fd;
+
+    for (fd = 0; fd < gctx->fdwatch_size; fd++)
+        if (gctx->fdwatch[fd].events != NULL)
+            free(gctx->fdwatch[fd].events);
+    if (gctx->fdwatch != NULL)
+        free(gctx->fdwatch);
+
+    gctx->fdwatch = NULL;
+    gctx->fdwatch_size = 0;
+    gctx->fdwatch_registered = 0;
+}
+
 /* wait for one or more events */
 int pth_wait(pth_event_t ev_ring)
 {
@@ -496,6 +667,9 @@ int pth_wait(pth_event_t ev_ring)
     pth_gctx_get()->pth_current->state = PTH_STATE_WAITING;
     pth_yield(NULL);
 
+    /* we no longer watch these fds until the next wait, even if we get cancelled now */
+    pth_event_unwatch(ev_ring);
+
     /* check for cancellation */
     pth_cancel_point();
 
@@ -510,10 +684,6 @@ int pth_wait(pth_event_t ev_ring)
             pth_debug2("pth_wait: non-pending event 0x%lx", (unsigned long)ev);
             nonpending++;
         }
-
-        /* we no longer watch this fd until the next wait */
-        _pth_event_deregister(ev);
-
         ev = ev->ev_next;
     } while (ev != ev_ring);
 
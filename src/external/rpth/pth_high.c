@@ -139,12 +139,15 @@ int pth_sigmask(int how, const sigset_t *set, sigset_t *oset)
 {
     int rv;
 
-    /* change the explicitly remembered signal mask copy for the scheduler */
+    /* change the explicitly remembered signal mask copy for the scheduler
+       (the asm mctx method remembers the mask on its own) */
+#if !PTH_MCTX_MTH(asm)
     if (set != NULL)
         pth_sc(sigprocmask)(how, &(pth_gctx_get()->pth_current->mctx.sigs), NULL);
+#endif
 
     /* change the real (per-thread saved/restored) signal mask */
-    rv = pth_sc(sigprocmask)(how, set, oset);
+    rv = pth_mctx_sigmask(how, set, oset);
 
     return rv;
 }
@@ -245,7 +248,7 @@ int pth_system(const char *cmd)
     /* block SIGCHLD signal */
     sigemptyset(&ss_block);
     sigaddset(&ss_block, SIGCHLD);
-    pth_sc(sigprocmask)(SIG_BLOCK, &ss_block, &ss_old);
+    pth_mctx_sigmask(SIG_BLOCK, &ss_block, &ss_old);
 
     /* fork the current process */
     pstat = -1;
@@ -277,7 +280,7 @@ int pth_system(const char *cmd)
     /* restore original signal dispositions and execute the command */
     sigaction(SIGINT,  &sa_int,  NULL);
     sigaction(SIGQUIT, &sa_quit, NULL);
-    pth_sc(sigprocmask)(SIG_SETMASK, &ss_old, NULL);
+    pth_mctx_sigmask(SIG_SETMASK, &ss_old, NULL);
 
     /* return error or child process result code */
     return (pid == -1 ? -1 : pstat);
@@ -501,14 +504,14 @@ int pth_pselect(int nfds, fd_set *rfds, fd_set *wfds, fd_set *efds,
 
     /* optionally set signal mask */
     if (mask != NULL)
-        if (pth_sc(sigprocmask)(SIG_SETMASK, mask, &omask) < 0)
+        if (pth_mctx_sigmask(SIG_SETMASK, mask, &omask) < 0)
             return pth_error(-1, errno);
 
     rv = pth_select(nfds, rfds, wfds, efds, tvp);
 
     /* optionally set signal mask */
     if (mask != NULL)
-        pth_shield { pth_sc(sigprocmask)(SIG_SETMASK, &omask, NULL); }
+        pth_shield { pth_mctx_sigmask(SIG_SETMASK, &omask, NULL); }
 
     return rv;
 }
@@ -643,14 +646,14 @@ int pth_ppoll(struct pollfd *fds, nfds_t nfds, const struct timespec *ts, const
 
     /* optionally set signal mask */
     if (mask != NULL)
-        if (pth_sc(sigprocmask)(SIG_SETMASK, mask, &omask) < 0)
+        if (pth_mctx_sigmask(SIG_SETMASK, mask, &omask) < 0)
             return pth_error(-1, errno);
 
     rv = pth_poll(fds, nfds, timeout);
 
     /* optionally set signal mask */
     if (mask != NULL)
-        pth_shield { pth_sc(sigprocmask)(SIG_SETMASK, &omask, NULL); }
+        pth_shield { pth_mctx_sigmask(SIG_SETMASK, &omask, NULL); }
 
     return rv;
 }
@@ -734,14 +737,14 @@ int pth_epoll_pwait(int epfd, struct epoll_event *events, int maxevents, int tim
 
     /* optionally set signal mask */
     if (mask != NULL)
-        if (pth_sc(sigprocmask)(SIG_SETMASK, mask, &omask) < 0)
+        if (pth_mctx_sigmask(SIG_SETMASK, mask, &omask) < 0)
             return pth_error(-1, errno);
 
     rv = pth_epoll_wait(epfd, events, maxevents, timeout);
 
     /* optionally set signal mask */
     if (mask != NULL)
-        pth_shield { pth_sc(sigprocmask)(SIG_SETMASK, &omask, NULL); }
+        pth_shield { pth_mctx_sigmask(SIG_SETMASK, &omask, NULL); }
 
     return rv;
 }
@@ -1651,3 +1654,184 @@ done:
     return rv;
 }
 
+
+/* Pth variant of POSIX recvmsg(2) */
+ssize_t pth_recvmsg(int s, struct msghdr *msg, int flags)
+{
+    return pth_recvmsg_ev(s, msg, flags, NULL);
+}
+
+/* Pth variant of POSIX recvmsg(2) with extra event(s) */
+ssize_t pth_recvmsg_ev(int fd, struct msghdr *msg, int flags, pth_event_t ev_extra)
+{
+    pth_event_t ev;
+    int fdmode;
+    ssize_t n;
+
+    pth_implicit_init();
+    pth_debug2("pth_recvmsg_ev: enter from thread \"%s\"", pth_gctx_get()->pth_current->name);
+
+    /* POSIX compliance */
+    if (msg == NULL)
+        return pth_error(-1, EFAULT);
+    if (!pth_util_fd_valid(fd))
+        return pth_error(-1, EBADF);
+
+    /* check mode of filedescriptor */
+    if ((fdmode = pth_fdmode(fd, PTH_FDMODE_POLL)) == PTH_FDMODE_ERROR)
+        return pth_error(-1, EBADF);
+
+    /* poll filedescriptor if not already in non-blocking operation */
+    if (fdmode == PTH_FDMODE_BLOCK) {
+        /* let thread sleep until fd is readable or the extra event occurs */
+        ev = pth_event(PTH_EVENT_FD|PTH_UNTIL_FD_READABLE, fd);
+        if (ev == NULL)
+            return pth_error(-1, errno);
+
+        if (ev_extra != NULL)
+            pth_event_concat(ev, ev_extra, NULL);
+
+        pth_wait(ev);
+
+        if (ev_extra != NULL)
+            pth_event_isolate(ev);
+
+        int ev_occurred = pth_event_status(ev) == PTH_STATUS_OCCURRED;
+        pth_event_free(ev, PTH_FREE_THIS);
+
+        /* check for the extra events */
+        if (ev_extra != NULL && !ev_occurred)
+            return pth_error(-1, EINTR);
+    }
+
+    /* now perform the actual read, which like in pth_recvfrom_ev()
+       is guaranteed not to block once */
+    while ((n = pth_sc(recvmsg)(fd, msg, flags)) < 0
+           && errno == EINTR) ;
+
+    pth_debug2("pth_recvmsg_ev: leave to thread \"%s\"", pth_gctx_get()->pth_current->name);
+    return n;
+}
+
+/* Pth variant of POSIX sendmsg(2) */
+ssize_t pth_sendmsg(int s, const struct msghdr *msg, int flags)
+{
+    return pth_sendmsg_ev(s, msg, flags, NULL);
+}
+
+/* Pth variant of POSIX sendmsg(2) with extra event(s) */
+ssize_t pth_sendmsg_ev(int fd, const struct msghdr *msg, int flags, pth_event_t ev_extra)
+{
+    pth_event_t ev;
+    int fdmode;
+    struct msghdr lmsg;
+    struct iovec *liov;
+    int liovcnt;
+    size_t nbytes;
+    ssize_t rv;
+    ssize_t s;
+    struct iovec tiov_stack[32];
+    struct iovec *tiov;
+
+    pth_implicit_init();
+    pth_debug2("pth_sendmsg_ev: enter from thread \"%s\"", pth_gctx_get()->pth_current->name);
+
+    /* POSIX compliance */
+    if (msg == NULL)
+        return pth_error(-1, EFAULT);
+    if (!pth_util_fd_valid(fd))
+        return pth_error(-1, EBADF);
+    if (msg->msg_iovlen > UIO_MAXIOV)
+        return pth_error(-1, EMSGSIZE);
+
+    /* force filedescriptor into non-blocking mode */
+    if ((fdmode = pth_fdmode(fd, PTH_FDMODE_NONBLOCK)) == PTH_FDMODE_ERROR)
+        return pth_error(-1, EBADF);
+
+    /* poll filedescriptor if not already in non-blocking operation */
+    if (fdmode != PTH_FDMODE_NONBLOCK) {
+        rv = 0;
+        nbytes = pth_writev_iov_bytes(msg->msg_iov, (int)msg->msg_iovlen);
+
+        /* provide temporary iovec structure for partial sends */
+        tiov = tiov_stack;
+        if (msg->msg_iovlen > sizeof(tiov_stack)/sizeof(struct iovec)) {
+            if ((tiov = (struct iovec *)malloc(sizeof(struct iovec) * msg->msg_iovlen)) == NULL) {
+                rv = pth_error(-1, errno);
+                goto done;
+            }
+        }
+
+        /* init local message, which only differs in its iovec */
+        lmsg = *msg;
+        liov = NULL;
+        liovcnt = 0;
+        pth_writev_iov_advance(msg->msg_iov, (int)msg->msg_iovlen, 0, &liov, &liovcnt,
+                               tiov, (int)msg->msg_iovlen);
+
+        for (;;) {
+            /* let thread sleep until fd is writeable or event occurs */
+            ev = pth_event(PTH_EVENT_FD|PTH_UNTIL_FD_WRITEABLE, fd);
+            if (ev == NULL) {
+                rv = pth_error(-1, errno);
+                break;
+            }
+
+            if (ev_extra != NULL)
+                pth_event_concat(ev, ev_extra, NULL);
+
+            pth_wait(ev);
+
+            if (ev_extra != NULL)
+                pth_event_isolate(ev);
+
+            int ev_occurred = pth_event_status(ev) == PTH_STATUS_OCCURRED;
+            pth_event_free(ev, PTH_FREE_THIS);
+
+            /* check for the extra events */
+            if (ev_extra != NULL && !ev_occurred) {
+                rv = pth_error(-1, EINTR);
+                break;
+            }
+
+            /* now perform the actual send operation */
+            lmsg.msg_iov = liov;
+            lmsg.msg_iovlen = liovcnt;
+            while ((s = pth_sc(sendmsg)(fd, &lmsg, flags)) < 0
+                   && errno == EINTR) ;
+            if (s > 0)
+                rv += s;
+
+            /* iterate unless all data is sent or an error occurs, to mimic
+               the blocking behaviour of sendmsg(2) like pth_writev_ev() */
+            if (s > 0 && s < (ssize_t)nbytes) {
+                nbytes -= s;
+                pth_writev_iov_advance(msg->msg_iov, (int)msg->msg_iovlen, s, &liov, &liovcnt,
+                                       tiov, (int)msg->msg_iovlen);
+                continue;
+            }
+
+            /* pass error to caller, but not for partial sends (rv > 0) */
+            if (s < 0 && rv == 0)
+                rv = -1;
+
+            /* stop looping */
+            break;
+        }
+
+        if (tiov != tiov_stack)
+            pth_shield { free(tiov); }
+    }
+    else {
+        /* just perform the actual send operation */
+        while ((rv = pth_sc(sendmsg)(fd, msg, flags)) < 0
+               && errno == EINTR) ;
+    }
+
+done:
+    /* restore filedescriptor mode */
+    pth_shield { pth_fdmode(fd, fdmode); }
+
+    pth_debug2("pth_sendmsg_ev: leave to thread \"%s\"", pth_gctx_get()->pth_current->name);
+    return rv;
+}
@@ -61,6 +61,9 @@ struct pth_gctx_st {
     pth_time_t   pth_loadtickgap;
 
     int main_efd; // epoll fd
+    struct pth_fdwatch_st *fdwatch; /* the events waiting on each fd in main_efd */
+    int fdwatch_size;
+    int fdwatch_registered;         /* how many fds main_efd watches for events */
 
     struct pth_keytab_st pth_keytab[PTH_KEY_MAX];
     pth_key_t ev_key_join;
@@ -236,6 +239,16 @@ static int pth_init_helper(void)
     /* create our epoll instance, used for scheduling */
     pth_gctx_get()->main_efd = epoll_create(1);
 
+    /* the blocking event manager also wakes up for signals that it catches,
+       through the read end of the signal pipe */
+    if (!pth_gctx_get()->pth_is_async) {
+        struct epoll_event epoll_ev;
+        memset(&epoll_ev, 0, sizeof(struct epoll_event));
+        epoll_ev.events = EPOLLIN;
+        epoll_ev.data.fd = pth_gctx_get()->pth_sigpipe[0];
+        epoll_ctl(pth_gctx_get()->main_efd, EPOLL_CTL_ADD, pth_gctx_get()->pth_sigpipe[0], &epoll_ev);
+    }
+
     /*
      * The first time we've to manually switch into the scheduler to start
      * threading. Because at this time the only non-scheduler thread is the
@@ -277,6 +290,9 @@ static int pth_kill_helper(void)
     pth_gctx_get()->pth_initialized = FALSE;
     pth_tcb_free(pth_gctx_get()->pth_sched);
     pth_tcb_free(pth_gctx_get()->pth_main);
+    pth_event_fdwatch_free();
+    close(pth_gctx_get()->main_efd);
+    pth_gctx_get()->main_efd = -1;
     pth_syscall_kill();
 #ifdef PTH_EX
     __ex_ctx       = __ex_ctx_default;
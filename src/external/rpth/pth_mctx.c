@@ -50,6 +50,8 @@ struct pth_mctx_st {
     int restored;
 #elif PTH_MCTX_MTH(sjlj)
     pth_sigjmpbuf jb;
+#elif PTH_MCTX_MTH(asm)
+    void *sp;
 #else
 #error "unknown mctx method"
 #endif
@@ -82,6 +84,8 @@ struct pth_mctx_st {
 #define pth_mctx_save(mctx) \
         ( (mctx)->error = errno, \
           pth_sigsetjmp((mctx)->jb) )
+#elif PTH_MCTX_MTH(asm)
+/* contexts are only saved when switching away from them */
 #else
 #error "unknown mctx method"
 #endif
@@ -99,6 +103,9 @@ struct pth_mctx_st {
 #define pth_mctx_restore(mctx) \
         ( errno = (mctx)->error, \
           (void)pth_siglongjmp((mctx)->jb, 1) )
+#elif PTH_MCTX_MTH(asm)
+#define pth_mctx_restore(mctx) \
+        pth_mctx_restore_asm(mctx)
 #else
 #error "unknown mctx method"
 #endif
@@ -135,10 +142,26 @@ struct pth_mctx_st {
     if (pth_mctx_save(old) == 0) \
         pth_mctx_restore(new); \
     pth_mctx_restored(old);
+#elif PTH_MCTX_MTH(asm)
+#define pth_mctx_switch(old,new) \
+    _pth_mctx_switch_debug \
+    pth_mctx_switch_asm(old, new);
 #else
 #error "unknown mctx method"
 #endif
 
+/*
+ * change the signal mask of the running thread
+ * (the asm method has to remember it, because its switches do not save it)
+ */
+#if PTH_MCTX_MTH(asm)
+#define pth_mctx_sigmask(how,set,oset) \
+    pth_mctx_sigmask_asm(how, set, oset)
+#else
+#define pth_mctx_sigmask(how,set,oset) \
+    pth_sc(sigprocmask)(how, set, oset)
+#endif
+
 #endif /* cpp */
 
 /*
@@ -538,6 +561,154 @@ pth_mctx_set(pth_mctx_t *mctx, void (*func)(void),
     return TRUE;
 }
 
+#elif PTH_MCTX_MTH(asm)
+
+/*
+ * VARIANT 6: HAND-WRITTEN X86_64 CONTEXT SWITCH
+ *
+ * A switch saves the callee-saved registers, the SSE and x87 control
+ * words and the stack pointer of the old context on its own stack,
+ * and pops those of the new context from its stack. Unlike
+ * swapcontext(3) and sigsetjmp(3) it does not save and restore the
+ * signal mask with a system call. Instead, we remember the mask the OS
+ * thread has, each context remembers the mask it ran with, and a
+ * switch only asks the kernel for a new mask when the two differ. All
+ * threads usually run with the same mask, so a switch is then entirely
+ * in user space. This only works as long as the masks are changed with
+ * pth_mctx_sigmask(), i.e., pth_sigmask().
+ */
+
+#if !defined(__x86_64__)
+#error "the asm mctx method is only implemented for x86_64"
+#endif
+
+/* void pth_mctx_asm_swap(void **old_sp, void *new_sp) */
+__asm__(
+    ".text\n"
+    ".p2align 4\n"
+    ".type pth_mctx_asm_swap,@function\n"
+    "pth_mctx_asm_swap:\n"
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    subq $8, %rsp\n"
+    "    stmxcsr (%rsp)\n"
+    "    fnstcw 4(%rsp)\n"
+    "    movq %rsp, (%rdi)\n"
+    "    movq %rsi, %rsp\n"
+    "    ldmxcsr (%rsp)\n"
+    "    fldcw 4(%rsp)\n"
+    "    addq $8, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    ".size pth_mctx_asm_swap,.-pth_mctx_asm_swap\n"
+);
+void pth_mctx_asm_swap(void **old_sp, void *new_sp);
+
+/* the mask the kernel has for this OS thread. it is not kept in the
+   gctx, because all gctxs that run on the OS thread share the one mask,
+   and a gctx may also move to another OS thread between its runs */
+static __thread sigset_t pth_mctx_sigmask_os;
+static __thread int pth_mctx_sigmask_os_known = FALSE;
+
+static sigset_t *pth_mctx_sigmask_os_get(void)
+{
+    if (!pth_mctx_sigmask_os_known) {
+        pth_sc(sigprocmask)(SIG_SETMASK, NULL, &pth_mctx_sigmask_os);
+        pth_mctx_sigmask_os_known = TRUE;
+    }
+    return &pth_mctx_sigmask_os;
+}
+
+intern void pth_mctx_switch_asm(pth_mctx_t *old, pth_mctx_t *new)
+{
+    sigset_t *os = pth_mctx_sigmask_os_get();
+
+    /* the old context keeps the mask it ran with, and the new one gets
+       its own only when that is a different one */
+    memcpy(&old->sigs, os, sizeof(sigset_t));
+    if (memcmp(&new->sigs, os, sizeof(sigset_t)) != 0) {
+        pth_sc(sigprocmask)(SIG_SETMASK, &new->sigs, NULL);
+        memcpy(os, &new->sigs, sizeof(sigset_t));
+    }
+
+    old->error = errno;
+    pth_mctx_asm_swap(&old->sp, new->sp);
+    errno = old->error;
+}
+
+intern void pth_mctx_restore_asm(pth_mctx_t *mctx)
+{
+    /* the context we leave is never resumed */
+    pth_mctx_t abandoned;
+    pth_mctx_switch_asm(&abandoned, mctx);
+    abort();
+}
+
+intern int pth_mctx_sigmask_asm(int how, const sigset_t *set, sigset_t *oset)
+{
+    sigset_t *os = pth_mctx_sigmask_os_get();
+    int sig;
+
+    if (pth_sc(sigprocmask)(how, set, oset) < 0)
+        return -1;
+
+    /* remember the mask we now have */
+    if (set != NULL) {
+        if (how == SIG_SETMASK)
+            memcpy(os, set, sizeof(sigset_t));
+        for (sig = 1; sig < PTH_NSIG; sig++) {
+            if (!sigismember(set, sig))
+                continue;
+            if (how == SIG_BLOCK)
+                sigaddset(os, sig);
+            else if (how == SIG_UNBLOCK)
+                sigdelset(os, sig);
+        }
+    }
+    return 0;
+}
+
+intern int pth_mctx_set(
+    pth_mctx_t *mctx, void (*func)(void), char *sk_addr_lo, char *sk_addr_hi)
+{
+    uint64_t *sp;
+    uint32_t mxcsr;
+    uint16_t fpucw;
+
+    /* leave room for what the first switch pops, and align like the ABI wants */
+    if (sk_addr_hi - sk_addr_lo < 128)
+        return FALSE;
+    sp = (uint64_t *)((uintptr_t)sk_addr_hi & ~(uintptr_t)15);
+
+    /* func never returns, but it starts with its stack aligned as if it was called */
+    *--sp = 0;
+    *--sp = (uint64_t)(uintptr_t)func;
+
+    /* the callee-saved registers start out zeroed, and the control words
+       as they are now, like getcontext(3) would have it */
+    sp -= 7;
+    memset(sp, 0, 7 * sizeof(uint64_t));
+    __asm__ __volatile__ ("stmxcsr %0" : "=m" (mxcsr));
+    __asm__ __volatile__ ("fnstcw %0" : "=m" (fpucw));
+    memcpy(sp, &mxcsr, sizeof(mxcsr));
+    memcpy((char *)sp + 4, &fpucw, sizeof(fpucw));
+
+    mctx->sp = sp;
+    /* new threads inherit the mask of their creator */
+    memcpy(&mctx->sigs, pth_mctx_sigmask_os_get(), sizeof(sigset_t));
+    mctx->error = 0;
+    return TRUE;
+}
+
 /*
  * VARIANT X: JMP_BUF FIDDLING FOR ONE MORE ESOTERIC OS
  * Add the jmp_buf fiddling for your esoteric OS here...
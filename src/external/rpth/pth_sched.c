@@ -27,6 +27,9 @@
                                      -- Unknown   */
 #include "pth_p.h"
 
+/* how many ready fds the event managers take from epoll per pass */
+#define PTH_SCHED_MAXEVENTS 128
+
 /* initialize the scheduler ingredients */
 intern int pth_scheduler_init(void)
 {
@@ -220,48 +223,18 @@ static void pth_sched_eventmanager_async(pth_time_t *now) {
         return;
     }
 
-    /* check for events without blocking!! */
-    struct epoll_event* events_ready = calloc(100, sizeof(struct epoll_event));
-    int n_events_ready = pth_sc(epoll_wait)(pth_gctx_get()->main_efd, events_ready, 100, 0);
-
-    /* mark events based on the status we got from epoll */
-    int i;
-    for(i = 0; i < n_events_ready; i++) {
-        pth_event_t ev = (pth_event_t) events_ready[i].data.ptr;
-        if(!ev) {
-            continue;
-        }
+    /* check for events without blocking, if any thread waits on an fd at all */
+    if(pth_gctx_get()->fdwatch_registered > 0) {
+        struct epoll_event events_ready[PTH_SCHED_MAXEVENTS];
+        int n_events_ready = pth_sc(epoll_wait)(pth_gctx_get()->main_efd, events_ready, PTH_SCHED_MAXEVENTS, 0);
 
-        /* Filedescriptor I/O */
-        if (ev->ev_type == PTH_EVENT_FD) {
-            if (((ev->ev_goal & PTH_UNTIL_FD_READABLE) && (events_ready[i].events & EPOLLIN)) ||
-                ((ev->ev_goal & PTH_UNTIL_FD_WRITEABLE) && (events_ready[i].events & EPOLLOUT)) ||
-                ((ev->ev_goal & PTH_UNTIL_FD_EXCEPTION) && (events_ready[i].events & EPOLLERR))) {
-                ev->ev_status = PTH_STATUS_OCCURRED;
-            }
-        }
-        /* Timer */
-        else if (ev->ev_type == PTH_EVENT_TIME) {
-            uint64_t n_expirations = 0;
-            ssize_t rc = pth_sc(read)(ev->ev_args.TIME.fd, &n_expirations, 8);
-            if(rc > 0 && n_expirations > 0) {
-                ev->ev_status = PTH_STATUS_OCCURRED;
-            }
-        }
-        /* Custom Event Function */
-        else if (ev->ev_type == PTH_EVENT_FUNC) {
-            uint64_t n_expirations = 0;
-            ssize_t rc = pth_sc(read)(ev->ev_args.FUNC.fd, &n_expirations, 8);
-            if(rc > 0 && n_expirations > 0) {
-                ev->ev_status = PTH_STATUS_OCCURRED;
-            }
+        /* mark events based on the status we got from epoll */
+        int i;
+        for(i = 0; i < n_events_ready; i++) {
+            pth_event_dispatch(events_ready[i].data.fd, events_ready[i].events);
         }
     }
 
-    /* cleanup */
-    free(events_ready);
-    events_ready = NULL;
-
     /* now comes the final cleanup loop where we've to do two jobs:
      * 1 handle all pth event types for all threads
      * 2 move threads with occurred events from the waiting queue to the ready queue */
@@ -335,7 +308,9 @@ static void pth_sched_eventmanager_async(pth_time_t *now) {
 /* the heart of this library: the thread scheduler */
 intern void *pth_scheduler(void *dummy)
 {
+#if !PTH_MCTX_MTH(asm)
     sigset_t sigs;
+#endif
     pth_time_t running;
     pth_time_t snapshot;
     struct sigaction sa;
@@ -351,9 +326,14 @@ intern void *pth_scheduler(void *dummy)
     /* mark this thread as the special scheduler thread */
     pth_gctx_get()->pth_sched->state = PTH_STATE_SCHEDULER;
 
-    /* block all signals in the scheduler thread */
+    /* block all signals in the scheduler thread, except with the asm mctx
+       method, where the scheduler then would need a system call for the
+       switches to and from every thread; the event manager still sets the
+       mask it needs while it waits */
+#if !PTH_MCTX_MTH(asm)
     sigfillset(&sigs);
     pth_sc(sigprocmask)(SIG_SETMASK, &sigs, NULL);
+#endif
 
     /* initialize the snapshot time for bootstrapping the loop */
     pth_time_set(&snapshot, PTH_TIME_NOW);
@@ -570,24 +550,6 @@ intern void *pth_scheduler(void *dummy)
     return NULL;
 }
 
-static int rpth_epoll_ctl_helper(int epollfd, int op, int fd, void* data, uint32_t evset) {
-    struct epoll_event* epollev = calloc(1, sizeof(struct epoll_event));
-    epollev->events = evset;
-    epollev->data.ptr = data;
-    int ret = epoll_ctl(epollfd, op, fd, epollev);
-    free(epollev);
-    if(ret == 0) {
-        /* all good, 1 fd got added */
-        return 1;
-    } else if(ret < 0 && errno == EEXIST) {
-        /* this didnt get added because it was already there */
-        return 0;
-    } else {
-        /* this didnt get added because of some other error */
-        return -1;
-    }
-}
-
 /*
  * Look whether some events already occurred (or failed) and move
  * corresponding threads from waiting queue back to ready queue.
@@ -611,8 +573,8 @@ intern void pth_sched_eventmanager(pth_time_t *now, int dopoll)
     int loop_repeat;
     int n_events_ready;
     int sig;
-    int epollfd;
-    int nepollevs;
+    int i;
+    struct epoll_event readyevs[PTH_SCHED_MAXEVENTS];
 
     pth_debug2("pth_sched_eventmanager: enter in %s mode",
                dopoll ? "polling" : "waiting");
@@ -621,14 +583,6 @@ intern void pth_sched_eventmanager(pth_time_t *now, int dopoll)
     loop_entry:
     loop_repeat = FALSE;
 
-    /* initialize epoll */
-    nepollevs = 0;
-    epollfd = epoll_create(1);
-    if(epollfd < 0) {
-        pth_debug2("pth_sched_eventmanager: epoll_create failed: error %d", errno);
-        abort(); // FIXME how to handle error here?
-    }
-
     /* initialize signal status */
     sigpending(&pth_gctx_get()->pth_sigpending);
     sigfillset(&pth_gctx_get()->pth_sigblock);
@@ -663,30 +617,11 @@ intern void pth_sched_eventmanager(pth_time_t *now, int dopoll)
             if (ev->ev_status == PTH_STATUS_PENDING) {
                 this_occurred = FALSE;
 
-                /* Filedescriptor I/O */
-                if (ev->ev_type == PTH_EVENT_FD) {
-                    /* filedescriptors are checked later all at once.
-                       Here we only track them in the epoll instance. */
-                    uint32_t evset = 0;
-                    if (ev->ev_goal & PTH_UNTIL_FD_READABLE)
-                        evset |= EPOLLIN;
-                    if (ev->ev_goal & PTH_UNTIL_FD_WRITEABLE)
-                        evset |= EPOLLOUT;
-                    if (ev->ev_goal & PTH_UNTIL_FD_EXCEPTION)
-                        evset |= EPOLLERR;
-                    if(evset != 0) {
-                        int retval = rpth_epoll_ctl_helper(epollfd, (int)EPOLL_CTL_ADD, ev->ev_args.FD.fd, ev, evset);
-                        if(retval < 0) {
-                            ev->ev_status = PTH_STATUS_FAILED;
-                            pth_debug3("pth_sched_eventmanager: "
-                                       "[I/O] event failed for thread \"%s\" fd %d", t->name, ev->ev_args.FD.fd);
-                        } else {
-                            nepollevs++;
-                        }
-                    }
-                }
+                /* Filedescriptor I/O is in main_efd since pth_wait(),
+                   and gets checked later all at once */
+
                 /* Signal Set */
-                else if (ev->ev_type == PTH_EVENT_SIGS) {
+                if (ev->ev_type == PTH_EVENT_SIGS) {
                     for (sig = 1; sig < PTH_NSIG; sig++) {
                         if (sigismember(ev->ev_args.SIGS.sigs, sig)) {
                             /* thread signal handling */
@@ -780,6 +715,10 @@ intern void pth_sched_eventmanager(pth_time_t *now, int dopoll)
                     any_occurred = TRUE;
                 }
             }
+            else {
+                /* e.g. pth_wait() failed to watch its fd, so do not block on it */
+                any_occurred = TRUE;
+            }
         } while ((ev = ev->ev_next) != evh);
     }
 
@@ -788,9 +727,6 @@ intern void pth_sched_eventmanager(pth_time_t *now, int dopoll)
 
     /* clear pipe and let select() wait for the read-part of the pipe */
     while (pth_sc(read)(pth_gctx_get()->pth_sigpipe[0], minibuf, sizeof(minibuf)) > 0) ;
-    nepollevs += rpth_epoll_ctl_helper(epollfd, (int)EPOLL_CTL_ADD, pth_gctx_get()->pth_sigpipe[0], NULL, (uint32_t)EPOLLIN);
-
-    struct epoll_event* readyevs = calloc(nepollevs, sizeof(struct epoll_event));
     int epoll_timeout;
 
     if (dopoll) {
@@ -829,8 +765,9 @@ intern void pth_sched_eventmanager(pth_time_t *now, int dopoll)
     /* now decide how and do the polling for fd I/O and timers
        WHEN THE SCHEDULER SLEEPS AT ALL, THEN HERE!! */
     n_events_ready = -1;
-    if (!(dopoll && nepollevs == 0))
-        while ((n_events_ready = pth_sc(epoll_wait)(epollfd, readyevs, nepollevs, epoll_timeout)) < 0
+    if (!(dopoll && pth_gctx_get()->fdwatch_registered == 0))
+        while ((n_events_ready = pth_sc(epoll_wait)(pth_gctx_get()->main_efd, readyevs,
+                                                    PTH_SCHED_MAXEVENTS, epoll_timeout)) < 0
                && errno == EINTR) ;
 
     /* restore signal mask and actions and handle signals */
@@ -854,73 +791,16 @@ intern void pth_sched_eventmanager(pth_time_t *now, int dopoll)
         }
     }
 
-    /* if an error occurred, avoid confusion in the cleanup loop */
-    if (n_events_ready <= 0) {
-        memset(readyevs, 0, nepollevs * sizeof(struct epoll_event));
-    }
-
     /* now comes the final cleanup loop where we've to
        do two jobs: first we've to do the late handling of the fd I/O events and
        additionally if a thread has one occurred event, we move it from the
        waiting queue to the ready queue */
 
-    /* set occurred events */
-    int i = 0;
-    ev = NULL;
-    for(i = 0; i < n_events_ready; i++) {
-        /* get the pth event that we stored here earlier */
-		struct epoll_event* readyev = &readyevs[i];
-        ev = (pth_event_t)readyev->data.ptr;
-
-        if(!ev) {
-//            /* if the internal signal pipe was used, adjust the select() results */
-//            if (!dopoll && rc > 0 && FD_ISSET(pth_gctx_get()->pth_sigpipe[0], &rfds)) {
-//                FD_CLR(pth_gctx_get()->pth_sigpipe[0], &rfds);
-//                rc--;
-//            }
+    /* set occurred events; the signal pipe only woke us up */
+    for (i = 0; i < n_events_ready; i++) {
+        if (readyevs[i].data.fd == pth_gctx_get()->pth_sigpipe[0])
             continue;
-        }
-
-        /*
-         * Late handling for still not occurred events
-         */
-        if (ev->ev_status == PTH_STATUS_PENDING) {
-            /* Filedescriptor I/O */
-            if (ev->ev_type == PTH_EVENT_FD) {
-                if (((ev->ev_goal & PTH_UNTIL_FD_READABLE) && (readyev->events & EPOLLIN)) ||
-                    ((ev->ev_goal & PTH_UNTIL_FD_WRITEABLE) && (readyev->events & EPOLLOUT)) ||
-                    ((ev->ev_goal & PTH_UNTIL_FD_EXCEPTION) && (readyev->events & EPOLLERR))) {
-                    ev->ev_status = PTH_STATUS_OCCURRED;
-                }
-            }
-            /* Signal Set */
-            else if (ev->ev_type == PTH_EVENT_SIGS) {
-                for (sig = 1; sig < PTH_NSIG; sig++) {
-                    if (sigismember(ev->ev_args.SIGS.sigs, sig)) {
-                        if (sigismember(&pth_gctx_get()->pth_sigraised, sig)) {
-                            if (ev->ev_args.SIGS.sig != NULL)
-                                *(ev->ev_args.SIGS.sig) = sig;
-                            sigdelset(&pth_gctx_get()->pth_sigraised, sig);
-                            ev->ev_status = PTH_STATUS_OCCURRED;
-                        }
-                    }
-                }
-            }
-        }
-        /*
-         * post-processing for already occurred events
-         */
-        else {
-            /* Condition Variable Signal */
-            if (ev->ev_type == PTH_EVENT_COND) {
-                /* clean signal */
-                if (ev->ev_args.COND.cond->cn_state & PTH_COND_SIGNALED) {
-                    ev->ev_args.COND.cond->cn_state &= ~(PTH_COND_SIGNALED);
-                    ev->ev_args.COND.cond->cn_state &= ~(PTH_COND_BROADCAST);
-                    ev->ev_args.COND.cond->cn_state &= ~(PTH_COND_HANDLED);
-                }
-            }
-        }
+        pth_event_dispatch(readyevs[i].data.fd, readyevs[i].events);
     }
 
     /* for all threads in the waiting queue... */
@@ -967,11 +847,6 @@ intern void pth_sched_eventmanager(pth_time_t *now, int dopoll)
         }
     }
 
-    if(epollfd > -1)
-        close(epollfd);
-    if(readyevs)
-        free(readyevs);
-
     /* perhaps we have to internally loop... */
     if (loop_repeat) {
         pth_time_set(now, PTH_TIME_NOW);
@@ -57,6 +57,8 @@
 #define sendto        __pth_sys_sendto
 #define pread         __pth_sys_pread
 #define pwrite        __pth_sys_pwrite
+#define recvmsg       __pth_sys_recvmsg
+#define sendmsg       __pth_sys_sendmsg
 
 /* include the private header and this way system headers */
 #include "pth_p.h"
@@ -108,6 +110,8 @@ const int pth_syscall_hard = PTH_SYSCALL_HARD;
 #undef sendto
 #undef pread
 #undef pwrite
+#undef recvmsg
+#undef sendmsg
 
 /* internal data structures */
 #if cpp
@@ -157,6 +161,8 @@ intern pth_syscall_fct_tab_t pth_syscall_fct_tab[] = {
 #define PTH_SCF_sendto        19
 #define PTH_SCF_pread         20
 #define PTH_SCF_pwrite        21
+#define PTH_SCF_recvmsg       22
+#define PTH_SCF_sendmsg       23
     { "fork",        NULL },
     { "waitpid",     NULL },
     { "system",      NULL },
@@ -179,6 +185,8 @@ intern pth_syscall_fct_tab_t pth_syscall_fct_tab[] = {
     { "sendto",      NULL },
     { "pread",       NULL },
     { "pwrite",      NULL },
+    { "recvmsg",     NULL },
+    { "sendmsg",     NULL },
     { NULL,          NULL }
 };
 #endif
@@ -721,5 +729,49 @@ intern ssize_t pth_sc_sendto(int fd, const void *buf, size_t nbytes, int flags,
 #endif
 }
 
+/* ==== Pth hard syscall wrapper for recvmsg(2) ==== */
+ssize_t recvmsg(int, struct msghdr *, int);
+ssize_t recvmsg(int fd, struct msghdr *msg, int flags)
+{
+    /* external entry point for application */
+    pth_implicit_init();
+    return pth_recvmsg(fd, msg, flags);
+}
+intern ssize_t pth_sc_recvmsg(int fd, struct msghdr *msg, int flags)
+{
+    /* internal exit point for Pth */
+    if (pth_syscall_fct_tab[PTH_SCF_recvmsg].addr != NULL)
+        return ((ssize_t (*)(int, struct msghdr *, int))
+               pth_syscall_fct_tab[PTH_SCF_recvmsg].addr)
+               (fd, msg, flags);
+#if defined(HAVE_SYSCALL) && defined(SYS_recvmsg)
+    else return (ssize_t)syscall(SYS_recvmsg, fd, msg, flags);
+#else
+    else PTH_SYSCALL_ERROR(-1, ENOSYS, "recvmsg");
+#endif
+}
+
+/* ==== Pth hard syscall wrapper for sendmsg(2) ==== */
+ssize_t sendmsg(int, const struct msghdr *, int);
+ssize_t sendmsg(int fd, const struct msghdr *msg, int flags)
+{
+    /* external entry point for application */
+    pth_implicit_init();
+    return pth_sendmsg(fd, msg, flags);
+}
+intern ssize_t pth_sc_sendmsg(int fd, const struct msghdr *msg, int flags)
+{
+    /* internal exit point for Pth */
+    if (pth_syscall_fct_tab[PTH_SCF_sendmsg].addr != NULL)
+        return ((ssize_t (*)(int, const struct msghdr *, int))
+               pth_syscall_fct_tab[PTH_SCF_sendmsg].addr)
+               (fd, msg, flags);
+#if defined(HAVE_SYSCALL) && defined(SYS_sendmsg)
+    else return (ssize_t)syscall(SYS_sendmsg, fd, msg, flags);
+#else
+    else PTH_SYSCALL_ERROR(-1, ENOSYS, "sendmsg");
+#endif
+}
+
 #endif /* PTH_SYSCALL_HARD */
 
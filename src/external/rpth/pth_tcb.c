@@ -108,13 +108,166 @@ intern const char *pth_state_names[] = {
 #endif
 #endif
 
+/*
+ * Thread stacks are mapped with a guard page below them and committed
+ * by the kernel only as the thread touches them. When a thread is freed
+ * its stack goes to a pool of the calling OS thread, which gives its
+ * pages back to the kernel (MADV_DONTNEED) but keeps the mapping, and the
+ * next thread of the same stack size reuses it. With one OS thread per
+ * simulator worker, the pool is shared by all contexts the worker runs.
+ */
+
+/* how many stacks an OS thread keeps for reuse at most */
+#define PTH_STACKPOOL_MAX 1024
+
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+#ifndef MAP_STACK
+#define MAP_STACK 0
+#endif
+
+struct pth_stack_st {
+    char  *addr;   /* lowest usable address, right above the guard page */
+    size_t size;
+};
+
+struct pth_stackpool_st {
+    struct pth_stack_st *stacks;   /* the pooled stacks, most recently freed last */
+    int nstacks;
+    int maxstacks;
+    pth_stackpool_stats_t stats;
+};
+
+/* like __pth_current_gctx, only ever access this through its address */
+static __thread struct pth_stackpool_st __pth_stackpool;
+
+static struct pth_stackpool_st *pth_stackpool_get(void)
+{
+    struct pth_stackpool_st *pool = &__pth_stackpool;
+    return pool;
+}
+
+static size_t pth_stack_pagesize(void)
+{
+    static size_t pagesize = 0;
+    if (pagesize == 0)
+        pagesize = (size_t)sysconf(_SC_PAGESIZE);
+    return pagesize;
+}
+
+static unsigned long long pth_stack_clock(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+/* get a stack of the given size (a multiple of the page size) */
+static char *pth_stack_acquire(size_t size)
+{
+    struct pth_stackpool_st *pool = pth_stackpool_get();
+    size_t guard = pth_stack_pagesize();
+    char *map;
+    int i;
+
+    /* prefer the most recently freed stacks, their pages are the likeliest to be kept */
+    for (i = pool->nstacks-1; i >= 0; i--) {
+        if (pool->stacks[i].size == size) {
+            map = pool->stacks[i].addr;
+            pool->stacks[i] = pool->stacks[--pool->nstacks];
+            pool->stats.pooled = pool->nstacks;
+            pool->stats.reused++;
+            return map;
+        }
+    }
+
+    map = (char *)mmap(NULL, size + guard, PROT_READ|PROT_WRITE,
+                       MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE|MAP_STACK, -1, 0);
+    if (map == MAP_FAILED)
+        return NULL;
+    if (mprotect(map, guard, PROT_NONE) != 0) {
+        pth_shield { munmap(map, size + guard); }
+        return NULL;
+    }
+    pool->stats.created++;
+    return map + guard;
+}
+
+/* give a stack from pth_stack_acquire() back */
+static void pth_stack_release(char *addr, size_t size)
+{
+    struct pth_stackpool_st *pool = pth_stackpool_get();
+    struct pth_stack_st *stacks;
+    int maxstacks;
+
+    if (pool->nstacks == pool->maxstacks) {
+        maxstacks = pool->maxstacks == 0 ? 16 : pool->maxstacks * 2;
+        if (maxstacks > PTH_STACKPOOL_MAX)
+            maxstacks = PTH_STACKPOOL_MAX;
+        stacks = NULL;
+        if (maxstacks > pool->maxstacks)
+            stacks = realloc(pool->stacks, maxstacks * sizeof(struct pth_stack_st));
+        if (stacks == NULL) {
+            munmap(addr - pth_stack_pagesize(), size + pth_stack_pagesize());
+            return;
+        }
+        pool->stacks = stacks;
+        pool->maxstacks = maxstacks;
+    }
+
+    /* the pages stay mapped but are dropped, so the next thread finds
+       them zero-filled just like a fresh stack; MADV_FREE would leave
+       it either the old contents or zeros, which breaks determinism */
+    madvise(addr, size, MADV_DONTNEED);
+
+    pool->stacks[pool->nstacks].addr = addr;
+    pool->stacks[pool->nstacks].size = size;
+    pool->nstacks++;
+    pool->stats.pooled = pool->nstacks;
+    if (pool->stats.pooled > pool->stats.maxpooled)
+        pool->stats.maxpooled = pool->stats.pooled;
+}
+
+/* report how the stack pool of the calling OS thread was used */
+void pth_stackpool_stats(pth_stackpool_stats_t *stats)
+{
+    if (stats != NULL)
+        *stats = pth_stackpool_get()->stats;
+}
+
+/* unmap the pooled stacks of the calling OS thread, e.g., before it exits */
+void pth_stackpool_free(void)
+{
+    struct pth_stackpool_st *pool = pth_stackpool_get();
+    size_t guard = pth_stack_pagesize();
+    int i;
+
+    for (i = 0; i < pool->nstacks; i++)
+        munmap(pool->stacks[i].addr - guard, pool->stacks[i].size + guard);
+    if (pool->stacks != NULL)
+        free(pool->stacks);
+    pool->stacks = NULL;
+    pool->nstacks = 0;
+    pool->maxstacks = 0;
+    pool->stats.pooled = 0;
+}
+
 /* allocate a thread control block */
 intern pth_t pth_tcb_alloc(unsigned int stacksize, void *stackaddr)
 {
     pth_t t;
+    size_t pagesize;
+    unsigned long long start = 0;
 
     if (stacksize > 0 && stacksize < SIGSTKSZ)
         stacksize = SIGSTKSZ;
+    if (stacksize > 0 && stackaddr == NULL) {
+        /* pooled stacks are whole pages */
+        pagesize = pth_stack_pagesize();
+        stacksize = (unsigned int)((stacksize + pagesize - 1) & ~(pagesize - 1));
+        start = pth_stack_clock();
+    }
     if ((t = (pth_t)calloc(1, sizeof(struct pth_st))) == NULL)
         return NULL;
 
@@ -128,7 +281,7 @@ intern pth_t pth_tcb_alloc(unsigned int stacksize, void *stackaddr)
         if (stackaddr != NULL)
             t->stack = (char *)(stackaddr);
         else {
-            if ((t->stack = (char *)calloc(1, stacksize)) == NULL) {
+            if ((t->stack = pth_stack_acquire(stacksize)) == NULL) {
                 pth_shield { free(t); }
                 return NULL;
             }
@@ -150,6 +303,9 @@ intern pth_t pth_tcb_alloc(unsigned int stacksize, void *stackaddr)
         t->stackguard = (long *)(t->stack+(((stacksize/sizeof(long))-1)*sizeof(long)));
 #endif
         *t->stackguard = 0xDEAD;
+
+        if (!t->stackloan)
+            pth_stackpool_get()->stats.create_ns += pth_stack_clock() - start;
     }
 
     return t;
@@ -158,19 +314,22 @@ intern pth_t pth_tcb_alloc(unsigned int stacksize, void *stackaddr)
 /* free a thread control block */
 intern void pth_tcb_free(pth_t t)
 {
+    struct pth_stackpool_st *pool;
+    unsigned long long start;
+    int pooled = FALSE;
+
     if (t == NULL || t->stackguard == NULL)
         return;
-    if (t->stack != NULL && !t->stackloan) {
-        if(t->stacksize > 0) {
+    start = pth_stack_clock();
+    if (t->stack != NULL && !t->stackloan && t->stacksize > 0) {
+        pooled = TRUE;
 #ifdef PTH_VALGRIND
 #ifdef PTH_DEBUG
-            pth_debug5("pth_tcb_free: freeing stack of size %u at [0x%p-0x%p] with valgrind id %i",
-              t->stacksize, t->stack, &t->stack[t->stacksize], t->valgrind_id);
+        pth_debug5("pth_tcb_free: freeing stack of size %u at [0x%p-0x%p] with valgrind id %i",
+          t->stacksize, t->stack, &t->stack[t->stacksize], t->valgrind_id);
 #endif
 #endif
-            memset(t->stack, 0, (size_t)t->stacksize);
-        }
-        free(t->stack);
+        pth_stack_release(t->stack, (size_t)t->stacksize);
     }
     if (t->data_value != NULL)
         free(t->data_value);
@@ -184,6 +343,11 @@ intern void pth_tcb_free(pth_t t)
 #endif
     memset(t, 0, sizeof(struct pth_st));
     free(t);
+    if (pooled) {
+        pool = pth_stackpool_get();
+        pool->stats.exited++;
+        pool->stats.exit_ns += pth_stack_clock() - start;
+    }
     return;
 }
 
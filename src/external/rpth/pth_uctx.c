@@ -150,14 +150,14 @@ pth_uctx_make(
 
     /* optionally establish temporary signal mask */
     if (sigmask != NULL)
-        sigprocmask(SIG_SETMASK, sigmask, &ss);
+        pth_mctx_sigmask(SIG_SETMASK, sigmask, &ss);
 
     /* perform the trampoline step */
     pth_mctx_switch(&mctx_parent, &(uctx->uc_mctx));
 
     /* optionally restore original signal mask */
     if (sigmask != NULL)
-        sigprocmask(SIG_SETMASK, &ss, NULL);
+        pth_mctx_sigmask(SIG_SETMASK, &ss, NULL);
 
     /* finally flag that the context is now configured */
     uctx->uc_mctx_set = TRUE;
@@ -221,7 +221,9 @@ static gboolean _master_loadTopology(Master* master) {
     }
 
     /* initialize global routing model */
-    master->topology = topology_new(temporaryFilename);
+    /* each worker counts packets on its own, and the serial mode has one worker */
+    guint numPacketCountShards = MAX(1, options_getNWorkerThreads(master->options));
+    master->topology = topology_new(temporaryFilename, numPacketCountShards);
     g_unlink(temporaryFilename);
 
     if(!master->topology) {
@@ -366,6 +368,7 @@ static void _master_registerHostCallback(ConfigurationHostElement* he, Master* m
         params->interfaceBufSize = he->interfacebuffer.isSet ? he->interfacebuffer.integer :
                 options_getInterfaceBufferSize(master->options);
         params->qdisc = options_getQueuingDiscipline(master->options);
+        params->segmentationOffload = options_doSegmentationOffload(master->options);
 
         /* requested attributes from shadow config */
         params->ipHint = he->ipHint.isSet ? he->ipHint.string->str : NULL;
@@ -424,6 +427,15 @@ gint master_run(Master* master) {
     _master_registerPlugins(master);
     _master_registerHosts(master);
 
+    /* now that all hosts are attached, we know every path we may need */
+    if(options_doPrecomputeTopologyPaths(master->options)) {
+        guint nThreads = MAX(1, options_getNWorkerThreads(master->options));
+        gdouble minPathLatency = topology_precomputePaths(master->topology, nThreads);
+        if(minPathLatency > 0) {
+            master_updateMinTimeJump(master, minPathLatency);
+        }
+    }
+
     message("running simulation");
 
     /* dont buffer log messages in debug mode */
@@ -9,21 +9,31 @@
 #include <glib.h>
 #include <math.h>
 #include <pthread.h>
+#include <sched.h>
 #include <stddef.h>
 #include <sys/types.h>
 
 #include "main/core/logger/shadow_logger.h"
 #include "main/core/scheduler/scheduler.h"
+#include "main/core/scheduler/scheduler_lookahead.h"
 #include "main/core/scheduler/scheduler_policy.h"
 #include "main/core/support/definitions.h"
 #include "main/core/work/event.h"
 #include "main/core/worker.h"
 #include "main/host/host.h"
 #include "main/utility/count_down_latch.h"
+#include "main/utility/numa_topology.h"
 #include "main/utility/random.h"
+#include "main/utility/round_barrier.h"
 #include "main/utility/utility.h"
 #include "support/logger/logger.h"
 
+/* padded so that workers counting their own events do not share cache lines */
+typedef struct _SchedulerWorkerCount SchedulerWorkerCount;
+struct _SchedulerWorkerCount {
+    guint64 numEvents;
+} __attribute__((aligned(64)));
+
 struct _Scheduler {
     /* all worker threads used by the scheduler */
     GQueue* threadItems;
@@ -34,12 +44,16 @@ struct _Scheduler {
     /* barrier for worker threads to start and stop running */
     CountDownLatch* startBarrier;
     CountDownLatch* finishBarrier;
+    /* the round barriers are passed by every worker and the main thread in every round.
+     * workers use their thread id as the participant id, and the main thread uses nWorkers. */
+    guint nWorkers;
     /* barrier to wait for worker threads to finish processing this round */
-    CountDownLatch* executeEventsBarrier;
-    /* barrier to wait for worker threads to collect info after a round */
-    CountDownLatch* collectInfoBarrier;
+    RoundBarrier* executeEventsBarrier;
+    /* barrier to wait for worker threads to collect info after a round; it also
+     * computes the minimum next event time over all workers */
+    RoundBarrier* collectInfoBarrier;
     /* barrier to wait for main thread to finish updating for the next round */
-    CountDownLatch* prepareRoundBarrier;
+    RoundBarrier* prepareRoundBarrier;
 
     /* holds a timer for each thread to track how long threads wait for execution barrier */
     GHashTable* threadToWaitTimerMap;
@@ -48,6 +62,33 @@ struct _Scheduler {
     SchedulerPolicy* policy;
     SchedulerPolicyType policyType;
 
+    /* if set, each worker runs up to its own horizon instead of the global window end */
+    SchedulerLookahead* lookahead;
+
+    /* moves hosts from busy to idle workers at round boundaries */
+    struct {
+        /* check the worker loads every this many rounds, or never if 0 */
+        guint interval;
+        /* only rebalance if the busiest worker exceeds the mean load by more than this percent */
+        guint hysteresis;
+        guint roundsSinceCheck;
+        /* maps each Host* to its SchedulerHostLoad */
+        GHashTable* hostLoads;
+        guint64 numChecks;
+        guint64 numRebalances;
+        guint64 numMigrations;
+    } rebalance;
+
+    /* if set, every worker is pinned to one CPU, and workers with adjacent thread ids
+     * are grouped on the same NUMA node */
+    struct {
+        NumaTopology* topology;
+        /* the node of each worker, by thread id */
+        guint* workerNodes;
+        /* the events each worker popped, by thread id */
+        SchedulerWorkerCount* workerEvents;
+    } numa;
+
     /* we store the hosts here */
     GHashTable* hostIDToHostMap;
 
@@ -59,7 +100,6 @@ struct _Scheduler {
     SimulationTime endTime;
     struct {
         SimulationTime endTime;
-        SimulationTime minNextEventTime;
     } currentRound;
 
     /* for memory management */
@@ -67,9 +107,23 @@ struct _Scheduler {
     MAGIC_DECLARE;
 };
 
+typedef struct _SchedulerHostLoad SchedulerHostLoad;
+struct _SchedulerHostLoad {
+    Host* host;
+    /* the host's total execution time when we last checked, in seconds */
+    gdouble lastExecutionTime;
+    /* the execution time since the last check, in seconds */
+    gdouble intervalExecutionTime;
+    /* the events executed since the last check; only the worker running the host writes this */
+    guint64 intervalEvents;
+    /* the number of the check in which we last moved the host, or 0 if we never did */
+    guint64 lastMovedCheck;
+};
+
 typedef struct _SchedulerThreadItem SchedulerThreadItem;
 struct _SchedulerThreadItem {
     pthread_t thread;
+    guint threadID;
     CountDownLatch* notifyDoneRunning;
     CountDownLatch* notifyReadyToJoin;
     CountDownLatch* notifyJoined;
@@ -112,8 +166,58 @@ static void _scheduler_stopHosts(Scheduler* scheduler) {
     }
 }
 
+static void _scheduler_pinWorker(Scheduler* scheduler, pthread_attr_t* attr, guint threadID) {
+    NumaTopology* topology = scheduler->numa.topology;
+
+    /* spread the workers evenly over all CPUs, which are numbered node by node */
+    guint numCPUs = numatopology_getNumCPUs(topology);
+    guint cpuIndex = (guint)(((guint64)threadID * numCPUs) / scheduler->nWorkers);
+    guint node = numatopology_getNodeOfIndex(topology, cpuIndex);
+    gint cpu = numatopology_getCPUOfIndex(topology, cpuIndex);
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    if(pthread_attr_setaffinity_np(attr, sizeof(cpu_set_t), &cpus) != 0) {
+        warning("unable to pin worker %u to CPU %i", threadID, cpu);
+    }
+
+    scheduler->numa.workerNodes[threadID] = node;
+    info("worker %u will run on CPU %i on NUMA node %u", threadID, cpu, node);
+}
+
+/* moves the calling thread to the node of the given worker, so that memory it touches
+ * next is placed on that node */
+static void _scheduler_moveToWorkerNode(Scheduler* scheduler, guint threadID) {
+    guint node = scheduler->numa.workerNodes[threadID];
+    const cpu_set_t* cpus = numatopology_getNodeCPUSet(scheduler->numa.topology, node);
+    if(pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), cpus) != 0) {
+        warning("unable to move the main thread to NUMA node %u", node);
+    }
+}
+
+static void _scheduler_logNodeEvents(Scheduler* scheduler) {
+    guint numNodes = numatopology_getNumNodes(scheduler->numa.topology);
+    guint64* nodeEvents = g_new0(guint64, numNodes);
+    guint* nodeWorkers = g_new0(guint, numNodes);
+
+    for(guint i = 0; i < scheduler->nWorkers; i++) {
+        nodeEvents[scheduler->numa.workerNodes[i]] += scheduler->numa.workerEvents[i].numEvents;
+        nodeWorkers[scheduler->numa.workerNodes[i]]++;
+    }
+
+    for(guint node = 0; node < numNodes; node++) {
+        message("NUMA node %u: %u workers executed %"G_GUINT64_FORMAT" events",
+                node, nodeWorkers[node], nodeEvents[node]);
+    }
+
+    g_free(nodeEvents);
+    g_free(nodeWorkers);
+}
+
 Scheduler* scheduler_new(SchedulerPolicyType policyType, guint nWorkers, gpointer threadUserData,
-        guint schedulerSeed, SimulationTime endTime) {
+        guint schedulerSeed, SimulationTime endTime, EventQueueType queueType, gboolean useInbox,
+        gboolean useLookahead, guint rebalanceInterval, guint rebalanceHysteresis, gboolean pinWorkers) {
     Scheduler* scheduler = g_new0(Scheduler, 1);
     MAGIC_INIT(scheduler);
 
@@ -122,13 +226,13 @@ Scheduler* scheduler_new(SchedulerPolicyType policyType, guint nWorkers, gpointe
 
     scheduler->startBarrier = countdownlatch_new(nWorkers+1);
     scheduler->finishBarrier = countdownlatch_new(nWorkers+1);
-    scheduler->executeEventsBarrier = countdownlatch_new(nWorkers+1);
-    scheduler->collectInfoBarrier = countdownlatch_new(nWorkers+1);
-    scheduler->prepareRoundBarrier = countdownlatch_new(nWorkers+1);
+    scheduler->nWorkers = nWorkers;
+    scheduler->executeEventsBarrier = roundbarrier_new(nWorkers+1);
+    scheduler->collectInfoBarrier = roundbarrier_new(nWorkers+1);
+    scheduler->prepareRoundBarrier = roundbarrier_new(nWorkers+1);
 
     scheduler->endTime = endTime;
     scheduler->currentRound.endTime = scheduler->endTime;// default to one single round
-    scheduler->currentRound.minNextEventTime = SIMTIME_MAX;
 
     scheduler->threadToWaitTimerMap = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)g_timer_destroy);
     scheduler->hostIDToHostMap = g_hash_table_new(g_direct_hash, g_direct_equal);
@@ -147,33 +251,65 @@ Scheduler* scheduler_new(SchedulerPolicyType policyType, guint nWorkers, gpointe
     /* create the configured policy to handle queues */
     switch(scheduler->policyType) {
         case SP_PARALLEL_HOST_SINGLE: {
-            scheduler->policy = schedulerpolicyhostsingle_new();
+            scheduler->policy = schedulerpolicyhostsingle_new(queueType);
             break;
         }
         case SP_PARALLEL_HOST_STEAL: {
-            scheduler->policy = schedulerpolicyhoststeal_new();
+            scheduler->policy = schedulerpolicyhoststeal_new(queueType, useInbox);
             break;
         }
         case SP_PARALLEL_THREAD_SINGLE: {
-            scheduler->policy = schedulerpolicythreadsingle_new();
+            scheduler->policy = schedulerpolicythreadsingle_new(queueType);
             break;
         }
         case SP_PARALLEL_THREAD_PERTHREAD: {
-            scheduler->policy = schedulerpolicythreadperthread_new();
+            scheduler->policy = schedulerpolicythreadperthread_new(queueType);
             break;
         }
         case SP_PARALLEL_THREAD_PERHOST: {
-            scheduler->policy = schedulerpolicythreadperhost_new();
+            scheduler->policy = schedulerpolicythreadperhost_new(queueType, rebalanceInterval > 0);
             break;
         }
         case SP_SERIAL_GLOBAL:
         default: {
-            scheduler->policy = schedulerpolicyglobalsingle_new();
+            scheduler->policy = schedulerpolicyglobalsingle_new(queueType);
             break;
         }
     }
     utility_assert(scheduler->policy);
 
+    if(useLookahead) {
+        /* the horizons are computed from the channels between workers, which
+         * requires that hosts never move to another worker */
+        if(scheduler->policyType == SP_PARALLEL_HOST_SINGLE) {
+            scheduler->lookahead = schedulerlookahead_new(nWorkers, endTime);
+        } else {
+            warning("scheduler lookahead is only supported by the 'host' policy, ignoring it");
+        }
+    }
+
+    if(rebalanceInterval > 0 && nWorkers > 1) {
+        if(scheduler->policy->migrateHost == NULL || scheduler->policy->getHostThread == NULL) {
+            warning("host rebalancing is only supported by the 'host', 'steal', and 'threadXhost' policies, ignoring it");
+        } else if(scheduler->lookahead) {
+            /* the lookahead channels are measured for a fixed host assignment */
+            warning("host rebalancing can not be combined with the scheduler lookahead, ignoring it");
+        } else {
+            scheduler->rebalance.interval = rebalanceInterval;
+            scheduler->rebalance.hysteresis = rebalanceHysteresis;
+            scheduler->rebalance.hostLoads = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+        }
+    }
+
+    if(pinWorkers && nWorkers > 0) {
+        scheduler->numa.topology = numatopology_new();
+        scheduler->numa.workerNodes = g_new0(guint, nWorkers);
+        scheduler->numa.workerEvents = g_new0(SchedulerWorkerCount, nWorkers);
+        message("pinning %u workers to %u CPUs on %u NUMA nodes", nWorkers,
+                numatopology_getNumCPUs(scheduler->numa.topology),
+                numatopology_getNumNodes(scheduler->numa.topology));
+    }
+
     /* make sure our ref count is set before starting the threads */
     scheduler->referenceCount = 1;
 
@@ -186,6 +322,7 @@ Scheduler* scheduler_new(SchedulerPolicyType policyType, guint nWorkers, gpointe
         g_string_printf(name, "worker-%i", (i));
 
         SchedulerThreadItem* item = g_new0(SchedulerThreadItem, 1);
+        item->threadID = (guint)i;
         item->notifyDoneRunning = countdownlatch_new(1);
         item->notifyReadyToJoin = countdownlatch_new(1);
         item->notifyJoined = countdownlatch_new(1);
@@ -198,7 +335,16 @@ Scheduler* scheduler_new(SchedulerPolicyType policyType, guint nWorkers, gpointe
         runData->notifyReadyToJoin = item->notifyReadyToJoin;
         runData->notifyJoined = item->notifyJoined;
 
-        gint returnVal = pthread_create(&(item->thread), NULL, (void*(*)(void*))worker_run, runData);
+        /* pin the thread before it starts, so that everything it allocates is placed
+         * on its own node from the beginning */
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        if(scheduler->numa.topology) {
+            _scheduler_pinWorker(scheduler, &attr, (guint)i);
+        }
+
+        gint returnVal = pthread_create(&(item->thread), &attr, (void*(*)(void*))worker_run, runData);
+        pthread_attr_destroy(&attr);
         if(returnVal != 0) {
             critical("unable to create worker thread");
             return NULL;
@@ -214,6 +360,10 @@ Scheduler* scheduler_new(SchedulerPolicyType policyType, guint nWorkers, gpointe
         shadow_logger_register(shadow_logger_getDefault(), item->thread);
 
         g_string_free(name, TRUE);
+
+        if(scheduler->numa.topology && scheduler->policy->setThreadNode) {
+            scheduler->policy->setThreadNode(scheduler->policy, item->thread, scheduler->numa.workerNodes[i]);
+        }
     }
     message("main scheduler thread will operate with %u worker threads", nWorkers);
 
@@ -269,6 +419,12 @@ static void _scheduler_joinThreads(SchedulerThreadItem* item, Scheduler* schedul
     }
 }
 
+static void _scheduler_logBarrierWaits(RoundBarrier* barrier, const gchar* name) {
+    gchar* histogram = roundbarrier_waitHistogramToString(barrier);
+    message("%s barrier wait histogram: %s", name, histogram);
+    g_free(histogram);
+}
+
 static void _scheduler_free(Scheduler* scheduler) {
     MAGIC_ASSERT(scheduler);
 
@@ -304,12 +460,35 @@ static void _scheduler_free(Scheduler* scheduler) {
 
     g_queue_free(scheduler->threadItems);
 
-    countdownlatch_free(scheduler->executeEventsBarrier);
-    countdownlatch_free(scheduler->collectInfoBarrier);
-    countdownlatch_free(scheduler->prepareRoundBarrier);
+    _scheduler_logBarrierWaits(scheduler->executeEventsBarrier, "execute events");
+    _scheduler_logBarrierWaits(scheduler->collectInfoBarrier, "collect info");
+    _scheduler_logBarrierWaits(scheduler->prepareRoundBarrier, "prepare round");
+
+    roundbarrier_free(scheduler->executeEventsBarrier);
+    roundbarrier_free(scheduler->collectInfoBarrier);
+    roundbarrier_free(scheduler->prepareRoundBarrier);
     countdownlatch_free(scheduler->startBarrier);
     countdownlatch_free(scheduler->finishBarrier);
 
+    if(scheduler->lookahead) {
+        schedulerlookahead_free(scheduler->lookahead);
+    }
+
+    if(scheduler->rebalance.hostLoads) {
+        message("host rebalancing checked the worker loads %"G_GUINT64_FORMAT" times, "
+                "rebalanced %"G_GUINT64_FORMAT" times, and migrated %"G_GUINT64_FORMAT" hosts",
+                scheduler->rebalance.numChecks, scheduler->rebalance.numRebalances,
+                scheduler->rebalance.numMigrations);
+        g_hash_table_destroy(scheduler->rebalance.hostLoads);
+    }
+
+    if(scheduler->numa.topology) {
+        _scheduler_logNodeEvents(scheduler);
+        numatopology_free(scheduler->numa.topology);
+        g_free(scheduler->numa.workerNodes);
+        g_free(scheduler->numa.workerEvents);
+    }
+
     g_mutex_clear(&(scheduler->globalLock));
 
     message("%i worker threads finished", nWorkers);
@@ -350,12 +529,61 @@ gboolean scheduler_push(Scheduler* scheduler, Event* event, Host* sender, Host*
     utility_assert(receiver);
     utility_assert(receiver == event_getHost(event));
 
+    /* events may not show up before the receiver's worker might have run past them */
+    SimulationTime barrier = scheduler->currentRound.endTime;
+    if(scheduler->lookahead) {
+        barrier = schedulerlookahead_getHostHorizon(scheduler->lookahead, receiver);
+    }
+
     /* push to a queue based on the policy */
-    scheduler->policy->push(scheduler->policy, event, sender, receiver, scheduler->currentRound.endTime);
+    scheduler->policy->push(scheduler->policy, event, sender, receiver, barrier);
 
     return TRUE;
 }
 
+gsize scheduler_noteCancelled(Scheduler* scheduler, Host* host) {
+    MAGIC_ASSERT(scheduler);
+    utility_assert(host);
+
+    if(scheduler->policy->noteCancelled) {
+        return scheduler->policy->noteCancelled(scheduler->policy, host);
+    } else {
+        return 0;
+    }
+}
+
+static Event* _scheduler_popFromPolicy(Scheduler* scheduler) {
+    SimulationTime barrier = scheduler->currentRound.endTime;
+    if(scheduler->lookahead) {
+        barrier = schedulerlookahead_getHorizon(scheduler->lookahead, (guint)worker_getThreadID());
+    }
+
+    /* pop from a queue based on the policy */
+    Event* nextEvent = scheduler->policy->pop(scheduler->policy, barrier);
+
+    if(nextEvent != NULL && scheduler->numa.workerEvents) {
+        scheduler->numa.workerEvents[worker_getThreadID()].numEvents++;
+    }
+
+    if(nextEvent != NULL && scheduler->rebalance.hostLoads) {
+        SchedulerHostLoad* load = g_hash_table_lookup(scheduler->rebalance.hostLoads, event_getHost(nextEvent));
+        utility_assert(load);
+        load->intervalEvents++;
+    }
+
+    return nextEvent;
+}
+
+Event* scheduler_tryPop(Scheduler* scheduler) {
+    MAGIC_ASSERT(scheduler);
+
+    /* like scheduler_pop, but returns NULL instead of blocking at the end of the round */
+    if(!scheduler->isRunning) {
+        return NULL;
+    }
+    return _scheduler_popFromPolicy(scheduler);
+}
+
 Event* scheduler_pop(Scheduler* scheduler) {
     MAGIC_ASSERT(scheduler);
 
@@ -363,8 +591,7 @@ Event* scheduler_pop(Scheduler* scheduler) {
      * return NULL only to signal the worker thread to quit */
 
     while(scheduler->isRunning) {
-        /* pop from a queue based on the policy */
-        Event* nextEvent = scheduler->policy->pop(scheduler->policy, scheduler->currentRound.endTime);
+        Event* nextEvent = _scheduler_popFromPolicy(scheduler);
 
         if(nextEvent != NULL) {
             /* we have an event, let the worker run it */
@@ -383,29 +610,32 @@ Event* scheduler_pop(Scheduler* scheduler) {
             if(executeEventsBarrierWaitTime) {
                 g_timer_continue(executeEventsBarrierWaitTime);
             }
-            countdownlatch_countDownAwait(scheduler->executeEventsBarrier);
+            guint participantID = (guint)worker_getThreadID();
+            roundbarrier_await(scheduler->executeEventsBarrier, participantID, SIMTIME_MAX);
             if(executeEventsBarrierWaitTime) {
                 g_timer_stop(executeEventsBarrierWaitTime);
             }
 
             /* now all threads reached the current round end barrier time.
              * asynchronously collect some stats that the main thread will use. */
+            SimulationTime nextTime = SIMTIME_MAX;
             if(scheduler->policy->getNextTime) {
-                SimulationTime nextTime = scheduler->policy->getNextTime(scheduler->policy);
-                g_mutex_lock(&(scheduler->globalLock));
-                scheduler->currentRound.minNextEventTime = MIN(scheduler->currentRound.minNextEventTime, nextTime);
-                g_mutex_unlock(&(scheduler->globalLock));
+                nextTime = scheduler->policy->getNextTime(scheduler->policy);
+            }
+            if(scheduler->lookahead) {
+                schedulerlookahead_setNextEventTime(scheduler->lookahead, participantID, nextTime);
             }
 
             /* clear all log messages from the last round */
             shadow_logger_flushRecords(shadow_logger_getDefault(),
                                        pthread_self());
 
-            /* wait for other threads to finish their collect step */
-            countdownlatch_countDownAwait(scheduler->collectInfoBarrier);
+            /* wait for other threads to finish their collect step; the barrier
+             * hands the minimum next event time to the main thread */
+            roundbarrier_await(scheduler->collectInfoBarrier, participantID, nextTime);
 
             /* now wait for main thread to process a barrier update for the next round */
-            countdownlatch_countDownAwait(scheduler->prepareRoundBarrier);
+            roundbarrier_await(scheduler->prepareRoundBarrier, participantID, SIMTIME_MAX);
         }
     }
 
@@ -471,7 +701,8 @@ static void _scheduler_shuffleQueue(Scheduler* scheduler, GQueue* queue) {
     }
 }
 
-static void _scheduler_assignHostsToThread(Scheduler* scheduler, GQueue* hosts, pthread_t thread, uint maxAssignments) {
+static void _scheduler_assignHostsToThread(Scheduler* scheduler, GQueue* hosts, pthread_t thread, guint threadID,
+        uint maxAssignments) {
     MAGIC_ASSERT(scheduler);
     utility_assert(hosts);
     utility_assert(thread);
@@ -480,7 +711,19 @@ static void _scheduler_assignHostsToThread(Scheduler* scheduler, GQueue* hosts,
     while((maxAssignments == 0 || numAssignments < maxAssignments) && !g_queue_is_empty(hosts)) {
         Host* host = (Host*) g_queue_pop_head(hosts);
         utility_assert(host);
+        if(scheduler->numa.topology) {
+            /* the policy allocates the host's queues, which we want on the worker's node */
+            _scheduler_moveToWorkerNode(scheduler, threadID);
+        }
         scheduler->policy->addHost(scheduler->policy, host, thread);
+        if(scheduler->rebalance.hostLoads) {
+            SchedulerHostLoad* load = g_new0(SchedulerHostLoad, 1);
+            load->host = host;
+            g_hash_table_replace(scheduler->rebalance.hostLoads, host, load);
+        }
+        if(scheduler->lookahead) {
+            schedulerlookahead_assignHost(scheduler->lookahead, host, threadID);
+        }
         numAssignments++;
     }
 }
@@ -496,18 +739,26 @@ static void _scheduler_assignHosts(Scheduler* scheduler) {
 
     guint nThreads = g_queue_get_length(scheduler->threadItems);
 
+    /* we may move between nodes while adding hosts, so remember where we came from */
+    cpu_set_t mainThreadCPUs;
+    if(scheduler->numa.topology) {
+        pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &mainThreadCPUs);
+    }
+
     if(nThreads <= 1) {
         /* either the main thread or the single worker gets everything */
         pthread_t chosen;
+        guint chosenID = 0;
         if(nThreads == 0) {
             chosen = pthread_self();
         } else {
             SchedulerThreadItem* item = g_queue_peek_head(scheduler->threadItems);
             chosen = item->thread;
+            chosenID = item->threadID;
         }
 
         /* assign *all* of the hosts to the chosen thread */
-        _scheduler_assignHostsToThread(scheduler, hosts, chosen, 0);
+        _scheduler_assignHostsToThread(scheduler, hosts, chosen, chosenID, 0);
         utility_assert(g_queue_is_empty(hosts));
     } else {
         /* we need to shuffle the list of hosts to make sure they are randomly assigned */
@@ -518,45 +769,172 @@ static void _scheduler_assignHosts(Scheduler* scheduler) {
             SchedulerThreadItem* item = g_queue_pop_head(scheduler->threadItems);
             pthread_t nextThread = item->thread;
 
-            _scheduler_assignHostsToThread(scheduler, hosts, nextThread, 1);
+            _scheduler_assignHostsToThread(scheduler, hosts, nextThread, item->threadID, 1);
 
             g_queue_push_tail(scheduler->threadItems, item);
         }
     }
 
+    if(scheduler->numa.topology) {
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &mainThreadCPUs);
+    }
+
     if(hosts) {
         g_queue_free(hosts);
     }
     g_mutex_unlock(&scheduler->globalLock);
 }
 
+static guint _scheduler_getThreadIndex(Scheduler* scheduler, pthread_t thread) {
+    for(GList* item = g_queue_peek_head_link(scheduler->threadItems); item != NULL; item = g_list_next(item)) {
+        SchedulerThreadItem* threadItem = item->data;
+        if(pthread_equal(threadItem->thread, thread)) {
+            return threadItem->threadID;
+        }
+    }
+    utility_assert(FALSE);
+    return 0;
+}
+
+static pthread_t _scheduler_getThreadOfIndex(Scheduler* scheduler, guint threadIndex) {
+    for(GList* item = g_queue_peek_head_link(scheduler->threadItems); item != NULL; item = g_list_next(item)) {
+        SchedulerThreadItem* threadItem = item->data;
+        if(threadItem->threadID == threadIndex) {
+            return threadItem->thread;
+        }
+    }
+    utility_assert(FALSE);
+    return 0;
+}
+
+static gint _scheduler_compareHostLoads(gconstpointer a, gconstpointer b) {
+    const SchedulerHostLoad* la = *((SchedulerHostLoad**)a);
+    const SchedulerHostLoad* lb = *((SchedulerHostLoad**)b);
+    GQuark ida = host_getID(la->host);
+    GQuark idb = host_getID(lb->host);
+    return (ida < idb) ? -1 : ((ida > idb) ? 1 : 0);
+}
+
+static guint _scheduler_findWorker(gdouble* workerLoads, guint nWorkers, gboolean findMax) {
+    guint chosen = 0;
+    for(guint i = 1; i < nWorkers; i++) {
+        if(findMax ? (workerLoads[i] > workerLoads[chosen]) : (workerLoads[i] < workerLoads[chosen])) {
+            chosen = i;
+        }
+    }
+    return chosen;
+}
+
+/* moves hosts from the busiest to the least busy workers, measured by the host execution
+ * time since the last check. this must run while all workers are blocked between rounds.
+ * event order does not depend on the assignment, because event sequence numbers are
+ * counted per host and the policies delay all inter-host events to the round barrier. */
 static void _scheduler_rebalanceHosts(Scheduler* scheduler) {
     MAGIC_ASSERT(scheduler);
 
-    // WARNING if this is run, then all existing eventSequenceCounters
-    // need to get set to the max of all existing counters to ensure order correctness
+    guint nWorkers = scheduler->nWorkers;
+    scheduler->rebalance.numChecks++;
 
-    /* get queue of all hosts */
-    GQueue* hosts = g_queue_new();
-    g_hash_table_foreach(scheduler->hostIDToHostMap, (GHFunc)_scheduler_appendHostToQueue, hosts);
+    /* visit hosts in a fixed order so that ties are broken the same way every time */
+    GPtrArray* loads = g_ptr_array_new();
+    GHashTableIter iter;
+    gpointer key = NULL, value = NULL;
+    g_hash_table_iter_init(&iter, scheduler->rebalance.hostLoads);
+    while(g_hash_table_iter_next(&iter, &key, &value)) {
+        g_ptr_array_add(loads, value);
+    }
+    g_ptr_array_sort(loads, _scheduler_compareHostLoads);
 
-    _scheduler_shuffleQueue(scheduler, hosts);
+    gdouble* workerLoads = g_new0(gdouble, nWorkers);
+    guint* hostWorkers = g_new0(guint, loads->len);
+    gdouble totalLoad = 0.0f;
+    guint64 totalEvents = 0;
 
-    /* now that our host order has been randomized, assign them evenly to worker threads */
-    while(!g_queue_is_empty(hosts)) {
-        Host* host = g_queue_pop_head(hosts);
-        SchedulerThreadItem* item = g_queue_pop_head(scheduler->threadItems);
-        pthread_t newThread = item->thread;
+    for(guint i = 0; i < loads->len; i++) {
+        SchedulerHostLoad* load = g_ptr_array_index(loads, i);
 
-//        TODO this needs to get uncommented/updated when migration code is added
-//        scheduler->policy->migrateHost(scheduler->policy, host, newThread);
+        gdouble executionTime = host_getElapsedExecutionTime(load->host);
+        load->intervalExecutionTime = MAX(0.0f, executionTime - load->lastExecutionTime);
+        load->lastExecutionTime = executionTime;
 
-        g_queue_push_tail(scheduler->threadItems, item);
+        pthread_t thread = scheduler->policy->getHostThread(scheduler->policy, load->host);
+        hostWorkers[i] = _scheduler_getThreadIndex(scheduler, thread);
+        workerLoads[hostWorkers[i]] += load->intervalExecutionTime;
+        totalLoad += load->intervalExecutionTime;
+        totalEvents += load->intervalEvents;
     }
 
-    if(hosts) {
-        g_queue_free(hosts);
+    gdouble meanLoad = totalLoad / nWorkers;
+    gdouble threshold = meanLoad * (1.0f + (((gdouble)scheduler->rebalance.hysteresis) / 100.0f));
+    gdouble oldMaxLoad = workerLoads[_scheduler_findWorker(workerLoads, nWorkers, TRUE)];
+
+    guint numMoved = 0;
+    while(totalLoad > 0.0f && numMoved < loads->len) {
+        guint busiest = _scheduler_findWorker(workerLoads, nWorkers, TRUE);
+        guint idlest = _scheduler_findWorker(workerLoads, nWorkers, FALSE);
+        if(workerLoads[busiest] <= threshold) {
+            break;
+        }
+
+        /* moving a host with load x narrows the gap by 2x, so we want x close to gap/2,
+         * but a host larger than the gap would just make the idle worker the busiest one */
+        gdouble gap = workerLoads[busiest] - workerLoads[idlest];
+        gint best = -1;
+        gdouble bestRemainder = gap;
+
+        for(guint i = 0; i < loads->len; i++) {
+            SchedulerHostLoad* load = g_ptr_array_index(loads, i);
+            if(hostWorkers[i] != busiest || load->intervalEvents == 0) {
+                continue;
+            }
+            /* hosts we just moved stay put for one check, so we do not bounce them around */
+            if(load->lastMovedCheck > 0 && load->lastMovedCheck + 1 >= scheduler->rebalance.numChecks) {
+                continue;
+            }
+            gdouble x = load->intervalExecutionTime;
+            if(x <= 0.0f || x >= gap) {
+                continue;
+            }
+            gdouble remainder = ABS(gap - (2 * x));
+            if(remainder < bestRemainder) {
+                bestRemainder = remainder;
+                best = (gint)i;
+            }
+        }
+
+        if(best < 0) {
+            break;
+        }
+
+        SchedulerHostLoad* load = g_ptr_array_index(loads, best);
+        scheduler->policy->migrateHost(scheduler->policy, load->host, _scheduler_getThreadOfIndex(scheduler, idlest));
+        debug("moved host '%s' with load %f seconds from worker %u to worker %u",
+                host_getName(load->host), load->intervalExecutionTime, busiest, idlest);
+
+        workerLoads[busiest] -= load->intervalExecutionTime;
+        workerLoads[idlest] += load->intervalExecutionTime;
+        hostWorkers[best] = idlest;
+        load->lastMovedCheck = scheduler->rebalance.numChecks;
+        numMoved++;
+    }
+
+    if(numMoved > 0) {
+        scheduler->rebalance.numRebalances++;
+        scheduler->rebalance.numMigrations += numMoved;
+        info("rebalanced %u hosts after %"G_GUINT64_FORMAT" events in %u rounds; the busiest worker's load "
+                "went from %f to %f seconds, the mean is %f seconds", numMoved, totalEvents,
+                scheduler->rebalance.interval, oldMaxLoad,
+                workerLoads[_scheduler_findWorker(workerLoads, nWorkers, TRUE)], meanLoad);
     }
+
+    for(guint i = 0; i < loads->len; i++) {
+        SchedulerHostLoad* load = g_ptr_array_index(loads, i);
+        load->intervalEvents = 0;
+    }
+
+    g_free(hostWorkers);
+    g_free(workerLoads);
+    g_ptr_array_free(loads, TRUE);
 }
 
 SchedulerPolicyType scheduler_getPolicy(Scheduler* scheduler) {
@@ -582,11 +960,17 @@ void scheduler_awaitStart(Scheduler* scheduler) {
     /* wait until all threads are waiting to start */
     countdownlatch_countDownAwait(scheduler->startBarrier);
 
+    /* measure the channels to the other workers before anyone sends packets */
+    if(scheduler->lookahead) {
+        GQueue* myHosts = scheduler->policy->getAssignedHosts(scheduler->policy);
+        schedulerlookahead_computeLatencies(scheduler->lookahead, (guint)worker_getThreadID(), myHosts);
+    }
+
     /* each thread will boot their own hosts */
     _scheduler_startHosts(scheduler);
 
     /* everyone is waiting for the next round to be ready */
-    countdownlatch_countDownAwait(scheduler->prepareRoundBarrier);
+    roundbarrier_await(scheduler->prepareRoundBarrier, (guint)worker_getThreadID(), SIMTIME_MAX);
 }
 
 void scheduler_awaitFinish(Scheduler* scheduler) {
@@ -617,35 +1001,48 @@ void scheduler_start(Scheduler* scheduler) {
 void scheduler_continueNextRound(Scheduler* scheduler, SimulationTime windowStart, SimulationTime windowEnd) {
     g_mutex_lock(&scheduler->globalLock);
     scheduler->currentRound.endTime = windowEnd;
-    scheduler->currentRound.minNextEventTime = SIMTIME_MAX;
+    if(scheduler->lookahead && (windowStart == 0 || !schedulerlookahead_isEnabled(scheduler->lookahead))) {
+        /* nobody executed events yet, so we do not know the workers' next event times;
+         * or the runahead delays some packets, which must then arrive when they would in round mode */
+        schedulerlookahead_setAllHorizons(scheduler->lookahead, windowEnd);
+    }
     g_mutex_unlock(&scheduler->globalLock);
 
     if(scheduler->policyType != SP_SERIAL_GLOBAL) {
         /* workers are waiting for preparation of the next round
          * this will cause them to start running events */
-        countdownlatch_countDownAwait(scheduler->prepareRoundBarrier);
+        roundbarrier_await(scheduler->prepareRoundBarrier, scheduler->nWorkers, SIMTIME_MAX);
 
         /* workers are running events now, and will wait at executeEventsBarrier
          * when blocked because there are no more events available in the current round */
-        countdownlatch_reset(scheduler->prepareRoundBarrier);
     }
 }
 
 SimulationTime scheduler_awaitNextRound(Scheduler* scheduler) {
     /* this function is called by the slave main thread */
+    SimulationTime minNextEventTime = SIMTIME_MAX;
+
     if(scheduler->policyType != SP_SERIAL_GLOBAL) {
         /* other workers will also wait at this barrier when they are finished with their events */
-        countdownlatch_countDownAwait(scheduler->executeEventsBarrier);
-        countdownlatch_reset(scheduler->executeEventsBarrier);
-        /* then they collect stats and wait at this barrier */
-        countdownlatch_countDownAwait(scheduler->collectInfoBarrier);
-        countdownlatch_reset(scheduler->collectInfoBarrier);
+        roundbarrier_await(scheduler->executeEventsBarrier, scheduler->nWorkers, SIMTIME_MAX);
+        /* then they collect stats and wait at this barrier, which computes their minimum */
+        minNextEventTime = roundbarrier_await(scheduler->collectInfoBarrier, scheduler->nWorkers, SIMTIME_MAX);
+
+        /* workers are still waiting at the prepare barrier, so nobody reads the horizons */
+        if(scheduler->lookahead) {
+            schedulerlookahead_updateHorizons(scheduler->lookahead);
+        }
+
+        /* for the same reason, nobody is running the hosts that we might move */
+        if(scheduler->rebalance.hostLoads) {
+            scheduler->rebalance.roundsSinceCheck++;
+            if(scheduler->rebalance.roundsSinceCheck >= scheduler->rebalance.interval) {
+                scheduler->rebalance.roundsSinceCheck = 0;
+                _scheduler_rebalanceHosts(scheduler);
+            }
+        }
     }
 
-    SimulationTime minNextEventTime = SIMTIME_MAX;
-    g_mutex_lock(&scheduler->globalLock);
-    minNextEventTime = scheduler->currentRound.minNextEventTime;
-    g_mutex_unlock(&scheduler->globalLock);
     return minNextEventTime;
 }
 
@@ -658,7 +1055,7 @@ void scheduler_finish(Scheduler* scheduler) {
     if(scheduler->policyType != SP_SERIAL_GLOBAL) {
         /* wake up threads from their waiting for the next round.
          * because isRunning is now false, they will all exit and wait at finishBarrier */
-        countdownlatch_countDownAwait(scheduler->prepareRoundBarrier);
+        roundbarrier_await(scheduler->prepareRoundBarrier, scheduler->nWorkers, SIMTIME_MAX);
 
         /* wait for them to be ready to finish */
         countdownlatch_countDownAwait(scheduler->finishBarrier);
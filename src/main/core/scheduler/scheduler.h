@@ -17,7 +17,8 @@
 typedef struct _Scheduler Scheduler;
 
 Scheduler* scheduler_new(SchedulerPolicyType policyType, guint nWorkers, gpointer threadUserData,
-        guint schedulerSeed, SimulationTime endTime);
+        guint schedulerSeed, SimulationTime endTime, EventQueueType queueType, gboolean useInbox,
+        gboolean useLookahead, guint rebalanceInterval, guint rebalanceHysteresis, gboolean pinWorkers);
 void scheduler_ref(Scheduler*);
 void scheduler_unref(Scheduler*);
 void scheduler_shutdown(Scheduler* scheduler);
@@ -31,6 +32,11 @@ void scheduler_finish(Scheduler*);
 
 gboolean scheduler_push(Scheduler*, Event*, Host* sender, Host* receiver);
 Event* scheduler_pop(Scheduler*);
+/* returns the worker's next event in this round, or NULL without blocking if there is none */
+Event* scheduler_tryPop(Scheduler*);
+/* called after the running host cancelled one of its queued tasks; returns how many
+ * cancelled events the policy removed from the host's queue early */
+gsize scheduler_noteCancelled(Scheduler*, Host*);
 
 void scheduler_addHost(Scheduler*, Host*);
 Host* scheduler_getHost(Scheduler*, GQuark);
@@ -0,0 +1,326 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include "main/core/scheduler/scheduler_lookahead.h"
+
+#include <glib.h>
+#include <math.h>
+#include <stddef.h>
+
+#include "main/core/support/definitions.h"
+#include "main/core/support/options.h"
+#include "main/core/worker.h"
+#include "main/host/host.h"
+#include "main/routing/address.h"
+#include "main/routing/topology.h"
+#include "main/utility/round_barrier.h"
+#include "main/utility/utility.h"
+#include "support/logger/logger.h"
+
+/* hosts attached to the same vertex all have the same latencies to everyone else,
+ * but we need two of them to find the latency between distinct hosts on that vertex */
+#define LOOKAHEAD_HOSTS_PER_VERTEX 2
+
+struct _SchedulerLookahead {
+    guint nWorkers;
+    SimulationTime endTime;
+
+    /* maps each Host* to its worker's thread id plus one */
+    GHashTable* hostToWorkerMap;
+
+    /* the hosts of each worker that stand in for all hosts on the same vertex */
+    GPtrArray** representatives;
+    /* lets the workers wait for each other while measuring their channels */
+    RoundBarrier* setupBarrier;
+
+    /* latencies[i * nWorkers + j] is the lookahead of the channel from worker i
+     * to worker j, or SIMTIME_MAX if i never sends anything to j */
+    SimulationTime* latencies;
+    gboolean isClosed;
+    /* set by a worker if the configured runahead delays packets between any of its
+     * channels' hosts; round mode delays those to the end of the global window */
+    gboolean* runAheadDelays;
+    gboolean isEnabled;
+
+    SimulationTime* nextEventTimes;
+    SimulationTime* horizons;
+
+    /* how far the horizons ran ahead of the workers' own next events in total */
+    SimulationTime* totalRunAhead;
+    guint64 numRounds;
+
+    MAGIC_DECLARE;
+};
+
+SchedulerLookahead* schedulerlookahead_new(guint nWorkers, SimulationTime endTime) {
+    utility_assert(nWorkers > 0);
+
+    SchedulerLookahead* lookahead = g_new0(SchedulerLookahead, 1);
+    MAGIC_INIT(lookahead);
+
+    lookahead->nWorkers = nWorkers;
+    lookahead->endTime = endTime;
+    lookahead->hostToWorkerMap = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+    lookahead->representatives = g_new0(GPtrArray*, nWorkers);
+    for(guint i = 0; i < nWorkers; i++) {
+        lookahead->representatives[i] = g_ptr_array_new();
+    }
+    lookahead->setupBarrier = roundbarrier_new(nWorkers);
+
+    lookahead->latencies = g_new(SimulationTime, nWorkers * nWorkers);
+    lookahead->runAheadDelays = g_new0(gboolean, nWorkers);
+    lookahead->isEnabled = TRUE;
+    for(guint i = 0; i < nWorkers * nWorkers; i++) {
+        lookahead->latencies[i] = SIMTIME_MAX;
+    }
+
+    lookahead->nextEventTimes = g_new(SimulationTime, nWorkers);
+    lookahead->horizons = g_new(SimulationTime, nWorkers);
+    lookahead->totalRunAhead = g_new0(SimulationTime, nWorkers);
+    for(guint i = 0; i < nWorkers; i++) {
+        lookahead->nextEventTimes[i] = SIMTIME_MAX;
+        lookahead->horizons[i] = 0;
+    }
+
+    return lookahead;
+}
+
+void schedulerlookahead_free(SchedulerLookahead* lookahead) {
+    MAGIC_ASSERT(lookahead);
+
+    for(guint i = 0; i < lookahead->nWorkers; i++) {
+        gdouble avgRunAheadMS = 0.0f;
+        if(lookahead->numRounds > 0) {
+            avgRunAheadMS = ((gdouble)lookahead->totalRunAhead[i]) /
+                    ((gdouble)lookahead->numRounds) / ((gdouble)SIMTIME_ONE_MILLISECOND);
+        }
+        message("lookahead for worker %u: average window %f milliseconds over %"G_GUINT64_FORMAT" rounds",
+                i, avgRunAheadMS, lookahead->numRounds);
+    }
+
+    for(guint i = 0; i < lookahead->nWorkers; i++) {
+        g_ptr_array_free(lookahead->representatives[i], TRUE);
+    }
+    g_free(lookahead->representatives);
+    roundbarrier_free(lookahead->setupBarrier);
+    g_hash_table_destroy(lookahead->hostToWorkerMap);
+
+    g_free(lookahead->latencies);
+    g_free(lookahead->runAheadDelays);
+    g_free(lookahead->nextEventTimes);
+    g_free(lookahead->horizons);
+    g_free(lookahead->totalRunAhead);
+
+    MAGIC_CLEAR(lookahead);
+    g_free(lookahead);
+}
+
+void schedulerlookahead_assignHost(SchedulerLookahead* lookahead, Host* host, guint workerID) {
+    MAGIC_ASSERT(lookahead);
+    utility_assert(workerID < lookahead->nWorkers);
+    g_hash_table_replace(lookahead->hostToWorkerMap, host, GUINT_TO_POINTER(workerID + 1));
+}
+
+static void _schedulerlookahead_chooseRepresentatives(SchedulerLookahead* lookahead, guint workerID, GQueue* hosts) {
+    Topology* topology = worker_getTopology();
+    GPtrArray* representatives = lookahead->representatives[workerID];
+
+    /* maps the vertex index to the number of representatives we chose on it */
+    GHashTable* vertexCounts = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+    for(GList* item = hosts ? g_queue_peek_head_link(hosts) : NULL; item != NULL; item = g_list_next(item)) {
+        Host* host = item->data;
+        gint vertexIndex = topology_getAttachedVertexIndex(topology, host_getDefaultAddress(host));
+
+        /* offset by one so that vertex 0 is not confused with a missing entry */
+        gpointer key = GINT_TO_POINTER(vertexIndex + 1);
+        guint count = GPOINTER_TO_UINT(g_hash_table_lookup(vertexCounts, key));
+        if(count < LOOKAHEAD_HOSTS_PER_VERTEX) {
+            g_ptr_array_add(representatives, host);
+            g_hash_table_replace(vertexCounts, key, GUINT_TO_POINTER(count + 1));
+        }
+    }
+
+    g_hash_table_destroy(vertexCounts);
+}
+
+static SimulationTime _schedulerlookahead_measureChannel(GPtrArray* sources, GPtrArray* destinations,
+        SimulationTime minLatency, gboolean* runAheadDelays) {
+    Topology* topology = worker_getTopology();
+    SimulationTime channelLatency = SIMTIME_MAX;
+
+    for(guint i = 0; i < sources->len; i++) {
+        Host* src = g_ptr_array_index(sources, i);
+        for(guint j = 0; j < destinations->len; j++) {
+            Host* dst = g_ptr_array_index(destinations, j);
+            if(src == dst) {
+                /* events a host sends to itself are never delayed by the scheduler */
+                continue;
+            }
+
+            gdouble latency = topology_getLatency(topology, host_getDefaultAddress(src), host_getDefaultAddress(dst));
+            if(latency < 0) {
+                /* no path, so no packets will ever use this pair */
+                continue;
+            }
+
+            /* this is exactly how the worker computes the packet delivery delay */
+            SimulationTime delay = (SimulationTime) ceil(latency * SIMTIME_ONE_MILLISECOND);
+            if(delay < minLatency) {
+                *runAheadDelays = TRUE;
+            }
+            channelLatency = MIN(channelLatency, MAX(delay, minLatency));
+        }
+    }
+
+    return channelLatency;
+}
+
+void schedulerlookahead_computeLatencies(SchedulerLookahead* lookahead, guint workerID, GQueue* hosts) {
+    MAGIC_ASSERT(lookahead);
+    utility_assert(workerID < lookahead->nWorkers);
+
+    _schedulerlookahead_chooseRepresentatives(lookahead, workerID, hosts);
+
+    /* wait until everyone chose their representatives before reading them */
+    roundbarrier_await(lookahead->setupBarrier, workerID, SIMTIME_MAX);
+
+    /* a configured runahead delays events that arrive earlier, so it also bounds every channel.
+     * a zero latency channel would stop the receiving worker from making progress. */
+    SimulationTime minLatency = MAX(1, ((SimulationTime)options_getMinRunAhead(worker_getOptions())) * SIMTIME_ONE_MILLISECOND);
+
+    /* each worker fills in the channels from itself to everyone else */
+    for(guint j = 0; j < lookahead->nWorkers; j++) {
+        lookahead->latencies[workerID * lookahead->nWorkers + j] = _schedulerlookahead_measureChannel(
+                lookahead->representatives[workerID], lookahead->representatives[j], minLatency,
+                &lookahead->runAheadDelays[workerID]);
+    }
+
+    /* wait until all channels were measured */
+    roundbarrier_await(lookahead->setupBarrier, workerID, SIMTIME_MAX);
+}
+
+static SimulationTime _schedulerlookahead_add(SimulationTime a, SimulationTime b) {
+    /* saturate at SIMTIME_MAX, which stands for infinity */
+    if(a == SIMTIME_MAX || b == SIMTIME_MAX || a > SIMTIME_MAX - b) {
+        return SIMTIME_MAX;
+    }
+    return a + b;
+}
+
+/* the direct channel from i to j may have a larger latency than a path through
+ * other workers. the horizons only stay monotonic if every channel is bounded by
+ * every such path, so we take the closure of the latency matrix. */
+static void _schedulerlookahead_closeLatencies(SchedulerLookahead* lookahead) {
+    guint n = lookahead->nWorkers;
+    SimulationTime* latencies = lookahead->latencies;
+
+    for(guint k = 0; k < n; k++) {
+        for(guint i = 0; i < n; i++) {
+            if(latencies[i * n + k] == SIMTIME_MAX) {
+                continue;
+            }
+            for(guint j = 0; j < n; j++) {
+                SimulationTime viaK = _schedulerlookahead_add(latencies[i * n + k], latencies[k * n + j]);
+                if(viaK < latencies[i * n + j]) {
+                    latencies[i * n + j] = viaK;
+                }
+            }
+        }
+    }
+
+    for(guint i = 0; i < n; i++) {
+        GString* row = g_string_new(NULL);
+        for(guint j = 0; j < n; j++) {
+            if(latencies[i * n + j] == SIMTIME_MAX) {
+                g_string_append(row, " inf");
+            } else {
+                g_string_append_printf(row, " %"G_GUINT64_FORMAT, latencies[i * n + j]);
+            }
+        }
+        info("lookahead from worker %u to each worker in nanoseconds:%s", i, row->str);
+        g_string_free(row, TRUE);
+    }
+
+    lookahead->isClosed = TRUE;
+
+    /* round mode delays such packets to the end of the global window, and a worker
+     * running up to its own horizon would deliver them at a different time */
+    for(guint i = 0; i < n; i++) {
+        if(lookahead->runAheadDelays[i]) {
+            lookahead->isEnabled = FALSE;
+        }
+    }
+    if(!lookahead->isEnabled) {
+        warning("the configured runahead is larger than the latency between some hosts, "
+                "so the lookahead can not keep the event order of the global window; ignoring it");
+    }
+}
+
+void schedulerlookahead_setAllHorizons(SchedulerLookahead* lookahead, SimulationTime horizon) {
+    MAGIC_ASSERT(lookahead);
+    for(guint i = 0; i < lookahead->nWorkers; i++) {
+        lookahead->horizons[i] = MIN(horizon, lookahead->endTime);
+    }
+}
+
+void schedulerlookahead_setNextEventTime(SchedulerLookahead* lookahead, guint workerID, SimulationTime nextTime) {
+    MAGIC_ASSERT(lookahead);
+    utility_assert(workerID < lookahead->nWorkers);
+    lookahead->nextEventTimes[workerID] = nextTime;
+}
+
+void schedulerlookahead_updateHorizons(SchedulerLookahead* lookahead) {
+    MAGIC_ASSERT(lookahead);
+
+    if(!lookahead->isClosed) {
+        _schedulerlookahead_closeLatencies(lookahead);
+    }
+    if(!lookahead->isEnabled) {
+        /* the scheduler keeps the horizons at the end of the global window */
+        return;
+    }
+
+    guint n = lookahead->nWorkers;
+    for(guint j = 0; j < n; j++) {
+        /* the earliest time at which any unexecuted event could reach one of j's hosts */
+        SimulationTime horizon = SIMTIME_MAX;
+        for(guint i = 0; i < n; i++) {
+            SimulationTime arrival = _schedulerlookahead_add(lookahead->nextEventTimes[i], lookahead->latencies[i * n + j]);
+            horizon = MIN(horizon, arrival);
+        }
+        horizon = MIN(horizon, lookahead->endTime);
+
+        /* events we already executed can not send anything to the past */
+        utility_assert(horizon >= lookahead->horizons[j]);
+        lookahead->horizons[j] = horizon;
+
+        SimulationTime nextTime = lookahead->nextEventTimes[j];
+        if(nextTime < horizon) {
+            lookahead->totalRunAhead[j] += horizon - nextTime;
+        }
+    }
+
+    lookahead->numRounds++;
+}
+
+gboolean schedulerlookahead_isEnabled(SchedulerLookahead* lookahead) {
+    MAGIC_ASSERT(lookahead);
+    return lookahead->isEnabled;
+}
+
+SimulationTime schedulerlookahead_getHorizon(SchedulerLookahead* lookahead, guint workerID) {
+    MAGIC_ASSERT(lookahead);
+    utility_assert(workerID < lookahead->nWorkers);
+    return lookahead->horizons[workerID];
+}
+
+SimulationTime schedulerlookahead_getHostHorizon(SchedulerLookahead* lookahead, Host* host) {
+    MAGIC_ASSERT(lookahead);
+    guint workerIDPlusOne = GPOINTER_TO_UINT(g_hash_table_lookup(lookahead->hostToWorkerMap, host));
+    utility_assert(workerIDPlusOne > 0);
+    return lookahead->horizons[workerIDPlusOne - 1];
+}
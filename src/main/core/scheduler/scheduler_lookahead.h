@@ -0,0 +1,56 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#ifndef SHD_SCHEDULER_LOOKAHEAD_H_
+#define SHD_SCHEDULER_LOOKAHEAD_H_
+
+#include <glib.h>
+
+#include "main/core/support/definitions.h"
+#include "main/host/host.h"
+
+/* Tracks how far each worker may safely run ahead of the others, for policies that
+ * statically assign hosts to workers. Every pair of workers (i, j) is treated as a
+ * channel whose lookahead is the smallest packet latency from any host of worker i
+ * to any other host of worker j. At each round boundary, worker j may run up to
+ * the minimum over all i of (next event time of worker i + lookahead of channel i->j),
+ * since no event that is still to be executed can reach j's hosts any earlier.
+ *
+ * Workers that only talk to each other over long paths thus get larger windows than
+ * the single global window that is bounded by the smallest latency in the topology. */
+typedef struct _SchedulerLookahead SchedulerLookahead;
+
+SchedulerLookahead* schedulerlookahead_new(guint nWorkers, SimulationTime endTime);
+void schedulerlookahead_free(SchedulerLookahead* lookahead);
+
+/* records that the host is run by the worker with the given thread id. this must be
+ * called for all hosts before the workers start. */
+void schedulerlookahead_assignHost(SchedulerLookahead* lookahead, Host* host, guint workerID);
+
+/* must be called by every worker thread, with the hosts assigned to it, after all
+ * hosts were assigned and before any events are executed; it blocks until all
+ * workers measured the latencies of their channels. */
+void schedulerlookahead_computeLatencies(SchedulerLookahead* lookahead, guint workerID, GQueue* hosts);
+
+/* sets the horizon of every worker to the end of the given window; used for the
+ * first round, before we know the time of any worker's next event */
+void schedulerlookahead_setAllHorizons(SchedulerLookahead* lookahead, SimulationTime horizon);
+/* called by each worker before it enters the barrier at the end of a round */
+void schedulerlookahead_setNextEventTime(SchedulerLookahead* lookahead, guint workerID, SimulationTime nextTime);
+/* called by a single thread after all workers set their next event time */
+void schedulerlookahead_updateHorizons(SchedulerLookahead* lookahead);
+
+/* FALSE once the channels were measured if the configured runahead is larger than the
+ * latency between some hosts. round mode delays the events on those paths to the end of
+ * the global window, which depends on the next event times of all workers, so then the
+ * horizons must follow the global window to keep the same event order. */
+gboolean schedulerlookahead_isEnabled(SchedulerLookahead* lookahead);
+
+/* the time before which the worker may execute events in the current round */
+SimulationTime schedulerlookahead_getHorizon(SchedulerLookahead* lookahead, guint workerID);
+/* the horizon of the worker that runs the given host */
+SimulationTime schedulerlookahead_getHostHorizon(SchedulerLookahead* lookahead, Host* host);
+
+#endif /* SHD_SCHEDULER_LOOKAHEAD_H_ */
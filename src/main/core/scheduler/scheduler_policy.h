@@ -7,6 +7,7 @@
 #define SHD_SCHEDULER_POLICY_H_
 
 #include "main/core/work/event.h"
+#include "main/core/work/event_queue.h"
 #include "main/host/host.h"
 
 typedef enum {
@@ -15,7 +16,8 @@ typedef enum {
     /* every host has a locked pqueue into which every thread inserts events,
      * max queue contention is N for N threads */
     SP_PARALLEL_HOST_SINGLE,
-    /* modified version of SP_PARALLEL_HOST_SINGLE that implements work stealing */
+    /* modified version of SP_PARALLEL_HOST_SINGLE that implements work stealing,
+     * optionally with lock-free per-host inboxes for cross-host pushes */
     SP_PARALLEL_HOST_STEAL,
     /* every thread has a locked pqueue into which every thread inserts events,
      * max queue contention is N for N threads */
@@ -35,6 +37,10 @@ typedef GQueue* (*SchedulerPolicyGetHostsFunc)(SchedulerPolicy*);
 typedef void (*SchedulerPolicyPushFunc)(SchedulerPolicy*, Event*, Host*, Host*, SimulationTime);
 typedef Event* (*SchedulerPolicyPopFunc)(SchedulerPolicy*, SimulationTime);
 typedef SimulationTime (*SchedulerPolicyGetNextTimeFunc)(SchedulerPolicy*);
+typedef pthread_t (*SchedulerPolicyGetHostThreadFunc)(SchedulerPolicy*, Host*);
+typedef void (*SchedulerPolicyMigrateHostFunc)(SchedulerPolicy*, Host*, pthread_t);
+typedef gsize (*SchedulerPolicyNoteCancelledFunc)(SchedulerPolicy*, Host*);
+typedef void (*SchedulerPolicySetThreadNodeFunc)(SchedulerPolicy*, pthread_t, guint);
 typedef void (*SchedulerPolicyFreeFunc)(SchedulerPolicy*);
 
 struct _SchedulerPolicy {
@@ -46,15 +52,27 @@ struct _SchedulerPolicy {
     SchedulerPolicyPushFunc push;
     SchedulerPolicyPopFunc pop;
     SchedulerPolicyGetNextTimeFunc getNextTime;
+    /* optional; policies that can move hosts between threads at round boundaries
+     * implement these, and they may only be called while all workers are blocked */
+    SchedulerPolicyGetHostThreadFunc getHostThread;
+    SchedulerPolicyMigrateHostFunc migrateHost;
+    /* optional; called by the thread running the host after the host cancelled one of
+     * its own queued tasks. policies whose queues only hold events of a single host
+     * implement it to purge cancelled events early, and return how many they purged.
+     * without it, cancelled events are only dropped when they are executed. */
+    SchedulerPolicyNoteCancelledFunc noteCancelled;
+    /* optional; tells the policy on which NUMA node a worker thread runs, before any
+     * hosts are added. stealing policies use it to prefer victims on the same node. */
+    SchedulerPolicySetThreadNodeFunc setThreadNode;
     SchedulerPolicyFreeFunc free;
     MAGIC_DECLARE;
 };
 
-SchedulerPolicy* schedulerpolicyglobalsingle_new();
-SchedulerPolicy* schedulerpolicyhostsingle_new();
-SchedulerPolicy* schedulerpolicyhoststeal_new();
-SchedulerPolicy* schedulerpolicythreadsingle_new();
-SchedulerPolicy* schedulerpolicythreadperthread_new();
-SchedulerPolicy* schedulerpolicythreadperhost_new();
+SchedulerPolicy* schedulerpolicyglobalsingle_new(EventQueueType queueType);
+SchedulerPolicy* schedulerpolicyhostsingle_new(EventQueueType queueType);
+SchedulerPolicy* schedulerpolicyhoststeal_new(EventQueueType queueType, gboolean useInbox);
+SchedulerPolicy* schedulerpolicythreadsingle_new(EventQueueType queueType);
+SchedulerPolicy* schedulerpolicythreadperthread_new(EventQueueType queueType);
+SchedulerPolicy* schedulerpolicythreadperhost_new(EventQueueType queueType, gboolean allowMigration);
 
 #endif /* SHD_SCHEDULER_POLICY_H_ */
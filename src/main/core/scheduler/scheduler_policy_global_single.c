@@ -10,13 +10,13 @@
 #include "main/core/scheduler/scheduler_policy.h"
 #include "main/core/support/definitions.h"
 #include "main/core/work/event.h"
+#include "main/core/work/event_queue.h"
 #include "main/host/host.h"
-#include "main/utility/priority_queue.h"
 #include "main/utility/utility.h"
 
 typedef struct _GlobalSinglePolicyData GlobalSinglePolicyData;
 struct _GlobalSinglePolicyData {
-    PriorityQueue* pq;
+    EventQueue* pq;
     SimulationTime lastEventTime;
     gsize nPushed;
     gsize nPopped;
@@ -40,14 +40,14 @@ static GQueue* _schedulerpolicyglobalsingle_getHosts(SchedulerPolicy* policy) {
 static void _schedulerpolicyglobalsingle_push(SchedulerPolicy* policy, Event* event, Host* srcHost, Host* dstHost, SimulationTime barrier) {
     MAGIC_ASSERT(policy);
     GlobalSinglePolicyData* data = policy->data;
-    priorityqueue_push(data->pq, event);
+    eventqueue_push(data->pq, event);
 }
 
 static Event* _schedulerpolicyglobalsingle_pop(SchedulerPolicy* policy, SimulationTime barrier) {
     MAGIC_ASSERT(policy);
     GlobalSinglePolicyData* data = policy->data;
 
-    Event* nextEvent = priorityqueue_peek(data->pq);
+    Event* nextEvent = eventqueue_peek(data->pq);
     if(!nextEvent) {
         return NULL;
     }
@@ -60,13 +60,13 @@ static Event* _schedulerpolicyglobalsingle_pop(SchedulerPolicy* policy, Simulati
     utility_assert(eventTime >= data->lastEventTime);
     data->lastEventTime = eventTime;
 
-    return priorityqueue_pop(data->pq);
+    return eventqueue_pop(data->pq);
 }
 
 static SimulationTime _schedulerpolicyglobalsingle_getNextTime(SchedulerPolicy* policy) {
     MAGIC_ASSERT(policy);
     GlobalSinglePolicyData* data = policy->data;
-    Event* nextEvent = priorityqueue_peek(data->pq);
+    Event* nextEvent = eventqueue_peek(data->pq);
     return (nextEvent != NULL) ? event_getTime(nextEvent) : SIMTIME_MAX;
 }
 
@@ -75,7 +75,7 @@ static void _schedulerpolicyglobalsingle_free(SchedulerPolicy* policy) {
     GlobalSinglePolicyData* data = policy->data;
 
     if(data->pq) {
-        priorityqueue_free(data->pq);
+        eventqueue_free(data->pq);
     }
     if(data->assignedHosts) {
         g_queue_free(data->assignedHosts);
@@ -86,9 +86,9 @@ static void _schedulerpolicyglobalsingle_free(SchedulerPolicy* policy) {
     g_free(policy);
 }
 
-SchedulerPolicy* schedulerpolicyglobalsingle_new() {
+SchedulerPolicy* schedulerpolicyglobalsingle_new(EventQueueType queueType) {
     GlobalSinglePolicyData* data = g_new0(GlobalSinglePolicyData, 1);
-    data->pq = priorityqueue_new((GCompareDataFunc)event_compare, NULL, (GDestroyNotify)event_unref);
+    data->pq = eventqueue_new(queueType);
     data->assignedHosts = g_queue_new();
 
     SchedulerPolicy* policy = g_new0(SchedulerPolicy, 1);
@@ -10,15 +10,15 @@
 #include "main/core/scheduler/scheduler_policy.h"
 #include "main/core/support/definitions.h"
 #include "main/core/work/event.h"
+#include "main/core/work/event_queue.h"
 #include "main/host/host.h"
-#include "main/utility/priority_queue.h"
 #include "main/utility/utility.h"
 #include "support/logger/logger.h"
 
 typedef struct _HostSingleQueueData HostSingleQueueData;
 struct _HostSingleQueueData {
     GMutex lock;
-    PriorityQueue* pq;
+    EventQueue* pq;
     SimulationTime lastEventTime;
     gsize nPushed;
     gsize nPopped;
@@ -42,6 +42,7 @@ struct _HostSinglePolicyData {
     GHashTable* hostToQueueDataMap;
     GHashTable* threadToThreadDataMap;
     GHashTable* hostToThreadMap;
+    EventQueueType queueType;
     MAGIC_DECLARE;
 };
 
@@ -97,11 +98,11 @@ static void _hostsinglethreaddata_free(HostSingleThreadData* tdata) {
     }
 }
 
-static HostSingleQueueData* _hostsinglequeuedata_new() {
+static HostSingleQueueData* _hostsinglequeuedata_new(EventQueueType queueType) {
     HostSingleQueueData* qdata = g_new0(HostSingleQueueData, 1);
 
     g_mutex_init(&(qdata->lock));
-    qdata->pq = priorityqueue_new((GCompareDataFunc)event_compare, NULL, (GDestroyNotify)event_unref);
+    qdata->pq = eventqueue_new(queueType);
 
     return qdata;
 }
@@ -109,7 +110,7 @@ static HostSingleQueueData* _hostsinglequeuedata_new() {
 static void _hostsinglequeuedata_free(HostSingleQueueData* qdata) {
     if(qdata) {
         if(qdata->pq) {
-            priorityqueue_free(qdata->pq);
+            eventqueue_free(qdata->pq);
         }
         g_mutex_clear(&(qdata->lock));
         g_free(qdata);
@@ -123,7 +124,7 @@ static void _schedulerpolicyhostsingle_addHost(SchedulerPolicy* policy, Host* ho
 
     /* each host has its own queue */
     if(!g_hash_table_lookup(data->hostToQueueDataMap, host)) {
-        g_hash_table_replace(data->hostToQueueDataMap, host, _hostsinglequeuedata_new());
+        g_hash_table_replace(data->hostToQueueDataMap, host, _hostsinglequeuedata_new(data->queueType));
     }
 
     /* each thread keeps track of the hosts it needs to run */
@@ -139,6 +140,57 @@ static void _schedulerpolicyhostsingle_addHost(SchedulerPolicy* policy, Host* ho
     g_hash_table_replace(data->hostToThreadMap, host, GUINT_TO_POINTER(assignedThread));
 }
 
+static gsize _schedulerpolicyhostsingle_noteCancelled(SchedulerPolicy* policy, Host* host) {
+    MAGIC_ASSERT(policy);
+    HostSinglePolicyData* data = policy->data;
+
+    HostSingleQueueData* qdata = g_hash_table_lookup(data->hostToQueueDataMap, host);
+    utility_assert(qdata);
+
+    GPtrArray* purged = g_ptr_array_new();
+
+    g_mutex_lock(&(qdata->lock));
+    eventqueue_noteCancelled(qdata->pq, purged);
+    g_mutex_unlock(&(qdata->lock));
+
+    /* the events may hold the last references to objects of the running host,
+     * so we release them outside of the queue lock */
+    gsize numPurged = purged->len;
+    g_ptr_array_set_free_func(purged, (GDestroyNotify)event_unref);
+    g_ptr_array_free(purged, TRUE);
+
+    return numPurged;
+}
+
+static pthread_t _schedulerpolicyhostsingle_getHostThread(SchedulerPolicy* policy, Host* host) {
+    MAGIC_ASSERT(policy);
+    HostSinglePolicyData* data = policy->data;
+    return (pthread_t)GPOINTER_TO_UINT(g_hash_table_lookup(data->hostToThreadMap, host));
+}
+
+/* this must be run while all workers are blocked between rounds */
+static void _schedulerpolicyhostsingle_migrateHost(SchedulerPolicy* policy, Host* host, pthread_t newThread) {
+    MAGIC_ASSERT(policy);
+    HostSinglePolicyData* data = policy->data;
+
+    pthread_t oldThread = _schedulerpolicyhostsingle_getHostThread(policy, host);
+    if(pthread_equal(oldThread, newThread)) {
+        return;
+    }
+
+    /* the host's events stay in its own queue, we only need to move the host itself */
+    HostSingleThreadData* tdata = g_hash_table_lookup(data->threadToThreadDataMap, GUINT_TO_POINTER(oldThread));
+    if(tdata) {
+        g_queue_remove(tdata->unprocessedHosts, host);
+        g_queue_remove(tdata->processedHosts, host);
+    }
+
+    /* migrate the TLS of all objects associated with this host */
+    host_migrate(host, &oldThread, &newThread);
+
+    _schedulerpolicyhostsingle_addHost(policy, host, newThread);
+}
+
 static void concat_queue_iter(Host* hostItem, GQueue* userQueue) {
     g_queue_push_tail(userQueue, hostItem);
 }
@@ -200,7 +252,7 @@ static void _schedulerpolicyhostsingle_push(SchedulerPolicy* policy, Event* even
     }
 
     /* 'deliver' the event to the destination queue */
-    priorityqueue_push(qdata->pq, event);
+    eventqueue_push(qdata->pq, event);
     qdata->nPushed++;
 
     /* release the destination queue lock */
@@ -244,13 +296,13 @@ static Event* _schedulerpolicyhostsingle_pop(SchedulerPolicy* policy, Simulation
         g_mutex_lock(&(qdata->lock));
         g_timer_stop(tdata->popIdleTime);
 
-        Event* nextEvent = priorityqueue_peek(qdata->pq);
+        Event* nextEvent = eventqueue_peek(qdata->pq);
         SimulationTime eventTime = (nextEvent != NULL) ? event_getTime(nextEvent) : SIMTIME_INVALID;
 
         if(nextEvent != NULL && eventTime < barrier) {
             utility_assert(eventTime >= qdata->lastEventTime);
             qdata->lastEventTime = eventTime;
-            nextEvent = priorityqueue_pop(qdata->pq);
+            nextEvent = eventqueue_pop(qdata->pq);
             qdata->nPopped++;
         } else {
             nextEvent = NULL;
@@ -275,7 +327,7 @@ static void _schedulerpolicyhostsingle_findMinTime(Host* host, HostSingleSearchS
     utility_assert(qdata);
 
     g_mutex_lock(&(qdata->lock));
-    Event* event = priorityqueue_peek(qdata->pq);
+    Event* event = eventqueue_peek(qdata->pq);
     g_mutex_unlock(&(qdata->lock));
 
     if(event != NULL) {
@@ -317,8 +369,9 @@ static void _schedulerpolicyhostsingle_free(SchedulerPolicy* policy) {
     g_free(policy);
 }
 
-SchedulerPolicy* schedulerpolicyhostsingle_new() {
+SchedulerPolicy* schedulerpolicyhostsingle_new(EventQueueType queueType) {
     HostSinglePolicyData* data = g_new0(HostSinglePolicyData, 1);
+    data->queueType = queueType;
     data->hostToQueueDataMap = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)_hostsinglequeuedata_free);
     data->threadToThreadDataMap = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)_hostsinglethreaddata_free);
     data->hostToThreadMap = g_hash_table_new(g_direct_hash, g_direct_equal);
@@ -330,6 +383,9 @@ SchedulerPolicy* schedulerpolicyhostsingle_new() {
     policy->push = _schedulerpolicyhostsingle_push;
     policy->pop = _schedulerpolicyhostsingle_pop;
     policy->getNextTime = _schedulerpolicyhostsingle_getNextTime;
+    policy->getHostThread = _schedulerpolicyhostsingle_getHostThread;
+    policy->migrateHost = _schedulerpolicyhostsingle_migrateHost;
+    policy->noteCancelled = _schedulerpolicyhostsingle_noteCancelled;
     policy->free = _schedulerpolicyhostsingle_free;
 
     policy->type = SP_PARALLEL_HOST_SINGLE;
@@ -10,15 +10,19 @@
 #include "main/core/scheduler/scheduler_policy.h"
 #include "main/core/support/definitions.h"
 #include "main/core/work/event.h"
+#include "main/core/work/event_queue.h"
 #include "main/host/host.h"
-#include "main/utility/priority_queue.h"
+#include "main/utility/mpsc_inbox.h"
 #include "main/utility/utility.h"
 #include "support/logger/logger.h"
 
 typedef struct _HostStealQueueData HostStealQueueData;
 struct _HostStealQueueData {
     GMutex lock;
-    PriorityQueue* pq;
+    EventQueue* pq;
+    /* if non-NULL, cross-host events are pushed here without locking, and only
+     * the worker that is running the host moves them into pq */
+    MPSCInbox* inbox;
     SimulationTime lastEventTime;
     gsize nPushed;
     gsize nPopped;
@@ -41,6 +45,11 @@ struct _HostStealThreadData {
     GTimer* popIdleTime;
     /* which worker thread this is */
     guint tnumber;
+    /* the NUMA node the thread runs on, if the policy knows it */
+    guint node;
+    /* hosts this thread stole from threads on its own and on other NUMA nodes */
+    guint64 numLocalSteals;
+    guint64 numRemoteSteals;
     GMutex lock;
 };
 
@@ -51,6 +60,12 @@ struct _HostStealPolicyData {
     GHashTable* hostToQueueDataMap;
     GHashTable* threadToThreadDataMap;
     GHashTable* hostToThreadMap;
+    /* if TRUE, pushes go to the destination host's lock-free inbox */
+    gboolean useInbox;
+    /* maps each pthread_t to its NUMA node plus one; if not empty, threads try to
+     * steal from threads on their own node before trying other nodes */
+    GHashTable* threadToNodeMap;
+    EventQueueType queueType;
     GRWLock lock;
     MAGIC_DECLARE;
 };
@@ -103,25 +118,34 @@ static void _hoststealthreaddata_free(HostStealThreadData* tdata) {
             g_timer_destroy(tdata->popIdleTime);
         }
 
-        g_free(tdata);
         message("scheduler thread data destroyed, total push wait time was %f seconds, "
-                "total pop wait time was %f seconds", totalPushWaitTime, totalPopWaitTime);
+                "total pop wait time was %f seconds, stole %"G_GUINT64_FORMAT" hosts from threads "
+                "on NUMA node %u and %"G_GUINT64_FORMAT" hosts from threads on other nodes",
+                totalPushWaitTime, totalPopWaitTime, tdata->numLocalSteals, tdata->node,
+                tdata->numRemoteSteals);
+        g_free(tdata);
     }
 }
 
-static HostStealQueueData* _hoststealqueuedata_new() {
+static HostStealQueueData* _hoststealqueuedata_new(EventQueueType queueType, gboolean useInbox) {
     HostStealQueueData* qdata = g_new0(HostStealQueueData, 1);
 
     g_mutex_init(&(qdata->lock));
-    qdata->pq = priorityqueue_new((GCompareDataFunc)event_compare, NULL, (GDestroyNotify)event_unref);
+    qdata->pq = eventqueue_new(queueType);
+    if(useInbox) {
+        qdata->inbox = mpscinbox_new((GDestroyNotify)event_unref);
+    }
 
     return qdata;
 }
 
 static void _hoststealqueuedata_free(HostStealQueueData* qdata) {
     if(qdata) {
+        if(qdata->inbox) {
+            mpscinbox_free(qdata->inbox);
+        }
         if(qdata->pq) {
-            priorityqueue_free(qdata->pq);
+            eventqueue_free(qdata->pq);
         }
         g_mutex_clear(&(qdata->lock));
         g_free(qdata);
@@ -138,7 +162,7 @@ static void _schedulerpolicyhoststeal_addHost(SchedulerPolicy* policy, Host* hos
      */
     if(!g_hash_table_lookup(data->hostToQueueDataMap, host)) {
         g_rw_lock_writer_lock(&data->lock);
-        g_hash_table_replace(data->hostToQueueDataMap, host, _hoststealqueuedata_new());
+        g_hash_table_replace(data->hostToQueueDataMap, host, _hoststealqueuedata_new(data->queueType, data->useInbox));
         g_rw_lock_writer_unlock(&data->lock);
     }
 
@@ -149,6 +173,8 @@ static void _schedulerpolicyhoststeal_addHost(SchedulerPolicy* policy, Host* hos
     g_rw_lock_reader_unlock(&data->lock);
     if(!tdata) {
         tdata = _hoststealthreaddata_new();
+        guint nodePlusOne = GPOINTER_TO_UINT(g_hash_table_lookup(data->threadToNodeMap, GUINT_TO_POINTER(assignedThread)));
+        tdata->node = (nodePlusOne > 0) ? nodePlusOne - 1 : 0;
         g_rw_lock_writer_lock(&data->lock);
         g_hash_table_replace(data->threadToThreadDataMap, GUINT_TO_POINTER(assignedThread), tdata);
         tdata->tnumber = data->threadCount;
@@ -195,6 +221,78 @@ static void _schedulerpolicyhoststeal_migrateHost(SchedulerPolicy* policy, Host*
     _schedulerpolicyhoststeal_addHost(policy, host, newThread);
 }
 
+static gsize _schedulerpolicyhoststeal_noteCancelled(SchedulerPolicy* policy, Host* host) {
+    MAGIC_ASSERT(policy);
+    HostStealPolicyData* data = policy->data;
+
+    g_rw_lock_reader_lock(&data->lock);
+    HostStealQueueData* qdata = g_hash_table_lookup(data->hostToQueueDataMap, host);
+    g_rw_lock_reader_unlock(&data->lock);
+    utility_assert(qdata);
+
+    /* hosts push the tasks they schedule for themselves directly into their queue,
+     * never into the inbox, so we only need to look at the queue */
+    GPtrArray* purged = g_ptr_array_new();
+
+    g_mutex_lock(&(qdata->lock));
+    eventqueue_noteCancelled(qdata->pq, purged);
+    g_mutex_unlock(&(qdata->lock));
+
+    /* the events may hold the last references to objects of the running host,
+     * so we release them outside of the queue lock */
+    gsize numPurged = purged->len;
+    g_ptr_array_set_free_func(purged, (GDestroyNotify)event_unref);
+    g_ptr_array_free(purged, TRUE);
+
+    return numPurged;
+}
+
+static void _schedulerpolicyhoststeal_setThreadNode(SchedulerPolicy* policy, pthread_t thread, guint node) {
+    MAGIC_ASSERT(policy);
+    HostStealPolicyData* data = policy->data;
+    g_rw_lock_writer_lock(&data->lock);
+    g_hash_table_replace(data->threadToNodeMap, GUINT_TO_POINTER(thread), GUINT_TO_POINTER(node + 1));
+    g_rw_lock_writer_unlock(&data->lock);
+}
+
+static pthread_t _schedulerpolicyhoststeal_getHostThread(SchedulerPolicy* policy, Host* host) {
+    MAGIC_ASSERT(policy);
+    HostStealPolicyData* data = policy->data;
+    g_rw_lock_reader_lock(&data->lock);
+    pthread_t thread = (pthread_t)g_hash_table_lookup(data->hostToThreadMap, host);
+    g_rw_lock_reader_unlock(&data->lock);
+    return thread;
+}
+
+/* moves the host to another thread between rounds, when no thread is running it. unlike
+ * stealing, this also takes the host out of the old thread's queues. */
+static void _schedulerpolicyhoststeal_rebalanceHost(SchedulerPolicy* policy, Host* host, pthread_t newThread) {
+    MAGIC_ASSERT(policy);
+    HostStealPolicyData* data = policy->data;
+
+    pthread_t oldThread = _schedulerpolicyhoststeal_getHostThread(policy, host);
+    if(oldThread == newThread) {
+        return;
+    }
+
+    g_rw_lock_reader_lock(&data->lock);
+    HostStealThreadData* tdata = g_hash_table_lookup(data->threadToThreadDataMap, GUINT_TO_POINTER(oldThread));
+    g_rw_lock_reader_unlock(&data->lock);
+
+    if(tdata) {
+        g_mutex_lock(&(tdata->lock));
+        utility_assert(tdata->runningHost == NULL);
+        g_queue_remove(tdata->unprocessedHosts, host);
+        g_queue_remove(tdata->processedHosts, host);
+        g_mutex_unlock(&(tdata->lock));
+
+        /* migrate the TLS of all objects associated with this host */
+        host_migrate(host, &oldThread, &newThread);
+    }
+
+    _schedulerpolicyhoststeal_addHost(policy, host, newThread);
+}
+
 static void concat_queue_iter(Host* hostItem, GQueue* userQueue) {
     g_queue_push_tail(userQueue, hostItem);
 }
@@ -222,6 +320,43 @@ static GQueue* _schedulerpolicyhoststeal_getHosts(SchedulerPolicy* policy) {
     return tdata->allHosts;
 }
 
+/* Move all events that other threads delivered to the host's inbox into its queue.
+ * This must only be called by the thread that is running the host (or, between rounds,
+ * the thread that is assigned the host), since nobody else may touch qdata->pq. The queue
+ * orders events with event_compare, so the order in which they arrived does not matter. */
+static void _schedulerpolicyhoststeal_drainInbox(HostStealQueueData* qdata) {
+    if(!qdata->inbox) {
+        return;
+    }
+
+    GSList* events = mpscinbox_takeAll(qdata->inbox);
+    for(GSList* item = events; item != NULL; item = g_slist_next(item)) {
+        eventqueue_push(qdata->pq, item->data);
+        qdata->nPushed++;
+    }
+    g_slist_free(events);
+}
+
+static void _schedulerpolicyhoststeal_pushInbox(HostStealThreadData* tdata, HostStealQueueData* qdata,
+        Event* event, Host* dstHost) {
+    if(tdata && tdata->runningHost == dstHost) {
+        /* we are running the destination host, so nobody else is using its queue */
+        eventqueue_push(qdata->pq, event);
+        qdata->nPushed++;
+        return;
+    }
+
+    /* 'deliver' the event to the destination inbox. the push never blocks, but it may
+     * have to retry when racing with other senders, which we count as idle time */
+    if(tdata) {
+        g_timer_continue(tdata->pushIdleTime);
+    }
+    mpscinbox_push(qdata->inbox, event);
+    if(tdata) {
+        g_timer_stop(tdata->pushIdleTime);
+    }
+}
+
 static void _schedulerpolicyhoststeal_push(SchedulerPolicy* policy, Event* event, Host* srcHost, Host* dstHost, SimulationTime barrier) {
     MAGIC_ASSERT(policy);
     HostStealPolicyData* data = policy->data;
@@ -250,6 +385,11 @@ static void _schedulerpolicyhoststeal_push(SchedulerPolicy* policy, Event* event
     g_rw_lock_reader_unlock(&data->lock);
     utility_assert(qdata);
 
+    if(data->useInbox) {
+        _schedulerpolicyhoststeal_pushInbox(tdata, qdata, event, dstHost);
+        return;
+    }
+
     /* tracking idle time spent waiting for the destination queue lock */
     if(tdata) {
         g_timer_continue(tdata->pushIdleTime);
@@ -261,7 +401,7 @@ static void _schedulerpolicyhoststeal_push(SchedulerPolicy* policy, Event* event
     }
 
     /* 'deliver' the event to the destination queue */
-    priorityqueue_push(qdata->pq, event);
+    eventqueue_push(qdata->pq, event);
     qdata->nPushed++;
 
     /* release the destination queue lock */
@@ -281,8 +421,10 @@ static Event* _schedulerpolicyhoststeal_popFromThread(SchedulerPolicy* policy, H
 
     while(!g_queue_is_empty(assignedHosts) || tdata->runningHost) {
         /* if there's no running host, we completed the last assignment and need a new one */
+        gboolean isNewAssignment = FALSE;
         if(!tdata->runningHost) {
             tdata->runningHost = g_queue_pop_head(assignedHosts);
+            isNewAssignment = TRUE;
         }
         Host* host = tdata->runningHost;
         g_rw_lock_reader_lock(&data->lock);
@@ -291,13 +433,20 @@ static Event* _schedulerpolicyhoststeal_popFromThread(SchedulerPolicy* policy, H
         utility_assert(qdata);
 
         g_mutex_lock(&(qdata->lock));
-        Event* nextEvent = priorityqueue_peek(qdata->pq);
+
+        /* events that other hosts sent this round are delayed until at least the barrier,
+         * so collecting the inbox once when we start running the host is sufficient */
+        if(isNewAssignment) {
+            _schedulerpolicyhoststeal_drainInbox(qdata);
+        }
+
+        Event* nextEvent = eventqueue_peek(qdata->pq);
         SimulationTime eventTime = (nextEvent != NULL) ? event_getTime(nextEvent) : SIMTIME_INVALID;
 
         if(nextEvent != NULL && eventTime < barrier) {
             utility_assert(eventTime >= qdata->lastEventTime);
             qdata->lastEventTime = eventTime;
-            nextEvent = priorityqueue_pop(qdata->pq);
+            nextEvent = eventqueue_pop(qdata->pq);
             qdata->nPopped++;
             /* migrate iff a migration is needed */
             _schedulerpolicyhoststeal_migrateHost(policy, host, pthread_self());
@@ -368,50 +517,67 @@ static Event* _schedulerpolicyhoststeal_pop(SchedulerPolicy* policy, SimulationT
     gpointer key, value;
     g_rw_lock_reader_lock(&data->lock);
     guint i, n = data->threadCount;
+    /* the node map is only written in scheduler_new, right after each worker thread is
+     * created; the workers wait at the start barrier until the main thread reaches it in
+     * scheduler_start, so every write happens before any thread gets here */
+    guint numPasses = (g_hash_table_size(data->threadToNodeMap) > 0) ? 2 : 1;
     g_rw_lock_reader_unlock(&data->lock);
-    for(i = 1; i < n; i++) {
-        guint stolenTnumber = (i + tdata->tnumber) % n;
-        g_rw_lock_reader_lock(&data->lock);
-        HostStealThreadData* stolenTdata = g_array_index(data->threadList, HostStealThreadData*, stolenTnumber);
-        g_rw_lock_reader_unlock(&data->lock);
-        /* We don't need a lock here, because we're only reading, and a misread just means either
-         * we read as empty when it's not, in which case the assigned thread (or one of the others)
-         * will pick it up anyway, or it reads as non-empty when it is empty, in which case we'll
-         * just get a NULL event and move on. Accepting this reduces lock contention towards the end
-         * of every round. */
-        if(g_queue_is_empty(stolenTdata->unprocessedHosts)) {
-            continue;
-        }
-        /* We need to lock the thread we're stealing from, to be sure that we're not stealing
-         * something already being stolen, as well as our own lock, to be sure nobody steals
-         * what we just stole. But we also need to do this in a well-ordered manner, to
-         * prevent deadlocks. To do this, we always lock the lock with the smaller thread
-         * number first. */
-        g_timer_continue(tdata->popIdleTime);
-        if(tdata->tnumber < stolenTnumber) {
-            g_mutex_lock(&(tdata->lock));
-            g_mutex_lock(&(stolenTdata->lock));
-        } else {
-            g_mutex_lock(&(stolenTdata->lock));
-            g_mutex_lock(&(tdata->lock));
-        }
-        g_timer_stop(tdata->popIdleTime);
-
-        /* attempt to get event from the other thread's queue, likely moving a host from its
-         * unprocessedHosts into this threads runningHost (and eventually processedHosts) */
-        nextEvent = _schedulerpolicyhoststeal_popFromThread(policy, tdata, stolenTdata->unprocessedHosts, barrier);
-
-        /* must unlock in reverse order of locking */
-        if(tdata->tnumber < stolenTnumber) {
-            g_mutex_unlock(&(stolenTdata->lock));
-            g_mutex_unlock(&(tdata->lock));
-        } else {
-            g_mutex_unlock(&(tdata->lock));
-            g_mutex_unlock(&(stolenTdata->lock));
-        }
+    /* with NUMA nodes, the first pass only visits threads on our own node, so that we only
+     * pull a host's memory across nodes if no thread on our node has work left */
+    for(guint pass = 0; pass < numPasses && nextEvent == NULL; pass++) {
+        for(i = 1; i < n; i++) {
+            guint stolenTnumber = (i + tdata->tnumber) % n;
+            g_rw_lock_reader_lock(&data->lock);
+            HostStealThreadData* stolenTdata = g_array_index(data->threadList, HostStealThreadData*, stolenTnumber);
+            g_rw_lock_reader_unlock(&data->lock);
+            gboolean isSameNode = (stolenTdata->node == tdata->node);
+            if(numPasses > 1 && isSameNode != (pass == 0)) {
+                continue;
+            }
+            /* We don't need a lock here, because we're only reading, and a misread just means either
+             * we read as empty when it's not, in which case the assigned thread (or one of the others)
+             * will pick it up anyway, or it reads as non-empty when it is empty, in which case we'll
+             * just get a NULL event and move on. Accepting this reduces lock contention towards the end
+             * of every round. */
+            if(g_queue_is_empty(stolenTdata->unprocessedHosts)) {
+                continue;
+            }
+            /* We need to lock the thread we're stealing from, to be sure that we're not stealing
+             * something already being stolen, as well as our own lock, to be sure nobody steals
+             * what we just stole. But we also need to do this in a well-ordered manner, to
+             * prevent deadlocks. To do this, we always lock the lock with the smaller thread
+             * number first. */
+            g_timer_continue(tdata->popIdleTime);
+            if(tdata->tnumber < stolenTnumber) {
+                g_mutex_lock(&(tdata->lock));
+                g_mutex_lock(&(stolenTdata->lock));
+            } else {
+                g_mutex_lock(&(stolenTdata->lock));
+                g_mutex_lock(&(tdata->lock));
+            }
+            g_timer_stop(tdata->popIdleTime);
+
+            /* attempt to get event from the other thread's queue, likely moving a host from its
+             * unprocessedHosts into this threads runningHost (and eventually processedHosts) */
+            nextEvent = _schedulerpolicyhoststeal_popFromThread(policy, tdata, stolenTdata->unprocessedHosts, barrier);
+
+            /* must unlock in reverse order of locking */
+            if(tdata->tnumber < stolenTnumber) {
+                g_mutex_unlock(&(stolenTdata->lock));
+                g_mutex_unlock(&(tdata->lock));
+            } else {
+                g_mutex_unlock(&(tdata->lock));
+                g_mutex_unlock(&(stolenTdata->lock));
+            }
 
-        if(nextEvent != NULL) {
-            break;
+            if(nextEvent != NULL) {
+                if(isSameNode) {
+                    tdata->numLocalSteals++;
+                } else {
+                    tdata->numRemoteSteals++;
+                }
+                break;
+            }
         }
     }
     return nextEvent;
@@ -424,7 +590,9 @@ static void _schedulerpolicyhoststeal_findMinTime(Host* host, HostStealSearchSta
     utility_assert(qdata);
 
     g_mutex_lock(&(qdata->lock));
-    Event* event = priorityqueue_peek(qdata->pq);
+    /* all workers are waiting at the round barrier, so no one is pushing right now */
+    _schedulerpolicyhoststeal_drainInbox(qdata);
+    Event* event = eventqueue_peek(qdata->pq);
     g_mutex_unlock(&(qdata->lock));
 
     if(event != NULL) {
@@ -462,6 +630,7 @@ static void _schedulerpolicyhoststeal_free(SchedulerPolicy* policy) {
     g_hash_table_destroy(data->hostToQueueDataMap);
     g_hash_table_destroy(data->threadToThreadDataMap);
     g_hash_table_destroy(data->hostToThreadMap);
+    g_hash_table_destroy(data->threadToNodeMap);
     g_rw_lock_clear(&data->lock);
     g_free(data);
 
@@ -469,12 +638,15 @@ static void _schedulerpolicyhoststeal_free(SchedulerPolicy* policy) {
     g_free(policy);
 }
 
-SchedulerPolicy* schedulerpolicyhoststeal_new() {
+SchedulerPolicy* schedulerpolicyhoststeal_new(EventQueueType queueType, gboolean useInbox) {
     HostStealPolicyData* data = g_new0(HostStealPolicyData, 1);
+    data->queueType = queueType;
+    data->useInbox = useInbox;
     data->threadList = g_array_new(FALSE, FALSE, sizeof(HostStealThreadData*));
     data->hostToQueueDataMap = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)_hoststealqueuedata_free);
     data->threadToThreadDataMap = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)_hoststealthreaddata_free);
     data->hostToThreadMap = g_hash_table_new(g_direct_hash, g_direct_equal);
+    data->threadToNodeMap = g_hash_table_new(g_direct_hash, g_direct_equal);
     g_rw_lock_init(&data->lock);
 
     SchedulerPolicy* policy = g_new0(SchedulerPolicy, 1);
@@ -484,6 +656,10 @@ SchedulerPolicy* schedulerpolicyhoststeal_new() {
     policy->push = _schedulerpolicyhoststeal_push;
     policy->pop = _schedulerpolicyhoststeal_pop;
     policy->getNextTime = _schedulerpolicyhoststeal_getNextTime;
+    policy->getHostThread = _schedulerpolicyhoststeal_getHostThread;
+    policy->migrateHost = _schedulerpolicyhoststeal_rebalanceHost;
+    policy->noteCancelled = _schedulerpolicyhoststeal_noteCancelled;
+    policy->setThreadNode = _schedulerpolicyhoststeal_setThreadNode;
     policy->free = _schedulerpolicyhoststeal_free;
 
     policy->type = SP_PARALLEL_HOST_STEAL;
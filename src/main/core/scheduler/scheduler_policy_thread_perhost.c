@@ -10,14 +10,14 @@
 #include "main/core/scheduler/scheduler_policy.h"
 #include "main/core/support/definitions.h"
 #include "main/core/work/event.h"
+#include "main/core/work/event_queue.h"
 #include "main/host/host.h"
-#include "main/utility/priority_queue.h"
 #include "main/utility/utility.h"
 #include "support/logger/logger.h"
 
 typedef struct _ThreadPerHostQueueData ThreadPerHostQueueData;
 struct _ThreadPerHostQueueData {
-    PriorityQueue* pq;
+    EventQueue* pq;
     SimulationTime lastEventTime;
     gsize nPushed;
     gsize nPopped;
@@ -32,19 +32,24 @@ struct _ThreadPerHostThreadData {
     /* this thread has pqueue that holds future events during each round, and is emptied into
      * the priority queue in qdata after each round */
     GHashTable* hostToPQueueMap;
+    EventQueueType queueType;
 };
 
 typedef struct _ThreadPerHostPolicyData ThreadPerHostPolicyData;
 struct _ThreadPerHostPolicyData {
     GHashTable* threadToThreadDataMap;
     GHashTable* hostToThreadMap;
+    EventQueueType queueType;
+    /* if TRUE, hosts may move between threads, so we delay all inter-host events
+     * at the barrier to keep event times independent of the host assignment */
+    gboolean allowMigration;
     MAGIC_DECLARE;
 };
 
-static ThreadPerHostQueueData* _threadperhostqueuedata_new() {
+static ThreadPerHostQueueData* _threadperhostqueuedata_new(EventQueueType queueType) {
     ThreadPerHostQueueData* qdata = g_new0(ThreadPerHostQueueData, 1);
 
-    qdata->pq = priorityqueue_new((GCompareDataFunc)event_compare, NULL, (GDestroyNotify)event_unref);
+    qdata->pq = eventqueue_new(queueType);
 
     return qdata;
 }
@@ -52,16 +57,17 @@ static ThreadPerHostQueueData* _threadperhostqueuedata_new() {
 static void _threadperhostqueuedata_free(ThreadPerHostQueueData* qdata) {
     if(qdata) {
         if(qdata->pq) {
-            priorityqueue_free(qdata->pq);
+            eventqueue_free(qdata->pq);
         }
         g_free(qdata);
     }
 }
 
-static ThreadPerHostThreadData* _threadperhostthreaddata_new() {
+static ThreadPerHostThreadData* _threadperhostthreaddata_new(EventQueueType queueType) {
     ThreadPerHostThreadData* tdata = g_new0(ThreadPerHostThreadData, 1);
-    tdata->hostToPQueueMap = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)priorityqueue_free);
-    tdata->qdata = _threadperhostqueuedata_new();
+    tdata->hostToPQueueMap = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)eventqueue_free);
+    tdata->qdata = _threadperhostqueuedata_new(queueType);
+    tdata->queueType = queueType;
     tdata->assignedHosts = g_queue_new();
     g_mutex_init(&(tdata->lock));
     return tdata;
@@ -90,7 +96,7 @@ static void _schedulerpolicythreadperhost_addHost(SchedulerPolicy* policy, Host*
     pthread_t assignedThread = (randomThread != 0) ? randomThread : pthread_self();
     ThreadPerHostThreadData* tdata = g_hash_table_lookup(data->threadToThreadDataMap, GUINT_TO_POINTER(assignedThread));
     if(!tdata) {
-        tdata = _threadperhostthreaddata_new();
+        tdata = _threadperhostthreaddata_new(data->queueType);
         g_hash_table_replace(data->threadToThreadDataMap, GUINT_TO_POINTER(assignedThread), tdata);
     }
     g_queue_push_tail(tdata->assignedHosts, host);
@@ -117,8 +123,9 @@ static void _schedulerpolicythreadperhost_push(SchedulerPolicy* policy, Event* e
     pthread_t dstThread = (pthread_t)GPOINTER_TO_UINT(g_hash_table_lookup(data->hostToThreadMap, dstHost));
 
     SimulationTime eventTime = event_getTime(event);
+    gboolean isRemote = data->allowMigration ? (srcHost != dstHost) : !pthread_equal(srcThread, dstThread);
 
-    if(!pthread_equal(srcThread, dstThread) && eventTime < barrier) {
+    if(isRemote && eventTime < barrier) {
         event_setTime(event, barrier);
         info("Inter-host event time %"G_GUINT64_FORMAT" changed to %"G_GUINT64_FORMAT" "
                 "to ensure event causality", eventTime, barrier);
@@ -130,7 +137,7 @@ static void _schedulerpolicythreadperhost_push(SchedulerPolicy* policy, Event* e
 
     pthread_t self = pthread_self();
     if(pthread_equal(dstThread, self)) {
-        priorityqueue_push(tdata->qdata->pq, event);
+        eventqueue_push(tdata->qdata->pq, event);
         tdata->qdata->nPushed++;
     } else {
         /* we need to lock this if srcThread != pthread_self */
@@ -139,14 +146,14 @@ static void _schedulerpolicythreadperhost_push(SchedulerPolicy* policy, Event* e
         }
 
         /* now make sure we have a mailbox for the source and create one if needed */
-        PriorityQueue* futureEvents = g_hash_table_lookup(tdata->hostToPQueueMap, srcHost);
+        EventQueue* futureEvents = g_hash_table_lookup(tdata->hostToPQueueMap, srcHost);
         if(!futureEvents) {
-            futureEvents = priorityqueue_new((GCompareDataFunc)event_compare, NULL, (GDestroyNotify)event_unref);
+            futureEvents = eventqueue_new(tdata->queueType);
             g_hash_table_replace(tdata->hostToPQueueMap, srcHost, futureEvents);
         }
 
         /* 'deliver' the event there */
-        priorityqueue_push(futureEvents, event);
+        eventqueue_push(futureEvents, event);
 
         if(!pthread_equal(srcThread, self)) {
             g_mutex_unlock(&(tdata->lock));
@@ -166,13 +173,13 @@ static Event* _schedulerpolicythreadperhost_pop(SchedulerPolicy* policy, Simulat
         return NULL;
     }
 
-    Event* nextEvent = priorityqueue_peek(tdata->qdata->pq);
+    Event* nextEvent = eventqueue_peek(tdata->qdata->pq);
     SimulationTime eventTime = (nextEvent != NULL) ? event_getTime(nextEvent) : SIMTIME_INVALID;
 
     if(nextEvent && eventTime < barrier) {
         utility_assert(eventTime >= tdata->qdata->lastEventTime);
         tdata->qdata->lastEventTime = eventTime;
-        nextEvent = priorityqueue_pop(tdata->qdata->pq);
+        nextEvent = eventqueue_pop(tdata->qdata->pq);
         tdata->qdata->nPopped++;
     } else {
         /* if we make it here, all hosts for this thread have no more events before barrier */
@@ -194,11 +201,11 @@ static SimulationTime _schedulerpolicythreadperhost_getNextTime(SchedulerPolicy*
         GList* values = g_hash_table_get_values(tdata->hostToPQueueMap);
         GList* item = values;
         while(item) {
-            PriorityQueue* futureEvents = item->data;
+            EventQueue* futureEvents = item->data;
 
-            while(!priorityqueue_isEmpty(futureEvents)) {
-                Event* event = priorityqueue_pop(futureEvents);
-                priorityqueue_push(tdata->qdata->pq, event);
+            while(!eventqueue_isEmpty(futureEvents)) {
+                Event* event = eventqueue_pop(futureEvents);
+                eventqueue_push(tdata->qdata->pq, event);
                 tdata->qdata->nPushed++;
             }
 
@@ -208,7 +215,7 @@ static SimulationTime _schedulerpolicythreadperhost_getNextTime(SchedulerPolicy*
             g_list_free(values);
         }
 
-        Event* nextEvent = priorityqueue_peek(tdata->qdata->pq);
+        Event* nextEvent = eventqueue_peek(tdata->qdata->pq);
         if(nextEvent != NULL) {
             nextTime = MIN(nextTime, event_getTime(nextEvent));
         }
@@ -217,6 +224,51 @@ static SimulationTime _schedulerpolicythreadperhost_getNextTime(SchedulerPolicy*
     return nextTime;
 }
 
+static pthread_t _schedulerpolicythreadperhost_getHostThread(SchedulerPolicy* policy, Host* host) {
+    MAGIC_ASSERT(policy);
+    ThreadPerHostPolicyData* data = policy->data;
+    return (pthread_t)GPOINTER_TO_UINT(g_hash_table_lookup(data->hostToThreadMap, host));
+}
+
+/* this must be run while all workers are blocked between rounds, after they
+ * drained their future events in getNextTime */
+static void _schedulerpolicythreadperhost_migrateHost(SchedulerPolicy* policy, Host* host, pthread_t newThread) {
+    MAGIC_ASSERT(policy);
+    ThreadPerHostPolicyData* data = policy->data;
+    utility_assert(data->allowMigration);
+
+    pthread_t oldThread = _schedulerpolicythreadperhost_getHostThread(policy, host);
+    if(pthread_equal(oldThread, newThread)) {
+        return;
+    }
+
+    /* make sure the new thread has a queue that can take the host's events */
+    _schedulerpolicythreadperhost_addHost(policy, host, newThread);
+    ThreadPerHostThreadData* newData = g_hash_table_lookup(data->threadToThreadDataMap, GUINT_TO_POINTER(newThread));
+    ThreadPerHostThreadData* oldData = g_hash_table_lookup(data->threadToThreadDataMap, GUINT_TO_POINTER(oldThread));
+
+    if(oldData) {
+        g_queue_remove(oldData->assignedHosts, host);
+
+        /* all of the old thread's events share one queue, so separate out the ones for this host */
+        EventQueue* remaining = eventqueue_new(data->queueType);
+        while(!eventqueue_isEmpty(oldData->qdata->pq)) {
+            Event* event = eventqueue_pop(oldData->qdata->pq);
+            if(event_getHost(event) == host) {
+                eventqueue_push(newData->qdata->pq, event);
+                newData->qdata->nPushed++;
+            } else {
+                eventqueue_push(remaining, event);
+            }
+        }
+        eventqueue_free(oldData->qdata->pq);
+        oldData->qdata->pq = remaining;
+
+        /* migrate the TLS of all objects associated with this host */
+        host_migrate(host, &oldThread, &newThread);
+    }
+}
+
 static void _schedulerpolicythreadperhost_free(SchedulerPolicy* policy) {
     MAGIC_ASSERT(policy);
     ThreadPerHostPolicyData* data = policy->data;
@@ -235,8 +287,10 @@ static void _schedulerpolicythreadperhost_free(SchedulerPolicy* policy) {
     g_free(policy);
 }
 
-SchedulerPolicy* schedulerpolicythreadperhost_new() {
+SchedulerPolicy* schedulerpolicythreadperhost_new(EventQueueType queueType, gboolean allowMigration) {
     ThreadPerHostPolicyData* data = g_new0(ThreadPerHostPolicyData, 1);
+    data->queueType = queueType;
+    data->allowMigration = allowMigration;
     data->threadToThreadDataMap = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)_threadperhostthreaddata_free);
     data->hostToThreadMap = g_hash_table_new(g_direct_hash, g_direct_equal);
 
@@ -247,6 +301,10 @@ SchedulerPolicy* schedulerpolicythreadperhost_new() {
     policy->push = _schedulerpolicythreadperhost_push;
     policy->pop = _schedulerpolicythreadperhost_pop;
     policy->getNextTime = _schedulerpolicythreadperhost_getNextTime;
+    if(allowMigration) {
+        policy->getHostThread = _schedulerpolicythreadperhost_getHostThread;
+        policy->migrateHost = _schedulerpolicythreadperhost_migrateHost;
+    }
     policy->free = _schedulerpolicythreadperhost_free;
 
     policy->type = SP_PARALLEL_THREAD_PERHOST;
@@ -10,8 +10,8 @@
 #include "main/core/scheduler/scheduler_policy.h"
 #include "main/core/support/definitions.h"
 #include "main/core/work/event.h"
+#include "main/core/work/event_queue.h"
 #include "main/host/host.h"
-#include "main/utility/priority_queue.h"
 #include "main/utility/utility.h"
 #include "support/logger/logger.h"
 
@@ -19,7 +19,7 @@ typedef struct _ThreadSingleThreadData ThreadSingleThreadData;
 struct _ThreadSingleThreadData {
     GQueue* assignedHosts2;
     GMutex lock;
-    PriorityQueue* pq;
+    EventQueue* pq;
     SimulationTime lastEventTime;
     gsize nPushed;
     gsize nPopped;
@@ -29,13 +29,14 @@ typedef struct _ThreadSinglePolicyData ThreadSinglePolicyData;
 struct _ThreadSinglePolicyData {
     GHashTable* threadToThreadDataMap;
     GHashTable* hostToThreadMap;
+    EventQueueType queueType;
     MAGIC_DECLARE;
 };
 
-static ThreadSingleThreadData* _threadsinglethreaddata_new() {
+static ThreadSingleThreadData* _threadsinglethreaddata_new(EventQueueType queueType) {
     ThreadSingleThreadData* tdata = g_new0(ThreadSingleThreadData, 1);
     g_mutex_init(&(tdata->lock));
-    tdata->pq = priorityqueue_new((GCompareDataFunc)event_compare, NULL, (GDestroyNotify)event_unref);
+    tdata->pq = eventqueue_new(queueType);
     tdata->assignedHosts2 = g_queue_new();
     return tdata;
 }
@@ -46,7 +47,7 @@ static void _threadsinglethreaddata_free(ThreadSingleThreadData* tdata) {
             g_queue_free(tdata->assignedHosts2);
         }
         if(tdata->pq) {
-            priorityqueue_free(tdata->pq);
+            eventqueue_free(tdata->pq);
         }
         g_mutex_clear(&(tdata->lock));
         g_free(tdata);
@@ -62,7 +63,7 @@ static void _schedulerpolicythreadsingle_addHost(SchedulerPolicy* policy, Host*
     pthread_t assignedThread = (randomThread != 0) ? randomThread : pthread_self();
     ThreadSingleThreadData* tdata = g_hash_table_lookup(data->threadToThreadDataMap, GUINT_TO_POINTER(assignedThread));
     if(!tdata) {
-        tdata = _threadsinglethreaddata_new();
+        tdata = _threadsinglethreaddata_new(data->queueType);
         g_hash_table_replace(data->threadToThreadDataMap, GUINT_TO_POINTER(assignedThread), tdata);
     }
     g_queue_push_tail(tdata->assignedHosts2, host);
@@ -102,7 +103,7 @@ static void _schedulerpolicythreadsingle_push(SchedulerPolicy* policy, Event* ev
 
     /* 'deliver' the event there */
     g_mutex_lock(&(tdata->lock));
-    priorityqueue_push(tdata->pq, event);
+    eventqueue_push(tdata->pq, event);
     tdata->nPushed++;
     g_mutex_unlock(&(tdata->lock));
 }
@@ -121,13 +122,13 @@ static Event* _schedulerpolicythreadsingle_pop(SchedulerPolicy* policy, Simulati
 
     g_mutex_lock(&(tdata->lock));
 
-    Event* nextEvent = priorityqueue_peek(tdata->pq);
+    Event* nextEvent = eventqueue_peek(tdata->pq);
     SimulationTime eventTime = (nextEvent != NULL) ? event_getTime(nextEvent) : SIMTIME_INVALID;
 
     if(nextEvent && eventTime < barrier) {
         utility_assert(eventTime >= tdata->lastEventTime);
         tdata->lastEventTime = eventTime;
-        nextEvent = priorityqueue_pop(tdata->pq);
+        nextEvent = eventqueue_pop(tdata->pq);
         tdata->nPopped++;
     } else {
         /* if we make it here, all hosts for this thread have no more events before barrier */
@@ -148,7 +149,7 @@ static SimulationTime _schedulerpolicythreadsingle_getNextTime(SchedulerPolicy*
     ThreadSingleThreadData* tdata = g_hash_table_lookup(data->threadToThreadDataMap, GUINT_TO_POINTER(pthread_self()));
     if(tdata) {
         g_mutex_lock(&(tdata->lock));
-        Event* event = priorityqueue_peek(tdata->pq);
+        Event* event = eventqueue_peek(tdata->pq);
         g_mutex_unlock(&(tdata->lock));
         if(event != NULL) {
             nextTime = MIN(nextTime, event_getTime(event));
@@ -170,8 +171,9 @@ static void _schedulerpolicythreadsingle_free(SchedulerPolicy* policy) {
     g_free(policy);
 }
 
-SchedulerPolicy* schedulerpolicythreadsingle_new() {
+SchedulerPolicy* schedulerpolicythreadsingle_new(EventQueueType queueType) {
     ThreadSinglePolicyData* data = g_new0(ThreadSinglePolicyData, 1);
+    data->queueType = queueType;
     data->threadToThreadDataMap = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)_threadsinglethreaddata_free);
     data->hostToThreadMap = g_hash_table_new(g_direct_hash, g_direct_equal);
 
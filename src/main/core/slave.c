@@ -18,11 +18,13 @@
 #include "main/core/support/definitions.h"
 #include "main/core/support/object_counter.h"
 #include "main/core/support/options.h"
+#include "main/core/work/event_queue.h"
 #include "main/core/worker.h"
 #include "main/host/host.h"
 #include "main/host/network_interface.h"
 #include "main/routing/address.h"
 #include "main/routing/dns.h"
+#include "main/routing/packet.h"
 #include "main/routing/topology.h"
 #include "main/utility/random.h"
 #include "main/utility/utility.h"
@@ -58,6 +60,8 @@ struct _Slave {
 
     /* global object counters, we collect counts from workers at end of sim */
     ObjectCounter* objectCounts;
+    /* the object pools of all workers that finished running */
+    GQueue* objectPools;
 
     /* the parallel event/host/thread scheduler */
     Scheduler* scheduler;
@@ -119,6 +123,20 @@ static SchedulerPolicyType _slave_getEventSchedulerPolicy(Slave* slave) {
     }
 }
 
+static EventQueueType _slave_getEventQueueType(Slave* slave) {
+    const gchar* typeStr = options_getEventQueueType(slave->options);
+    if (g_ascii_strcasecmp(typeStr, "pqueue") == 0) {
+        return EQ_PRIORITY_QUEUE;
+    } else if (g_ascii_strcasecmp(typeStr, "heap") == 0) {
+        return EQ_KEYED_HEAP;
+    } else if (g_ascii_strcasecmp(typeStr, "wheel") == 0) {
+        return EQ_TIMING_WHEEL;
+    } else {
+        error("unknown event queue type '%s'; valid values are 'pqueue', 'heap', or 'wheel'", typeStr);
+        return EQ_PRIORITY_QUEUE;
+    }
+}
+
 _ProgramMeta* _program_meta_new(const gchar* name, const gchar* path, const gchar* startSymbol) {
     if((name == NULL) || (path == NULL)) {
         error("attempting to register a program with a null name and/or path");
@@ -181,6 +199,7 @@ Slave* slave_new(Master* master, Options* options, SimulationTime endTime, Simul
     slave->options = options;
     slave->random = random_new(randomSeed);
     slave->objectCounts = objectcounter_new();
+    slave->objectPools = g_queue_new();
     slave->bootstrapEndTime = unlimBWEndTime;
 
     slave->rawFrequencyKHz = utility_getRawCPUFrequency(CONFIG_CPU_MAX_FREQ_FILE);
@@ -196,7 +215,23 @@ Slave* slave_new(Master* master, Options* options, SimulationTime endTime, Simul
     guint nWorkers = options_getNWorkerThreads(options);
     SchedulerPolicyType policy = _slave_getEventSchedulerPolicy(slave);
     guint schedulerSeed = _slave_nextRandomUInt(slave);
-    slave->scheduler = scheduler_new(policy, nWorkers, slave, schedulerSeed, endTime);
+    EventQueueType queueType = _slave_getEventQueueType(slave);
+    gboolean useInbox = options_doUseSchedulerInbox(options);
+    gboolean useLookahead = options_doUseSchedulerLookahead(options);
+    if(useLookahead && nWorkers > 0 && policy != SP_PARALLEL_HOST_SINGLE) {
+        /* the lookahead needs a fixed host-to-worker assignment */
+        warning("scheduler lookahead requires the 'host' policy, switching to it");
+        policy = SP_PARALLEL_HOST_SINGLE;
+    }
+    guint rebalanceInterval = options_getSchedulerRebalanceInterval(options);
+    guint rebalanceHysteresis = options_getSchedulerRebalanceHysteresis(options);
+    gboolean pinWorkers = options_doPinSchedulerWorkers(options);
+
+    /* must be set before any worker creates packets */
+    packet_setTracingEnabled(options_doTracePackets(options));
+
+    slave->scheduler = scheduler_new(policy, nWorkers, slave, schedulerSeed, endTime, queueType,
+            useInbox, useLookahead, rebalanceInterval, rebalanceHysteresis, pinWorkers);
 
     slave->cwdPath = g_get_current_dir();
     slave->dataPath = g_build_filename(slave->cwdPath, options_getDataOutputPath(options), NULL);
@@ -220,6 +255,23 @@ Slave* slave_new(Master* master, Options* options, SimulationTime endTime, Simul
     return slave;
 }
 
+static void _slave_logResourceUsage(const gchar* when) {
+    struct rusage resources;
+    if(!getrusage(RUSAGE_SELF, &resources)) {
+        /* success, convert the values */
+        gdouble maxMemory = ((gdouble)resources.ru_maxrss)/((gdouble)1048576.0f); // Kib->GiB
+        gdouble userTimeMinutes = ((gdouble)resources.ru_utime.tv_sec)/((gdouble)60.0f);
+        gdouble systemTimeMinutes = ((gdouble)resources.ru_stime.tv_sec)/((gdouble)60.0f);
+
+        /* log the usage results */
+        message("process resource usage %s reported by getrusage(): "
+                "ru_maxrss=%03f GiB, ru_utime=%03f minutes, ru_stime=%03f minutes, ru_nvcsw=%li, ru_nivcsw=%li",
+                when, maxMemory, userTimeMinutes, systemTimeMinutes, resources.ru_nvcsw, resources.ru_nivcsw);
+    } else {
+        warning("unable to print process resources usage: error %i in getrusage: %s", errno, g_strerror(errno));
+    }
+}
+
 gint slave_free(Slave* slave) {
     MAGIC_ASSERT(slave);
     gint returnCode = (slave->numPluginErrors > 0) ? -1 : 0;
@@ -234,12 +286,22 @@ gint slave_free(Slave* slave) {
         scheduler_unref(slave->scheduler);
     }
 
+    /* the peak resident set size, including the thread stacks of all hosts */
+    _slave_logResourceUsage("at the end of the simulation");
+
     if(slave->objectCounts != NULL) {
         message("%s", objectcounter_valuesToString(slave->objectCounts));
         message("%s", objectcounter_diffsToString(slave->objectCounts));
+        message("%s", objectcounter_poolsToString(slave->objectCounts));
+        message("%s", objectcounter_copiesToString(slave->objectCounts));
         objectcounter_free(slave->objectCounts);
     }
 
+    /* all objects are freed, so nothing can be released into the pools anymore */
+    if(slave->objectPools != NULL) {
+        g_queue_free_full(slave->objectPools, (GDestroyNotify)objectpool_free);
+    }
+
     g_hash_table_destroy(slave->programMeta);
 
     g_mutex_clear(&(slave->lock));
@@ -393,20 +455,9 @@ static void _slave_heartbeat(Slave* slave, SimulationTime simClockNow) {
     if(simClockNow > (slave->simClockLastHeartbeat + options_getHeartbeatInterval(slave->options))) {
         slave->simClockLastHeartbeat = simClockNow;
 
-        struct rusage resources;
-        if(!getrusage(RUSAGE_SELF, &resources)) {
-            /* success, convert the values */
-            gdouble maxMemory = ((gdouble)resources.ru_maxrss)/((gdouble)1048576.0f); // Kib->GiB
-            gdouble userTimeMinutes = ((gdouble)resources.ru_utime.tv_sec)/((gdouble)60.0f);
-            gdouble systemTimeMinutes = ((gdouble)resources.ru_stime.tv_sec)/((gdouble)60.0f);
-
-            /* log the usage results */
-            message("process resource usage at simtime %"G_GUINT64_FORMAT" reported by getrusage(): "
-                    "ru_maxrss=%03f GiB, ru_utime=%03f minutes, ru_stime=%03f minutes, ru_nvcsw=%li, ru_nivcsw=%li",
-                    simClockNow, maxMemory, userTimeMinutes, systemTimeMinutes, resources.ru_nvcsw, resources.ru_nivcsw);
-        } else {
-            warning("unable to print process resources usage: error %i in getrusage: %s", errno, g_strerror(errno));
-        }
+        gchar* when = g_strdup_printf("at simtime %"G_GUINT64_FORMAT, simClockNow);
+        _slave_logResourceUsage(when);
+        g_free(when);
     }
 }
 
@@ -472,6 +523,11 @@ void slave_incrementPluginError(Slave* slave) {
     _slave_unlock(slave);
 }
 
+const gchar* slave_getDataPath(Slave* slave) {
+    MAGIC_ASSERT(slave);
+    return slave->dataPath;
+}
+
 const gchar* slave_getHostsRootPath(Slave* slave) {
     MAGIC_ASSERT(slave);
     return slave->hostsPath;
@@ -486,6 +542,13 @@ void slave_storeCounts(Slave* slave, ObjectCounter* objectCounter) {
     _slave_unlock(slave);
 }
 
+void slave_storeObjectPool(Slave* slave, ObjectPool* pool) {
+    MAGIC_ASSERT(slave);
+    _slave_lock(slave);
+    g_queue_push_tail(slave->objectPools, pool);
+    _slave_unlock(slave);
+}
+
 void slave_countObject(ObjectType otype, CounterType ctype) {
     if(globalSlave) {
         MAGIC_ASSERT(globalSlave);
@@ -497,6 +560,17 @@ void slave_countObject(ObjectType otype, CounterType ctype) {
     }
 }
 
+void slave_countCopiedBytes(CopyType ctype, gsize numBytes) {
+    if(globalSlave) {
+        MAGIC_ASSERT(globalSlave);
+        _slave_lock(globalSlave);
+        if(globalSlave->objectCounts) {
+            objectcounter_addCopiedBytes(globalSlave->objectCounts, ctype, (guint64)numBytes);
+        }
+        _slave_unlock(globalSlave);
+    }
+}
+
 SimulationTime slave_getBootstrapEndTime(Slave* slave) {
     MAGIC_ASSERT(slave);
     return slave->bootstrapEndTime;
@@ -50,6 +50,7 @@ Options* slave_getOptions(Slave* slave);
 SimulationTime slave_getBootstrapEndTime(Slave* slave);
 
 void slave_incrementPluginError(Slave* slave);
+const gchar* slave_getDataPath(Slave* slave);
 const gchar* slave_getHostsRootPath(Slave* slave);
 
 void slave_updateMinTimeJump(Slave* slave, gdouble minPathLatency);
@@ -65,5 +66,7 @@ void slave_addNewVirtualProcess(Slave* slave, gchar* hostName, gchar* pluginName
 
 void slave_storeCounts(Slave* slave, ObjectCounter* objectCounter);
 void slave_countObject(ObjectType otype, CounterType ctype);
+void slave_countCopiedBytes(CopyType ctype, gsize numBytes);
+void slave_storeObjectPool(Slave* slave, ObjectPool* pool);
 
 #endif /* SHD_SLAVE_H_ */
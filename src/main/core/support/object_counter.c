@@ -16,6 +16,15 @@ struct _ObjectCounts {
     guint64 free;
 };
 
+typedef struct _PoolCounts PoolCounts;
+struct _PoolCounts {
+    guint64 hits;
+    guint64 misses;
+    /* the sum of the high-water marks of all workers' pools */
+    guint64 highWater;
+    guint64 bytesRetained;
+};
+
 struct _ObjectCounter {
     /* counting objects for debugging memory leaks */
     struct {
@@ -35,6 +44,21 @@ struct _ObjectCounter {
         ObjectCounts timer;
     } counters;
 
+    /* allocation statistics for the objects that come from worker pools */
+    struct {
+        PoolCounts task;
+        PoolCounts event;
+        PoolCounts packet;
+        PoolCounts payload;
+    } pools;
+
+    /* bytes of application data copied by the simulator */
+    struct {
+        guint64 in;
+        guint64 out;
+        guint64 delivered;
+    } copies;
+
     GString* stringBuffer;
 
     MAGIC_DECLARE;
@@ -168,6 +192,49 @@ void objectcounter_incrementOne(ObjectCounter* counter, ObjectType otype, Counte
     }
 }
 
+static void _poolcount_incrementAll(PoolCounts* counts, PoolCounts* increments) {
+    utility_assert(counts != NULL);
+    utility_assert(increments != NULL);
+
+    counts->hits += increments->hits;
+    counts->misses += increments->misses;
+    counts->highWater += increments->highWater;
+    counts->bytesRetained += increments->bytesRetained;
+}
+
+void objectcounter_addPoolStats(ObjectCounter* counter, ObjectType otype, ObjectPoolStats* stats) {
+    MAGIC_ASSERT(counter);
+    utility_assert(stats != NULL);
+
+    PoolCounts increments = {stats->hits, stats->misses, stats->highWater, stats->bytesRetained};
+
+    switch(otype) {
+        case OBJECT_TYPE_TASK: {
+            _poolcount_incrementAll(&(counter->pools.task), &increments);
+            break;
+        }
+
+        case OBJECT_TYPE_EVENT: {
+            _poolcount_incrementAll(&(counter->pools.event), &increments);
+            break;
+        }
+
+        case OBJECT_TYPE_PACKET: {
+            _poolcount_incrementAll(&(counter->pools.packet), &increments);
+            break;
+        }
+
+        case OBJECT_TYPE_PAYLOAD: {
+            _poolcount_incrementAll(&(counter->pools.payload), &increments);
+            break;
+        }
+
+        default: {
+            break;
+        }
+    }
+}
+
 void objectcounter_incrementAll(ObjectCounter* counter, ObjectCounter* increment) {
     MAGIC_ASSERT(counter);
     MAGIC_ASSERT(increment);
@@ -185,6 +252,39 @@ void objectcounter_incrementAll(ObjectCounter* counter, ObjectCounter* increment
     _objectcount_incrementAll(&(counter->counters.udp), &(increment->counters.udp));
     _objectcount_incrementAll(&(counter->counters.epoll), &(increment->counters.epoll));
     _objectcount_incrementAll(&(counter->counters.timer), &(increment->counters.timer));
+    _poolcount_incrementAll(&(counter->pools.task), &(increment->pools.task));
+    _poolcount_incrementAll(&(counter->pools.event), &(increment->pools.event));
+    _poolcount_incrementAll(&(counter->pools.packet), &(increment->pools.packet));
+    _poolcount_incrementAll(&(counter->pools.payload), &(increment->pools.payload));
+    counter->copies.in += increment->copies.in;
+    counter->copies.out += increment->copies.out;
+    counter->copies.delivered += increment->copies.delivered;
+}
+
+void objectcounter_addCopiedBytes(ObjectCounter* counter, CopyType ctype, guint64 numBytes) {
+    MAGIC_ASSERT(counter);
+
+    switch(ctype) {
+        case COPY_TYPE_IN: {
+            counter->copies.in += numBytes;
+            break;
+        }
+
+        case COPY_TYPE_OUT: {
+            counter->copies.out += numBytes;
+            break;
+        }
+
+        case COPY_TYPE_DELIVERED: {
+            counter->copies.delivered += numBytes;
+            break;
+        }
+
+        default:
+        case COPY_TYPE_NONE: {
+            break;
+        }
+    }
 }
 
 const gchar* objectcounter_valuesToString(ObjectCounter* counter) {
@@ -266,3 +366,49 @@ const gchar* objectcounter_diffsToString(ObjectCounter* counter) {
 
     return (const gchar*) counter->stringBuffer->str;
 }
+
+const gchar* objectcounter_poolsToString(ObjectCounter* counter) {
+    MAGIC_ASSERT(counter);
+
+    if(!counter->stringBuffer) {
+        counter->stringBuffer = g_string_new(NULL);
+    }
+
+    g_string_printf(counter->stringBuffer, "ObjectCounter: pool values: "
+            "task_hit=%"G_GUINT64_FORMAT" task_miss=%"G_GUINT64_FORMAT" "
+            "task_highwater=%"G_GUINT64_FORMAT" task_bytes=%"G_GUINT64_FORMAT" "
+            "event_hit=%"G_GUINT64_FORMAT" event_miss=%"G_GUINT64_FORMAT" "
+            "event_highwater=%"G_GUINT64_FORMAT" event_bytes=%"G_GUINT64_FORMAT" "
+            "packet_hit=%"G_GUINT64_FORMAT" packet_miss=%"G_GUINT64_FORMAT" "
+            "packet_highwater=%"G_GUINT64_FORMAT" packet_bytes=%"G_GUINT64_FORMAT" "
+            "payload_hit=%"G_GUINT64_FORMAT" payload_miss=%"G_GUINT64_FORMAT" "
+            "payload_highwater=%"G_GUINT64_FORMAT" payload_bytes=%"G_GUINT64_FORMAT" ",
+            counter->pools.task.hits, counter->pools.task.misses,
+            counter->pools.task.highWater, counter->pools.task.bytesRetained,
+            counter->pools.event.hits, counter->pools.event.misses,
+            counter->pools.event.highWater, counter->pools.event.bytesRetained,
+            counter->pools.packet.hits, counter->pools.packet.misses,
+            counter->pools.packet.highWater, counter->pools.packet.bytesRetained,
+            counter->pools.payload.hits, counter->pools.payload.misses,
+            counter->pools.payload.highWater, counter->pools.payload.bytesRetained);
+
+    return (const gchar*) counter->stringBuffer->str;
+}
+
+const gchar* objectcounter_copiesToString(ObjectCounter* counter) {
+    MAGIC_ASSERT(counter);
+
+    if(!counter->stringBuffer) {
+        counter->stringBuffer = g_string_new(NULL);
+    }
+
+    gdouble copiesPerByte = counter->copies.delivered > 0 ?
+            ((gdouble)(counter->copies.in + counter->copies.out)) / ((gdouble)counter->copies.delivered) : 0.0f;
+
+    g_string_printf(counter->stringBuffer, "ObjectCounter: payload copies: "
+            "bytes_in=%"G_GUINT64_FORMAT" bytes_out=%"G_GUINT64_FORMAT" "
+            "bytes_delivered=%"G_GUINT64_FORMAT" copies_per_delivered_byte=%f",
+            counter->copies.in, counter->copies.out, counter->copies.delivered, copiesPerByte);
+
+    return (const gchar*) counter->stringBuffer->str;
+}
@@ -8,6 +8,8 @@
 
 #include <glib.h>
 
+#include "main/utility/object_pool.h"
+
 typedef enum _ObjectType ObjectType;
 enum _ObjectType {
     OBJECT_TYPE_NONE,
@@ -34,6 +36,19 @@ enum _CounterType {
     COUNTER_TYPE_FREE,
 };
 
+/* copies of application data made by the simulator, to count how often each byte
+ * a plugin sends is copied before another plugin receives it */
+typedef enum _CopyType CopyType;
+enum _CopyType {
+    COPY_TYPE_NONE,
+    /* into a packet payload buffer */
+    COPY_TYPE_IN,
+    /* out of a packet payload, into a plugin buffer or a pcap record */
+    COPY_TYPE_OUT,
+    /* returned to a plugin by a receive call; this is not an extra copy */
+    COPY_TYPE_DELIVERED,
+};
+
 typedef struct _ObjectCounter ObjectCounter;
 
 ObjectCounter* objectcounter_new();
@@ -42,9 +57,16 @@ void objectcounter_free(ObjectCounter* counter);
 /* increment the counter of type ctype for the object of type otype. */
 void objectcounter_incrementOne(ObjectCounter* counter, ObjectType otype, CounterType ctype);
 
+/* add numBytes to the copy counter of type ctype */
+void objectcounter_addCopiedBytes(ObjectCounter* counter, CopyType ctype, guint64 numBytes);
+
 /* add all counter values from 'increment' into the values of 'counter' */
 void objectcounter_incrementAll(ObjectCounter* counter, ObjectCounter* increment);
 
+/* add the allocation statistics of a worker's object pool for objects of type otype.
+ * only tasks, events, packets, and payloads are allocated from pools. */
+void objectcounter_addPoolStats(ObjectCounter* counter, ObjectType otype, ObjectPoolStats* stats);
+
 /* prints the current values of the counters as a string that can be logged.
  * the string is owned by the object counter, and should not be freed by the caller. */
 const gchar* objectcounter_valuesToString(ObjectCounter* counter);
@@ -53,4 +75,13 @@ const gchar* objectcounter_valuesToString(ObjectCounter* counter);
  * the string is owned by the object counter, and should not be freed by the caller. */
 const gchar* objectcounter_diffsToString(ObjectCounter* counter);
 
+/* prints the object pool statistics as a string that can be logged.
+ * the string is owned by the object counter, and should not be freed by the caller. */
+const gchar* objectcounter_poolsToString(ObjectCounter* counter);
+
+/* prints the copy counters, and the number of bytes copied per delivered byte, as a
+ * string that can be logged. the string is owned by the object counter, and should
+ * not be freed by the caller. */
+const gchar* objectcounter_copiesToString(ObjectCounter* counter);
+
 #endif /* SRC_MAIN_CORE_SUPPORT_SHD_OBJECT_COUNTER_H_ */
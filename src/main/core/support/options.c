@@ -41,7 +41,16 @@ struct _Options {
     gboolean autotuneSocketReceiveBuffer;
     gboolean autotuneSocketSendBuffer;
     gchar* interfaceQueuingDiscipline;
+    gboolean useSegmentationOffload;
+    gboolean tracePackets;
+    gboolean precomputeTopologyPaths;
     gchar* eventSchedulingPolicy;
+    gboolean useSchedulerInbox;
+    gboolean useSchedulerLookahead;
+    gint schedulerRebalanceInterval;
+    gint schedulerRebalanceHysteresis;
+    gboolean pinSchedulerWorkers;
+    gchar* eventQueueType;
     SimulationTime interfaceBatchTime;
     gchar* tcpCongestionControl;
     gint tcpSlowStartThreshold;
@@ -81,6 +90,7 @@ Options* options_new(gint argc, gchar* argv[]) {
     options->cpuThreshold = -1;
     options->cpuPrecision = 200;
     options->heartbeatInterval = 1;
+    options->schedulerRebalanceHysteresis = 10;
 
     /* set options to change defaults for the main group */
     options->mainOptionGroup = g_option_group_new("main", "Main Options", "Primary simulator options", NULL, NULL);
@@ -96,6 +106,12 @@ Options* options_new(gint argc, gchar* argv[]) {
       { "runahead", 'r', 0, G_OPTION_ARG_INT, &(options->minRunAhead), "If set, overrides the automatically calculated minimum TIME workers may run ahead when sending events between nodes, in milliseconds [0]", "TIME" },
       { "seed", 's', 0, G_OPTION_ARG_INT, &(options->randomSeed), "Initialize randomness for each thread using seed N [1]", "N" },
       { "scheduler-policy", 't', 0, G_OPTION_ARG_STRING, &(options->eventSchedulingPolicy), "The event scheduler's policy for thread synchronization ('thread', 'host', 'steal', 'threadXthread', 'threadXhost') ['steal']", "SPOL" },
+      { "scheduler-inbox", 0, 0, G_OPTION_ARG_NONE, &(options->useSchedulerInbox), "Push cross-host events into lock-free per-host inboxes instead of locked host queues (only for the 'steal' policy)", NULL },
+      { "scheduler-lookahead", 0, 0, G_OPTION_ARG_NONE, &(options->useSchedulerLookahead), "Let each worker run ahead as far as the latencies from the other workers' hosts to its own hosts allow, instead of using one global window (only for the 'host' policy)", NULL },
+      { "scheduler-rebalance", 0, 0, G_OPTION_ARG_INT, &(options->schedulerRebalanceInterval), "Every N rounds, move hosts from busy to idle workers based on their measured execution time, or never if 0 (only for the 'host', 'steal', and 'threadXhost' policies) [0]", "N" },
+      { "scheduler-rebalance-hysteresis", 0, 0, G_OPTION_ARG_INT, &(options->schedulerRebalanceHysteresis), "Only move hosts when the busiest worker's load exceeds the mean by more than N percent [10]", "N" },
+      { "scheduler-pin-workers", 0, 0, G_OPTION_ARG_NONE, &(options->pinSchedulerWorkers), "Pin each worker thread to a CPU, group workers by NUMA node, and allocate each host's scheduler queues on its worker's node", NULL },
+      { "event-queue", 0, 0, G_OPTION_ARG_STRING, &(options->eventQueueType), "The data structure used to order pending events ('pqueue', 'heap', 'wheel') ['pqueue']", "TYPE" },
       { "workers", 'w', 0, G_OPTION_ARG_INT, &(options->nWorkerThreads), "Run concurrently with N worker threads [0]", "N" },
       { "valgrind", 'x', 0, G_OPTION_ARG_NONE, &(options->runValgrind), "Run through valgrind for debugging", NULL },
       { "version", 'v', 0, G_OPTION_ARG_NONE, &(options->printSoftwareVersion), "Print software version and exit", NULL },
@@ -131,11 +147,14 @@ Options* options_new(gint argc, gchar* argv[]) {
       { "interface-batch", 0, 0, G_OPTION_ARG_INT, &(options->interfaceBatchTime), "Batch TIME for network interface sends and receives, in microseconds [5000]", "TIME" },
       { "interface-buffer", 0, 0, G_OPTION_ARG_INT, &(options->interfaceBufferSize), "Size of the network interface receive buffer, in bytes [1024000]", "N" },
       { "interface-qdisc", 0, 0, G_OPTION_ARG_STRING, &(options->interfaceQueuingDiscipline), "The interface queuing discipline QDISC used to select the next sendable socket ('fifo' or 'rr') ['fifo']", "QDISC" },
+      { "interface-segmentation-offload", 0, 0, G_OPTION_ARG_NONE, &(options->useSegmentationOffload), "Deliver the consecutive packets that an interface sends to the same host at the same time as one packet train event, instead of one event per packet", NULL },
+      { "packet-trace", 0, 0, G_OPTION_ARG_NONE, &(options->tracePackets), "Record every packet delivery status change to binary packet-trace-N.bin files in the data directory, one per worker (decode with src/tools/decode_packet_trace.py)", NULL },
       { "socket-recv-buffer", 0, 0, G_OPTION_ARG_INT, &(options->initialSocketReceiveBufferSize), sockrecv->str, "N" },
       { "socket-send-buffer", 0, 0, G_OPTION_ARG_INT, &(options->initialSocketSendBufferSize), socksend->str, "N" },
-      { "tcp-congestion-control", 0, 0, G_OPTION_ARG_STRING, &(options->tcpCongestionControl), "Congestion control algorithm to use for TCP ('aimd', 'reno', 'cubic') ['reno']", "TCPCC" },
+      { "tcp-congestion-control", 0, 0, G_OPTION_ARG_STRING, &(options->tcpCongestionControl), "Congestion control algorithm to use for TCP ('aimd', 'reno', 'cubic', 'bbr') ['reno']", "TCPCC" },
       { "tcp-ssthresh", 0, 0, G_OPTION_ARG_INT, &(options->tcpSlowStartThreshold), "Set TCP ssthresh value instead of discovering it via packet loss or hystart [0]", "N" },
       { "tcp-windows", 0, 0, G_OPTION_ARG_INT, &(options->initialTCPWindow), "Initialize the TCP send, receive, and congestion windows to N packets [10]", "N" },
+      { "topology-precompute-paths", 0, 0, G_OPTION_ARG_NONE, &(options->precomputeTopologyPaths), "Compute the paths between all pairs of attached topology vertices in parallel at startup, instead of lazily on first use", NULL },
       { NULL },
     };
 
@@ -198,6 +217,9 @@ Options* options_new(gint argc, gchar* argv[]) {
     if(options->eventSchedulingPolicy == NULL) {
         options->eventSchedulingPolicy = g_strdup("steal");
     }
+    if(options->eventQueueType == NULL) {
+        options->eventQueueType = g_strdup("pqueue");
+    }
     if(!options->initialSocketReceiveBufferSize) {
         options->initialSocketReceiveBufferSize = CONFIG_RECV_BUFFER_SIZE;
         options->autotuneSocketReceiveBuffer = TRUE;
@@ -239,6 +261,7 @@ void options_free(Options* options) {
     g_free(options->heartbeatLogInfo);
     g_free(options->interfaceQueuingDiscipline);
     g_free(options->eventSchedulingPolicy);
+    g_free(options->eventQueueType);
     g_free(options->tcpCongestionControl);
     if(options->argstr) {
         g_free(options->argstr);
@@ -321,6 +344,36 @@ gchar* options_getEventSchedulerPolicy(Options* options) {
     return options->eventSchedulingPolicy;
 }
 
+gboolean options_doUseSchedulerInbox(Options* options) {
+    MAGIC_ASSERT(options);
+    return options->useSchedulerInbox;
+}
+
+gboolean options_doUseSchedulerLookahead(Options* options) {
+    MAGIC_ASSERT(options);
+    return options->useSchedulerLookahead;
+}
+
+guint options_getSchedulerRebalanceInterval(Options* options) {
+    MAGIC_ASSERT(options);
+    return options->schedulerRebalanceInterval > 0 ? (guint)options->schedulerRebalanceInterval : 0;
+}
+
+guint options_getSchedulerRebalanceHysteresis(Options* options) {
+    MAGIC_ASSERT(options);
+    return options->schedulerRebalanceHysteresis > 0 ? (guint)options->schedulerRebalanceHysteresis : 0;
+}
+
+gboolean options_doPinSchedulerWorkers(Options* options) {
+    MAGIC_ASSERT(options);
+    return options->pinSchedulerWorkers;
+}
+
+gchar* options_getEventQueueType(Options* options) {
+    MAGIC_ASSERT(options);
+    return options->eventQueueType;
+}
+
 guint options_getNWorkerThreads(Options* options) {
     MAGIC_ASSERT(options);
     return options->nWorkerThreads > 0 ? (guint)options->nWorkerThreads : 0;
@@ -426,6 +479,21 @@ gboolean options_doAutotuneSendBuffer(Options* options) {
     return options->autotuneSocketSendBuffer;
 }
 
+gboolean options_doSegmentationOffload(Options* options) {
+    MAGIC_ASSERT(options);
+    return options->useSegmentationOffload;
+}
+
+gboolean options_doTracePackets(Options* options) {
+    MAGIC_ASSERT(options);
+    return options->tracePackets;
+}
+
+gboolean options_doPrecomputeTopologyPaths(Options* options) {
+    MAGIC_ASSERT(options);
+    return options->precomputeTopologyPaths;
+}
+
 const GString* options_getInputXMLFilename(Options* options) {
     MAGIC_ASSERT(options);
     return options->inputXMLFilename;
@@ -92,6 +92,12 @@ QDiscMode options_getQueuingDiscipline(Options* options);
 gchar* options_getEventSchedulerPolicy(Options* options);
 
 guint options_getNWorkerThreads(Options* options);
+gboolean options_doUseSchedulerInbox(Options* options);
+gboolean options_doUseSchedulerLookahead(Options* options);
+guint options_getSchedulerRebalanceInterval(Options* options);
+guint options_getSchedulerRebalanceHysteresis(Options* options);
+gboolean options_doPinSchedulerWorkers(Options* options);
+gchar* options_getEventQueueType(Options* options);
 
 const gchar* options_getArgumentString(Options* options);
 const gchar* options_getHeartbeatLogInfoString(Options* options);
@@ -117,6 +123,9 @@ gint options_getSocketReceiveBufferSize(Options* options);
 gint options_getSocketSendBufferSize(Options* options);
 gboolean options_doAutotuneReceiveBuffer(Options* options);
 gboolean options_doAutotuneSendBuffer(Options* options);
+gboolean options_doSegmentationOffload(Options* options);
+gboolean options_doTracePackets(Options* options);
+gboolean options_doPrecomputeTopologyPaths(Options* options);
 
 const GString* options_getInputXMLFilename(Options* options);
 
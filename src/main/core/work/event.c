@@ -27,7 +27,7 @@ struct _Event {
 
 Event* event_new_(Task* task, SimulationTime time, gpointer srcHost, gpointer dstHost) {
     utility_assert(task != NULL);
-    Event* event = g_new0(Event, 1);
+    Event* event = worker_newObject(OBJECT_TYPE_EVENT, sizeof(Event));
     MAGIC_INIT(event);
 
     event->srcHost = (Host*)srcHost;
@@ -45,7 +45,7 @@ Event* event_new_(Task* task, SimulationTime time, gpointer srcHost, gpointer ds
 static void _event_free(Event* event) {
     task_unref(event->task);
     MAGIC_CLEAR(event);
-    g_free(event);
+    worker_freeObject(OBJECT_TYPE_EVENT, event);
     worker_countObject(OBJECT_TYPE_EVENT, COUNTER_TYPE_FREE);
 }
 
@@ -62,11 +62,15 @@ void event_unref(Event* event) {
     }
 }
 
-void event_execute(Event* event) {
+void event_executeLocked(Event* event) {
     MAGIC_ASSERT(event);
+    utility_assert(worker_getActiveHost() == event->dstHost);
 
-    host_lock(event->dstHost);
-    worker_setActiveHost(event->dstHost);
+    if(task_isCancelled(event->task)) {
+        /* the task was cancelled after this event was queued */
+        worker_countSkippedEvent();
+        return;
+    }
 
     /* check if we are allowed to execute or have to wait for cpu delays */
     CPU* cpu = host_getCPU(event->dstHost);
@@ -83,11 +87,20 @@ void event_execute(Event* event) {
         worker_scheduleTask(event->task, cpuDelay);
     } else {
         /* cpu is not blocked, its ok to execute the event */
-        host_continueExecutionTimer(event->dstHost);
         task_execute(event->task);
-        host_stopExecutionTimer(event->dstHost);
     }
+}
+
+void event_execute(Event* event) {
+    MAGIC_ASSERT(event);
+
+    host_lock(event->dstHost);
+    worker_setActiveHost(event->dstHost);
+    host_continueExecutionTimer(event->dstHost);
+
+    event_executeLocked(event);
 
+    host_stopExecutionTimer(event->dstHost);
     worker_setActiveHost(NULL);
     host_unlock(event->dstHost);
 }
@@ -102,11 +115,35 @@ gpointer event_getHost(Event* event) {
     return event->dstHost;
 }
 
+gboolean event_isHostLocal(Event* event) {
+    MAGIC_ASSERT(event);
+    return event->srcHost == event->dstHost;
+}
+
+gboolean event_isCancelled(Event* event) {
+    MAGIC_ASSERT(event);
+    return task_isCancelled(event->task);
+}
+
 void event_setTime(Event* event, SimulationTime time) {
     MAGIC_ASSERT(event);
     event->time = time;
 }
 
+void event_getSortKey(Event* event, KeyedHeapKey* key) {
+    MAGIC_ASSERT(event);
+    utility_assert(key);
+
+    /* host ids are GQuarks, so both fit into one 64 bit word with the dst id
+     * in the high bits to keep the same priority order as event_compare */
+    guint64 dstID = (guint64)host_getID(event->dstHost);
+    guint64 srcID = (guint64)host_getID(event->srcHost);
+
+    key->primary = event->time;
+    key->secondary = (dstID << 32) | srcID;
+    key->tertiary = event->srcHostEventID;
+}
+
 gint event_compare(const Event* a, const Event* b, gpointer userData) {
     MAGIC_ASSERT(a);
     MAGIC_ASSERT(b);
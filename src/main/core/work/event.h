@@ -10,6 +10,7 @@
 
 #include "main/core/support/definitions.h"
 #include "main/core/work/task.h"
+#include "main/utility/keyed_heap.h"
 
 /* An event for a local virtual host, i.e.,
  * a host running on the same slave machine as the event initiator.
@@ -21,9 +22,18 @@ void event_ref(Event* event);
 void event_unref(Event* event);
 
 void event_execute(Event* event);
+/* executes the event without setting up its host; the caller must hold the host lock,
+ * have made it the worker's active host, and be running its execution timer */
+void event_executeLocked(Event* event);
 gint event_compare(const Event* a, const Event* b, gpointer userData);
+/* fills key so that comparing keys gives the same order as event_compare */
+void event_getSortKey(Event* event, KeyedHeapKey* key);
 
 gpointer event_getHost(Event* event);
+/* returns TRUE if the event's host scheduled it for itself */
+gboolean event_isHostLocal(Event* event);
+/* returns TRUE if the event's task was cancelled, so executing it would do nothing */
+gboolean event_isCancelled(Event* event);
 SimulationTime event_getTime(Event* event);
 void event_setTime(Event* event, SimulationTime time);
 
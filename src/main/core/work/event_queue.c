@@ -0,0 +1,203 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include "main/core/work/event_queue.h"
+
+#include <glib.h>
+#include <stddef.h>
+
+#include "main/core/work/event.h"
+#include "main/utility/keyed_heap.h"
+#include "main/utility/priority_queue.h"
+#include "main/utility/timing_wheel.h"
+#include "main/utility/utility.h"
+#include "support/logger/logger.h"
+
+/* don't bother purging cancelled events from queues shorter than this */
+#define EVENT_QUEUE_MIN_PURGE_LENGTH 32
+
+struct _EventQueue {
+    EventQueueType type;
+    /* only the one matching type is used, except that EQ_TIMING_WHEEL uses heap for
+     * events between hosts and wheel for events that a host scheduled for itself */
+    PriorityQueue* pq;
+    KeyedHeap* heap;
+    TimingWheel* wheel;
+    /* how many queued events were cancelled since the last purge, at most */
+    gsize numCancelled;
+    MAGIC_DECLARE;
+};
+
+EventQueue* eventqueue_new(EventQueueType type) {
+    EventQueue* queue = g_new0(EventQueue, 1);
+    MAGIC_INIT(queue);
+
+    queue->type = type;
+    if(type == EQ_TIMING_WHEEL) {
+        queue->heap = keyedheap_new((GDestroyNotify)event_unref);
+        queue->wheel = timingwheel_new((GDestroyNotify)event_unref);
+    } else if(type == EQ_KEYED_HEAP) {
+        queue->heap = keyedheap_new((GDestroyNotify)event_unref);
+    } else {
+        queue->pq = priorityqueue_new((GCompareDataFunc)event_compare, NULL, (GDestroyNotify)event_unref);
+    }
+
+    return queue;
+}
+
+void eventqueue_free(EventQueue* queue) {
+    MAGIC_ASSERT(queue);
+
+    if(queue->type == EQ_TIMING_WHEEL) {
+        keyedheap_free(queue->heap);
+        timingwheel_free(queue->wheel);
+    } else if(queue->type == EQ_KEYED_HEAP) {
+        keyedheap_free(queue->heap);
+    } else {
+        priorityqueue_free(queue->pq);
+    }
+
+    MAGIC_CLEAR(queue);
+    g_free(queue);
+}
+
+gsize eventqueue_getLength(EventQueue* queue) {
+    MAGIC_ASSERT(queue);
+    if(queue->type == EQ_TIMING_WHEEL) {
+        return keyedheap_getLength(queue->heap) + timingwheel_getLength(queue->wheel);
+    } else if(queue->type == EQ_KEYED_HEAP) {
+        return keyedheap_getLength(queue->heap);
+    } else {
+        return priorityqueue_getLength(queue->pq);
+    }
+}
+
+gboolean eventqueue_isEmpty(EventQueue* queue) {
+    MAGIC_ASSERT(queue);
+    if(queue->type == EQ_TIMING_WHEEL) {
+        return keyedheap_isEmpty(queue->heap) && timingwheel_isEmpty(queue->wheel);
+    } else if(queue->type == EQ_KEYED_HEAP) {
+        return keyedheap_isEmpty(queue->heap);
+    } else {
+        return priorityqueue_isEmpty(queue->pq);
+    }
+}
+
+/* Debug builds log every push and pop, so that running e.g. the phold test with
+ * '-l debug' captures an event trace that the event queue benchmark can replay. */
+static void _eventqueue_trace(Event* pushedEvent) {
+#ifdef DEBUG
+    if(pushedEvent) {
+        KeyedHeapKey key;
+        event_getSortKey(pushedEvent, &key);
+        debug("event-trace push %"G_GUINT64_FORMAT" %"G_GUINT64_FORMAT" %"G_GUINT64_FORMAT,
+                key.primary, key.secondary, key.tertiary);
+    } else {
+        debug("event-trace pop");
+    }
+#endif
+}
+
+void eventqueue_push(EventQueue* queue, Event* event) {
+    MAGIC_ASSERT(queue);
+    _eventqueue_trace(event);
+    if(queue->type == EQ_TIMING_WHEEL) {
+        KeyedHeapKey key;
+        event_getSortKey(event, &key);
+        if(event_isHostLocal(event)) {
+            timingwheel_push(queue->wheel, &key, event);
+        } else {
+            keyedheap_push(queue->heap, &key, event);
+        }
+    } else if(queue->type == EQ_KEYED_HEAP) {
+        /* the key is computed once here, so the event time must not change while queued */
+        KeyedHeapKey key;
+        event_getSortKey(event, &key);
+        keyedheap_push(queue->heap, &key, event);
+    } else {
+        priorityqueue_push(queue->pq, event);
+    }
+}
+
+/* returns TRUE if the next event is in the wheel rather than the heap */
+static gboolean _eventqueue_isWheelNext(EventQueue* queue) {
+    const KeyedHeapKey* heapKey = keyedheap_peekKey(queue->heap);
+    /* the wheel does not need to sort any slots that start after the heap's next event */
+    const KeyedHeapKey* wheelKey = timingwheel_peekKeyBefore(queue->wheel,
+            heapKey ? heapKey->primary : G_MAXUINT64);
+
+    if(wheelKey == NULL) {
+        return FALSE;
+    } else if(heapKey == NULL) {
+        return TRUE;
+    } else {
+        return keyedheap_compareKeys(wheelKey, heapKey) < 0;
+    }
+}
+
+Event* eventqueue_peek(EventQueue* queue) {
+    MAGIC_ASSERT(queue);
+    if(queue->type == EQ_TIMING_WHEEL) {
+        return _eventqueue_isWheelNext(queue) ? timingwheel_peek(queue->wheel) : keyedheap_peek(queue->heap);
+    } else if(queue->type == EQ_KEYED_HEAP) {
+        return keyedheap_peek(queue->heap);
+    } else {
+        return priorityqueue_peek(queue->pq);
+    }
+}
+
+Event* eventqueue_pop(EventQueue* queue) {
+    MAGIC_ASSERT(queue);
+    _eventqueue_trace(NULL);
+
+    Event* event = NULL;
+    if(queue->type == EQ_TIMING_WHEEL) {
+        event = _eventqueue_isWheelNext(queue) ? timingwheel_pop(queue->wheel) : keyedheap_pop(queue->heap);
+    } else if(queue->type == EQ_KEYED_HEAP) {
+        event = keyedheap_pop(queue->heap);
+    } else {
+        event = priorityqueue_pop(queue->pq);
+    }
+
+    /* the caller will skip it, so it no longer counts towards the next purge */
+    if(event && queue->numCancelled > 0 && event_isCancelled(event)) {
+        queue->numCancelled--;
+    }
+
+    return event;
+}
+
+static gboolean _eventqueue_takeIfCancelled(Event* event, GPtrArray* purged) {
+    if(event_isCancelled(event)) {
+        g_ptr_array_add(purged, event);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+void eventqueue_noteCancelled(EventQueue* queue, GPtrArray* purged) {
+    MAGIC_ASSERT(queue);
+    utility_assert(purged);
+
+    queue->numCancelled++;
+
+    /* a purge is linear in the queue length, so wait until it would remove at least
+     * half of the queue; this keeps the amortized cost per cancellation constant */
+    gsize length = eventqueue_getLength(queue);
+    if(length < EVENT_QUEUE_MIN_PURGE_LENGTH || queue->numCancelled * 2 < length) {
+        return;
+    }
+
+    if(queue->type == EQ_TIMING_WHEEL) {
+        timingwheel_removeIf(queue->wheel, (KeyedHeapPredicateFunc)_eventqueue_takeIfCancelled, purged);
+        keyedheap_removeIf(queue->heap, (KeyedHeapPredicateFunc)_eventqueue_takeIfCancelled, purged);
+    } else if(queue->type == EQ_KEYED_HEAP) {
+        keyedheap_removeIf(queue->heap, (KeyedHeapPredicateFunc)_eventqueue_takeIfCancelled, purged);
+    } else {
+        priorityqueue_removeIf(queue->pq, (PriorityQueuePredicateFunc)_eventqueue_takeIfCancelled, purged);
+    }
+
+    queue->numCancelled = 0;
+}
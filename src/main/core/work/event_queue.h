@@ -0,0 +1,43 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#ifndef SHD_EVENT_QUEUE_H_
+#define SHD_EVENT_QUEUE_H_
+
+#include <glib.h>
+
+#include "main/core/work/event.h"
+
+typedef enum _EventQueueType EventQueueType;
+enum _EventQueueType {
+    /* a binary PriorityQueue that calls event_compare on every comparison */
+    EQ_PRIORITY_QUEUE,
+    /* a d-ary KeyedHeap that stores each event's sort key inline */
+    EQ_KEYED_HEAP,
+    /* a KeyedHeap for events between hosts, plus a TimingWheel for events that hosts
+     * schedule for themselves, like timers; the two are merged when popping */
+    EQ_TIMING_WHEEL,
+};
+
+/* A queue of events ordered by event_compare, backed by one of the queue types.
+ * The queue holds a reference to every event it contains. */
+typedef struct _EventQueue EventQueue;
+
+EventQueue* eventqueue_new(EventQueueType type);
+void eventqueue_free(EventQueue* queue);
+
+gsize eventqueue_getLength(EventQueue* queue);
+gboolean eventqueue_isEmpty(EventQueue* queue);
+void eventqueue_push(EventQueue* queue, Event* event);
+Event* eventqueue_peek(EventQueue* queue);
+Event* eventqueue_pop(EventQueue* queue);
+
+/* records that the task of one of the queued events was cancelled. cancelled events
+ * are otherwise only dropped when they are executed, so once they make up a large part
+ * of the queue, they are all removed at once and appended to purged, which takes over
+ * the queue's references. */
+void eventqueue_noteCancelled(EventQueue* queue, GPtrArray* purged);
+
+#endif /* SHD_EVENT_QUEUE_H_ */
@@ -17,6 +17,9 @@ struct _Task {
     TaskObjectFreeFunc objectFree;
     TaskArgumentFreeFunc argumentFree;
     gint referenceCount;
+    /* points to where the owner tracks the pending task, if anywhere */
+    Task** handle;
+    gboolean isCancelled;
     MAGIC_DECLARE;
 };
 
@@ -25,7 +28,7 @@ Task* task_new(TaskCallbackFunc callback, gpointer callbackObject, gpointer call
         TaskObjectFreeFunc objectFree, TaskArgumentFreeFunc argumentFree) {
     utility_assert(callback != NULL);
 
-    Task* task = g_new0(Task, 1);
+    Task* task = worker_newObject(OBJECT_TYPE_TASK, sizeof(Task));
 
     task->execute = callback;
     task->callbackObject = callbackObject;
@@ -40,7 +43,16 @@ Task* task_new(TaskCallbackFunc callback, gpointer callbackObject, gpointer call
     return task;
 }
 
+static void _task_clearHandle(Task* task) {
+    if(task->handle) {
+        *(task->handle) = NULL;
+        task->handle = NULL;
+    }
+}
+
 static void _task_free(Task* task) {
+    /* clear it before the callback object that may hold it goes away */
+    _task_clearHandle(task);
     if(task->objectFree && task->callbackObject) {
         task->objectFree(task->callbackObject);
     }
@@ -48,7 +60,7 @@ static void _task_free(Task* task) {
         task->argumentFree(task->callbackArgument);
     }
     MAGIC_CLEAR(task);
-    g_free(task);
+    worker_freeObject(OBJECT_TYPE_TASK, task);
     worker_countObject(OBJECT_TYPE_TASK, COUNTER_TYPE_FREE);
 }
 
@@ -67,5 +79,26 @@ void task_unref(Task* task) {
 
 void task_execute(Task* task) {
     MAGIC_ASSERT(task);
+    utility_assert(!task->isCancelled);
+    /* the task is no longer pending once it runs */
+    _task_clearHandle(task);
     task->execute(task->callbackObject, task->callbackArgument);
 }
+
+void task_setHandle(Task* task, Task** handle) {
+    MAGIC_ASSERT(task);
+    utility_assert(handle);
+    task->handle = handle;
+    *handle = task;
+}
+
+void task_cancel(Task* task) {
+    MAGIC_ASSERT(task);
+    task->isCancelled = TRUE;
+    _task_clearHandle(task);
+}
+
+gboolean task_isCancelled(Task* task) {
+    MAGIC_ASSERT(task);
+    return task->isCancelled;
+}
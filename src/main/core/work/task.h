@@ -23,4 +23,15 @@ void task_ref(Task* task);
 void task_unref(Task* task);
 void task_execute(Task* task);
 
+/* stores the task in *handle, and resets *handle to NULL as soon as the task starts
+ * executing, is cancelled, or is freed, so that *handle is only set while the task is
+ * pending. the handle usually lives in the callback object, which the task keeps alive;
+ * otherwise, the owner of the handle must cancel the task before freeing the handle. */
+void task_setHandle(Task* task, Task** handle);
+
+/* marks the task so that none of its scheduled executions will run. a cancelled
+ * task can not be scheduled again; use a new task instead. */
+void task_cancel(Task* task);
+gboolean task_isCancelled(Task* task);
+
 #endif /* SHD_TASK_H_ */
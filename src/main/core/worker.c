@@ -11,6 +11,7 @@
 #include <pthread.h>
 #include <stddef.h>
 
+#include "external/rpth/rpth.h"
 #include "main/core/logger/shadow_logger.h"
 #include "main/core/scheduler/scheduler.h"
 #include "main/core/slave.h"
@@ -25,14 +26,20 @@
 #include "main/routing/address.h"
 #include "main/routing/dns.h"
 #include "main/routing/packet.h"
+#include "main/routing/packet_trace.h"
+#include "main/routing/path.h"
 #include "main/routing/router.h"
 #include "main/routing/topology.h"
 #include "main/utility/count_down_latch.h"
+#include "main/utility/object_pool.h"
 #include "main/utility/random.h"
 #include "main/utility/utility.h"
 #include "support/logger/log_level.h"
 #include "support/logger/logger.h"
 
+/* the last bucket counts all batches of 2^(N-1) or more events */
+#define WORKER_BATCH_HISTOGRAM_BUCKETS 16
+
 struct _Worker {
     /* our thread and an id that is unique among all threads */
     pthread_t thread;
@@ -61,6 +68,41 @@ struct _Worker {
 
     ObjectCounter* objectCounts;
 
+    /* slab pools for the small objects we create most often. they are created
+     * on first use, and handed to the slave when we are done running because
+     * other threads may still release objects into them after we exit. */
+    struct {
+        ObjectPool* task;
+        ObjectPool* event;
+        ObjectPool* packet;
+        ObjectPool* payload;
+    } pools;
+
+    /* how many consecutive events we ran for the same host under one host setup */
+    struct {
+        guint64 numBatches;
+        guint64 numEvents;
+        guint64 maxSize;
+        /* batches of size at least 2^i and less than 2^(i+1) */
+        guint64 sizeHistogram[WORKER_BATCH_HISTOGRAM_BUCKETS];
+    } batches;
+
+    /* scheduled tasks that our hosts cancelled, and what became of their events */
+    struct {
+        guint64 numCancelled;
+        /* removed from the event queues before they reached the front */
+        guint64 numPurged;
+        /* popped like any other event, but not executed */
+        guint64 numSkipped;
+    } cancellations;
+
+    /* the packet status records of this worker, if packet tracing is enabled. the
+     * trace is opened on first use, and closed once our hosts are freed. */
+    struct {
+        PacketTrace* trace;
+        gboolean isClosed;
+    } packetTrace;
+
     MAGIC_DECLARE;
 };
 
@@ -144,6 +186,161 @@ Options* worker_getOptions() {
     return slave_getOptions(worker->slave);
 }
 
+static ObjectPool** _worker_getObjectPoolSlot(Worker* worker, ObjectType otype) {
+    MAGIC_ASSERT(worker);
+
+    switch(otype) {
+        case OBJECT_TYPE_TASK: {
+            return &(worker->pools.task);
+        }
+
+        case OBJECT_TYPE_EVENT: {
+            return &(worker->pools.event);
+        }
+
+        case OBJECT_TYPE_PACKET: {
+            return &(worker->pools.packet);
+        }
+
+        case OBJECT_TYPE_PAYLOAD: {
+            return &(worker->pools.payload);
+        }
+
+        default: {
+            return NULL;
+        }
+    }
+}
+
+static void _worker_storeObjectPool(Worker* worker, ObjectType otype) {
+    ObjectPool** slot = _worker_getObjectPoolSlot(worker, otype);
+    utility_assert(slot != NULL);
+
+    if(*slot != NULL) {
+        /* give back the objects we freed for other workers before they are counted */
+        objectpool_flush(*slot);
+
+        ObjectPoolStats stats;
+        objectpool_getStats(*slot, &stats);
+        objectcounter_addPoolStats(worker->objectCounts, otype, &stats);
+
+        /* the slave frees the pool once no other thread can release objects into it.
+         * we keep using it until then, since in global mode the scheduler frees our
+         * remaining objects after we return. */
+        slave_storeObjectPool(worker->slave, *slot);
+    }
+}
+
+static void _worker_storeObjectPools(Worker* worker) {
+    MAGIC_ASSERT(worker);
+    _worker_storeObjectPool(worker, OBJECT_TYPE_TASK);
+    _worker_storeObjectPool(worker, OBJECT_TYPE_EVENT);
+    _worker_storeObjectPool(worker, OBJECT_TYPE_PACKET);
+    _worker_storeObjectPool(worker, OBJECT_TYPE_PAYLOAD);
+}
+
+static void _worker_countBatch(Worker* worker, guint64 batchSize) {
+    worker->batches.numBatches++;
+    worker->batches.numEvents += batchSize;
+    worker->batches.maxSize = MAX(worker->batches.maxSize, batchSize);
+
+    guint bucket = 0;
+    while(batchSize > 1 && bucket < WORKER_BATCH_HISTOGRAM_BUCKETS - 1) {
+        batchSize >>= 1;
+        bucket++;
+    }
+    worker->batches.sizeHistogram[bucket]++;
+}
+
+static void _worker_logBatches(Worker* worker) {
+    gdouble meanSize = (worker->batches.numBatches > 0) ?
+            ((gdouble)worker->batches.numEvents) / ((gdouble)worker->batches.numBatches) : 0.0f;
+
+    GString* histogram = g_string_new(NULL);
+    for(guint i = 0; i < WORKER_BATCH_HISTOGRAM_BUCKETS; i++) {
+        if(worker->batches.sizeHistogram[i] > 0) {
+            g_string_append_printf(histogram, " %s%"G_GUINT64_FORMAT"=%"G_GUINT64_FORMAT,
+                    (i < WORKER_BATCH_HISTOGRAM_BUCKETS - 1) ? "" : ">=",
+                    G_GUINT64_CONSTANT(1) << i, worker->batches.sizeHistogram[i]);
+        }
+    }
+
+    message("worker %u executed %"G_GUINT64_FORMAT" events in %"G_GUINT64_FORMAT" host batches, "
+            "mean batch size %f, max %"G_GUINT64_FORMAT"; batches by size:%s", worker->threadID,
+            worker->batches.numEvents, worker->batches.numBatches, meanSize, worker->batches.maxSize,
+            histogram->str);
+    g_string_free(histogram, TRUE);
+}
+
+static void _worker_logCancellations(Worker* worker) {
+    message("worker %u cancelled %"G_GUINT64_FORMAT" scheduled tasks, avoiding %"G_GUINT64_FORMAT" event "
+            "executions; %"G_GUINT64_FORMAT" events were purged from queues early, %"G_GUINT64_FORMAT" were popped "
+            "and skipped", worker->threadID, worker->cancellations.numCancelled,
+            worker->cancellations.numPurged + worker->cancellations.numSkipped,
+            worker->cancellations.numPurged, worker->cancellations.numSkipped);
+}
+
+static void _worker_logThreadStacks(Worker* worker) {
+    pth_stackpool_stats_t stats;
+    pth_stackpool_stats(&stats);
+
+    guint64 numCreated = stats.created + stats.reused;
+    gdouble meanCreate = (numCreated > 0) ? ((gdouble)stats.create_ns) / numCreated / 1000.0f : 0.0f;
+    gdouble meanExit = (stats.exited > 0) ? ((gdouble)stats.exit_ns) / stats.exited / 1000.0f : 0.0f;
+
+    message("worker %u created %"G_GUINT64_FORMAT" threads, %lu of them on reused stacks, "
+            "with mean create latency %f us; %lu threads exited with mean latency %f us; "
+            "the stack pool held up to %lu stacks", worker->threadID, numCreated, stats.reused,
+            meanCreate, stats.exited, meanExit, stats.maxpooled);
+}
+
+/* executes event and all following events of the same host that the scheduler hands us
+ * without blocking, while taking the host lock only once.
+ * returns the first event for another host that we popped, if any. */
+static Event* _worker_runHostBatch(Worker* worker, Event* event) {
+    Host* host = event_getHost(event);
+    guint64 batchSize = 0;
+
+    /* keep the host while it is not the active host between events */
+    host_ref(host);
+    host_lock(host);
+    worker_setActiveHost(host);
+    host_continueExecutionTimer(host);
+
+    while(event != NULL && event_getHost(event) == host) {
+        /* update cache, reset clocks */
+        worker->clock.now = event_getTime(event);
+
+        /* process the local event */
+        event_executeLocked(event);
+        event_unref(event);
+        batchSize++;
+
+        /* update times */
+        worker->clock.last = worker->clock.now;
+        worker->clock.now = SIMTIME_INVALID;
+
+        /* the pop may steal work from other threads, which is not time spent executing
+         * this host and must not count towards its load, and anything it runs must not
+         * see this host as the active one */
+        host_stopExecutionTimer(host);
+        worker_setActiveHost(NULL);
+
+        event = scheduler_tryPop(worker->scheduler);
+
+        if(event != NULL && event_getHost(event) == host) {
+            worker_setActiveHost(host);
+            host_continueExecutionTimer(host);
+        }
+    }
+
+    host_unlock(host);
+    host_unref(host);
+
+    _worker_countBatch(worker, batchSize);
+    return event;
+}
+
 /* this is the entry point for worker threads when running in parallel mode,
  * and otherwise is the main event loop when running in serial mode */
 gpointer worker_run(WorkerRunData* data) {
@@ -161,23 +358,33 @@ gpointer worker_run(WorkerRunData* data) {
 
     /* ask the slave for the next event, blocking until one is available that
      * we are allowed to run. when this returns NULL, we should stop. */
-    Event* event = NULL;
-    while((event = scheduler_pop(worker->scheduler)) != NULL) {
-        /* update cache, reset clocks */
-        worker->clock.now = event_getTime(event);
-
-        /* process the local event */
-        event_execute(event);
-        event_unref(event);
-
-        /* update times */
-        worker->clock.last = worker->clock.now;
-        worker->clock.now = SIMTIME_INVALID;
+    Event* event = scheduler_pop(worker->scheduler);
+    while(event != NULL) {
+        /* the scheduler pops events in the same order as one at a time, we
+         * just avoid setting up the same host again for consecutive events */
+        event = _worker_runHostBatch(worker, event);
+        if(event == NULL) {
+            event = scheduler_pop(worker->scheduler);
+        }
     }
 
+    _worker_logBatches(worker);
+    _worker_logCancellations(worker);
+
     /* this will free the host data that we have been managing */
     scheduler_awaitFinish(worker->scheduler);
 
+    /* the threads of our hosts' processes are gone, and their stacks with them */
+    _worker_logThreadStacks(worker);
+    pth_stackpool_free();
+
+    /* packets that other threads free later are not traced */
+    if(worker->packetTrace.trace) {
+        packettrace_free(worker->packetTrace.trace);
+        worker->packetTrace.trace = NULL;
+    }
+    worker->packetTrace.isClosed = TRUE;
+
     scheduler_unref(worker->scheduler);
 
     /* tell that we are done running */
@@ -191,6 +398,7 @@ gpointer worker_run(WorkerRunData* data) {
     }
 
     /* cleanup is all done, send object counts to slave */
+    _worker_storeObjectPools(worker);
     slave_storeCounts(worker->slave, worker->objectCounts);
 
     /* synchronize thread join */
@@ -233,6 +441,34 @@ gboolean worker_scheduleTask(Task* task, SimulationTime nanoDelay) {
     }
 }
 
+void worker_cancelTask(Task* task) {
+    utility_assert(task);
+
+    if(task_isCancelled(task)) {
+        return;
+    }
+
+    task_cancel(task);
+
+    /* objects may be freed by the slave thread, which has no worker */
+    if(!worker_isAlive()) {
+        return;
+    }
+
+    Worker* worker = _worker_getPrivate();
+    worker->cancellations.numCancelled++;
+
+    /* the policy may remove the host's cancelled events from its queue right away */
+    if(slave_schedulerIsRunning(worker->slave) && worker->active.host != NULL) {
+        worker->cancellations.numPurged += scheduler_noteCancelled(worker->scheduler, worker->active.host);
+    }
+}
+
+void worker_countSkippedEvent() {
+    Worker* worker = _worker_getPrivate();
+    worker->cancellations.numSkipped++;
+}
+
 static void _worker_runDeliverPacketTask(Packet* packet, gpointer userData) {
     in_addr_t ip = packet_getDestinationIP(packet);
     Router* router = host_getUpstreamRouter(_worker_getPrivate()->active.host, ip);
@@ -240,8 +476,24 @@ static void _worker_runDeliverPacketTask(Packet* packet, gpointer userData) {
     router_enqueue(router, packet);
 }
 
+static void _worker_runDeliverPacketTrainTask(GPtrArray* train, gpointer userData) {
+    /* all packets of a train go to the same address */
+    in_addr_t ip = packet_getDestinationIP(g_ptr_array_index(train, 0));
+    Router* router = host_getUpstreamRouter(_worker_getPrivate()->active.host, ip);
+    utility_assert(router != NULL);
+
+    /* the router queues or drops each one as if it arrived on its own */
+    for(guint i = 0; i < train->len; i++) {
+        router_enqueue(router, g_ptr_array_index(train, i));
+    }
+}
+
 void worker_sendPacket(Packet* packet) {
-    utility_assert(packet != NULL);
+    worker_sendPackets(&packet, 1);
+}
+
+void worker_sendPackets(Packet** packets, guint numPackets) {
+    utility_assert(packets != NULL && numPackets > 0);
 
     /* get our thread-private worker */
     Worker* worker = _worker_getPrivate();
@@ -250,8 +502,8 @@ void worker_sendPacket(Packet* packet) {
         return;
     }
 
-    in_addr_t srcIP = packet_getSourceIP(packet);
-    in_addr_t dstIP = packet_getDestinationIP(packet);
+    in_addr_t srcIP = packet_getSourceIP(packets[0]);
+    in_addr_t dstIP = packet_getDestinationIP(packets[0]);
 
     Address* srcAddress = worker_resolveIPToAddress(srcIP);
     Address* dstAddress = worker_resolveIPToAddress(dstIP);
@@ -263,44 +515,81 @@ void worker_sendPacket(Packet* packet) {
 
     gboolean bootstrapping = worker_isBootstrapActive();
 
-    /* check if network reliability forces us to 'drop' the packet */
-    gdouble reliability = topology_getReliability(worker_getTopology(), srcAddress, dstAddress);
-    Random* random = host_getRandom(worker_getActiveHost());
-    gdouble chance = random_nextDouble(random);
+    /* the path is the same for every packet, so we only look it up once */
+    Path* path = topology_getPath(worker_getTopology(), srcAddress, dstAddress);
+    if(!path) {
+        for(guint i = 0; i < numPackets; i++) {
+            packet_addDeliveryStatus(packets[i], PDS_INET_DROPPED);
+        }
+        return;
+    }
 
-    /* don't drop control packets with length 0, otherwise congestion
-     * control has problems responding to packet loss */
-    if(bootstrapping || chance <= reliability || packet_getPayloadLength(packet) == 0) {
-        /* the sender's packet will make it through, find latency */
-        gdouble latency = topology_getLatency(worker_getTopology(), srcAddress, dstAddress);
-        SimulationTime delay = (SimulationTime) ceil(latency * SIMTIME_ONE_MILLISECOND);
-        SimulationTime deliverTime = worker->clock.now + delay;
+    gdouble reliability = path_getReliability(path);
+    gdouble latency = path_getLatency(path);
+    SimulationTime delay = (SimulationTime) ceil(latency * SIMTIME_ONE_MILLISECOND);
+    SimulationTime deliverTime = worker->clock.now + delay;
 
-        topology_incrementPathPacketCounter(worker_getTopology(), srcAddress, dstAddress);
+    Random* random = host_getRandom(worker_getActiveHost());
+    GPtrArray* train = NULL;
+    Packet* single = NULL;
 
-        /* TODO this should change for sending to remote slave (on a different machine)
-         * this is the only place where tasks are sent between separate hosts */
+    for(guint i = 0; i < numPackets; i++) {
+        Packet* packet = packets[i];
+        utility_assert(packet_getDestinationIP(packet) == dstIP);
 
-        Host* srcHost = worker->active.host;
-        GQuark dstID = (GQuark)address_getID(dstAddress);
-        Host* dstHost = scheduler_getHost(worker->scheduler, dstID);
-        utility_assert(dstHost);
+        /* check if network reliability forces us to 'drop' the packet */
+        gdouble chance = random_nextDouble(random);
 
+        /* don't drop control packets with length 0, otherwise congestion
+         * control has problems responding to packet loss */
+        if(!(bootstrapping || chance <= reliability || packet_getPayloadLength(packet) == 0)) {
+            packet_addDeliveryStatus(packet, PDS_INET_DROPPED);
+            continue;
+        }
+
+        path_incrementPacketCount(path, worker->threadID);
         packet_addDeliveryStatus(packet, PDS_INET_SENT);
 
         /* the packetCopy starts with 1 ref, which will be held by the packet task
          * and unreffed after the task is finished executing. */
         Packet* packetCopy = packet_copy(packet);
 
-        Task* packetTask = task_new((TaskCallbackFunc)_worker_runDeliverPacketTask,
-                packetCopy, NULL, (TaskObjectFreeFunc)packet_unref, NULL);
-        Event* packetEvent = event_new_(packetTask, deliverTime, srcHost, dstHost);
-        task_unref(packetTask);
+        if(!single && !train) {
+            single = packetCopy;
+        } else {
+            if(!train) {
+                train = g_ptr_array_new_full(numPackets, (GDestroyNotify)packet_unref);
+                g_ptr_array_add(train, single);
+                single = NULL;
+            }
+            g_ptr_array_add(train, packetCopy);
+        }
+    }
 
-        scheduler_push(worker->scheduler, packetEvent, srcHost, dstHost);
+    /* TODO this should change for sending to remote slave (on a different machine)
+     * this is the only place where tasks are sent between separate hosts */
+
+    Host* srcHost = worker->active.host;
+    GQuark dstID = (GQuark)address_getID(dstAddress);
+    Host* dstHost = scheduler_getHost(worker->scheduler, dstID);
+    utility_assert(dstHost);
+
+    Task* packetTask = NULL;
+    if(single) {
+        packetTask = task_new((TaskCallbackFunc)_worker_runDeliverPacketTask,
+                single, NULL, (TaskObjectFreeFunc)packet_unref, NULL);
+    } else if(train) {
+        packetTask = task_new((TaskCallbackFunc)_worker_runDeliverPacketTrainTask,
+                train, NULL, (TaskObjectFreeFunc)g_ptr_array_unref, NULL);
     } else {
-        packet_addDeliveryStatus(packet, PDS_INET_DROPPED);
+        /* all of them were dropped */
+        return;
     }
+
+    Event* packetEvent = event_new_(packetTask, deliverTime, srcHost, dstHost);
+    task_unref(packetTask);
+
+    scheduler_push(worker->scheduler, packetEvent, srcHost, dstHost);
 }
 
 static void _worker_bootHost(Host* host, Worker* worker) {
@@ -442,6 +731,65 @@ void worker_countObject(ObjectType otype, CounterType ctype) {
     }
 }
 
+PacketTrace* worker_getPacketTrace() {
+    if(!worker_isAlive()) {
+        return NULL;
+    }
+
+    Worker* worker = _worker_getPrivate();
+    if(!worker->packetTrace.trace && !worker->packetTrace.isClosed) {
+        gchar* name = g_strdup_printf("packet-trace-%u.bin", worker->threadID);
+        gchar* path = g_build_filename(slave_getDataPath(worker->slave), name, NULL);
+        worker->packetTrace.trace = packettrace_new(path);
+        /* don't try again if we can't open the file */
+        worker->packetTrace.isClosed = (worker->packetTrace.trace == NULL);
+        g_free(path);
+        g_free(name);
+    }
+
+    return worker->packetTrace.trace;
+}
+
+void worker_countCopiedBytes(CopyType ctype, gsize numBytes) {
+    /* the slave thread captures packets of hosts it frees */
+    if(worker_isAlive()) {
+        Worker* worker = _worker_getPrivate();
+        objectcounter_addCopiedBytes(worker->objectCounts, ctype, (guint64)numBytes);
+    } else {
+        slave_countCopiedBytes(ctype, numBytes);
+    }
+}
+
+gpointer worker_newObject(ObjectType otype, gsize objectSize) {
+    /* the slave thread creates some objects before the workers start */
+    if(!worker_isAlive()) {
+        return objectpool_allocUnpooled(objectSize);
+    }
+
+    Worker* worker = _worker_getPrivate();
+    ObjectPool** slot = _worker_getObjectPoolSlot(worker, otype);
+    if(slot == NULL) {
+        return objectpool_allocUnpooled(objectSize);
+    }
+
+    if(*slot == NULL) {
+        *slot = objectpool_new(objectSize);
+    }
+    return objectpool_alloc(*slot);
+}
+
+void worker_freeObject(ObjectType otype, gpointer object) {
+    ObjectPool* callerPool = NULL;
+    if(worker_isAlive()) {
+        Worker* worker = _worker_getPrivate();
+        ObjectPool** slot = _worker_getObjectPoolSlot(worker, otype);
+        if(slot != NULL) {
+            callerPool = *slot;
+        }
+    }
+    objectpool_release(callerPool, object);
+}
+
 gboolean worker_isBootstrapActive() {
     Worker* worker = _worker_getPrivate();
 
@@ -19,6 +19,7 @@
 #include "main/routing/address.h"
 #include "main/routing/dns.h"
 #include "main/routing/packet.h"
+#include "main/routing/packet_trace.h"
 #include "main/routing/topology.h"
 #include "main/utility/count_down_latch.h"
 #include "support/logger/log_level.h"
@@ -40,10 +41,29 @@ Topology* worker_getTopology();
 Options* worker_getOptions();
 gpointer worker_run(WorkerRunData*);
 gboolean worker_scheduleTask(Task* task, SimulationTime nanoDelay);
+/* cancels a task that the active host scheduled with worker_scheduleTask, so that it
+ * will not run. callers track their pending tasks with task_setHandle; to reschedule
+ * a task, cancel it and schedule a new one. */
+void worker_cancelTask(Task* task);
+/* counts an event that was not executed because its task was cancelled */
+void worker_countSkippedEvent();
 void worker_sendPacket(Packet* packet);
+/* sends packets that all go from and to the same address at the same time, and
+ * delivers the ones that the path does not drop in a single event */
+void worker_sendPackets(Packet** packets, guint numPackets);
 gboolean worker_isAlive();
 
 void worker_countObject(ObjectType otype, CounterType ctype);
+void worker_countCopiedBytes(CopyType ctype, gsize numBytes);
+/* returns the packet trace of the calling worker, or NULL if there is no worker or
+ * its trace is closed. only call this if packet tracing is enabled. */
+PacketTrace* worker_getPacketTrace();
+
+/* allocate and free objects of type otype from this worker's object pool. objects
+ * from worker_newObject are zeroed and must be freed with worker_freeObject, which
+ * may be called from any thread. */
+gpointer worker_newObject(ObjectType otype, gsize objectSize);
+void worker_freeObject(ObjectType otype, gpointer object);
 
 SimulationTime worker_getCurrentTime();
 EmulatedTime worker_getEmulatedTime();
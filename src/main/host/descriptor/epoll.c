@@ -62,6 +62,9 @@ struct _EpollWatch {
     struct epoll_event event;
     /* current status of the underlying shadow descriptor */
     EpollWatchFlags flags;
+    /* links the watch into the epoll's ready queue, while inReadyQueue is set */
+    GList readyLink;
+    gboolean inReadyQueue;
     gint referenceCount;
     MAGIC_DECLARE;
 };
@@ -89,13 +92,23 @@ struct _Epoll {
     /* holds the wrappers for the descriptors we are watching for events */
     GHashTable* watching;
 
-    /* holds the descriptors that we are watching that have events */
-    GHashTable* ready;
+    /* holds the watches that have events, through their embedded links. each
+     * watch in the queue holds a reference. */
+    GQueue ready;
 
     Process* ownerProcess;
     gint osEpollChild;
     gint osEpollParent;
 
+    /* the number of OS file descriptors registered with osEpollChild. we only
+     * ask the OS about events when there are any. */
+    guint numOSDescriptors;
+    /* whether the OS descriptors had events the last time we asked */
+    gboolean isReadyOS;
+    /* how often we asked the OS about events, and how often we skipped it */
+    guint64 numOSChecks;
+    guint64 numOSChecksAvoided;
+
     MAGIC_DECLARE;
 };
 
@@ -113,6 +126,7 @@ static EpollWatch* _epollwatch_new(Epoll* epoll, Descriptor* descriptor, struct
 
     watch->descriptor = descriptor;
     watch->event = *event;
+    watch->readyLink.data = watch;
     watch->referenceCount = 1;
 
     return watch;
@@ -140,13 +154,37 @@ static void _epollwatch_unref(EpollWatch* watch) {
     }
 }
 
+static void _epoll_queueReady(Epoll* epoll, EpollWatch* watch) {
+    MAGIC_ASSERT(watch);
+    if(!watch->inReadyQueue) {
+        _epollwatch_ref(watch);
+        watch->inReadyQueue = TRUE;
+        g_queue_push_tail_link(&epoll->ready, &watch->readyLink);
+    }
+}
+
+static void _epoll_unqueueReady(Epoll* epoll, EpollWatch* watch) {
+    MAGIC_ASSERT(watch);
+    if(watch->inReadyQueue) {
+        g_queue_unlink(&epoll->ready, &watch->readyLink);
+        watch->inReadyQueue = FALSE;
+        _epollwatch_unref(watch);
+    }
+}
+
 /* should only be called from descriptor dereferencing the functionTable */
 static void _epoll_free(Epoll* epoll) {
     MAGIC_ASSERT(epoll);
 
+    info("epoll descriptor %i asked the OS for events %"G_GUINT64_FORMAT" times and "
+            "avoided %"G_GUINT64_FORMAT" checks", epoll->super.handle,
+            epoll->numOSChecks, epoll->numOSChecksAvoided);
+
     /* this unrefs all of the remaining watches */
+    while(!g_queue_is_empty(&epoll->ready)) {
+        _epoll_unqueueReady(epoll, g_queue_peek_head(&epoll->ready));
+    }
     g_hash_table_destroy(epoll->watching);
-    g_hash_table_destroy(epoll->ready);
 
     epoll_ctl(epoll->osEpollParent, EPOLL_CTL_DEL, epoll->osEpollChild, NULL);
     close(epoll->osEpollChild);
@@ -212,7 +250,7 @@ Epoll* epoll_new(gint handle) {
 
     /* allocate backend needed for managing events for this descriptor */
     epoll->watching = g_hash_table_new_full(g_int_hash, g_int_equal, NULL, (GDestroyNotify)_epollwatch_unref);
-    epoll->ready = g_hash_table_new_full(g_int_hash, g_int_equal, NULL, (GDestroyNotify)_epollwatch_unref);
+    g_queue_init(&epoll->ready);
 
     /* the application may want us to watch some system files, so we need a
      * real OS epoll fd so we can offload that task.
@@ -328,18 +366,24 @@ static gboolean _epollwatch_isReady(EpollWatch* watch) {
 static gboolean _epoll_isReadyOS(Epoll* epoll) {
     MAGIC_ASSERT(epoll);
 
+    /* without any OS descriptors there is nothing to ask the OS about */
+    if(epoll->numOSDescriptors == 0) {
+        epoll->numOSChecksAvoided++;
+        epoll->isReadyOS = FALSE;
+        return FALSE;
+    }
+
+    epoll->numOSChecks++;
+
     /* the os epoll will be readable when ready */
     struct epoll_event epoll_ev;
     memset(&epoll_ev, 0, sizeof(struct epoll_event));
 
     gint ret = epoll_wait(epoll->osEpollParent, &epoll_ev, 1, 0);
-    if(ret > 0 && epoll_ev.events == EPOLLIN) {
-        /* the parent is readable, which means the child has events we should collect */
-        return TRUE;
-    }
 
-    /* the os descriptor has no events */
-    return FALSE;
+    /* if the parent is readable, the child has events we should collect */
+    epoll->isReadyOS = (ret > 0 && epoll_ev.events == EPOLLIN) ? TRUE : FALSE;
+    return epoll->isReadyOS;
 }
 
 static void _epoll_scheduleNotification(Epoll* epoll) {
@@ -375,8 +419,13 @@ static gboolean _epoll_adjustStatus(Epoll* epoll) {
     /* check the status on the parent epoll fd and adjust as needed */
     DescriptorStatus status = descriptor_getStatus(&epoll->super);
 
-    /* check status to see if we need to schedule a notification */
-    gboolean isReady = g_hash_table_size(epoll->ready) > 0 || _epoll_isReadyOS(epoll) ? TRUE : FALSE;
+    /* check status to see if we need to schedule a notification. this runs every
+     * time a watched descriptor changes status, so we use what the OS told us the
+     * last time we asked instead of asking again. */
+    if(g_queue_is_empty(&epoll->ready)) {
+        epoll->numOSChecksAvoided++;
+    }
+    gboolean isReady = !g_queue_is_empty(&epoll->ready) || epoll->isReadyOS ? TRUE : FALSE;
 
     /* for epoll fd, readable means some children watch fds have events.
      * we only need to take action if the status changed. */
@@ -471,8 +520,8 @@ gint epoll_control(Epoll* epoll, gint operation, Descriptor* descriptor, struct
             /* its deleted, so stop listening for updates */
             descriptor_removeEpollListener(watch->descriptor, (Descriptor*)epoll);
 
-            /* unref gets called on the watch when it is removed from these tables */
-            g_hash_table_remove(epoll->ready, watchHandleRef);
+            /* unref gets called on the watch when it is removed from these */
+            _epoll_unqueueReady(epoll, watch);
             g_hash_table_remove(epoll->watching, watchHandleRef);
 
             break;
@@ -493,8 +542,19 @@ gint epoll_controlOS(Epoll* epoll, gint operation, gint fileDescriptor,
     /* ask the OS about any events on our kernel epoll descriptor */
     gint ret = epoll_ctl(epoll->osEpollChild, operation, fileDescriptor, event);
     if(ret < 0) {
-        ret = errno;
+        return errno;
     }
+
+    /* the OS drops descriptors that are closed without EPOLL_CTL_DEL, so this may
+     * overcount, which only costs us some checks that we could have avoided */
+    if(operation == EPOLL_CTL_ADD) {
+        epoll->numOSDescriptors++;
+    } else if(operation == EPOLL_CTL_DEL && epoll->numOSDescriptors > 0) {
+        epoll->numOSDescriptors--;
+    }
+
+    /* the changed registrations decide whether the OS has events for us */
+    _epoll_isReadyOS(epoll);
     return ret;
 }
 
@@ -506,11 +566,11 @@ gint epoll_getEvents(Epoll* epoll, struct epoll_event* eventArray, gint eventArr
      * overflow. the number of actual events is returned in nEvents. */
     gint eventIndex = 0;
 
-    GHashTableIter iter;
-    gpointer key, value;
-    g_hash_table_iter_init(&iter, epoll->ready);
-    while(g_hash_table_iter_next(&iter, &key, &value) && (eventIndex < eventArrayLength)) {
-        EpollWatch* watch = value;
+    /* visit each ready watch at most once; watches that stay ready go to the back
+     * of the queue so that a small event array does not starve the others */
+    guint numReady = g_queue_get_length(&epoll->ready);
+    for(guint i = 0; i < numReady && eventIndex < eventArrayLength; i++) {
+        EpollWatch* watch = g_queue_peek_head(&epoll->ready);
         MAGIC_ASSERT(watch);
 
         if(_epollwatch_isReady(watch)) {
@@ -544,21 +604,36 @@ gint epoll_getEvents(Epoll* epoll, struct epoll_event* eventArray, gint eventArr
                 watch->flags |= EWF_ONESHOT_REPORTED;
             }
         }
+
+        /* it comes back through epoll_descriptorStatusChanged once it has a new event */
+        if(_epollwatch_isReady(watch)) {
+            g_queue_unlink(&epoll->ready, &watch->readyLink);
+            g_queue_push_tail_link(&epoll->ready, &watch->readyLink);
+        } else {
+            _epoll_unqueueReady(epoll, watch);
+        }
     }
 
     gint space = eventArrayLength - eventIndex;
-    if(space && _epoll_isReadyOS(epoll)) {
-        /* now we have to get events from the OS descriptors */
+    if(space && epoll->numOSDescriptors > 0) {
+        /* now we have to get events from the OS descriptors. asking the child directly
+         * tells us whether it is ready too, so we skip asking the parent first. */
         struct epoll_event osEvents[space];
         memset(&osEvents, 0, space*sizeof(struct epoll_event));
 
         /* since we are in shadow context, this will be forwarded to the OS epoll */
+        epoll->numOSChecks++;
         gint nos = epoll_wait(epoll->osEpollChild, osEvents, space, 0);
 
         if(nos == -1) {
             warning("error in epoll_wait for OS events on epoll fd %i", epoll->osEpollChild);
+            nos = 0;
         }
 
+        /* the plugin did not handle these events yet, so we count them as still ready
+         * until the next notification asks the OS again */
+        epoll->isReadyOS = nos > 0 ? TRUE : FALSE;
+
         /* nos will fit into eventArray */
         for(gint j = 0; j < nos; j++) {
             eventArray[eventIndex] = osEvents[j];
@@ -597,13 +672,10 @@ void epoll_descriptorStatusChanged(Epoll* epoll, Descriptor* descriptor) {
 
     /* check if its ready (has an event to report) now */
     if(_epollwatch_isReady(watch)) {
-        if(!g_hash_table_contains(epoll->ready, watchHandleRef)) {
-            _epollwatch_ref(watch);
-            g_hash_table_replace(epoll->ready, watchHandleRef, watch);
-        }
+        _epoll_queueReady(epoll, watch);
     } else {
-        /* this calls unref on the watch if its in the table */
-        g_hash_table_remove(epoll->ready, watchHandleRef);
+        /* this calls unref on the watch if its in the queue */
+        _epoll_unqueueReady(epoll, watch);
     }
 
     /* check the status on the parent epoll fd and adjust as needed */
@@ -652,7 +724,7 @@ static void _epoll_tryNotify(Epoll* epoll, gpointer userData) {
      * check if there is events on the OS epoll instance, but only if we would otherwise
      * not call the process. this ensures the process can collect events for which we are
      * using the OS as a backend, even if none of our own watches have ready events. */
-    gboolean isReady = g_hash_table_size(epoll->ready) > 0 || _epoll_isReadyOS(epoll) ? TRUE : FALSE;
+    gboolean isReady = !g_queue_is_empty(&epoll->ready) || _epoll_isReadyOS(epoll) ? TRUE : FALSE;
 
     if(isReady) {
         /* an event should have only been scheduled for the special epollfd */
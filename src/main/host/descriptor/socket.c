@@ -68,18 +68,18 @@ void socket_close(Socket* socket) {
     socket->vtable->close((Descriptor*)socket);
 }
 
-gssize socket_sendUserData(Socket* socket, gconstpointer buffer, gsize nBytes,
+gssize socket_sendUserData(Socket* socket, const struct iovec* iov, gint iovcnt,
         in_addr_t ip, in_port_t port) {
     MAGIC_ASSERT(socket);
     MAGIC_ASSERT(socket->vtable);
-    return socket->vtable->send((Transport*)socket, buffer, nBytes, ip, port);
+    return socket->vtable->send((Transport*)socket, iov, iovcnt, ip, port);
 }
 
-gssize socket_receiveUserData(Socket* socket, gpointer buffer, gsize nBytes,
+gssize socket_receiveUserData(Socket* socket, const struct iovec* iov, gint iovcnt,
         in_addr_t* ip, in_port_t* port) {
     MAGIC_ASSERT(socket);
     MAGIC_ASSERT(socket->vtable);
-    return socket->vtable->receive((Transport*)socket, buffer, nBytes, ip, port);
+    return socket->vtable->receive((Transport*)socket, iov, iovcnt, ip, port);
 }
 
 TransportFunctionTable socket_functions = {
@@ -334,8 +334,8 @@ gboolean socket_addToInputBuffer(Socket* socket, Packet* packet) {
     Descriptor* descriptor = (Descriptor *)socket;
     tracker_updateSocketInputBuffer(tracker, descriptor->handle, socket->inputBufferLength, socket->inputBufferSize);
 
-    /* we just added a packet, so we are readable */
-    if(socket->inputBufferLength > 0) {
+    /* we just added a packet, so we are readable, even if it is an empty datagram */
+    if(!g_queue_is_empty(socket->inputBuffer)) {
         descriptor_adjustStatus((Descriptor*)socket, DS_READABLE, TRUE);
     }
 
@@ -363,7 +363,7 @@ Packet* socket_removeFromInputBuffer(Socket* socket) {
         tracker_updateSocketInputBuffer(tracker, descriptor->handle, socket->inputBufferLength, socket->inputBufferSize);
 
         /* we are not readable if we are now empty */
-        if(socket->inputBufferLength <= 0) {
+        if(g_queue_is_empty(socket->inputBuffer)) {
             descriptor_adjustStatus((Descriptor*)socket, DS_READABLE, FALSE);
         }
     }
@@ -474,3 +474,40 @@ gchar* socket_getUnixPath(Socket* socket) {
     MAGIC_ASSERT(socket);
     return socket->unixPath;
 }
+
+void socket_setPacingRate(Socket* socket, guint64 bytesPerSecond) {
+    MAGIC_ASSERT(socket);
+    socket->pacingRate = bytesPerSecond;
+    /* the interface keeps paced sockets sorted by this time, so it must not change
+     * until the socket is woken up */
+    if(bytesPerSecond == 0 && !socket->isPaced) {
+        socket->pacingNextSendTime = 0;
+    }
+}
+
+SimulationTime socket_getPacingTime(Socket* socket) {
+    MAGIC_ASSERT(socket);
+    return socket->pacingNextSendTime;
+}
+
+void socket_advancePacingTime(Socket* socket, SimulationTime now, gsize bytes) {
+    MAGIC_ASSERT(socket);
+
+    if(socket->pacingRate == 0 || bytes == 0) {
+        return;
+    }
+
+    /* idle time does not build up credit for a burst later */
+    SimulationTime start = MAX(now, socket->pacingNextSendTime);
+    socket->pacingNextSendTime = start + (SimulationTime)((bytes * SIMTIME_ONE_SECOND) / socket->pacingRate);
+}
+
+gboolean socket_isPaced(Socket* socket) {
+    MAGIC_ASSERT(socket);
+    return socket->isPaced;
+}
+
+void socket_setPaced(Socket* socket, gboolean isPaced) {
+    MAGIC_ASSERT(socket);
+    socket->isPaced = isPaced;
+}
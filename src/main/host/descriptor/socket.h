@@ -74,6 +74,13 @@ struct _Socket {
     gsize outputBufferSizePending;
     gsize outputBufferLength;
 
+    /* bytes per second that the interface sends our packets at, 0 if unpaced */
+    guint64 pacingRate;
+    /* the earliest time the interface may send our next packet */
+    SimulationTime pacingNextSendTime;
+    /* TRUE while the interface holds us back until pacingNextSendTime */
+    gboolean isPaced;
+
     MAGIC_DECLARE;
 };
 
@@ -99,6 +106,12 @@ gsize socket_getOutputBufferSpace(Socket* socket);
 gboolean socket_addToOutputBuffer(Socket* socket, Packet* packet);
 Packet* socket_removeFromOutputBuffer(Socket* socket);
 
+void socket_setPacingRate(Socket* socket, guint64 bytesPerSecond);
+SimulationTime socket_getPacingTime(Socket* socket);
+void socket_advancePacingTime(Socket* socket, SimulationTime now, gsize bytes);
+gboolean socket_isPaced(Socket* socket);
+void socket_setPaced(Socket* socket, gboolean isPaced);
+
 gboolean socket_isBound(Socket* socket);
 gboolean socket_getPeerName(Socket* socket, in_addr_t* ip, in_port_t* port);
 void socket_setPeerName(Socket* socket, in_addr_t ip, in_port_t port);
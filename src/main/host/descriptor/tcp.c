@@ -27,6 +27,8 @@
 #include "main/host/descriptor/descriptor.h"
 #include "main/host/descriptor/socket.h"
 #include "main/host/descriptor/tcp_cong.h"
+#include "main/host/descriptor/tcp_cong_bbr.h"
+#include "main/host/descriptor/tcp_cong_cubic.h"
 #include "main/host/descriptor/tcp_cong_reno.h"
 #include "main/host/descriptor/tcp_retransmit_tally.h"
 #include "main/host/descriptor/transport.h"
@@ -35,7 +37,7 @@
 #include "main/host/protocol.h"
 #include "main/host/tracker.h"
 #include "main/routing/address.h"
-#include "main/utility/priority_queue.h"
+#include "main/utility/sequence_ring.h"
 #include "main/utility/utility.h"
 #include "support/logger/logger.h"
 
@@ -166,22 +168,27 @@ struct _TCP {
         guint32 packetsSent;
         /* total number of quick acknowledgments sent */
         guint32 numQuickACKsSent;
-        gboolean delayedACKIsScheduled;
+        /* the pending delayed ACK task, or NULL if none is scheduled */
+        Task* delayedACKTask;
         guint32 delayedACKCounter;
         /* list of selective ACKs, packets received after a missing packet */
         GList* selectiveACKs;
     } send;
 
     struct {
-        /* TCP provides reliable transport, keep track of packets until they are acked */
-        GHashTable* queue;
+        /* TCP provides reliable transport, keep track of packets until they are acked
+         * or sacked. indexed by sequence number, so that acks only visit the packets
+         * they release. */
+        SequenceRing* queue;
         /* track amount of queued application data */
         gsize queueLength;
         /* retransmission timeout value (rto), in milliseconds */
         gint timeout;
-        /* when the scheduled timer events will expire; empty if no retransmit is scheduled */
-        PriorityQueue* scheduledTimerExpirations;
-        /* our updated expiration time, to determine if previous events are still valid */
+        /* the pending timer task and when it will run, or NULL if none is scheduled */
+        Task* timerTask;
+        SimulationTime timerTaskExpiration;
+        /* our updated expiration time; 0 if the timer is stopped. the pending task may
+         * run earlier than this, in which case it schedules the next one. */
         SimulationTime desiredTimerExpiration;
         /* number of times we backed off due to congestion */
         guint backoffCount;
@@ -219,13 +226,16 @@ struct _TCP {
         guint32 rtt;
     } info;
 
-    /* TCP throttles outgoing data packets if too many are in flight */
-    PriorityQueue* throttledOutput;
+    /* TCP throttles outgoing data packets if too many are in flight. they are indexed
+     * by sequence number, while control packets have none and go out first, in order. */
+    SequenceRing* throttledOutput;
+    GQueue* throttledControl;
     /* track amount of queued application data */
     gsize throttledOutputLength;
 
-    /* TCP ensures that the user receives data in-order */
-    PriorityQueue* unorderedInput;
+    /* TCP ensures that the user receives data in-order. indexed by sequence number,
+     * with the ring's base following the next sequence we expect. */
+    SequenceRing* unorderedInput;
     /* track amount of queued application data */
     gsize unorderedInputLength;
 
@@ -711,6 +721,15 @@ gsize tcp_getInputBufferLength(TCP* tcp) {
     return socket_getInputBufferLength(&(tcp->super)) + tcp->unorderedInputLength;
 }
 
+/* returns the memory used by the packet queues themselves, not counting the packets */
+static gsize _tcp_getQueueAllocatedBytes(TCP* tcp) {
+    MAGIC_ASSERT(tcp);
+    return sequencering_getAllocatedBytes(tcp->throttledOutput) +
+            sequencering_getAllocatedBytes(tcp->unorderedInput) +
+            sequencering_getAllocatedBytes(tcp->retransmit.queue) +
+            (g_queue_get_length(tcp->throttledControl) * sizeof(GList));
+}
+
 static gsize _tcp_getBufferSpaceOut(TCP* tcp) {
     MAGIC_ASSERT(tcp);
     /* account for throttled and retransmission buffer */
@@ -726,12 +745,22 @@ static gsize _tcp_getBufferSpaceIn(TCP* tcp) {
     return MAX(0, space);
 }
 
+static gboolean _tcp_throttlePacket(TCP* tcp, Packet* packet) {
+    PacketTCPHeader* header = packet_getTCPHeader(packet);
+    if(header->sequence == 0) {
+        g_queue_push_tail(tcp->throttledControl, packet);
+        return TRUE;
+    } else {
+        /* fails if it is already throttled, or was acked while we retransmitted it */
+        return sequencering_insert(tcp->throttledOutput, header->sequence, packet);
+    }
+}
+
 static void _tcp_bufferPacketOut(TCP* tcp, Packet* packet) {
     MAGIC_ASSERT(tcp);
 
-    if(!priorityqueue_find(tcp->throttledOutput, packet)) {
+    if(_tcp_throttlePacket(tcp, packet)) {
         /* TCP wants to avoid congestion */
-        priorityqueue_push(tcp->throttledOutput, packet);
         packet_ref(packet);
 
         /* the packet takes up more space */
@@ -747,9 +776,11 @@ static void _tcp_bufferPacketOut(TCP* tcp, Packet* packet) {
 static void _tcp_bufferPacketIn(TCP* tcp, Packet* packet) {
     MAGIC_ASSERT(tcp);
 
-    if(!priorityqueue_find(tcp->unorderedInput, packet)) {
+    PacketTCPHeader* header = packet_getTCPHeader(packet);
+
+    /* if we already have this sequence, the packet is a duplicate */
+    if(sequencering_insert(tcp->unorderedInput, header->sequence, packet)) {
         /* TCP wants in-order data */
-        priorityqueue_push(tcp->unorderedInput, packet);
         packet_ref(packet);
 
         /* account for the packet length */
@@ -788,7 +819,9 @@ static void _tcp_updateSendWindow(TCP* tcp) {
     tcp->send.window = (guint32)MIN(tcp->cong.cwnd, (gint)tcp->receive.lastWindow);
 }
 
-static Packet* _tcp_createPacket(TCP* tcp, enum ProtocolTCPFlags flags, gconstpointer payload, gsize payloadLength) {
+/* the packet's payload is the given range of the buffer, which may be NULL */
+static Packet* _tcp_createPacket(TCP* tcp, enum ProtocolTCPFlags flags, PayloadBuffer* payload,
+        gsize payloadOffset, gsize payloadLength) {
     MAGIC_ASSERT(tcp);
 
     /*
@@ -822,7 +855,7 @@ static Packet* _tcp_createPacket(TCP* tcp, enum ProtocolTCPFlags flags, gconstpo
 
     /* create the TCP packet. the ack, window, and timestamps will be set in _tcp_flush */
     Host* host = worker_getActiveHost();
-    Packet* packet = packet_new(payload, payloadLength, (guint)host_getID(host), host_getNewPacketID(host));
+    Packet* packet = packet_newSlice(payload, payloadOffset, payloadLength, (guint)host_getID(host), host_getNewPacketID(host));
     packet_setTCP(packet, flags, sourceIP, sourcePort, destinationIP, destinationPort, sequence);
     packet_addDeliveryStatus(packet, PDS_SND_CREATED);
 
@@ -838,7 +871,7 @@ static void _tcp_sendControlPacket(TCP* tcp, enum ProtocolTCPFlags flags) {
     MAGIC_ASSERT(tcp);
 
     /* create the ack packet, without any payload data */
-    Packet* control = _tcp_createPacket(tcp, flags, NULL, 0);
+    Packet* control = _tcp_createPacket(tcp, flags, NULL, 0, 0);
 
     /* make sure it gets sent before whatever else is in the queue */
     packet_setPriority(control, 0.0);
@@ -855,12 +888,10 @@ static void _tcp_addRetransmit(TCP* tcp, Packet* packet) {
     MAGIC_ASSERT(tcp);
 
     PacketTCPHeader* header = packet_getTCPHeader(packet);
-    gpointer key = GINT_TO_POINTER(header->sequence);
 
-    /* if it is already in the queue, it won't consume another packet reference */
-    if(g_hash_table_lookup(tcp->retransmit.queue, key) == NULL) {
-        /* its not in the queue yet */
-        g_hash_table_insert(tcp->retransmit.queue, key, packet);
+    /* if it is already in the queue, it won't consume another packet reference.
+     * retransmissions that were acked while waiting to be sent are not kept either. */
+    if(sequencering_insert(tcp->retransmit.queue, header->sequence, packet)) {
         packet_ref(packet);
 
         packet_addDeliveryStatus(packet, PDS_SND_TCP_ENQUEUE_RETRANSMIT);
@@ -872,23 +903,19 @@ static void _tcp_addRetransmit(TCP* tcp, Packet* packet) {
     }
 }
 
+static void _tcp_releaseRetransmit(TCP* tcp, Packet* packet) {
+    tcp->retransmit.queueLength -= packet_getPayloadLength(packet);
+    packet_addDeliveryStatus(packet, PDS_SND_TCP_DEQUEUE_RETRANSMIT);
+    packet_unref(packet);
+}
+
 /* remove all packets with a sequence number less than the sequence parameter */
 static void _tcp_clearRetransmit(TCP* tcp, guint sequence) {
     MAGIC_ASSERT(tcp);
 
-    GHashTableIter iter;
-    gpointer key, value;
-    g_hash_table_iter_init(&iter, tcp->retransmit.queue);
-
-    while(g_hash_table_iter_next(&iter, &key, &value)) {
-        guint ackedSequence = GPOINTER_TO_INT(key);
-        Packet* ackedPacket = (Packet*)value;
-
-        if(ackedSequence < sequence) {
-            tcp->retransmit.queueLength -= packet_getPayloadLength(ackedPacket);
-            packet_addDeliveryStatus(ackedPacket, PDS_SND_TCP_DEQUEUE_RETRANSMIT);
-            g_hash_table_iter_remove(&iter);
-        }
+    Packet* packet = NULL;
+    while((packet = sequencering_stealBelow(tcp->retransmit.queue, sequence)) != NULL) {
+        _tcp_releaseRetransmit(tcp, packet);
     }
 
     if(_tcp_getBufferSpaceOut(tcp) > 0) {
@@ -900,17 +927,10 @@ static void _tcp_clearRetransmit(TCP* tcp, guint sequence) {
 static void _tcp_clearRetransmitRange(TCP* tcp, guint begin, guint end) {
     MAGIC_ASSERT(tcp);
 
-
     for (uint32_t seq = begin; seq < end; ++seq) {
-        Packet *packet = g_hash_table_lookup(tcp->retransmit.queue,
-                                             GINT_TO_POINTER(seq));
-
+        Packet *packet = sequencering_steal(tcp->retransmit.queue, seq);
         if (packet != NULL) {
-            tcp->retransmit.queueLength -= packet_getPayloadLength(packet);
-            packet_addDeliveryStatus(packet, PDS_SND_TCP_DEQUEUE_RETRANSMIT);
-            bool success = g_hash_table_remove(tcp->retransmit.queue,
-                                               GINT_TO_POINTER(seq));
-            utility_assert(success);
+            _tcp_releaseRetransmit(tcp, packet);
         }
     }
 
@@ -919,38 +939,52 @@ static void _tcp_clearRetransmitRange(TCP* tcp, guint begin, guint end) {
     }
 }
 
+/* drop throttled retransmissions that were acked before we could send them */
+static void _tcp_clearThrottled(TCP* tcp, guint sequence) {
+    MAGIC_ASSERT(tcp);
+
+    Packet* packet = NULL;
+    while((packet = sequencering_stealBelow(tcp->throttledOutput, sequence)) != NULL) {
+        tcp->throttledOutputLength -= packet_getPayloadLength(packet);
+        packet_unref(packet);
+    }
+}
+
+/* called by the retransmit tally for each block that was newly sacked */
+static void _tcp_onSelectiveACKed(void* tcp, uint32_t begin, uint32_t end) {
+    _tcp_clearRetransmitRange((TCP*)tcp, begin, end);
+}
+
 // XXX forward declaration
 static void _tcp_runRetransmitTimerExpiredTask(TCP* tcp, gpointer userData);
 
 static void _tcp_scheduleRetransmitTimer(TCP* tcp, SimulationTime now, SimulationTime delay) {
     MAGIC_ASSERT(tcp);
 
-    SimulationTime* expireTimePtr = g_new0(SimulationTime, 1);
-    *expireTimePtr = now + delay;
-    gboolean success = priorityqueue_push(tcp->retransmit.scheduledTimerExpirations, expireTimePtr);
+    /* the pending task would run later than needed, so replace it */
+    if(tcp->retransmit.timerTask) {
+        worker_cancelTask(tcp->retransmit.timerTask);
+    }
 
-    if(success) {
-        descriptor_ref(tcp);
-        Task* retexpTask = task_new((TaskCallbackFunc)_tcp_runRetransmitTimerExpiredTask,
-                tcp, NULL, descriptor_unref, NULL);
-        worker_scheduleTask(retexpTask, delay);
-        task_unref(retexpTask);
+    descriptor_ref(tcp);
+    Task* retexpTask = task_new((TaskCallbackFunc)_tcp_runRetransmitTimerExpiredTask,
+            tcp, NULL, descriptor_unref, NULL);
+    task_setHandle(retexpTask, &tcp->retransmit.timerTask);
+    tcp->retransmit.timerTaskExpiration = now + delay;
+    worker_scheduleTask(retexpTask, delay);
+    task_unref(retexpTask);
 
-        debug("%s retransmit timer scheduled for %"G_GUINT64_FORMAT" ns",
-                tcp->super.boundString, *expireTimePtr);
-    } else {
-        warning("%s could not schedule a retransmit timer for %"G_GUINT64_FORMAT" ns",
-                tcp->super.boundString, *expireTimePtr);
-        g_free(expireTimePtr);
-    }
+    debug("%s retransmit timer scheduled for %"G_GUINT64_FORMAT" ns",
+            tcp->super.boundString, tcp->retransmit.timerTaskExpiration);
 }
 
 static void _tcp_scheduleRetransmitTimerIfNeeded(TCP* tcp, SimulationTime now) {
-    /* logic for scheduling retransmission events. we only need to schedule one if
-     * we have no events that will allow us to schedule one later. */
-    SimulationTime* nextTimePtr = priorityqueue_peek(tcp->retransmit.scheduledTimerExpirations);
-    if(nextTimePtr && *nextTimePtr <= tcp->retransmit.desiredTimerExpiration) {
-        /* another event will fire before the RTO expires, check again then */
+    /* logic for scheduling retransmission events. the timer is reset on every ACK, so
+     * rather than replacing the pending task each time, we let it run if it runs before
+     * the RTO expires, and then schedule another one for the remaining time. */
+    if(tcp->retransmit.timerTask &&
+            tcp->retransmit.timerTaskExpiration <= tcp->retransmit.desiredTimerExpiration) {
+        /* the pending task will run before the RTO expires, check again then */
         return;
     }
 
@@ -972,9 +1006,11 @@ static void _tcp_setRetransmitTimer(TCP* tcp, SimulationTime now) {
 
 static void _tcp_stopRetransmitTimer(TCP* tcp) {
     MAGIC_ASSERT(tcp);
-    /* we want to stop the timer. since there may be an event already scheduled,
-     * lets mark our desired time as 0 so we know to cancel when the event fires. */
+    /* we want to stop the timer, so we no longer need the pending task */
     tcp->retransmit.desiredTimerExpiration = 0;
+    if(tcp->retransmit.timerTask) {
+        worker_cancelTask(tcp->retransmit.timerTask);
+    }
 
     debug("%s retransmit timer disabled", tcp->super.boundString);
 }
@@ -1027,7 +1063,8 @@ static void _tcp_updateRTTEstimate(TCP* tcp, SimulationTime timestamp) {
 static void _tcp_retransmitPacket(TCP* tcp, gint sequence) {
     MAGIC_ASSERT(tcp);
 
-    Packet* packet = g_hash_table_lookup(tcp->retransmit.queue, GINT_TO_POINTER(sequence));
+    /* remove from queue; the packet ref is now ours */
+    Packet* packet = sequencering_steal(tcp->retransmit.queue, (guint32)sequence);
     /* if packet wasn't found is was most likely retransmitted from a previous SACK
      * but has yet to be received/acknowledged by the receiver */
     if(!packet) {
@@ -1040,10 +1077,6 @@ static void _tcp_retransmitPacket(TCP* tcp, gint sequence) {
     debug("retransmitting packet %d", sequence);
     // fprintf(stderr, "R- retransmitting packet %d with ts %llu\n", sequence, hdr.timestampValue);
 
-    /* remove from queue and update length and status.
-     * calling steal means that the packet ref count is not decremented */
-    g_hash_table_steal(tcp->retransmit.queue, GINT_TO_POINTER(sequence));
-
     /* update queue length and status */
     tcp->retransmit.queueLength -= packet_getPayloadLength(packet);
     packet_addDeliveryStatus(packet, PDS_SND_TCP_DEQUEUE_RETRANSMIT);
@@ -1078,7 +1111,7 @@ static void _tcp_sendShutdownFin(TCP* tcp) {
 
     if(sendFin) {
         /* send a fin */
-        Packet* fin = _tcp_createPacket(tcp, PTCP_FIN, NULL, 0);
+        Packet* fin = _tcp_createPacket(tcp, PTCP_FIN, NULL, 0, 0);
         _tcp_bufferPacketOut(tcp, fin);
         _tcp_flush(tcp);
 
@@ -1103,8 +1136,11 @@ void tcp_networkInterfaceIsAboutToSendPacket(TCP* tcp, Packet* packet) {
     PacketTCPHeader* header = packet_getTCPHeader(packet);
 
     if(header->flags & PTCP_ACK) {
-        /* we are sending an ACK already, so we may not need any delayed ACK */
+        /* we are sending an ACK already, so we don't need the delayed ACK */
         tcp->send.delayedACKCounter = 0;
+        if(tcp->send.delayedACKTask) {
+            worker_cancelTask(tcp->send.delayedACKTask);
+        }
     }
 
     if(header->sequence > 0 || (header->flags & PTCP_SYN)) {
@@ -1160,9 +1196,12 @@ static void _tcp_flush(TCP* tcp) {
     // bool print = true;
 
     /* flush packets that can now be sent to socket */
-    while(!priorityqueue_isEmpty(tcp->throttledOutput)) {
-        /* get the next throttled packet, in sequence order */
-        Packet* packet = priorityqueue_peek(tcp->throttledOutput);
+    while(TRUE) {
+        /* get the next throttled packet, control packets first and then in sequence order */
+        Packet* packet = g_queue_peek_head(tcp->throttledControl);
+        if(!packet) {
+            packet = sequencering_peekFirst(tcp->throttledOutput);
+        }
 
         /* break out if we have no packets left */
         if(!packet) {
@@ -1190,7 +1229,11 @@ static void _tcp_flush(TCP* tcp) {
         }
 
         /* packet is sendable, we removed it from out buffer */
-        priorityqueue_pop(tcp->throttledOutput);
+        if(header->sequence == 0) {
+            g_queue_pop_head(tcp->throttledControl);
+        } else {
+            sequencering_steal(tcp->throttledOutput, header->sequence);
+        }
         tcp->throttledOutputLength -= length;
 
         /* packet will get stored in retrans queue in tcp_networkInterfaceIsAboutToSendPacket */
@@ -1207,32 +1250,28 @@ static void _tcp_flush(TCP* tcp) {
     }
 
     /* any packets now in order can be pushed to our user input buffer */
-    while(!priorityqueue_isEmpty(tcp->unorderedInput)) {
-        Packet* packet = priorityqueue_peek(tcp->unorderedInput);
-
+    Packet* packet = NULL;
+    while((packet = sequencering_get(tcp->unorderedInput, tcp->receive.next)) != NULL) {
         PacketTCPHeader* header = packet_getTCPHeader(packet);
 
         _rswlog(tcp, "I just received packet %d\n", header->sequence);
-        if(header->sequence == tcp->receive.next) {
-            /* move from the unordered buffer to user input buffer */
-            gboolean fitInBuffer = socket_addToInputBuffer(&(tcp->super), packet);
-
-            if(fitInBuffer) {
-                // fprintf(stderr, "SND/RCV Recv %s %s %d @ %f\n", tcp->super.boundString, tcp->super.peerString, header.sequence, dtime);
-                tcp->receive.lastSequence = header->sequence;
-                priorityqueue_pop(tcp->unorderedInput);
-                packet_unref(packet);
-                tcp->unorderedInputLength -= packet_getPayloadLength(packet);
-                (tcp->receive.next)++;
-                continue;
-            }
-        }
 
-        _rswlog(tcp, "Could not buffer %d, was expecting %d\n", header->sequence,
-                tcp->receive.next);
+        /* move from the unordered buffer to user input buffer */
+        gboolean fitInBuffer = socket_addToInputBuffer(&(tcp->super), packet);
 
-        /* we could not buffer it because its out of order or we have no space */
-        break;
+        if(!fitInBuffer) {
+            _rswlog(tcp, "Could not buffer %d, no space\n", header->sequence);
+            break;
+        }
+
+        // fprintf(stderr, "SND/RCV Recv %s %s %d @ %f\n", tcp->super.boundString, tcp->super.peerString, header.sequence, dtime);
+        tcp->receive.lastSequence = header->sequence;
+        /* nothing is stored below the next sequence, so this takes the packet and moves
+         * the ring's base past it */
+        sequencering_stealBelow(tcp->unorderedInput, tcp->receive.next + 1);
+        tcp->unorderedInputLength -= packet_getPayloadLength(packet);
+        packet_unref(packet);
+        (tcp->receive.next)++;
     }
 
     /* update the tracker input/output buffer stats */
@@ -1243,6 +1282,7 @@ static void _tcp_flush(TCP* tcp) {
     gsize outSize = socket_getOutputBufferSize(&(tcp->super));
     tracker_updateSocketInputBuffer(tracker, descriptor->handle, inSize - _tcp_getBufferSpaceIn(tcp), inSize);
     tracker_updateSocketOutputBuffer(tracker, descriptor->handle, outSize - _tcp_getBufferSpaceOut(tcp), outSize);
+    tracker_updateSocketQueueMemory(tracker, descriptor->handle, _tcp_getQueueAllocatedBytes(tcp));
 
     /* should we send a fin after clearing the output buffer */
     if((tcp->flags & TCPF_SHOULD_SEND_WR_FIN) && tcp_getOutputBufferLength(tcp) == 0) {
@@ -1280,11 +1320,10 @@ static void _tcp_flush(TCP* tcp) {
 static void _tcp_runRetransmitTimerExpiredTask(TCP* tcp, gpointer userData) {
     MAGIC_ASSERT(tcp);
 
-    /* a timer expired, update our timer tracking state */
+    /* a timer expired; replaced tasks are cancelled, so this was the pending one and
+     * running it cleared our handle */
     SimulationTime now = worker_getCurrentTime();
-    SimulationTime* scheduledTimerExpirationPtr = priorityqueue_pop(tcp->retransmit.scheduledTimerExpirations);
-    utility_assert(scheduledTimerExpirationPtr);
-    g_free(scheduledTimerExpirationPtr);
+    utility_assert(tcp->retransmit.timerTask == NULL);
 
     debug("%s a scheduled retransmit timer expired", tcp->super.boundString);
 
@@ -1295,7 +1334,7 @@ static void _tcp_runRetransmitTimerExpiredTask(TCP* tcp, gpointer userData) {
         return;
     }
 
-    if(g_hash_table_size(tcp->retransmit.queue) == 0) {
+    if(sequencering_getLength(tcp->retransmit.queue) == 0) {
         _tcp_stopRetransmitTimer(tcp);
         return;
     }
@@ -1317,7 +1356,9 @@ static void _tcp_runRetransmitTimerExpiredTask(TCP* tcp, gpointer userData) {
     _tcp_setRetransmitTimeout(tcp, tcp->retransmit.timeout * 2);
     _tcp_setRetransmitTimer(tcp, now);
 
+    tcp->cong.now = now;
     tcp->cong.hooks->tcp_cong_timeout_ev(tcp);
+    socket_setPacingRate(&(tcp->super), tcp->cong.pacingRate);
     info("[CONG] a congestion timeout has occurred on %s", tcp->super.boundString);
     _tcp_logCongestionInfo(tcp);
 
@@ -1680,6 +1721,14 @@ TCPProcessFlags _tcp_ackProcessing(TCP* tcp, Packet* packet, PacketTCPHeader *he
         flags |= TCP_PF_RWND_UPDATED;
     }
 
+    /* what the congestion hooks may look at for this ack */
+    tcp->cong.now = now;
+    tcp->cong.rttSample = 0;
+    if(header->timestampEcho && tcp->retransmit.backoffCount == 0 && now > header->timestampEcho) {
+        tcp->cong.rttSample = now - header->timestampEcho;
+    }
+    tcp->cong.packetsInFlight = tcp->send.next - tcp->send.unacked;
+
     /* duplicate acks indicate out of order data on the other end of connection. */
     bool is_dup = (header->flags & PTCP_DUPACK);
 
@@ -1696,8 +1745,8 @@ TCPProcessFlags _tcp_ackProcessing(TCP* tcp, Packet* packet, PacketTCPHeader *he
     gint nPacketsAcked = 0;
     if(isValidAck) {
         /* the packets just acked are 'released' from retransmit queue */
-        _tcp_clearRetransmitRange(tcp, tcp->receive.lastAcknowledgment,
-                                  header->acknowledgment);
+        _tcp_clearRetransmit(tcp, header->acknowledgment);
+        _tcp_clearThrottled(tcp, header->acknowledgment);
 
         _rswlog(tcp, "The ReTX is now %zu\n", tcp->retransmit.queueLength);
 
@@ -1730,6 +1779,8 @@ TCPProcessFlags _tcp_ackProcessing(TCP* tcp, Packet* packet, PacketTCPHeader *he
         tcp->retransmit.backoffCount = 0;
     }
 
+    socket_setPacingRate(&(tcp->super), tcp->cong.pacingRate);
+
     if(isValidWindow) {
         /* accept the window update */
         tcp->receive.lastWindow = (guint32) header->window;
@@ -1766,7 +1817,7 @@ static void _tcp_logCongestionInfo(TCP* tcp) {
 
 static void _tcp_sendACKTaskCallback(TCP* tcp, gpointer userData) {
     MAGIC_ASSERT(tcp);
-    tcp->send.delayedACKIsScheduled = FALSE;
+    /* running this task cleared our handle, so later ACKs will schedule a new one */
     if(tcp->send.delayedACKCounter > 0) {
         _tcp_sendControlPacket(tcp, PTCP_ACK);
         tcp->send.delayedACKCounter = 0;
@@ -2014,7 +2065,9 @@ void tcp_processPacket(TCP* tcp, Packet* packet) {
     GList* selectiveACKs = packet_copyTCPSelectiveACKs(packet);
 
     if (selectiveACKs) {
-       retransmit_tally_mark_sacked(tcp->retransmit.tally, selectiveACKs);
+       /* the receiver holds on to sacked packets, so we won't retransmit them */
+       retransmit_tally_mark_sacked(tcp->retransmit.tally, selectiveACKs,
+                                    _tcp_onSelectiveACKed, tcp);
     }
 
     if(selectiveACKs) {
@@ -2063,13 +2116,15 @@ void tcp_processPacket(TCP* tcp, Packet* packet) {
             /* just send the response now */
             _tcp_sendControlPacket(tcp, responseFlags);
         } else {
-            if(tcp->send.delayedACKIsScheduled == FALSE) {
+            if(tcp->send.delayedACKTask == NULL) {
                 /* we need to send an ACK, lets schedule a task so we don't send an ACK
                  * for all packets that are received during this same simtime receiving round. */
                 Task* sendACKTask = task_new((TaskCallbackFunc)_tcp_sendACKTaskCallback,
                                 tcp, NULL, descriptor_unref, NULL);
                 /* taks holds a ref to tcp */
                 descriptor_ref(tcp);
+                /* we cancel it if we send an ACK before it runs */
+                task_setHandle(sendACKTask, &tcp->send.delayedACKTask);
 
                 /* figure out what we should use as delay */
                 SimulationTime delay = 0;
@@ -2084,8 +2139,6 @@ void tcp_processPacket(TCP* tcp, Packet* packet) {
 
                 worker_scheduleTask(sendACKTask, delay);
                 task_unref(sendACKTask);
-
-                tcp->send.delayedACKIsScheduled = TRUE;
             }
             tcp->send.delayedACKCounter++;
         }
@@ -2123,9 +2176,11 @@ static void _tcp_endOfFileSignalled(TCP* tcp, enum TCPFlags flags) {
     }
 }
 
-gssize tcp_sendUserData(TCP* tcp, gconstpointer buffer, gsize nBytes, in_addr_t ip, in_port_t port) {
+gssize tcp_sendUserData(TCP* tcp, const struct iovec* iov, gint iovcnt, in_addr_t ip, in_port_t port) {
     MAGIC_ASSERT(tcp);
 
+    gsize nBytes = utility_iovecLength(iov, iovcnt);
+
     /* return 0 to signal close, if necessary */
     if(tcp->error & TCPE_SEND_EOF)
     {
@@ -2148,12 +2203,15 @@ gssize tcp_sendUserData(TCP* tcp, gconstpointer buffer, gsize nBytes, in_addr_t
     gsize maxPacketLength = CONFIG_MTU - CONFIG_HEADER_SIZE_TCPIPETH;
     gsize bytesCopied = 0;
 
+    /* gather the data once, and let each packet reference its own part of the copy */
+    PayloadBuffer* payload = remaining > 0 ? payloadbuffer_newVector(iov, iovcnt, 0, remaining) : NULL;
+
     /* create as many packets as needed */
     while(remaining > 0) {
         gsize copyLength = MIN(maxPacketLength, remaining);
 
         /* use helper to create the packet */
-        Packet* packet = _tcp_createPacket(tcp, PTCP_ACK, buffer + bytesCopied, copyLength);
+        Packet* packet = _tcp_createPacket(tcp, PTCP_ACK, payload, bytesCopied, copyLength);
         if(copyLength > 0) {
             /* we are sending more user data */
             tcp->send.end++;
@@ -2169,6 +2227,11 @@ gssize tcp_sendUserData(TCP* tcp, gconstpointer buffer, gsize nBytes, in_addr_t
         bytesCopied += copyLength;
     }
 
+    /* the packets hold the buffer refs now */
+    if(payload) {
+        payloadbuffer_unref(payload);
+    }
+
     debug("%s <-> %s: sending %"G_GSIZE_FORMAT" user bytes", tcp->super.boundString, tcp->super.peerString, bytesCopied);
 
     /* now flush as much as possible out to socket */
@@ -2189,7 +2252,7 @@ static void _tcp_sendWindowUpdate(TCP* tcp, gpointer data) {
     tcp->receive.windowUpdatePending = FALSE;
 }
 
-gssize tcp_receiveUserData(TCP* tcp, gpointer buffer, gsize nBytes, in_addr_t* ip, in_port_t* port) {
+gssize tcp_receiveUserData(TCP* tcp, const struct iovec* iov, gint iovcnt, in_addr_t* ip, in_port_t* port) {
     MAGIC_ASSERT(tcp);
 
     /*
@@ -2203,7 +2266,7 @@ gssize tcp_receiveUserData(TCP* tcp, gpointer buffer, gsize nBytes, in_addr_t* i
     /* make sure we pull in all readable user data */
     _tcp_flush(tcp);
 
-    gsize remaining = nBytes;
+    gsize remaining = utility_iovecLength(iov, iovcnt);
     gsize bytesCopied = 0;
     gsize totalCopied = 0;
     gsize offset = 0;
@@ -2216,7 +2279,7 @@ gssize tcp_receiveUserData(TCP* tcp, gpointer buffer, gsize nBytes, in_addr_t* i
         utility_assert(partialBytes > 0);
 
         copyLength = MIN(partialBytes, remaining);
-        bytesCopied = packet_copyPayload(tcp->partialUserDataPacket, tcp->partialOffset, buffer, copyLength);
+        bytesCopied = packet_copyPayloadVector(tcp->partialUserDataPacket, tcp->partialOffset, iov, iovcnt, offset, copyLength);
         totalCopied += bytesCopied;
         remaining -= bytesCopied;
         offset += bytesCopied;
@@ -2250,7 +2313,7 @@ gssize tcp_receiveUserData(TCP* tcp, gpointer buffer, gsize nBytes, in_addr_t* i
 
         guint packetLength = packet_getPayloadLength(packet);
         copyLength = MIN(packetLength, remaining);
-        bytesCopied = packet_copyPayload(packet, 0, buffer + offset, copyLength);
+        bytesCopied = packet_copyPayloadVector(packet, 0, iov, iovcnt, offset, copyLength);
         totalCopied += bytesCopied;
         remaining -= bytesCopied;
         offset += bytesCopied;
@@ -2322,6 +2385,7 @@ gssize tcp_receiveUserData(TCP* tcp, gpointer buffer, gsize nBytes, in_addr_t* i
     }
 
     debug("%s <-> %s: receiving %"G_GSIZE_FORMAT" user bytes", tcp->super.boundString, tcp->super.peerString, totalCopied);
+    worker_countCopiedBytes(COPY_TYPE_DELIVERED, totalCopied);
 
     return (gssize) (totalCopied == 0 ? -1 : totalCopied);
 }
@@ -2329,10 +2393,10 @@ gssize tcp_receiveUserData(TCP* tcp, gpointer buffer, gsize nBytes, in_addr_t* i
 void tcp_free(TCP* tcp) {
     MAGIC_ASSERT(tcp);
 
-    priorityqueue_free(tcp->throttledOutput);
-    priorityqueue_free(tcp->unorderedInput);
-    g_hash_table_destroy(tcp->retransmit.queue);
-    priorityqueue_free(tcp->retransmit.scheduledTimerExpirations);
+    sequencering_free(tcp->throttledOutput);
+    g_queue_free_full(tcp->throttledControl, (GDestroyNotify)packet_unref);
+    sequencering_free(tcp->unorderedInput);
+    sequencering_free(tcp->retransmit.queue);
 
     if(tcp->child) {
         MAGIC_ASSERT(tcp->child);
@@ -2462,16 +2526,24 @@ TCP* tcp_new(gint handle, guint receiveBufferSize, guint sendBufferSize) {
 
     TCPCongestionType congestionType = tcpCongestion_getType(tcpCC);
 
+    tcp->cong.random = host_getRandom(worker_getActiveHost());
     switch(congestionType) {
         default:
             warning("CC %s not implemented, falling back to reno", tcpCC);
         case TCP_CC_RENO:
             tcp_cong_reno_init(tcp);
             break;
+        case TCP_CC_CUBIC:
+            tcp_cong_cubic_init(tcp);
+            break;
+        case TCP_CC_BBR:
+            tcp_cong_bbr_init(tcp);
+            break;
         case TCP_CC_UNKNOWN:
             error("Failed to initialize TCP congestion control for %s", tcpCC);
             break;
     }
+    socket_setPacingRate(&(tcp->super), tcp->cong.pacingRate);
 
     tcp->send.window = initial_window;
     tcp->send.lastWindow = initial_window;
@@ -2492,18 +2564,13 @@ TCP* tcp_new(gint handle, guint receiveBufferSize, guint sendBufferSize) {
 
     tcp->autotune.isEnabled = TRUE;
 
-    tcp->throttledOutput =
-            priorityqueue_new((GCompareDataFunc)packet_compareTCPSequence, NULL, (GDestroyNotify)packet_unref);
-    tcp->unorderedInput =
-            priorityqueue_new((GCompareDataFunc)packet_compareTCPSequence, NULL, (GDestroyNotify)packet_unref);
-    tcp->retransmit.queue =
-            g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)packet_unref);
+    tcp->throttledOutput = sequencering_new(initialSequenceNumber, (GDestroyNotify)packet_unref);
+    tcp->throttledControl = g_queue_new();
+    tcp->unorderedInput = sequencering_new(initialSequenceNumber, (GDestroyNotify)packet_unref);
+    tcp->retransmit.queue = sequencering_new(0, (GDestroyNotify)packet_unref);
 
     retransmit_tally_init(&tcp->retransmit.tally);
 
-    tcp->retransmit.scheduledTimerExpirations =
-            priorityqueue_new((GCompareDataFunc)utility_simulationTimeCompare, NULL, g_free);
-
     /* initialize tcp retransmission timeout */
     _tcp_setRetransmitTimeout(tcp, CONFIG_TCP_RTO_INIT);
 
@@ -2514,6 +2581,10 @@ TCP* tcp_new(gint handle, guint receiveBufferSize, guint sendBufferSize) {
 TCPCongestionType tcpCongestion_getType(const gchar* type) {
     if(!g_ascii_strcasecmp(type, "reno")) {
         return TCP_CC_RENO;
+    } else if(!g_ascii_strcasecmp(type, "cubic")) {
+        return TCP_CC_CUBIC;
+    } else if(!g_ascii_strcasecmp(type, "bbr")) {
+        return TCP_CC_BBR;
     }
 
     return TCP_CC_UNKNOWN;
@@ -35,7 +35,7 @@ enum TCPProcessFlags {
 
 typedef enum _TCPCongestionType TCPCongestionType;
 enum _TCPCongestionType {
-    TCP_CC_UNKNOWN, TCP_CC_AIMD, TCP_CC_RENO, TCP_CC_CUBIC,
+    TCP_CC_UNKNOWN, TCP_CC_AIMD, TCP_CC_RENO, TCP_CC_CUBIC, TCP_CC_BBR,
 };
 
 TCP* tcp_new(gint handle, guint receiveBufferSize, guint sendBufferSize);
@@ -3,7 +3,12 @@
 
 #include <stdbool.h>
 
+#include "main/core/support/definitions.h"
 #include "main/host/descriptor/tcp.h"
+#include "main/utility/random.h"
+
+/* the window that a connection starts with, in packets (rfc 6928) */
+#define TCP_INITIAL_CWND 10
 
 // congestion event hooks
 
@@ -25,6 +30,21 @@ typedef struct TCPCongHooks_ {
 
 typedef struct TCPCong_ {
     guint32 cwnd;
+    /* the rate in bytes per second that the socket paces its packets at, or 0 to
+     * send them as fast as the window allows. set by the hooks. */
+    guint64 pacingRate;
+
+    /* tcp updates these before it calls the hooks */
+    SimulationTime now;
+    /* the round trip time measured by the ack being processed, or 0 if the ack
+     * did not echo a timestamp or echoed a retransmission */
+    SimulationTime rttSample;
+    /* data packets that were sent but not acked before the ack being processed */
+    guint32 packetsInFlight;
+
+    /* the host's random source, for hooks that make random choices */
+    Random *random;
+
     const TCPCongHooks *hooks;
     void *ca;
 } TCPCong;
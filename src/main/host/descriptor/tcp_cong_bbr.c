@@ -0,0 +1,422 @@
+#include "main/host/descriptor/tcp_cong_bbr.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "main/core/support/definitions.h"
+#include "main/host/descriptor/tcp.h"
+#include "main/host/descriptor/tcp_cong.h"
+#include "support/logger/logger.h"
+
+/* the smallest gain that doubles the sending rate every round in startup */
+#define BBR_HIGH_GAIN 2.885
+#define BBR_CWND_GAIN 2.0
+#define BBR_MIN_CWND 4
+/* extra packets in the window to keep the pipe full while acks are delayed */
+#define BBR_CWND_QUANTUM 3
+
+/* the bottleneck bandwidth is the best delivery rate of the last rounds */
+#define BBR_BW_FILTER_ROUNDS 10
+/* the propagation delay is the smallest rtt of this window */
+#define BBR_MIN_RTT_WINDOW (10 * SIMTIME_ONE_SECOND)
+#define BBR_PROBE_RTT_DURATION (200 * SIMTIME_ONE_MILLISECOND)
+
+/* startup ends once the bandwidth grew less than 25% for 3 rounds */
+#define BBR_FULL_BW_THRESH 1.25
+#define BBR_FULL_BW_ROUNDS 3
+
+#define BBR_NUM_CYCLE_GAINS 8
+
+/* the rtt that the initial pacing rate assumes before we measured one */
+#define BBR_DEFAULT_RTT SIMTIME_ONE_MILLISECOND
+
+/* the number of (time, delivered) points kept to take delivery rate samples */
+#define BBR_RATE_HISTORY 64
+
+static const double bbr_pacing_gain_cycle_[BBR_NUM_CYCLE_GAINS] = {
+    1.25, 0.75, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0
+};
+
+typedef enum BBRMode_ {
+    BBR_STARTUP,
+    BBR_DRAIN,
+    BBR_PROBE_BW,
+    BBR_PROBE_RTT,
+} BBRMode;
+
+typedef struct BBRDeliveryPoint_ {
+    SimulationTime time;
+    guint64 delivered;
+} BBRDeliveryPoint;
+
+typedef struct CABBR_ {
+
+    BBRMode mode;
+    double pacing_gain;
+    double cwnd_gain;
+
+    size_t duplicate_ack_n;
+    bool in_recovery;
+    /* the window to restore after recovery and probe rtt */
+    guint32 prior_cwnd;
+
+    /* packets acked so far, and packet-timed rounds over them */
+    guint64 delivered;
+    guint64 round_count;
+    guint64 next_round_delivered;
+    bool round_start;
+
+    /* the best delivery rate in packets per second of each recent round */
+    double bw_round_max[BBR_BW_FILTER_ROUNDS];
+    double btl_bw;
+
+    SimulationTime min_rtt;
+    SimulationTime min_rtt_stamp;
+
+    double full_bw;
+    guint32 full_bw_count;
+    bool filled_pipe;
+
+    guint32 cycle_index;
+    SimulationTime cycle_stamp;
+
+    SimulationTime probe_rtt_done_stamp;
+    bool probe_rtt_round_done;
+
+    /* delivered counts over time, so an ack can find how much was delivered when
+     * the packet it acks was sent. a ring, oldest point at history_head. */
+    BBRDeliveryPoint history[BBR_RATE_HISTORY];
+    guint32 history_head;
+    guint32 history_n;
+
+} CABBR;
+
+static const gchar *bbr_mode_string_(BBRMode mode) {
+    switch (mode) {
+        case BBR_STARTUP: return "startup";
+        case BBR_DRAIN: return "drain";
+        case BBR_PROBE_BW: return "probe_bw";
+        case BBR_PROBE_RTT: return "probe_rtt";
+        default: return "unknown";
+    }
+}
+
+static void bbr_set_mode_(CABBR *bbr, BBRMode mode, double pacing_gain, double cwnd_gain) {
+    if (bbr->mode != mode) {
+        info("[CONG] bbr transition from %s to %s", bbr_mode_string_(bbr->mode), bbr_mode_string_(mode));
+    }
+    bbr->mode = mode;
+    bbr->pacing_gain = pacing_gain;
+    bbr->cwnd_gain = cwnd_gain;
+}
+
+/* the bandwidth-delay product in packets */
+static double bbr_bdp_(CABBR *bbr) {
+    return bbr->btl_bw * ((double)bbr->min_rtt / SIMTIME_ONE_SECOND);
+}
+
+/* DELIVERY RATE *******************************************************/
+
+static void bbr_record_delivered_(CABBR *bbr, SimulationTime now) {
+    if (bbr->history_n > 0) {
+        guint32 newest = (bbr->history_head + bbr->history_n - 1) % BBR_RATE_HISTORY;
+        /* space the points so that the history covers several rtts */
+        if (now - bbr->history[newest].time < bbr->min_rtt / 16) {
+            return;
+        }
+    }
+
+    if (bbr->history_n == BBR_RATE_HISTORY) {
+        bbr->history_head = (bbr->history_head + 1) % BBR_RATE_HISTORY;
+        bbr->history_n--;
+    }
+
+    guint32 tail = (bbr->history_head + bbr->history_n) % BBR_RATE_HISTORY;
+    bbr->history[tail].time = now;
+    bbr->history[tail].delivered = bbr->delivered;
+    bbr->history_n++;
+}
+
+/* returns the delivery rate in packets per second since the acked packet was
+ * sent one rtt ago, or 0 if we can't tell */
+static double bbr_sample_delivery_rate_(CABBR *bbr, TCPCong *cong) {
+    SimulationTime rtt = cong->rttSample > 0 ? cong->rttSample : bbr->min_rtt;
+    if (rtt == 0 || bbr->history_n == 0 || rtt > cong->now) {
+        return 0;
+    }
+
+    /* the newest point at or before the send time, or the oldest one we have */
+    SimulationTime sent = cong->now - rtt;
+    BBRDeliveryPoint *point = &bbr->history[bbr->history_head];
+    for (guint32 i = 1; i < bbr->history_n; i++) {
+        BBRDeliveryPoint *next = &bbr->history[(bbr->history_head + i) % BBR_RATE_HISTORY];
+        if (next->time > sent) {
+            break;
+        }
+        point = next;
+    }
+
+    if (point->time >= cong->now) {
+        return 0;
+    }
+
+    double seconds = (double)(cong->now - point->time) / SIMTIME_ONE_SECOND;
+    return (double)(bbr->delivered - point->delivered) / seconds;
+}
+
+/* MODEL *******************************************************/
+
+static void bbr_update_bw_(CABBR *bbr, TCPCong *cong, guint32 n) {
+    bbr->delivered += n;
+
+    bbr->round_start = false;
+    if (bbr->delivered >= bbr->next_round_delivered) {
+        guint32 still_in_flight = cong->packetsInFlight > n ? cong->packetsInFlight - n : 0;
+        bbr->next_round_delivered = bbr->delivered + still_in_flight;
+        bbr->round_count++;
+        bbr->round_start = true;
+        bbr->bw_round_max[bbr->round_count % BBR_BW_FILTER_ROUNDS] = 0;
+    }
+
+    double rate = bbr_sample_delivery_rate_(bbr, cong);
+    bbr_record_delivered_(bbr, cong->now);
+
+    double *slot = &bbr->bw_round_max[bbr->round_count % BBR_BW_FILTER_ROUNDS];
+    if (rate > *slot) {
+        *slot = rate;
+    }
+
+    bbr->btl_bw = 0;
+    for (size_t i = 0; i < BBR_BW_FILTER_ROUNDS; i++) {
+        bbr->btl_bw = MAX(bbr->btl_bw, bbr->bw_round_max[i]);
+    }
+}
+
+static void bbr_check_full_pipe_(CABBR *bbr) {
+    if (bbr->filled_pipe || !bbr->round_start || bbr->btl_bw == 0) {
+        return;
+    }
+
+    if (bbr->btl_bw >= bbr->full_bw * BBR_FULL_BW_THRESH) {
+        bbr->full_bw = bbr->btl_bw;
+        bbr->full_bw_count = 0;
+        return;
+    }
+
+    bbr->full_bw_count++;
+    if (bbr->full_bw_count >= BBR_FULL_BW_ROUNDS) {
+        bbr->filled_pipe = true;
+        info("[CONG] bbr filled the pipe at %f packets per second", bbr->btl_bw);
+    }
+}
+
+static void bbr_enter_probe_bw_(CABBR *bbr, TCPCong *cong) {
+    /* start anywhere in the cycle except the draining phase, like linux; the
+     * host's random source keeps the choice deterministic */
+    guint32 idx = random_nextUInt(cong->random) % (BBR_NUM_CYCLE_GAINS - 1);
+    bbr->cycle_index = idx == 0 ? 0 : idx + 1;
+    bbr->cycle_stamp = cong->now;
+    bbr_set_mode_(bbr, BBR_PROBE_BW, bbr_pacing_gain_cycle_[bbr->cycle_index], BBR_CWND_GAIN);
+}
+
+static void bbr_check_drain_(CABBR *bbr, TCPCong *cong) {
+    if (bbr->mode == BBR_STARTUP && bbr->filled_pipe) {
+        bbr_set_mode_(bbr, BBR_DRAIN, 1.0 / BBR_HIGH_GAIN, BBR_HIGH_GAIN);
+    }
+    if (bbr->mode == BBR_DRAIN && cong->packetsInFlight <= bbr_bdp_(bbr)) {
+        bbr_enter_probe_bw_(bbr, cong);
+    }
+}
+
+static void bbr_update_cycle_(CABBR *bbr, TCPCong *cong) {
+    if (bbr->mode != BBR_PROBE_BW) {
+        return;
+    }
+
+    bool is_full_length = cong->now - bbr->cycle_stamp > bbr->min_rtt;
+    /* the draining phase may end as soon as the queue it drains is gone */
+    bool is_drained = bbr->pacing_gain < 1.0 && cong->packetsInFlight <= bbr_bdp_(bbr);
+
+    if (is_full_length || is_drained) {
+        bbr->cycle_index = (bbr->cycle_index + 1) % BBR_NUM_CYCLE_GAINS;
+        bbr->cycle_stamp = cong->now;
+        bbr->pacing_gain = bbr_pacing_gain_cycle_[bbr->cycle_index];
+    }
+}
+
+static void bbr_exit_probe_rtt_(CABBR *bbr, TCPCong *cong) {
+    bbr->min_rtt_stamp = cong->now;
+    cong->cwnd = MAX(cong->cwnd, bbr->prior_cwnd);
+    if (bbr->filled_pipe) {
+        bbr_enter_probe_bw_(bbr, cong);
+    } else {
+        bbr_set_mode_(bbr, BBR_STARTUP, BBR_HIGH_GAIN, BBR_HIGH_GAIN);
+    }
+}
+
+static void bbr_update_min_rtt_(CABBR *bbr, TCPCong *cong) {
+    bool expired = bbr->min_rtt_stamp > 0 && cong->now - bbr->min_rtt_stamp > BBR_MIN_RTT_WINDOW;
+
+    if (cong->rttSample > 0 && (bbr->min_rtt == 0 || cong->rttSample <= bbr->min_rtt || expired)) {
+        bbr->min_rtt = cong->rttSample;
+        bbr->min_rtt_stamp = cong->now;
+    }
+
+    if (expired && bbr->mode != BBR_PROBE_RTT) {
+        /* drain the queue so that we can see the propagation delay again */
+        bbr->prior_cwnd = cong->cwnd;
+        bbr->probe_rtt_done_stamp = 0;
+        bbr_set_mode_(bbr, BBR_PROBE_RTT, 1.0, 1.0);
+    }
+
+    if (bbr->mode == BBR_PROBE_RTT) {
+        if (bbr->probe_rtt_done_stamp == 0 && cong->packetsInFlight <= BBR_MIN_CWND) {
+            bbr->probe_rtt_done_stamp = cong->now + BBR_PROBE_RTT_DURATION;
+            bbr->probe_rtt_round_done = false;
+            bbr->next_round_delivered = bbr->delivered;
+        } else if (bbr->probe_rtt_done_stamp > 0) {
+            if (bbr->round_start) {
+                bbr->probe_rtt_round_done = true;
+            }
+            if (bbr->probe_rtt_round_done && cong->now > bbr->probe_rtt_done_stamp) {
+                bbr_exit_probe_rtt_(bbr, cong);
+            }
+        }
+    }
+}
+
+static void bbr_set_pacing_rate_(CABBR *bbr, TCPCong *cong) {
+    double rate = 0;
+    if (bbr->btl_bw > 0) {
+        rate = bbr->pacing_gain * bbr->btl_bw;
+    } else {
+        /* no estimate yet, so pace the initial window over the rtt */
+        SimulationTime rtt = bbr->min_rtt > 0 ? bbr->min_rtt : BBR_DEFAULT_RTT;
+        rate = BBR_HIGH_GAIN * cong->cwnd / ((double)rtt / SIMTIME_ONE_SECOND);
+    }
+
+    guint64 pacing_rate = (guint64)(rate * CONFIG_MTU);
+
+    /* until the pipe is full, only raise the rate so that a low sample does not slow startup */
+    if (bbr->filled_pipe || pacing_rate > cong->pacingRate) {
+        cong->pacingRate = MAX(pacing_rate, 1);
+    }
+}
+
+static void bbr_set_cwnd_(CABBR *bbr, TCPCong *cong, guint32 n) {
+    if (bbr->mode == BBR_PROBE_RTT) {
+        cong->cwnd = MIN(cong->cwnd, BBR_MIN_CWND);
+        return;
+    }
+
+    guint32 target = TCP_INITIAL_CWND;
+    if (bbr->btl_bw > 0 && bbr->min_rtt > 0) {
+        target = (guint32)(bbr->cwnd_gain * bbr_bdp_(bbr)) + BBR_CWND_QUANTUM;
+    }
+
+    if (bbr->filled_pipe) {
+        cong->cwnd = MIN(cong->cwnd + n, target);
+    } else if (cong->cwnd < target || bbr->delivered < TCP_INITIAL_CWND) {
+        cong->cwnd += n;
+    }
+
+    cong->cwnd = MAX(cong->cwnd, BBR_MIN_CWND);
+}
+
+/*******************************************************************/
+
+static void tcp_cong_bbr_delete_(TCP *tcp) {
+    free(tcp_cong(tcp)->ca);
+}
+
+static void tcp_cong_bbr_duplicate_ack_ev_(TCP *tcp) {
+    TCPCong *cong = tcp_cong(tcp);
+    CABBR *bbr = cong->ca;
+
+    if (bbr->in_recovery) {
+        /* each duplicate ack means a packet left the network */
+        cong->cwnd += 1;
+        return;
+    }
+
+    bbr->duplicate_ack_n++;
+
+    if (bbr->duplicate_ack_n == 3) {
+        /* bbr does not back off on loss, it only conserves packets until recovered */
+        debug("[CONG-AVOID] three duplicate acks");
+        bbr->in_recovery = true;
+        bbr->prior_cwnd = cong->cwnd;
+        cong->cwnd = MAX(cong->packetsInFlight, BBR_MIN_CWND);
+    }
+}
+
+static bool tcp_cong_bbr_fast_recovery_(TCP *tcp) {
+    CABBR *bbr = tcp_cong(tcp)->ca;
+    return bbr->in_recovery;
+}
+
+static void tcp_cong_bbr_new_ack_ev_(TCP *tcp, guint32 n) {
+    TCPCong *cong = tcp_cong(tcp);
+    CABBR *bbr = cong->ca;
+
+    bbr->duplicate_ack_n = 0;
+    if (bbr->in_recovery) {
+        bbr->in_recovery = false;
+        cong->cwnd = MAX(cong->cwnd, bbr->prior_cwnd);
+    }
+
+    bbr_update_bw_(bbr, cong, n);
+    bbr_check_full_pipe_(bbr);
+    bbr_check_drain_(bbr, cong);
+    bbr_update_cycle_(bbr, cong);
+    bbr_update_min_rtt_(bbr, cong);
+
+    bbr_set_pacing_rate_(bbr, cong);
+    bbr_set_cwnd_(bbr, cong, n);
+}
+
+static void tcp_cong_bbr_timeout_ev_(TCP *tcp) {
+    TCPCong *cong = tcp_cong(tcp);
+    CABBR *bbr = cong->ca;
+
+    bbr->duplicate_ack_n = 0;
+    bbr->in_recovery = false;
+    bbr->prior_cwnd = MAX(bbr->prior_cwnd, cong->cwnd);
+    cong->cwnd = BBR_MIN_CWND;
+    info("[CONG] bbr timeout in %s, window %u", bbr_mode_string_(bbr->mode), bbr->prior_cwnd);
+}
+
+static guint32 tcp_cong_bbr_ssthresh_(TCP *tcp) {
+    /* bbr does not use a slow start threshold */
+    return INT32_MAX;
+}
+
+static const struct TCPCongHooks_ bbr_hooks_ = {
+    .tcp_cong_delete = tcp_cong_bbr_delete_,
+    .tcp_cong_duplicate_ack_ev = tcp_cong_bbr_duplicate_ack_ev_,
+    .tcp_cong_fast_recovery = tcp_cong_bbr_fast_recovery_,
+    .tcp_cong_new_ack_ev = tcp_cong_bbr_new_ack_ev_,
+    .tcp_cong_timeout_ev = tcp_cong_bbr_timeout_ev_,
+    .tcp_cong_ssthresh = tcp_cong_bbr_ssthresh_
+};
+
+void tcp_cong_bbr_init(TCP *tcp) {
+    CABBR *bbr = calloc(1, sizeof(CABBR));
+    bbr->mode = BBR_STARTUP;
+    bbr->pacing_gain = BBR_HIGH_GAIN;
+    bbr->cwnd_gain = BBR_HIGH_GAIN;
+
+    tcp_cong(tcp)->cwnd = TCP_INITIAL_CWND;
+    tcp_cong(tcp)->hooks = &bbr_hooks_;
+    tcp_cong(tcp)->ca = bbr;
+
+    tcp_cong(tcp)->pacingRate = 0;
+    bbr_set_pacing_rate_(bbr, tcp_cong(tcp));
+}
+
+guint32 tcp_cong_bbr_cycle_index(TCP *tcp) {
+    CABBR *bbr = tcp_cong(tcp)->ca;
+    return bbr->cycle_index;
+}
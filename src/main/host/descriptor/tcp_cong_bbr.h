@@ -0,0 +1,11 @@
+#ifndef SHD_TCP_CONG_BBR_H_
+#define SHD_TCP_CONG_BBR_H_
+
+#include "main/host/descriptor/tcp.h"
+#include "main/host/descriptor/tcp_cong.h"
+
+void tcp_cong_bbr_init(TCP *tcp);
+/* the phase of the pacing gain cycle that bbr is in, or was in when it left probe_bw */
+guint32 tcp_cong_bbr_cycle_index(TCP *tcp);
+
+#endif // SHD_TCP_CONG_BBR_H_
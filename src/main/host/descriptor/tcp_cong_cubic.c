@@ -0,0 +1,273 @@
+#include "main/host/descriptor/tcp_cong_cubic.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "main/core/support/definitions.h"
+#include "main/host/descriptor/tcp.h"
+#include "main/host/descriptor/tcp_cong.h"
+#include "support/logger/logger.h"
+
+/* window growth and reduction factors from rfc 8312 */
+#define CUBIC_C 0.4
+#define CUBIC_BETA 0.7
+/* reno's additive increase that makes the same average window as cubic's beta */
+#define CUBIC_FRIENDLY_ALPHA (3.0 * (1.0 - CUBIC_BETA) / (1.0 + CUBIC_BETA))
+
+/* hystart only leaves slow start early once the window is this large */
+#define HYSTART_LOW_WINDOW 16
+/* acks closer together than this are part of the same ack train */
+#define HYSTART_ACK_DELTA (2 * SIMTIME_ONE_MILLISECOND)
+/* the number of rtt samples taken at the start of each round */
+#define HYSTART_MIN_SAMPLES 8
+/* bounds on the rtt increase that counts as a filling queue */
+#define HYSTART_DELAY_MIN (4 * SIMTIME_ONE_MILLISECOND)
+#define HYSTART_DELAY_MAX (16 * SIMTIME_ONE_MILLISECOND)
+
+typedef struct CACubic_ {
+
+    size_t duplicate_ack_n;
+    bool in_fast_recovery;
+
+    guint32 ssthresh;
+
+    /* the window right before the last reduction, in packets */
+    double w_max;
+    /* when the current congestion avoidance epoch started, or 0 if it did not */
+    SimulationTime epoch_start;
+    /* seconds after the epoch start when the cubic function reaches origin_point */
+    double k;
+    double origin_point;
+    /* the window that reno would have in this epoch */
+    double w_est;
+    /* window growth that does not add up to a whole packet yet */
+    double cwnd_fraction;
+
+    /* the smallest rtt sample so far, or 0 if there was none */
+    SimulationTime delay_min;
+
+    /* hystart measures each round of one window of acks */
+    guint64 delivered;
+    guint64 round_end_delivered;
+    SimulationTime round_start;
+    SimulationTime last_ack;
+    SimulationTime round_rtt_min;
+    guint32 round_sample_n;
+
+} CACubic;
+
+/* HELPERS *******************************************************/
+
+/* remember the window before a loss, and start a new epoch from the reduced one */
+static void cubic_reduce_(TCPCong *cong, CACubic *cubic) {
+    double cwnd = cong->cwnd;
+
+    /* fast convergence: a flow whose window shrunk since the last loss leaves
+     * room for new flows by aiming lower */
+    if (cwnd < cubic->w_max) {
+        cubic->w_max = cwnd * (1.0 + CUBIC_BETA) / 2.0;
+    } else {
+        cubic->w_max = cwnd;
+    }
+
+    cubic->ssthresh = MAX((guint32)(cwnd * CUBIC_BETA), 2);
+    cubic->epoch_start = 0;
+    cubic->cwnd_fraction = 0;
+}
+
+static void hystart_exit_(TCPCong *cong, CACubic *cubic, const gchar *reason) {
+    cubic->ssthresh = cong->cwnd;
+    info("[CONG] hystart %s, leaving slow start at cwnd %u", reason, cong->cwnd);
+}
+
+static void hystart_update_(TCPCong *cong, CACubic *cubic, guint32 n) {
+    cubic->delivered += n;
+
+    /* a round ends when everything that was in flight at its start was acked */
+    if (cubic->delivered >= cubic->round_end_delivered) {
+        guint32 still_in_flight = cong->packetsInFlight > n ? cong->packetsInFlight - n : 0;
+        cubic->round_end_delivered = cubic->delivered + still_in_flight;
+        cubic->round_start = cong->now;
+        cubic->last_ack = cong->now;
+        cubic->round_rtt_min = 0;
+        cubic->round_sample_n = 0;
+    }
+
+    if (cong->cwnd < HYSTART_LOW_WINDOW || cubic->delay_min == 0) {
+        return;
+    }
+
+    /* the acks of a window arrive back to back while the path is not full, so an
+     * unbroken train longer than half the rtt means we reached the bottleneck */
+    if (cong->now - cubic->last_ack <= HYSTART_ACK_DELTA) {
+        cubic->last_ack = cong->now;
+        if (cong->now - cubic->round_start > cubic->delay_min / 2) {
+            hystart_exit_(cong, cubic, "found the end of the ack train");
+            return;
+        }
+    }
+
+    /* a growing rtt at the start of the round means a queue is building */
+    if (cong->rttSample > 0 && cubic->round_sample_n < HYSTART_MIN_SAMPLES) {
+        if (cubic->round_rtt_min == 0 || cong->rttSample < cubic->round_rtt_min) {
+            cubic->round_rtt_min = cong->rttSample;
+        }
+        cubic->round_sample_n++;
+
+        if (cubic->round_sample_n == HYSTART_MIN_SAMPLES) {
+            SimulationTime threshold = CLAMP(cubic->delay_min / 8, HYSTART_DELAY_MIN, HYSTART_DELAY_MAX);
+            if (cubic->round_rtt_min > cubic->delay_min + threshold) {
+                hystart_exit_(cong, cubic, "detected a delay increase");
+            }
+        }
+    }
+}
+
+static void cubic_cong_avoid_(TCPCong *cong, CACubic *cubic, guint32 n) {
+    if (n == 0) {
+        return;
+    }
+
+    double cwnd = cong->cwnd;
+
+    if (cubic->epoch_start == 0) {
+        cubic->epoch_start = cong->now;
+        if (cwnd < cubic->w_max) {
+            cubic->k = cbrt((cubic->w_max - cwnd) / CUBIC_C);
+            cubic->origin_point = cubic->w_max;
+        } else {
+            cubic->k = 0;
+            cubic->origin_point = cwnd;
+        }
+        cubic->w_est = cwnd;
+    }
+
+    /* aim for the window the cubic function reaches one rtt from now */
+    double t = (double)(cong->now - cubic->epoch_start + cubic->delay_min) / SIMTIME_ONE_SECOND;
+    double offset = t - cubic->k;
+    double target = cubic->origin_point + CUBIC_C * offset * offset * offset;
+
+    /* in the tcp-friendly region, grow at least as fast as reno would */
+    cubic->w_est += CUBIC_FRIENDLY_ALPHA * n / cwnd;
+    if (target < cubic->w_est) {
+        target = cubic->w_est;
+    }
+
+    if (target > cwnd) {
+        /* like linux, grow by at most half a packet per acked packet */
+        cubic->cwnd_fraction += MIN((target - cwnd) / cwnd, 0.5) * n;
+    } else {
+        /* near the plateau, keep probing very slowly */
+        cubic->cwnd_fraction += n / (100.0 * cwnd);
+    }
+
+    while (cubic->cwnd_fraction >= 1.0) {
+        cubic->cwnd_fraction -= 1.0;
+        cong->cwnd += 1;
+    }
+}
+
+/*******************************************************************/
+
+static void tcp_cong_cubic_delete_(TCP *tcp) {
+    free(tcp_cong(tcp)->ca);
+}
+
+static void tcp_cong_cubic_duplicate_ack_ev_(TCP *tcp) {
+    TCPCong *cong = tcp_cong(tcp);
+    CACubic *cubic = cong->ca;
+
+    if (cubic->in_fast_recovery) {
+        /* each duplicate ack means a packet left the network */
+        cong->cwnd += 1;
+        return;
+    }
+
+    cubic->duplicate_ack_n++;
+
+    if (cubic->duplicate_ack_n == 3) {
+        debug("[CONG-AVOID] three duplicate acks");
+        cubic_reduce_(cong, cubic);
+        cong->cwnd = cubic->ssthresh + 3;
+        cubic->in_fast_recovery = true;
+        info("[CONG] cubic fast recovery with w_max %f and ssthresh %u", cubic->w_max, cubic->ssthresh);
+    }
+}
+
+static bool tcp_cong_cubic_fast_recovery_(TCP *tcp) {
+    CACubic *cubic = tcp_cong(tcp)->ca;
+    return cubic->in_fast_recovery;
+}
+
+static void tcp_cong_cubic_new_ack_ev_(TCP *tcp, guint32 n) {
+    TCPCong *cong = tcp_cong(tcp);
+    CACubic *cubic = cong->ca;
+
+    cubic->duplicate_ack_n = 0;
+
+    if (cong->rttSample > 0 && (cubic->delay_min == 0 || cong->rttSample < cubic->delay_min)) {
+        cubic->delay_min = cong->rttSample;
+    }
+
+    if (cubic->in_fast_recovery) {
+        /* deflate the window that the duplicate acks inflated */
+        cubic->in_fast_recovery = false;
+        cong->cwnd = cubic->ssthresh;
+        return;
+    }
+
+    if (cong->cwnd < cubic->ssthresh) {
+        hystart_update_(cong, cubic, n);
+
+        /* slow start up to ssthresh, and use the leftover acks for cubic growth */
+        guint32 room = cubic->ssthresh > cong->cwnd ? cubic->ssthresh - cong->cwnd : 0;
+        guint32 slow_start_n = MIN(n, room);
+        cong->cwnd += slow_start_n;
+        n -= slow_start_n;
+    }
+
+    if (cong->cwnd >= cubic->ssthresh) {
+        cubic_cong_avoid_(cong, cubic, n);
+    }
+}
+
+static void tcp_cong_cubic_timeout_ev_(TCP *tcp) {
+    TCPCong *cong = tcp_cong(tcp);
+    CACubic *cubic = cong->ca;
+
+    cubic->duplicate_ack_n = 0;
+    cubic->in_fast_recovery = false;
+    cubic_reduce_(cong, cubic);
+    cong->cwnd = 1;
+
+    /* slow start measures its rounds from scratch */
+    cubic->round_end_delivered = cubic->delivered;
+    info("[CONG] cubic timeout, transition to slow start with ssthresh %u", cubic->ssthresh);
+}
+
+static guint32 tcp_cong_cubic_ssthresh_(TCP *tcp) {
+    CACubic *cubic = tcp_cong(tcp)->ca;
+    return cubic->ssthresh;
+}
+
+static const struct TCPCongHooks_ cubic_hooks_ = {
+    .tcp_cong_delete = tcp_cong_cubic_delete_,
+    .tcp_cong_duplicate_ack_ev = tcp_cong_cubic_duplicate_ack_ev_,
+    .tcp_cong_fast_recovery = tcp_cong_cubic_fast_recovery_,
+    .tcp_cong_new_ack_ev = tcp_cong_cubic_new_ack_ev_,
+    .tcp_cong_timeout_ev = tcp_cong_cubic_timeout_ev_,
+    .tcp_cong_ssthresh = tcp_cong_cubic_ssthresh_
+};
+
+void tcp_cong_cubic_init(TCP *tcp) {
+    CACubic *cubic = calloc(1, sizeof(CACubic));
+    cubic->ssthresh = INT32_MAX;
+
+    tcp_cong(tcp)->cwnd = TCP_INITIAL_CWND;
+    tcp_cong(tcp)->pacingRate = 0;
+    tcp_cong(tcp)->hooks = &cubic_hooks_;
+    tcp_cong(tcp)->ca = cubic;
+}
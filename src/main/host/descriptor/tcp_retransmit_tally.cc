@@ -221,7 +221,10 @@ enum TCPProcessFlags_ retransmit_tally_update(void *p, uint32_t last_ack, uint32
 
 /* We have to do an awful linear scan here because sacks use GList and there
  * is no efficient way to get the last element. */
-void retransmit_tally_mark_sacked(void *p, GList *sacked) {
+void retransmit_tally_mark_sacked(void *p, GList *sacked,
+                                  void (*on_sacked)(void *user_data, uint32_t begin, uint32_t end),
+                                  void *user_data)
+{
    auto rt = cast_and_assert(p);
    SeqRange sacked_block{-1, -1};
 
@@ -235,6 +238,12 @@ void retransmit_tally_mark_sacked(void *p, GList *sacked) {
           || GPOINTER_TO_INT(g_list_next(n)->data) != s + 1)
       {
          sacked_block.second = s + 1;
+         if (on_sacked != nullptr) {
+            // the receiver repeats its whole sack list in every ack
+            for (const auto &range : ranges_subtract({sacked_block}, rt->sacked_)) {
+               on_sacked(user_data, range.first, range.second);
+            }
+         }
          ranges_insert(&rt->sacked_, sacked_block);
          sacked_block.first = -1;
          sacked_block.second = -1;
@@ -36,7 +36,11 @@ size_t retransmit_tally_size_bytes();
 
 enum TCPProcessFlags_ retransmit_tally_update(void *p, uint32_t last_ack, uint32_t max_ack, bool is_dup);
 void retransmit_tally_cleanup_sacked(void *p);
-void retransmit_tally_mark_sacked(void *p, struct _GList *sacked);
+/* Calls on_sacked, if given, with each block [begin, end) that was not already
+ * marked as sacked, so callers can release those packets exactly once. */
+void retransmit_tally_mark_sacked(void *p, struct _GList *sacked,
+                                  void (*on_sacked)(void *user_data, uint32_t begin, uint32_t end),
+                                  void *user_data);
 /* Marks the block [begin, end) as lost. */
 void retransmit_tally_mark_lost(void *p, uint32_t begin, uint32_t end);
 void retransmit_tally_mark_retransmitted(void *p, uint32_t begin, uint32_t end);
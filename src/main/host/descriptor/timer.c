@@ -30,12 +30,10 @@ struct _Timer {
     /* number of expires that happened since the timer was last set */
     guint64 expireCountSinceLastSet;
 
-    /* expire ids are used internally to cancel events that fire after
-     * they have become invalid because the user reset the timer */
-    guint nextExpireID;
-    guint minValidExpireID;
+    /* the pending expiration task, or NULL if none is scheduled. we cancel
+     * it when the user resets or closes the timer. */
+    Task* expireTask;
 
-    guint numEventsScheduled;
     gboolean isClosed;
 
     MAGIC_DECLARE;
@@ -44,6 +42,9 @@ struct _Timer {
 static void _timer_close(Timer* timer) {
     MAGIC_ASSERT(timer);
     timer->isClosed = TRUE;
+    if(timer->expireTask) {
+        worker_cancelTask(timer->expireTask);
+    }
     descriptor_adjustStatus(&(timer->super), DS_ACTIVE, FALSE);
     host_closeDescriptor(worker_getActiveHost(), timer->super.handle);
 }
@@ -141,7 +142,9 @@ static void _timer_disarm(Timer* timer) {
     MAGIC_ASSERT(timer);
     timer->nextExpireTime = 0;
     timer->expireInterval = 0;
-    timer->minValidExpireID = timer->nextExpireID;
+    if(timer->expireTask) {
+        worker_cancelTask(timer->expireTask);
+    }
     debug("timer fd %i disarmed", timer->super.handle);
 }
 
@@ -200,14 +203,13 @@ static void _timer_expire(Timer* timer, gpointer data);
 
 static void _timer_scheduleNewExpireEvent(Timer* timer) {
     MAGIC_ASSERT(timer);
-
-    /* callback to our own node */
-    gpointer next = GUINT_TO_POINTER(timer->nextExpireID);
+    utility_assert(timer->expireTask == NULL);
 
     /* ref the timer storage in the callback event */
     descriptor_ref(timer);
     Task* task = task_new((TaskCallbackFunc)_timer_expire,
-            timer, next, descriptor_unref, NULL);
+            timer, NULL, descriptor_unref, NULL);
+    task_setHandle(task, &timer->expireTask);
 
     SimulationTime delay = timer->nextExpireTime - worker_getCurrentTime();
 
@@ -217,23 +219,16 @@ static void _timer_scheduleNewExpireEvent(Timer* timer) {
 
     worker_scheduleTask(task, delay);
     task_unref(task);
-
-    timer->nextExpireID++;
-    timer->numEventsScheduled++;
 }
 
 static void _timer_expire(Timer* timer, gpointer data) {
     MAGIC_ASSERT(timer);
 
-    /* this is a task callback event */
-
-    guint expireID = GPOINTER_TO_UINT(data);
-    debug("timer fd %i expired; isClosed=%i expireID=%u minValidExpireID=%u", timer->super.handle, timer->isClosed, expireID, timer->minValidExpireID);
-
-    timer->numEventsScheduled--;
+    /* this is a task callback event. resetting or closing the timer cancels the
+     * pending task, so this expiration is still valid. */
+    debug("timer fd %i expired; isClosed=%i", timer->super.handle, timer->isClosed);
 
-    /* make sure the timer has not been reset since we scheduled this expiration event */
-    if(!timer->isClosed && expireID >= timer->minValidExpireID) {
+    if(!timer->isClosed) {
         /* check if it actually expired on this callback check */
         if(timer->nextExpireTime <= worker_getCurrentTime()) {
             /* if a one-time (non-periodic) timer already expired before they
@@ -9,6 +9,7 @@
 
 #include <glib.h>
 #include <netinet/in.h>
+#include <sys/uio.h>
 
 #include "main/core/support/definitions.h"
 #include "main/host/descriptor/descriptor.h"
@@ -16,8 +17,10 @@
 typedef struct _Transport Transport;
 typedef struct _TransportFunctionTable TransportFunctionTable;
 
-typedef gssize (*TransportSendFunc)(Transport* transport, gconstpointer buffer, gsize nBytes, in_addr_t ip, in_port_t port);
-typedef gssize (*TransportReceiveFunc)(Transport* transport, gpointer buffer, gsize nBytes, in_addr_t* ip, in_port_t* port);
+/* user data moves through vectors of buffers, so that scatter-gather calls reach the
+ * transport without being flattened into a temporary buffer first */
+typedef gssize (*TransportSendFunc)(Transport* transport, const struct iovec* iov, gint iovcnt, in_addr_t ip, in_port_t port);
+typedef gssize (*TransportReceiveFunc)(Transport* transport, const struct iovec* iov, gint iovcnt, in_addr_t* ip, in_port_t* port);
 
 struct _TransportFunctionTable {
     DescriptorFunc close;
@@ -36,9 +39,9 @@ struct _Transport {
 
 void transport_init(Transport* transport, TransportFunctionTable* vtable, DescriptorType type, gint handle);
 
-gssize transport_sendUserData(Transport* transport, gconstpointer buffer, gsize nBytes,
+gssize transport_sendUserData(Transport* transport, const struct iovec* iov, gint iovcnt,
         in_addr_t ip, in_port_t port);
-gssize transport_receiveUserData(Transport* transport, gpointer buffer, gsize nBytes,
+gssize transport_receiveUserData(Transport* transport, const struct iovec* iov, gint iovcnt,
         in_addr_t* ip, in_port_t* port);
 
 #endif /* SHD_TRANSPORT_H_ */
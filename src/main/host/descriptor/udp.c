@@ -53,11 +53,10 @@ gint udp_connectToPeer(UDP* udp, in_addr_t ip, in_port_t port, sa_family_t famil
 void udp_processPacket(UDP* udp, Packet* packet) {
     MAGIC_ASSERT(udp);
 
-    /* UDP packet contains data for user and can be buffered immediately */
-    if(packet_getPayloadLength(packet) > 0) {
-        if(!socket_addToInputBuffer((Socket*)udp, packet)) {
-            packet_addDeliveryStatus(packet, PDS_RCV_SOCKET_DROPPED);
-        }
+    /* UDP packet contains data for user and can be buffered immediately. an empty
+     * datagram is still a datagram that the user receives */
+    if(!socket_addToInputBuffer((Socket*)udp, packet)) {
+        packet_addDeliveryStatus(packet, PDS_RCV_SOCKET_DROPPED);
     }
 }
 
@@ -72,9 +71,10 @@ void udp_dropPacket(UDP* udp, Packet* packet) {
  * ip and port parameters. this function assumes that the socket is already
  * bound to a local port, no matter if that happened explicitly or implicitly.
  */
-gssize udp_sendUserData(UDP* udp, gconstpointer buffer, gsize nBytes, in_addr_t ip, in_port_t port) {
+gssize udp_sendUserData(UDP* udp, const struct iovec* iov, gint iovcnt, in_addr_t ip, in_port_t port) {
     MAGIC_ASSERT(udp);
 
+    gsize nBytes = utility_iovecLength(iov, iovcnt);
     gsize space = socket_getOutputBufferSpace(&(udp->super));
     if(space < nBytes) {
         /* not enough space to buffer the data */
@@ -86,8 +86,11 @@ gssize udp_sendUserData(UDP* udp, gconstpointer buffer, gsize nBytes, in_addr_t
     gsize remaining = nBytes;
     gsize offset = 0;
 
-    /* create as many packets as needed */
-    while(remaining > 0) {
+    /* gather the data once, and let each packet reference its own part of the copy */
+    PayloadBuffer* payload = remaining > 0 ? payloadbuffer_newVector(iov, iovcnt, 0, remaining) : NULL;
+
+    /* create as many packets as needed, and one empty datagram for an empty send */
+    do {
         gsize copyLength = MIN(maxPacketLength, remaining);
 
         /* use default destination if none was specified */
@@ -111,7 +114,7 @@ gssize udp_sendUserData(UDP* udp, gconstpointer buffer, gsize nBytes, in_addr_t
 
         /* create the UDP packet */
         Host* host = worker_getActiveHost();
-        Packet* packet = packet_new(buffer + offset, copyLength, (guint)host_getID(host), host_getNewPacketID(host));
+        Packet* packet = packet_newSlice(payload, offset, copyLength, (guint)host_getID(host), host_getNewPacketID(host));
         packet_setUDP(packet, PUDP_NONE, sourceIP, sourcePort, destinationIP, destinationPort);
         packet_addDeliveryStatus(packet, PDS_SND_CREATED);
 
@@ -126,6 +129,11 @@ gssize udp_sendUserData(UDP* udp, gconstpointer buffer, gsize nBytes, in_addr_t
             warning("unable to send UDP packet");
             break;
         }
+    } while(remaining > 0);
+
+    /* the packets hold the buffer refs now */
+    if(payload) {
+        payloadbuffer_unref(payload);
     }
 
     /* update the tracker output buffer stats */
@@ -141,7 +149,7 @@ gssize udp_sendUserData(UDP* udp, gconstpointer buffer, gsize nBytes, in_addr_t
     return (gssize) offset;
 }
 
-gssize udp_receiveUserData(UDP* udp, gpointer buffer, gsize nBytes, in_addr_t* ip, in_port_t* port) {
+gssize udp_receiveUserData(UDP* udp, const struct iovec* iov, gint iovcnt, in_addr_t* ip, in_port_t* port) {
     MAGIC_ASSERT(udp);
 
     Packet* packet = socket_removeFromInputBuffer((Socket*)udp);
@@ -151,11 +159,12 @@ gssize udp_receiveUserData(UDP* udp, gpointer buffer, gsize nBytes, in_addr_t* i
 
     /* copy lesser of requested and available amount to application buffer */
     guint packetLength = packet_getPayloadLength(packet);
-    gsize copyLength = MIN(nBytes, packetLength);
-    guint bytesCopied = packet_copyPayload(packet, 0, buffer, copyLength);
+    gsize copyLength = MIN(utility_iovecLength(iov, iovcnt), packetLength);
+    guint bytesCopied = packet_copyPayloadVector(packet, 0, iov, iovcnt, 0, copyLength);
 
     utility_assert(bytesCopied == copyLength);
     packet_addDeliveryStatus(packet, PDS_RCV_SOCKET_DELIVERED);
+    worker_countCopiedBytes(COPY_TYPE_DELIVERED, bytesCopied);
 
     /* fill in address info */
     if(ip) {
@@ -192,9 +192,11 @@ void host_setup(Host* host, DNS* dns, Topology* topology, guint rawCPUFreq, cons
 
     /* virtual addresses and interfaces for managing network I/O */
     NetworkInterface* loopback = networkinterface_new(loopbackAddress, G_MAXUINT32, G_MAXUINT32,
-            host->params.logPcap, host->params.pcapDir, host->params.qdisc, host->params.interfaceBufSize);
+            host->params.logPcap, host->params.pcapDir, host->params.qdisc, host->params.interfaceBufSize,
+            host->params.segmentationOffload);
     NetworkInterface* ethernet = networkinterface_new(ethernetAddress, bwDownKiBps, bwUpKiBps,
-            host->params.logPcap, host->params.pcapDir, host->params.qdisc, host->params.interfaceBufSize);
+            host->params.logPcap, host->params.pcapDir, host->params.qdisc, host->params.interfaceBufSize,
+            host->params.segmentationOffload);
 
     g_hash_table_replace(host->interfaces, GUINT_TO_POINTER((guint)address_toNetworkIP(ethernetAddress)), ethernet);
     g_hash_table_replace(host->interfaces, GUINT_TO_POINTER((guint)htonl(INADDR_LOOPBACK)), loopback);
@@ -1463,7 +1465,7 @@ gint host_getSocketName(Host* host, gint handle, const struct sockaddr* address,
     }
 }
 
-gint host_sendUserData(Host* host, gint handle, gconstpointer buffer, gsize nBytes,
+gint host_sendUserData(Host* host, gint handle, const struct iovec* iov, gint iovcnt,
         in_addr_t ip, in_addr_t port, gsize* bytesCopied) {
     MAGIC_ASSERT(host);
     utility_assert(bytesCopied);
@@ -1489,7 +1491,8 @@ gint host_sendUserData(Host* host, gint handle, gconstpointer buffer, gsize nByt
 
     /* we should block if our cpu has been too busy lately */
     if(cpu_isBlocked(host->cpu)) {
-        debug("blocked on CPU when trying to send %"G_GSIZE_FORMAT" bytes from socket %i", nBytes, handle);
+        debug("blocked on CPU when trying to send %"G_GSIZE_FORMAT" bytes from socket %i",
+                utility_iovecLength(iov, iovcnt), handle);
 
         /*
          * immediately schedule an event to tell the socket it can write. it will
@@ -1539,7 +1542,7 @@ gint host_sendUserData(Host* host, gint handle, gconstpointer buffer, gsize nByt
         }
     }
 
-    gssize n = transport_sendUserData(transport, buffer, nBytes, ip, port);
+    gssize n = transport_sendUserData(transport, iov, iovcnt, ip, port);
     if(n > 0) {
         /* user is writing some bytes. */
         *bytesCopied = (gsize)n;
@@ -1554,7 +1557,7 @@ gint host_sendUserData(Host* host, gint handle, gconstpointer buffer, gsize nByt
     return 0;
 }
 
-gint host_receiveUserData(Host* host, gint handle, gpointer buffer, gsize nBytes,
+gint host_receiveUserData(Host* host, gint handle, const struct iovec* iov, gint iovcnt,
         in_addr_t* ip, in_port_t* port, gsize* bytesCopied) {
     MAGIC_ASSERT(host);
     utility_assert(ip && port && bytesCopied);
@@ -1579,7 +1582,8 @@ gint host_receiveUserData(Host* host, gint handle, gpointer buffer, gsize nBytes
 
     /* we should block if our cpu has been too busy lately */
     if(cpu_isBlocked(host->cpu)) {
-        debug("blocked on CPU when trying to send %"G_GSIZE_FORMAT" bytes from socket %i", nBytes, handle);
+        debug("blocked on CPU when trying to send %"G_GSIZE_FORMAT" bytes from socket %i",
+                utility_iovecLength(iov, iovcnt), handle);
 
         /*
          * immediately schedule an event to tell the socket it can read. it will
@@ -1590,7 +1594,7 @@ gint host_receiveUserData(Host* host, gint handle, gpointer buffer, gsize nBytes
         return EAGAIN;
     }
 
-    gssize n = transport_receiveUserData(transport, buffer, nBytes, ip, port);
+    gssize n = transport_receiveUserData(transport, iov, iovcnt, ip, port);
     if(n > 0) {
         /* user is reading some bytes. */
         *bytesCopied = (gsize)n;
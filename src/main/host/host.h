@@ -14,6 +14,7 @@
 #include <sys/epoll.h>
 #include <sys/select.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 #include "main/core/support/definitions.h"
 #include "main/core/support/options.h"
@@ -52,6 +53,7 @@ struct _HostParameters {
     gboolean logPcap;
     gchar* pcapDir;
     QDiscMode qdisc;
+    gboolean segmentationOffload;
     guint64 recvBufSize;
     gboolean autotuneRecvBuf;
     guint64 sendBufSize;
@@ -123,8 +125,8 @@ gint host_bindToInterface(Host* host, gint handle, const struct sockaddr* addres
 gint host_connectToPeer(Host* host, gint handle, const struct sockaddr* address);
 gint host_listenForPeer(Host* host, gint handle, gint backlog);
 gint host_acceptNewPeer(Host* host, gint handle, in_addr_t* ip, in_port_t* port, gint* acceptedHandle);
-gint host_sendUserData(Host* host, gint handle, gconstpointer buffer, gsize nBytes, in_addr_t ip, in_addr_t port, gsize* bytesCopied);
-gint host_receiveUserData(Host* host, gint handle, gpointer buffer, gsize nBytes, in_addr_t* ip, in_port_t* port, gsize* bytesCopied);
+gint host_sendUserData(Host* host, gint handle, const struct iovec* iov, gint iovcnt, in_addr_t ip, in_addr_t port, gsize* bytesCopied);
+gint host_receiveUserData(Host* host, gint handle, const struct iovec* iov, gint iovcnt, in_addr_t* ip, in_port_t* port, gsize* bytesCopied);
 gint host_getPeerName(Host* host, gint handle, const struct sockaddr* address, socklen_t* len);
 gint host_getSocketName(Host* host, gint handle, const struct sockaddr* address, socklen_t* len);
 
@@ -19,6 +19,7 @@
 #include "main/host/host.h"
 #include "main/host/network_interface.h"
 #include "main/host/protocol.h"
+#include "main/host/socket_demux.h"
 #include "main/host/tracker.h"
 #include "main/routing/address.h"
 #include "main/routing/dns.h"
@@ -37,6 +38,10 @@ struct _NetworkInterfaceTokenBucket {
     guint64 bytesRemaining;
     /* The number of bytes that get added to the bucket every millisecond */
     guint64 bytesRefill;
+    /* The last time we added the tokens earned until then, and the fraction of a
+     * byte we had earned on top, in bytes times nanoseconds per millisecond */
+    SimulationTime lastRefillTime;
+    guint64 partialRefill;
 };
 
 struct _NetworkInterface {
@@ -51,8 +56,8 @@ struct _NetworkInterface {
     /* The address associated with this interface */
     Address* address;
 
-    /* (protocol,port)-to-socket bindings */
-    GHashTable* boundSockets;
+    /* (protocol,port,peer)-to-socket bindings */
+    SocketDemux* boundSockets;
 
     /* Transports wanting to send data out */
     GQueue* rrQueue;
@@ -66,12 +71,24 @@ struct _NetworkInterface {
      * packets that do not conform to incoming rate limits are dropped. */
     NetworkInterfaceTokenBucket receiveBucket;
 
-    /* Store the time we started refilling our token buckets. This is used to
-     * help us compute when refills should occur following an idle period. */
-    SimulationTime timeStartedRefillingBuckets;
-
-    /* If we have scheduled a refill task but it has not yet executed. */
-    gboolean isRefillPending;
+    /* The refill task we scheduled for when the next waiting packet conforms, if it
+     * has not yet executed, and when it runs. The task does not hold a reference to
+     * us, so we cancel it when we are freed. */
+    Task* refillTask;
+    SimulationTime refillTaskTime;
+
+    /* Sockets that have packets but whose pacing rate does not allow sending
+     * yet, ordered by when they may send. They keep their sendable queue ref,
+     * and are flagged with socket_setPaced while in here. */
+    PriorityQueue* pacedSockets;
+    /* The task that wakes the earliest paced socket and when it runs, so we can
+     * move it earlier. It is cancelled when we are freed. */
+    Task* pacingTask;
+    SimulationTime pacingTaskTime;
+
+    /* With segmentation offload, the packets we just sent in a row to the same
+     * remote address, which the router forwards as one train. NULL otherwise. */
+    GPtrArray* sendTrain;
 
     /* To support capturing incoming and outgoing packets */
     PCapWriter* pcap;
@@ -83,6 +100,8 @@ struct _NetworkInterface {
 static void _networkinterface_sendPackets(NetworkInterface* interface);
 static void _networkinterface_refillTokenBucketsCB(NetworkInterface* interface,
                                                    gpointer userData);
+static void _networkinterface_wakePacedSocketsCB(NetworkInterface* interface,
+                                                 gpointer userData);
 
 static gint _networkinterface_compareSocket(const Socket* sa, const Socket* sb, gpointer userData) {
     Packet* pa = socket_peekNextPacket(sa);
@@ -90,6 +109,12 @@ static gint _networkinterface_compareSocket(const Socket* sa, const Socket* sb,
     return packet_getPriority(pa) > packet_getPriority(pb) ? +1 : -1;
 }
 
+static gint _networkinterface_comparePacingTime(const Socket* sa, const Socket* sb, gpointer userData) {
+    SimulationTime ta = socket_getPacingTime((Socket*)sa);
+    SimulationTime tb = socket_getPacingTime((Socket*)sb);
+    return ta > tb ? +1 : (ta < tb ? -1 : 0);
+}
+
 static inline SimulationTime _networkinterface_getRefillInterval() {
     return (SimulationTime) SIMTIME_ONE_MILLISECOND*1;
 }
@@ -99,13 +124,51 @@ static inline guint64 _networkinterface_getCapacityFactor() {
     return (guint64) 1;
 }
 
-static void _networkinterface_refillTokenBucket(NetworkInterfaceTokenBucket* bucket) {
-    /* We have room to add more tokens. */
-    bucket->bytesRemaining += bucket->bytesRefill;
+/* adds the tokens earned since the bucket was last refilled */
+static void _networkinterface_refillTokenBucket(NetworkInterfaceTokenBucket* bucket,
+                                                SimulationTime now) {
+    if(now <= bucket->lastRefillTime) {
+        return;
+    }
+
+    SimulationTime interval = _networkinterface_getRefillInterval();
+    SimulationTime elapsed = now - bucket->lastRefillTime;
+    bucket->lastRefillTime = now;
+
+    if(bucket->bytesRemaining >= bucket->bytesCapacity || bucket->bytesRefill == 0) {
+        bucket->partialRefill = 0;
+        return;
+    }
+
+    /* a bucket fills up after this long, which also keeps the products from overflowing */
+    SimulationTime fillTime = ((bucket->bytesCapacity * interval) / bucket->bytesRefill) + 1;
+    elapsed = MIN(elapsed, fillTime);
+
+    guint64 earned = (elapsed * bucket->bytesRefill) + bucket->partialRefill;
+    bucket->bytesRemaining += earned / interval;
+    bucket->partialRefill = earned % interval;
+
     /* Make sure we stay within capacity. */
-    if(bucket->bytesRemaining > bucket->bytesCapacity) {
+    if(bucket->bytesRemaining >= bucket->bytesCapacity) {
         bucket->bytesRemaining = bucket->bytesCapacity;
+        bucket->partialRefill = 0;
+    }
+}
+
+/* returns how long until the bucket holds the given number of bytes */
+static SimulationTime _networkinterface_getTokenBucketWaitTime(NetworkInterfaceTokenBucket* bucket,
+                                                             guint64 bytes) {
+    bytes = MIN(bytes, bucket->bytesCapacity);
+    if(bucket->bytesRemaining >= bytes) {
+        return 0;
+    }
+    if(bucket->bytesRefill == 0) {
+        return SIMTIME_INVALID;
     }
+
+    SimulationTime interval = _networkinterface_getRefillInterval();
+    guint64 needed = ((bytes - bucket->bytesRemaining) * interval) - bucket->partialRefill;
+    return (needed + bucket->bytesRefill - 1) / bucket->bytesRefill;
 }
 
 static void
@@ -118,62 +181,71 @@ _networkinterface_consumeTokenBucket(NetworkInterfaceTokenBucket* bucket,
     }
 }
 
+static gboolean _networkinterface_hasSendableSockets(NetworkInterface* interface) {
+    return !g_queue_is_empty(interface->rrQueue) || !priorityqueue_isEmpty(interface->fifoQueue);
+}
+
+/* returns how long until the bucket lets the next packet through, or SIMTIME_INVALID
+ * if no packet is waiting for it */
+static SimulationTime _networkinterface_getWaitTime(NetworkInterface* interface,
+        NetworkInterfaceTokenBucket* bucket, gboolean isWaiting) {
+    if(!isWaiting || bucket->bytesRemaining >= CONFIG_MTU) {
+        return SIMTIME_INVALID;
+    }
+
+    /* with offload, wait until a whole refill interval of packets can go at once,
+     * like the bursts a segmentation offload engine sends */
+    guint64 bytes = interface->sendTrain ? bucket->bytesCapacity : CONFIG_MTU;
+    return _networkinterface_getTokenBucketWaitTime(bucket, bytes);
+}
+
 static void _networkinterface_scheduleRefillTask(NetworkInterface* interface,
                                                  TaskCallbackFunc func,
                                                  SimulationTime delay) {
     Task* refillTask = task_new(func, interface, NULL, NULL, NULL);
+    task_setHandle(refillTask, &interface->refillTask);
     worker_scheduleTask(refillTask, delay);
     task_unref(refillTask);
-    interface->isRefillPending = TRUE;
 }
 
-static void _networkinterface_scheduleNextRefill(NetworkInterface* interface) {
+/* The buckets earn tokens continuously, and we add them up whenever we use a bucket.
+ * We only need a callback when a packet is waiting for tokens, at the time it will
+ * conform, so the refill cost follows the packets sent rather than the time passed. */
+static void _networkinterface_scheduleNextRefillIfNeeded(NetworkInterface* interface) {
+    SimulationTime sendWait = _networkinterface_getWaitTime(interface, &interface->sendBucket,
+            _networkinterface_hasSendableSockets(interface));
+    SimulationTime receiveWait = _networkinterface_getWaitTime(interface, &interface->receiveBucket,
+            interface->router && router_peek(interface->router));
+
+    SimulationTime wait = MIN(sendWait, receiveWait);
+    if(wait == SIMTIME_INVALID) {
+        return;
+    }
+
     SimulationTime now = worker_getCurrentTime();
-    SimulationTime interval = _networkinterface_getRefillInterval();
+    wait = MAX(wait, 1);
 
-    /* This computes the time that the next refill should have occurred if we
-     * were to always call the refill function every interval, even though in
-     * practice we stop scheduling refill tasks once we notice we are idle. */
-    SimulationTime offset = now - interface->timeStartedRefillingBuckets;
-    SimulationTime relTimeSincelastRefill = offset % interval;
-    SimulationTime relTimeUntilNextRefill = interval - relTimeSincelastRefill;
+    if(interface->refillTask) {
+        if(interface->refillTaskTime <= now + wait) {
+            return;
+        }
+        /* the bucket will conform sooner than the pending callback runs */
+        worker_cancelTask(interface->refillTask);
+    }
 
     /* call back when we need the next refill */
     _networkinterface_scheduleRefillTask(
-        interface, (TaskCallbackFunc)_networkinterface_refillTokenBucketsCB,
-        relTimeUntilNextRefill);
-}
-
-static gboolean _networkinterface_isRefillNeeded(NetworkInterface* interface) {
-    gboolean sendNeedsRefill = interface->sendBucket.bytesRemaining <
-                               interface->sendBucket.bytesCapacity;
-    gboolean receiveNeedsRefill = interface->receiveBucket.bytesRemaining <
-                                  interface->receiveBucket.bytesCapacity;
-    return (sendNeedsRefill || receiveNeedsRefill) &&
-           !interface->isRefillPending;
-}
-
-static void
-_networkinterface_scheduleNextRefillIfNeeded(NetworkInterface* interface) {
-    if (_networkinterface_isRefillNeeded(interface)) {
-        _networkinterface_scheduleNextRefill(interface);
-    }
+        interface, (TaskCallbackFunc)_networkinterface_refillTokenBucketsCB, wait);
+    interface->refillTaskTime = now + wait;
 }
 
 static void _networkinterface_refillTokenBucketsCB(NetworkInterface* interface,
                                                    gpointer userData) {
     MAGIC_ASSERT(interface);
 
-    /* We no longer have an outstanding event in the event queue. */
-    interface->isRefillPending = FALSE;
-
-    /* Refill the token buckets. */
-    _networkinterface_refillTokenBucket(&interface->receiveBucket);
-    _networkinterface_refillTokenBucket(&interface->sendBucket);
-
     /* the refill may have caused us to be able to receive and send again.
      * we only receive packets from an upstream router if we have one (i.e.,
-     * if this is not a loopback interface). */
+     * if this is not a loopback interface). both refill the buckets they use. */
     if(interface->router) {
         networkinterface_receivePackets(interface);
     }
@@ -185,7 +257,13 @@ static void _networkinterface_refillTokenBucketsCB(NetworkInterface* interface,
 void networkinterface_startRefillingTokenBuckets(NetworkInterface* interface) {
     MAGIC_ASSERT(interface);
 
-    interface->timeStartedRefillingBuckets = worker_getCurrentTime();
+    /* start with the tokens of one refill interval, and earn more from now on */
+    SimulationTime now = worker_getCurrentTime();
+    interface->receiveBucket.lastRefillTime = now;
+    interface->receiveBucket.bytesRemaining = interface->receiveBucket.bytesRefill;
+    interface->sendBucket.lastRefillTime = now;
+    interface->sendBucket.bytesRemaining = interface->sendBucket.bytesRefill;
+
     _networkinterface_refillTokenBucketsCB(interface, NULL);
 }
 
@@ -252,86 +330,55 @@ guint32 networkinterface_getSpeedDownKiBps(NetworkInterface* interface) {
     return (guint32)kibPerSecond;
 }
 
-static gchar* _networkinterface_getAssociationKey(NetworkInterface* interface,
-        ProtocolType type, in_port_t port, in_addr_t peerAddr, in_port_t peerPort) {
-    MAGIC_ASSERT(interface);
-
-    GString* strBuffer = g_string_new(NULL);
-    g_string_printf(strBuffer,
-            "%s|%"G_GUINT32_FORMAT":%"G_GUINT16_FORMAT"|%"G_GUINT32_FORMAT":%"G_GUINT16_FORMAT,
-            protocol_toString(type),
-            (guint)address_toNetworkIP(interface->address),
-            port, peerAddr, peerPort);
-
-    return g_string_free(strBuffer, FALSE);
-}
-
-static gchar* _networkinterface_socketToAssociationKey(NetworkInterface* interface, Socket* socket) {
-    MAGIC_ASSERT(interface);
-
-    ProtocolType type = socket_getProtocol(socket);
-
-    in_addr_t peerIP = 0;
-    in_port_t peerPort = 0;
-    socket_getPeerName(socket, &peerIP, &peerPort);
+static void _networkinterface_getSocketTuple(Socket* socket, in_port_t* boundPort,
+        in_addr_t* peerIP, in_port_t* peerPort) {
+    *peerIP = 0;
+    *peerPort = 0;
+    socket_getPeerName(socket, peerIP, peerPort);
 
     in_addr_t boundIP = 0;
-    in_port_t boundPort = 0;
-    socket_getSocketName(socket, &boundIP, &boundPort);
-
-    gchar* key = _networkinterface_getAssociationKey(interface, type, boundPort, peerIP, peerPort);
-    return key;
+    *boundPort = 0;
+    socket_getSocketName(socket, &boundIP, boundPort);
 }
 
 gboolean networkinterface_isAssociated(NetworkInterface* interface, ProtocolType type,
         in_port_t port, in_addr_t peerAddr, in_port_t peerPort) {
     MAGIC_ASSERT(interface);
 
-    gboolean isFound = FALSE;
-
-    /* we need to check the general key too (ie the ones listening sockets use) */
-    gchar* general = _networkinterface_getAssociationKey(interface, type, port, 0, 0);
-    if(g_hash_table_lookup(interface->boundSockets, general)) {
-        isFound = TRUE;
-    }
-    g_free(general);
-
-    if(!isFound) {
-        gchar* specific = _networkinterface_getAssociationKey(interface, type, port, peerAddr, peerPort);
-        if(g_hash_table_lookup(interface->boundSockets, specific)) {
-            isFound = TRUE;
-        }
-        g_free(specific);
-    }
-
-    return isFound;
+    /* this checks the general key too (ie the ones listening sockets use) */
+    return socketdemux_lookup(interface->boundSockets, type, port, peerAddr, peerPort) != NULL;
 }
 
 void networkinterface_associate(NetworkInterface* interface, Socket* socket) {
     MAGIC_ASSERT(interface);
 
-    gchar* key = _networkinterface_socketToAssociationKey(interface, socket);
-
-    /* make sure there is no collision */
-    utility_assert(!g_hash_table_contains(interface->boundSockets, key));
+    ProtocolType type = socket_getProtocol(socket);
+    in_port_t boundPort = 0, peerPort = 0;
+    in_addr_t peerIP = 0;
+    _networkinterface_getSocketTuple(socket, &boundPort, &peerIP, &peerPort);
 
-    /* insert to our storage, key is now owned by table */
-    g_hash_table_replace(interface->boundSockets, key, socket);
+    /* insert to our storage, and make sure there is no collision */
+    gboolean isInserted = socketdemux_insert(interface->boundSockets, type, boundPort, peerIP, peerPort, socket);
+    utility_assert(isInserted);
     descriptor_ref(socket);
 
-    debug("associated socket key %s", key);
+    debug("associated socket %s|%"G_GUINT16_FORMAT"|%"G_GUINT32_FORMAT":%"G_GUINT16_FORMAT,
+            protocol_toString(type), boundPort, peerIP, peerPort);
 }
 
 void networkinterface_disassociate(NetworkInterface* interface, Socket* socket) {
     MAGIC_ASSERT(interface);
 
-    gchar* key = _networkinterface_socketToAssociationKey(interface, socket);
+    ProtocolType type = socket_getProtocol(socket);
+    in_port_t boundPort = 0, peerPort = 0;
+    in_addr_t peerIP = 0;
+    _networkinterface_getSocketTuple(socket, &boundPort, &peerIP, &peerPort);
 
     /* we will no longer receive packets for this port, this unrefs descriptor */
-    g_hash_table_remove(interface->boundSockets, key);
+    socketdemux_remove(interface->boundSockets, type, boundPort, peerIP, peerPort);
 
-    debug("disassociated socket key %s", key);
-    g_free(key);
+    debug("disassociated socket %s|%"G_GUINT16_FORMAT"|%"G_GUINT32_FORMAT":%"G_GUINT16_FORMAT,
+            protocol_toString(type), boundPort, peerIP, peerPort);
 }
 
 static void _networkinterface_capturePacket(NetworkInterface* interface, Packet* packet) {
@@ -385,22 +432,11 @@ static void _networkinterface_receivePacket(NetworkInterface* interface, Packet*
     ProtocolType ptype = packet_getProtocol(packet);
     in_port_t bindPort = packet_getDestinationPort(packet);
 
-    /* the first check is for servers who don't associate with specific destinations */
-    gchar* key = _networkinterface_getAssociationKey(interface, ptype, bindPort, 0, 0);
-    debug("looking for socket associated with general key %s", key);
-    Socket* socket = g_hash_table_lookup(interface->boundSockets, key);
-    g_free(key);
-
-    if(!socket) {
-        /* now check the destination-specific key */
-        in_addr_t peerIP = packet_getSourceIP(packet);
-        in_port_t peerPort = packet_getSourcePort(packet);
-
-        key = _networkinterface_getAssociationKey(interface, ptype, bindPort, peerIP, peerPort);
-        debug("looking for socket associated with specific key %s", key);
-        socket = g_hash_table_lookup(interface->boundSockets, key);
-        g_free(key);
-    }
+    /* servers who don't associate with specific destinations are checked first, then
+     * the destination-specific sockets */
+    in_addr_t peerIP = packet_getSourceIP(packet);
+    in_port_t peerPort = packet_getSourcePort(packet);
+    Socket* socket = socketdemux_lookup(interface->boundSockets, ptype, bindPort, peerIP, peerPort);
 
     /* if the socket closed, just drop the packet */
     gint socketHandle = -1;
@@ -431,6 +467,8 @@ void networkinterface_receivePackets(NetworkInterface* interface) {
     /* get the bootstrapping mode */
     gboolean bootstrapping = worker_isBootstrapActive();
 
+    _networkinterface_refillTokenBucket(&interface->receiveBucket, worker_getCurrentTime());
+
     while(bootstrapping || interface->receiveBucket.bytesRemaining >= CONFIG_MTU) {
         /* we are now the owner of the packet reference from the router */
         Packet* packet = router_dequeue(interface->router);
@@ -449,9 +487,11 @@ void networkinterface_receivePackets(NetworkInterface* interface) {
         if(!bootstrapping) {
             _networkinterface_consumeTokenBucket(&interface->receiveBucket,
                                                  length);
-            _networkinterface_scheduleNextRefillIfNeeded(interface);
         }
     }
+
+    /* wake up when the next packet the router holds for us conforms */
+    _networkinterface_scheduleNextRefillIfNeeded(interface);
 }
 
 static void _networkinterface_updatePacketHeader(Descriptor* descriptor, Packet* packet) {
@@ -462,6 +502,63 @@ static void _networkinterface_updatePacketHeader(Descriptor* descriptor, Packet*
     }
 }
 
+static void _networkinterface_schedulePacingTask(NetworkInterface* interface) {
+    Socket* earliest = priorityqueue_peek(interface->pacedSockets);
+    if(!earliest) {
+        return;
+    }
+
+    SimulationTime wakeTime = socket_getPacingTime(earliest);
+    if(interface->pacingTask) {
+        if(interface->pacingTaskTime <= wakeTime) {
+            return;
+        }
+        /* a socket must wake before the pending task runs */
+        worker_cancelTask(interface->pacingTask);
+    }
+
+    SimulationTime now = worker_getCurrentTime();
+    SimulationTime delay = wakeTime > now ? wakeTime - now : 1;
+
+    Task* pacingTask = task_new((TaskCallbackFunc)_networkinterface_wakePacedSocketsCB,
+            interface, NULL, NULL, NULL);
+    task_setHandle(pacingTask, &interface->pacingTask);
+    worker_scheduleTask(pacingTask, delay);
+    task_unref(pacingTask);
+    interface->pacingTaskTime = now + delay;
+}
+
+/* returns TRUE if the socket may not send until later, in which case it was moved
+ * with its ref to the paced sockets */
+static gboolean _networkinterface_parkIfPaced(NetworkInterface* interface, Socket* socket) {
+    if(socket_getPacingTime(socket) <= worker_getCurrentTime()) {
+        return FALSE;
+    }
+
+    /* only data is paced, acks and other control packets go out right away */
+    Packet* next = socket_peekNextPacket(socket);
+    if(!next || packet_getPayloadLength(next) == 0) {
+        return FALSE;
+    }
+
+    socket_setPaced(socket, TRUE);
+    priorityqueue_push(interface->pacedSockets, socket);
+    _networkinterface_schedulePacingTask(interface);
+    return TRUE;
+}
+
+static Packet* _networkinterface_pullOutPacket(Socket* socket) {
+    Packet* packet = socket_pullOutPacket(socket);
+
+    if(packet) {
+        _networkinterface_updatePacketHeader((Descriptor*)socket, packet);
+        /* control packets carry no payload and so do not delay the next packet */
+        socket_advancePacingTime(socket, worker_getCurrentTime(), packet_getPayloadLength(packet));
+    }
+
+    return packet;
+}
+
 /* round robin queuing discipline ($ man tc)*/
 static Packet* _networkinterface_selectRoundRobin(NetworkInterface* interface, gint* socketHandle) {
     Packet* packet = NULL;
@@ -469,16 +566,18 @@ static Packet* _networkinterface_selectRoundRobin(NetworkInterface* interface, g
     while(!packet && !g_queue_is_empty(interface->rrQueue)) {
         /* do round robin to get the next packet from the next socket */
         Socket* socket = g_queue_pop_head(interface->rrQueue);
-        packet = socket_pullOutPacket(socket);
-        *socketHandle = *descriptor_getHandleReference((Descriptor*)socket);
-
-        if(socket && packet) {
-            _networkinterface_updatePacketHeader((Descriptor*)socket, packet);
+        if(_networkinterface_parkIfPaced(interface, socket)) {
+            continue;
         }
 
+        packet = _networkinterface_pullOutPacket(socket);
+        *socketHandle = *descriptor_getHandleReference((Descriptor*)socket);
+
         if(socket_peekNextPacket(socket)) {
             /* socket has more packets, and is still reffed from before */
-            g_queue_push_tail(interface->rrQueue, socket);
+            if(!_networkinterface_parkIfPaced(interface, socket)) {
+                g_queue_push_tail(interface->rrQueue, socket);
+            }
         } else {
             /* socket has no more packets, unref it from the sendable queue */
             descriptor_unref((Descriptor*) socket);
@@ -497,16 +596,18 @@ static Packet* _networkinterface_selectFirstInFirstOut(NetworkInterface* interfa
     while(!packet && !priorityqueue_isEmpty(interface->fifoQueue)) {
         /* do fifo to get the next packet from the next socket */
         Socket* socket = priorityqueue_pop(interface->fifoQueue);
-        packet = socket_pullOutPacket(socket);
-        *socketHandle = *descriptor_getHandleReference((Descriptor*)socket);
-
-        if(socket && packet) {
-            _networkinterface_updatePacketHeader((Descriptor*)socket, packet);
+        if(_networkinterface_parkIfPaced(interface, socket)) {
+            continue;
         }
 
+        packet = _networkinterface_pullOutPacket(socket);
+        *socketHandle = *descriptor_getHandleReference((Descriptor*)socket);
+
         if(socket_peekNextPacket(socket)) {
             /* socket has more packets, and is still reffed from before */
-            priorityqueue_push(interface->fifoQueue, socket);
+            if(!_networkinterface_parkIfPaced(interface, socket)) {
+                priorityqueue_push(interface->fifoQueue, socket);
+            }
         } else {
             /* socket has no more packets, unref it from the sendable queue */
             descriptor_unref((Descriptor*) socket);
@@ -516,11 +617,40 @@ static Packet* _networkinterface_selectFirstInFirstOut(NetworkInterface* interfa
     return packet;
 }
 
+static void _networkinterface_flushSendTrain(NetworkInterface* interface) {
+    if(interface->sendTrain && interface->sendTrain->len > 0) {
+        router_forwardPackets(interface->router, (Packet**)interface->sendTrain->pdata,
+                interface->sendTrain->len);
+        /* this unrefs the packets */
+        g_ptr_array_remove_range(interface->sendTrain, 0, interface->sendTrain->len);
+    }
+}
+
+static void _networkinterface_forwardPacket(NetworkInterface* interface, Packet* packet) {
+    if(!interface->sendTrain) {
+        router_forward(interface->router, packet);
+        return;
+    }
+
+    /* a train only holds packets to one address, all sent at the current time */
+    if(interface->sendTrain->len > 0) {
+        Packet* head = g_ptr_array_index(interface->sendTrain, 0);
+        if(packet_getDestinationIP(head) != packet_getDestinationIP(packet)) {
+            _networkinterface_flushSendTrain(interface);
+        }
+    }
+
+    packet_ref(packet);
+    g_ptr_array_add(interface->sendTrain, packet);
+}
+
 static void _networkinterface_sendPackets(NetworkInterface* interface) {
     MAGIC_ASSERT(interface);
 
     gboolean bootstrapping = worker_isBootstrapActive();
 
+    _networkinterface_refillTokenBucket(&interface->sendBucket, worker_getCurrentTime());
+
     /* loop until we find a socket that has something to send */
     while(interface->sendBucket.bytesRemaining >= CONFIG_MTU) {
         gint socketHandle = -1;
@@ -557,7 +687,7 @@ static void _networkinterface_sendPackets(NetworkInterface* interface) {
             /* let the upstream router send to remote with appropriate delays.
              * if we get here we are not loopback and should have been assigned a router. */
             utility_assert(interface->router);
-            router_forward(interface->router, packet);
+            _networkinterface_forwardPacket(interface, packet);
         }
 
         /* successfully sent, calculate how long it took to 'send' this packet */
@@ -565,7 +695,6 @@ static void _networkinterface_sendPackets(NetworkInterface* interface) {
             guint length = packet_getPayloadLength(packet) + packet_getHeaderSize(packet);
             _networkinterface_consumeTokenBucket(&interface->sendBucket,
                                                  length);
-            _networkinterface_scheduleNextRefillIfNeeded(interface);
         }
 
         tracker_addOutputBytes(host_getTracker(worker_getActiveHost()), packet, socketHandle);
@@ -576,11 +705,57 @@ static void _networkinterface_sendPackets(NetworkInterface* interface) {
         /* sending side is done with its ref */
         packet_unref(packet);
     }
+
+    /* time moves on before we send again, so the train leaves now. if we sent from
+     * within a send, this includes the packets of the outer send so far, in order. */
+    _networkinterface_flushSendTrain(interface);
+
+    /* wake up when the next packet of the sockets still waiting conforms */
+    _networkinterface_scheduleNextRefillIfNeeded(interface);
+}
+
+static void _networkinterface_pushSendable(NetworkInterface* interface, Socket* socket) {
+    /* the caller passes its socket ref on to the queue */
+    switch(interface->qdisc) {
+        case QDISC_MODE_RR: {
+            g_queue_push_tail(interface->rrQueue, socket);
+            break;
+        }
+        case QDISC_MODE_FIFO:
+        default: {
+            priorityqueue_push(interface->fifoQueue, socket);
+            break;
+        }
+    }
+}
+
+static void _networkinterface_wakePacedSocketsCB(NetworkInterface* interface,
+                                                 gpointer userData) {
+    MAGIC_ASSERT(interface);
+
+    SimulationTime now = worker_getCurrentTime();
+
+    /* the sockets whose pacing time passed may send again */
+    Socket* socket = priorityqueue_peek(interface->pacedSockets);
+    while(socket && socket_getPacingTime(socket) <= now) {
+        priorityqueue_pop(interface->pacedSockets);
+        socket_setPaced(socket, FALSE);
+        _networkinterface_pushSendable(interface, socket);
+        socket = priorityqueue_peek(interface->pacedSockets);
+    }
+
+    _networkinterface_sendPackets(interface);
+    _networkinterface_schedulePacingTask(interface);
 }
 
 void networkinterface_wantsSend(NetworkInterface* interface, Socket* socket) {
     MAGIC_ASSERT(interface);
 
+    /* a paced socket is woken by the pacing task, and sends nothing before that */
+    if(socket_isPaced(socket)) {
+        return;
+    }
+
     /* track the new socket for sending if not already tracking */
     switch(interface->qdisc) {
         case QDISC_MODE_RR: {
@@ -621,7 +796,8 @@ Router* networkinterface_getRouter(NetworkInterface* interface) {
 }
 
 NetworkInterface* networkinterface_new(Address* address, guint64 bwDownKiBps, guint64 bwUpKiBps,
-        gboolean logPcap, gchar* pcapDir, QDiscMode qdisc, guint64 interfaceReceiveLength) {
+        gboolean logPcap, gchar* pcapDir, QDiscMode qdisc, guint64 interfaceReceiveLength,
+        gboolean segmentationOffload) {
     NetworkInterface* interface = g_new0(NetworkInterface, 1);
     MAGIC_INIT(interface);
 
@@ -629,11 +805,16 @@ NetworkInterface* networkinterface_new(Address* address, guint64 bwDownKiBps, gu
     address_ref(interface->address);
 
     /* incoming packets get passed along to sockets */
-    interface->boundSockets = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, descriptor_unref);
+    interface->boundSockets = socketdemux_new(descriptor_unref);
 
     /* sockets tell us when they want to start sending */
     interface->rrQueue = g_queue_new();
     interface->fifoQueue = priorityqueue_new((GCompareDataFunc)_networkinterface_compareSocket, NULL, descriptor_unref);
+    interface->pacedSockets = priorityqueue_new((GCompareDataFunc)_networkinterface_comparePacingTime, NULL, NULL);
+
+    if(segmentationOffload) {
+        interface->sendTrain = g_ptr_array_new_with_free_func((GDestroyNotify)packet_unref);
+    }
 
     /* parse queuing discipline */
     interface->qdisc = (qdisc == QDISC_MODE_NONE) ? QDISC_MODE_FIFO : qdisc;
@@ -661,6 +842,14 @@ NetworkInterface* networkinterface_new(Address* address, guint64 bwDownKiBps, gu
 void networkinterface_free(NetworkInterface* interface) {
     MAGIC_ASSERT(interface);
 
+    /* the pending refill would run on a freed interface */
+    if(interface->refillTask) {
+        worker_cancelTask(interface->refillTask);
+    }
+    if(interface->pacingTask) {
+        worker_cancelTask(interface->pacingTask);
+    }
+
     /* unref all sockets wanting to send */
     while(interface->rrQueue && !g_queue_is_empty(interface->rrQueue)) {
         Socket* socket = g_queue_pop_head(interface->rrQueue);
@@ -668,9 +857,20 @@ void networkinterface_free(NetworkInterface* interface) {
     }
     g_queue_free(interface->rrQueue);
 
+    while(interface->pacedSockets && !priorityqueue_isEmpty(interface->pacedSockets)) {
+        Socket* socket = priorityqueue_pop(interface->pacedSockets);
+        socket_setPaced(socket, FALSE);
+        descriptor_unref(socket);
+    }
+    priorityqueue_free(interface->pacedSockets);
+
     priorityqueue_free(interface->fifoQueue);
 
-    g_hash_table_destroy(interface->boundSockets);
+    if(interface->sendTrain) {
+        g_ptr_array_free(interface->sendTrain, TRUE);
+    }
+
+    socketdemux_free(interface->boundSockets);
 
     if(interface->router) {
         router_unref(interface->router);
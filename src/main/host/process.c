@@ -346,6 +346,23 @@ static void _process_setErrno(Process* proc, int errnoValue) {
     errno = errnoValue;
 }
 
+static int _process_getErrno(Process* proc) {
+    MAGIC_ASSERT(proc);
+
+    if(proc->plugin.errnoGetLocationIsStale) {
+        _process_updateErrnoLocation(proc);
+    }
+
+    if(proc->plugin.errnoGetLocation) {
+        int* errnoLocation = proc->plugin.errnoGetLocation();
+        if(errnoLocation) {
+            return *errnoLocation;
+        }
+    }
+
+    return errno;
+}
+
 static void _process_unloadPlugin(Process* proc) {
     MAGIC_ASSERT(proc);
 
@@ -1464,8 +1481,8 @@ static gint _process_emu_addressHelper(Process* proc, gint fd, const struct sock
     return 0;
 }
 
-static gssize _process_emu_sendHelper(Process* proc, gint fd, gconstpointer buf, gsize n, gint flags,
-        const struct sockaddr* addr, socklen_t len) {
+static gssize _process_emu_sendVectorHelper(Process* proc, gint fd, const struct iovec* iov,
+        gint iovcnt, gint flags, const struct sockaddr* addr, socklen_t len) {
     /* this function MUST be called after switching in shadow context */
     utility_assert(proc->activeContext == PCTX_SHADOW);
 
@@ -1487,7 +1504,7 @@ static gssize _process_emu_sendHelper(Process* proc, gint fd, gconstpointer buf,
     }
 
     gsize bytes = 0;
-    gint result = host_sendUserData(proc->host, fd, buf, n, ip, port, &bytes);
+    gint result = host_sendUserData(proc->host, fd, iov, iovcnt, ip, port, &bytes);
 
     if(result != 0) {
         _process_setErrno(proc, result);
@@ -1496,8 +1513,14 @@ static gssize _process_emu_sendHelper(Process* proc, gint fd, gconstpointer buf,
     return (gssize) bytes;
 }
 
-static gssize _process_emu_recvHelper(Process* proc, gint fd, gpointer buf, size_t n, gint flags,
-        struct sockaddr* addr, socklen_t* len) {
+static gssize _process_emu_sendHelper(Process* proc, gint fd, gconstpointer buf, gsize n, gint flags,
+        const struct sockaddr* addr, socklen_t len) {
+    struct iovec iov = {.iov_base = (gpointer)buf, .iov_len = n};
+    return _process_emu_sendVectorHelper(proc, fd, &iov, 1, flags, addr, len);
+}
+
+static gssize _process_emu_recvVectorHelper(Process* proc, gint fd, const struct iovec* iov,
+        gint iovcnt, gint flags, struct sockaddr* addr, socklen_t* len) {
     /* this function MUST be called after switching in shadow context */
     utility_assert(proc->activeContext == PCTX_SHADOW);
 
@@ -1512,7 +1535,7 @@ static gssize _process_emu_recvHelper(Process* proc, gint fd, gpointer buf, size
     in_port_t port = 0;
 
     gsize bytes = 0;
-    gint result = host_receiveUserData(proc->host, fd, buf, n, &ip, &port, &bytes);
+    gint result = host_receiveUserData(proc->host, fd, iov, iovcnt, &ip, &port, &bytes);
 
     if(result != 0) {
         _process_setErrno(proc, result);
@@ -1531,6 +1554,12 @@ static gssize _process_emu_recvHelper(Process* proc, gint fd, gpointer buf, size
     return (gssize) bytes;
 }
 
+static gssize _process_emu_recvHelper(Process* proc, gint fd, gpointer buf, size_t n, gint flags,
+        struct sockaddr* addr, socklen_t* len) {
+    struct iovec iov = {.iov_base = buf, .iov_len = n};
+    return _process_emu_recvVectorHelper(proc, fd, &iov, 1, flags, addr, len);
+}
+
 static gint _process_emu_fcntlHelper(Process* proc, int fd, int cmd, void* argp) {
     /* check if this is a socket */
     ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
@@ -2277,12 +2306,96 @@ ssize_t process_emu_sendto(Process* proc, int fd, const void *buf, size_t n, int
 }
 
 ssize_t process_emu_sendmsg(Process* proc, int fd, const struct msghdr *message, int flags) {
-    /* TODO implement */
     ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
-    warning("sendmsg not implemented");
-    _process_setErrno(proc, ENOSYS);
+    gssize ret = 0;
+
+    if(message == NULL) {
+        _process_setErrno(proc, EFAULT);
+        ret = -1;
+    } else if(message->msg_iovlen > IOV_MAX) {
+        _process_setErrno(proc, EMSGSIZE);
+        ret = -1;
+    } else if(!host_isShadowDescriptor(proc->host, fd)) {
+        gint osfd = host_getOSHandle(proc->host, fd);
+        if(osfd >= 0) {
+            ret = sendmsg(osfd, message, flags);
+            if(ret < 0) {
+                _process_setErrno(proc, errno);
+            }
+        } else {
+            _process_setErrno(proc, EBADF);
+            ret = -1;
+        }
+    } else if(prevCTX == PCTX_PLUGIN) {
+        _process_changeContext(proc, PCTX_SHADOW, PCTX_PTH);
+        utility_assert(proc->tstate == pth_gctx_get());
+        ret = pth_sendmsg(fd, message, flags);
+        _process_changeContext(proc, PCTX_PTH, PCTX_SHADOW);
+        if(ret == -1) {
+            _process_setErrno(proc, errno);
+        }
+    } else {
+        /* ancillary data is ignored, the buffers go to the transport as they are */
+        ret = _process_emu_sendVectorHelper(proc, fd, message->msg_iov, (gint)message->msg_iovlen,
+                flags, message->msg_name, message->msg_namelen);
+    }
+
     _process_changeContext(proc, PCTX_SHADOW, prevCTX);
-    return -1;
+    return ret;
+}
+
+int process_emu_sendmmsg(Process* proc, int fd, struct mmsghdr* msgvec, unsigned int vlen, int flags) {
+    ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
+
+    if(!host_isShadowDescriptor(proc->host, fd)) {
+        gint ret = -1;
+        gint osfd = host_getOSHandle(proc->host, fd);
+        if(osfd >= 0) {
+            ret = sendmmsg(osfd, msgvec, vlen, flags);
+            if(ret < 0) {
+                _process_setErrno(proc, errno);
+            }
+        } else {
+            _process_setErrno(proc, EBADF);
+        }
+        _process_changeContext(proc, PCTX_SHADOW, prevCTX);
+        return ret;
+    }
+
+    _process_changeContext(proc, PCTX_SHADOW, prevCTX);
+
+    if(vlen == 0) {
+        return 0;
+    }
+
+    /* the first message may block like sendmsg does */
+    gssize n = process_emu_sendmsg(proc, fd, &msgvec[0].msg_hdr, flags);
+    if(n < 0) {
+        return -1;
+    }
+    msgvec[0].msg_len = (unsigned int)n;
+
+    /* the rest are only sent while the socket has room for them. the caller gets the
+     * messages that were sent, so the error that ended the batch must not show */
+    prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
+    gint savedErrno = _process_getErrno(proc);
+    unsigned int i = 1;
+    for(; i < vlen; i++) {
+        struct msghdr* message = &msgvec[i].msg_hdr;
+        if(message->msg_iovlen > IOV_MAX) {
+            break;
+        }
+        n = _process_emu_sendVectorHelper(proc, fd, message->msg_iov, (gint)message->msg_iovlen,
+                flags, message->msg_name, message->msg_namelen);
+        if(n < 0) {
+            break;
+        }
+        msgvec[i].msg_len = (unsigned int)n;
+    }
+    _process_setErrno(proc, savedErrno);
+    _process_changeContext(proc, PCTX_SHADOW, prevCTX);
+
+    return (int)i;
 }
 
 ssize_t process_emu_recv(Process* proc, int fd, void *buf, size_t n, int flags) {
@@ -2321,13 +2434,147 @@ ssize_t process_emu_recvfrom(Process* proc, int fd, void *buf, size_t n, int fla
     return ret;
 }
 
+/* receives into the buffers of the message, which must be called in shadow context */
+static gssize _process_emu_recvMessageHelper(Process* proc, gint fd, struct msghdr* message, gint flags) {
+    socklen_t namelen = message->msg_name != NULL ? message->msg_namelen : 0;
+    gssize ret = _process_emu_recvVectorHelper(proc, fd, message->msg_iov, (gint)message->msg_iovlen,
+            flags, message->msg_name, message->msg_name != NULL ? &namelen : NULL);
+    if(ret >= 0) {
+        message->msg_namelen = namelen;
+        /* we never have ancillary data to deliver */
+        message->msg_controllen = 0;
+        message->msg_flags = 0;
+    }
+    return ret;
+}
+
 ssize_t process_emu_recvmsg(Process* proc, int fd, struct msghdr *message, int flags) {
-    /* TODO implement */
     ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
-    warning("recvmsg not implemented");
-    _process_setErrno(proc, ENOSYS);
+    gssize ret = 0;
+
+    if(message == NULL) {
+        _process_setErrno(proc, EFAULT);
+        ret = -1;
+    } else if(message->msg_iovlen > IOV_MAX) {
+        _process_setErrno(proc, EMSGSIZE);
+        ret = -1;
+    } else if(!host_isShadowDescriptor(proc->host, fd)) {
+        gint osfd = host_getOSHandle(proc->host, fd);
+        if(osfd >= 0) {
+            ret = recvmsg(osfd, message, flags);
+            if(ret < 0) {
+                _process_setErrno(proc, errno);
+            }
+        } else {
+            _process_setErrno(proc, EBADF);
+            ret = -1;
+        }
+    } else if(prevCTX == PCTX_PLUGIN) {
+        _process_changeContext(proc, PCTX_SHADOW, PCTX_PTH);
+        utility_assert(proc->tstate == pth_gctx_get());
+        ret = pth_recvmsg(fd, message, flags);
+        _process_changeContext(proc, PCTX_PTH, PCTX_SHADOW);
+        if(ret == -1) {
+            _process_setErrno(proc, errno);
+        }
+    } else {
+        ret = _process_emu_recvMessageHelper(proc, fd, message, flags);
+    }
+
     _process_changeContext(proc, PCTX_SHADOW, prevCTX);
-    return -1;
+    return ret;
+}
+
+int process_emu_recvmmsg(Process* proc, int fd, struct mmsghdr* msgvec, unsigned int vlen, int flags,
+        struct timespec* timeout) {
+    ProcessContext prevCTX = _process_changeContext(proc, proc->activeContext, PCTX_SHADOW);
+
+    if(!host_isShadowDescriptor(proc->host, fd)) {
+        gint ret = -1;
+        gint osfd = host_getOSHandle(proc->host, fd);
+        if(osfd >= 0) {
+            ret = recvmmsg(osfd, msgvec, vlen, flags, timeout);
+            if(ret < 0) {
+                _process_setErrno(proc, errno);
+            }
+        } else {
+            _process_setErrno(proc, EBADF);
+        }
+        _process_changeContext(proc, PCTX_SHADOW, prevCTX);
+        return ret;
+    }
+
+    if(vlen == 0) {
+        _process_changeContext(proc, PCTX_SHADOW, prevCTX);
+        return 0;
+    }
+
+    if(timeout != NULL && (timeout->tv_sec < 0 || timeout->tv_nsec < 0 ||
+            timeout->tv_nsec >= 1000000000L)) {
+        _process_setErrno(proc, EINVAL);
+        _process_changeContext(proc, PCTX_SHADOW, prevCTX);
+        return -1;
+    }
+
+    /* the timeout bounds the whole call, so one timer event serves every wait */
+    pth_event_t timeoutEvent = NULL;
+    if(timeout != NULL && prevCTX == PCTX_PLUGIN) {
+        _process_changeContext(proc, PCTX_SHADOW, PCTX_PTH);
+        timeoutEvent = pth_event(PTH_EVENT_TIME, pth_timeout(timeout->tv_sec, timeout->tv_nsec / 1000));
+        _process_changeContext(proc, PCTX_PTH, PCTX_SHADOW);
+    }
+
+    gint savedErrno = _process_getErrno(proc);
+    gint messageFlags = flags & ~MSG_WAITFORONE;
+    unsigned int i = 0;
+    for(; i < vlen; i++) {
+        struct msghdr* message = &msgvec[i].msg_hdr;
+        gssize n = 0;
+
+        /* we wait for every message, or only for the first one with MSG_WAITFORONE */
+        gboolean mayBlock = prevCTX == PCTX_PLUGIN && !(flags & MSG_DONTWAIT) &&
+                (i == 0 || !(flags & MSG_WAITFORONE));
+
+        if(message->msg_iovlen > IOV_MAX) {
+            _process_setErrno(proc, EMSGSIZE);
+            n = -1;
+        } else if(mayBlock) {
+            _process_changeContext(proc, PCTX_SHADOW, PCTX_PTH);
+            utility_assert(proc->tstate == pth_gctx_get());
+            n = pth_recvmsg_ev(fd, message, messageFlags, timeoutEvent);
+            gint recvErrno = errno;
+            /* pth reports the timer event that ended the wait as EINTR */
+            if(n == -1 && recvErrno == EINTR && timeoutEvent != NULL &&
+                    pth_event_status(timeoutEvent) == PTH_STATUS_OCCURRED) {
+                recvErrno = EAGAIN;
+            }
+            _process_changeContext(proc, PCTX_PTH, PCTX_SHADOW);
+            if(n == -1) {
+                _process_setErrno(proc, recvErrno);
+            }
+        } else {
+            n = _process_emu_recvMessageHelper(proc, fd, message, messageFlags);
+        }
+
+        if(n < 0) {
+            break;
+        }
+        msgvec[i].msg_len = (unsigned int)n;
+    }
+
+    if(timeoutEvent != NULL) {
+        _process_changeContext(proc, PCTX_SHADOW, PCTX_PTH);
+        pth_event_free(timeoutEvent, PTH_FREE_THIS);
+        _process_changeContext(proc, PCTX_PTH, PCTX_SHADOW);
+    }
+
+    /* like linux, an error after the first message only ends the batch */
+    if(i > 0) {
+        _process_setErrno(proc, savedErrno);
+    }
+
+    _process_changeContext(proc, PCTX_SHADOW, prevCTX);
+    return i > 0 ? (int)i : -1;
 }
 
 int process_emu_getsockopt(Process* proc, int fd, int level, int optname, void* optval, socklen_t* optlen) {
@@ -2766,37 +3013,26 @@ ssize_t process_emu_readv(Process* proc, int fd, const struct iovec *iov, int io
         if (iovcnt < 0 || iovcnt > IOV_MAX) {
             _process_setErrno(proc, EINVAL);
             ret = -1;
+        } else if(utility_iovecLength(iov, iovcnt) == 0) {
+            ret = 0;
+        } else if(descriptor_getType(host_lookupDescriptor(proc->host, fd)) != DT_TIMER) {
+            /* the transport scatters straight into the iov buffers */
+            ret = _process_emu_recvVectorHelper(proc, fd, iov, iovcnt, 0, NULL, 0);
         } else {
-            /* figure out how much they want to read total */
-            int i = 0;
-            size_t totalIOLength = 0;
-            for (i = 0; i < iovcnt; i++) {
-                totalIOLength += iov[i].iov_len;
-            }
-
-            if (totalIOLength == 0) {
-                ret = 0;
-            } else {
-                /* get a temporary buffer and read to it */
-                void* tempBuffer = g_malloc0(totalIOLength);
-                _process_changeContext(proc, PCTX_SHADOW, prevCTX);
-                ssize_t totalBytesRead = process_emu_read(proc, fd, tempBuffer, totalIOLength);
-                _process_changeContext(proc, prevCTX, PCTX_SHADOW);
-
-                if (totalBytesRead > 0) {
-                    /* place all of the bytes we read in the iov buffers */
-                    size_t bytesCopied = 0;
-                    for (i = 0; i < iovcnt; i++) {
-                        size_t bytesRemaining = (size_t) (totalBytesRead - bytesCopied);
-                        size_t bytesToCopy = MIN(bytesRemaining, iov[i].iov_len);
-                        g_memmove(iov[i].iov_base, tempBuffer+bytesCopied, bytesToCopy);
-                        bytesCopied += bytesToCopy;
-                    }
-                }
+            /* timers are read whole, so read into a temporary buffer of the total size */
+            size_t totalIOLength = utility_iovecLength(iov, iovcnt);
+            void* tempBuffer = g_malloc0(totalIOLength);
+            _process_changeContext(proc, PCTX_SHADOW, prevCTX);
+            ssize_t totalBytesRead = process_emu_read(proc, fd, tempBuffer, totalIOLength);
+            _process_changeContext(proc, prevCTX, PCTX_SHADOW);
 
-                g_free(tempBuffer);
-                ret = totalBytesRead;
+            if (totalBytesRead > 0) {
+                /* place all of the bytes we read in the iov buffers */
+                utility_iovecScatter(iov, iovcnt, 0, tempBuffer, (gsize)totalBytesRead);
             }
+
+            g_free(tempBuffer);
+            ret = totalBytesRead;
         }
     }
 
@@ -2831,36 +3067,11 @@ ssize_t process_emu_writev(Process* proc, int fd, const struct iovec *iov, int i
         if(iovcnt < 0 || iovcnt > IOV_MAX) {
             _process_setErrno(proc, EINVAL);
             ret = -1;
+        } else if(utility_iovecLength(iov, iovcnt) == 0) {
+            ret = 0;
         } else {
-            /* figure out how much they want to write total */
-            int i = 0;
-            size_t totalIOLength = 0;
-            for(i = 0; i < iovcnt; i++) {
-                totalIOLength += iov[i].iov_len;
-            }
-
-            if(totalIOLength == 0) {
-                ret = 0;
-            } else {
-                /* get a temporary buffer and write to it */
-                void* tempBuffer = g_malloc0(totalIOLength);
-                size_t bytesCopied = 0;
-                for(i = 0; i < iovcnt; i++) {
-                    g_memmove(tempBuffer+bytesCopied, iov[i].iov_base, iov[i].iov_len);
-                    bytesCopied += iov[i].iov_len;
-                }
-
-                ssize_t totalBytesWritten = 0;
-                if(bytesCopied > 0) {
-                    /* try to write all of the bytes we got from the iov buffers */
-                    _process_changeContext(proc, PCTX_SHADOW, prevCTX);
-                    totalBytesWritten = process_emu_write(proc, fd, tempBuffer, bytesCopied);
-                    _process_changeContext(proc, prevCTX, PCTX_SHADOW);
-                }
-
-                g_free(tempBuffer);
-                ret = totalBytesWritten;
-            }
+            /* the transport gathers straight from the iov buffers */
+            ret = _process_emu_sendVectorHelper(proc, fd, iov, iovcnt, 0, NULL, 0);
         }
     }
 
@@ -5183,6 +5394,9 @@ int process_emu_syscall(Process* proc, int number, va_list ap) {
 #if defined SYS_recvmsg
         case SYS_recvmsg:
 #endif
+#if defined SYS_recvmmsg
+        case SYS_recvmmsg:
+#endif
 #if defined SYS_select
         case SYS_select:
 #endif
@@ -5192,6 +5406,9 @@ int process_emu_syscall(Process* proc, int number, va_list ap) {
 #if defined SYS_sendmsg
         case SYS_sendmsg:
 #endif
+#if defined SYS_sendmmsg
+        case SYS_sendmmsg:
+#endif
 #if defined SYS_sendto
         case SYS_sendto:
 #endif
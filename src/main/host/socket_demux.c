@@ -0,0 +1,222 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include "main/host/socket_demux.h"
+
+#include <glib.h>
+#include <netinet/in.h>
+
+#include "main/utility/utility.h"
+
+/* must be a power of 2 */
+#define SOCKET_DEMUX_MIN_CAPACITY 16
+
+typedef struct _SocketDemuxEntry SocketDemuxEntry;
+struct _SocketDemuxEntry {
+    /* the peer ip in the high 32 bits, then the local port and the peer port */
+    guint64 tuple;
+    ProtocolType protocol;
+    /* NULL if the slot is empty */
+    gpointer value;
+};
+
+struct _SocketDemux {
+    /* a power of 2 number of slots, at most 3/4 of which are used */
+    SocketDemuxEntry* entries;
+    guint capacity;
+    guint length;
+
+    /* if there are no wildcard entries, lookups skip probing for them */
+    guint numWildcards;
+
+    GDestroyNotify valueDestroyFunc;
+
+    MAGIC_DECLARE;
+};
+
+static inline guint64 _socketdemux_toTuple(in_port_t localPort, in_addr_t peerIP, in_port_t peerPort) {
+    return (((guint64)peerIP) << 32) | (((guint64)localPort) << 16) | ((guint64)peerPort);
+}
+
+static inline gboolean _socketdemux_isWildcard(guint64 tuple) {
+    /* only the local port is set */
+    return (tuple & G_GUINT64_CONSTANT(0xFFFFFFFF0000FFFF)) == 0;
+}
+
+/* the ports and addresses of a host's sockets differ in only a few bits, so mix
+ * them well before masking off the low bits for the slot index */
+static inline guint _socketdemux_getHomeSlot(SocketDemux* demux, ProtocolType protocol, guint64 tuple) {
+    guint64 hash = tuple ^ (((guint64)protocol) * G_GUINT64_CONSTANT(0x9E3779B97F4A7C15));
+    hash ^= hash >> 33;
+    hash *= G_GUINT64_CONSTANT(0xFF51AFD7ED558CCD);
+    hash ^= hash >> 33;
+    hash *= G_GUINT64_CONSTANT(0xC4CEB9FE1A85EC53);
+    hash ^= hash >> 33;
+    return (guint)(hash & (demux->capacity - 1));
+}
+
+/* returns the slot holding the tuple, or the empty slot where it would be inserted */
+static guint _socketdemux_findSlot(SocketDemux* demux, ProtocolType protocol, guint64 tuple) {
+    guint mask = demux->capacity - 1;
+    guint slot = _socketdemux_getHomeSlot(demux, protocol, tuple);
+
+    while(demux->entries[slot].value != NULL) {
+        SocketDemuxEntry* entry = &demux->entries[slot];
+        if(entry->tuple == tuple && entry->protocol == protocol) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+static void _socketdemux_resize(SocketDemux* demux, guint capacity) {
+    SocketDemuxEntry* oldEntries = demux->entries;
+    guint oldCapacity = demux->capacity;
+
+    demux->entries = g_new0(SocketDemuxEntry, capacity);
+    demux->capacity = capacity;
+
+    for(guint i = 0; i < oldCapacity; i++) {
+        SocketDemuxEntry* entry = &oldEntries[i];
+        if(entry->value != NULL) {
+            guint slot = _socketdemux_findSlot(demux, entry->protocol, entry->tuple);
+            demux->entries[slot] = *entry;
+        }
+    }
+
+    g_free(oldEntries);
+}
+
+SocketDemux* socketdemux_new(GDestroyNotify valueDestroyFunc) {
+    SocketDemux* demux = g_new0(SocketDemux, 1);
+    MAGIC_INIT(demux);
+
+    demux->capacity = SOCKET_DEMUX_MIN_CAPACITY;
+    demux->entries = g_new0(SocketDemuxEntry, demux->capacity);
+    demux->valueDestroyFunc = valueDestroyFunc;
+
+    return demux;
+}
+
+void socketdemux_free(SocketDemux* demux) {
+    MAGIC_ASSERT(demux);
+
+    if(demux->valueDestroyFunc) {
+        for(guint i = 0; i < demux->capacity; i++) {
+            if(demux->entries[i].value != NULL) {
+                demux->valueDestroyFunc(demux->entries[i].value);
+            }
+        }
+    }
+
+    g_free(demux->entries);
+
+    MAGIC_CLEAR(demux);
+    g_free(demux);
+}
+
+guint socketdemux_getLength(SocketDemux* demux) {
+    MAGIC_ASSERT(demux);
+    return demux->length;
+}
+
+gboolean socketdemux_insert(SocketDemux* demux, ProtocolType protocol, in_port_t localPort,
+        in_addr_t peerIP, in_port_t peerPort, gpointer value) {
+    MAGIC_ASSERT(demux);
+    utility_assert(value != NULL);
+
+    guint64 tuple = _socketdemux_toTuple(localPort, peerIP, peerPort);
+    guint slot = _socketdemux_findSlot(demux, protocol, tuple);
+    if(demux->entries[slot].value != NULL) {
+        return FALSE;
+    }
+
+    demux->entries[slot].tuple = tuple;
+    demux->entries[slot].protocol = protocol;
+    demux->entries[slot].value = value;
+    demux->length++;
+    if(_socketdemux_isWildcard(tuple)) {
+        demux->numWildcards++;
+    }
+
+    if(demux->length * 4 > demux->capacity * 3) {
+        _socketdemux_resize(demux, demux->capacity * 2);
+    }
+
+    return TRUE;
+}
+
+gboolean socketdemux_remove(SocketDemux* demux, ProtocolType protocol, in_port_t localPort,
+        in_addr_t peerIP, in_port_t peerPort) {
+    MAGIC_ASSERT(demux);
+
+    guint64 tuple = _socketdemux_toTuple(localPort, peerIP, peerPort);
+    guint slot = _socketdemux_findSlot(demux, protocol, tuple);
+    gpointer value = demux->entries[slot].value;
+    if(value == NULL) {
+        return FALSE;
+    }
+
+    demux->entries[slot].value = NULL;
+    demux->length--;
+    if(_socketdemux_isWildcard(tuple)) {
+        demux->numWildcards--;
+    }
+
+    /* shift later entries of the probe run back into the hole, unless that would
+     * move them before their home slot, so lookups never need tombstones */
+    guint mask = demux->capacity - 1;
+    guint hole = slot;
+    guint next = slot;
+    while(TRUE) {
+        next = (next + 1) & mask;
+        SocketDemuxEntry* entry = &demux->entries[next];
+        if(entry->value == NULL) {
+            break;
+        }
+
+        guint home = _socketdemux_getHomeSlot(demux, entry->protocol, entry->tuple);
+        if(((next - home) & mask) >= ((next - hole) & mask)) {
+            demux->entries[hole] = *entry;
+            entry->value = NULL;
+            hole = next;
+        }
+    }
+
+    if(demux->capacity > SOCKET_DEMUX_MIN_CAPACITY && demux->length * 8 < demux->capacity) {
+        _socketdemux_resize(demux, demux->capacity / 2);
+    }
+
+    if(demux->valueDestroyFunc) {
+        demux->valueDestroyFunc(value);
+    }
+
+    return TRUE;
+}
+
+gpointer socketdemux_get(SocketDemux* demux, ProtocolType protocol, in_port_t localPort,
+        in_addr_t peerIP, in_port_t peerPort) {
+    MAGIC_ASSERT(demux);
+    guint64 tuple = _socketdemux_toTuple(localPort, peerIP, peerPort);
+    return demux->entries[_socketdemux_findSlot(demux, protocol, tuple)].value;
+}
+
+gpointer socketdemux_lookup(SocketDemux* demux, ProtocolType protocol, in_port_t localPort,
+        in_addr_t peerIP, in_port_t peerPort) {
+    MAGIC_ASSERT(demux);
+
+    /* listening servers take all packets for their port, and pass them on to their
+     * child sockets themselves */
+    if(demux->numWildcards > 0) {
+        gpointer value = socketdemux_get(demux, protocol, localPort, 0, 0);
+        if(value != NULL) {
+            return value;
+        }
+    }
+
+    return socketdemux_get(demux, protocol, localPort, peerIP, peerPort);
+}
@@ -0,0 +1,45 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#ifndef SHD_SOCKET_DEMUX_H_
+#define SHD_SOCKET_DEMUX_H_
+
+#include <glib.h>
+#include <netinet/in.h>
+
+#include "main/host/protocol.h"
+
+/* Maps (protocol, local port, peer ip, peer port) tuples to sockets for one network
+ * interface, whose own address is implied. Sockets that accept packets from any peer,
+ * like listening servers, are stored with a peer ip and port of 0.
+ *
+ * The tuples are stored inline in an open-addressing table with linear probing, so
+ * lookups on the packet receive path neither allocate nor follow pointers. Values
+ * must not be NULL, since NULL marks an empty slot. */
+typedef struct _SocketDemux SocketDemux;
+
+SocketDemux* socketdemux_new(GDestroyNotify valueDestroyFunc);
+/* calls the destroy function on all values that are still stored */
+void socketdemux_free(SocketDemux* demux);
+
+guint socketdemux_getLength(SocketDemux* demux);
+
+/* returns FALSE, and does not take the value, if the tuple is already stored */
+gboolean socketdemux_insert(SocketDemux* demux, ProtocolType protocol, in_port_t localPort,
+        in_addr_t peerIP, in_port_t peerPort, gpointer value);
+/* removes the tuple and calls the destroy function on its value. returns FALSE if
+ * the tuple was not stored. */
+gboolean socketdemux_remove(SocketDemux* demux, ProtocolType protocol, in_port_t localPort,
+        in_addr_t peerIP, in_port_t peerPort);
+
+/* returns the value stored for exactly this tuple, or NULL */
+gpointer socketdemux_get(SocketDemux* demux, ProtocolType protocol, in_port_t localPort,
+        in_addr_t peerIP, in_port_t peerPort);
+/* returns the value that should receive a packet from the given peer: the wildcard
+ * entry for the port if there is one, otherwise the entry for the exact tuple, or NULL */
+gpointer socketdemux_lookup(SocketDemux* demux, ProtocolType protocol, in_port_t localPort,
+        in_addr_t peerIP, in_port_t peerPort);
+
+#endif /* SHD_SOCKET_DEMUX_H_ */
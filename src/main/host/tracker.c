@@ -95,6 +95,8 @@ struct _SocketStats {
     gsize inputBufferLength;
     gsize outputBufferSize;
     gsize outputBufferLength;
+    /* memory used by the socket's packet queues, not counting the packets */
+    gsize queueAllocatedBytes;
 
     IFaceCounters local;
     IFaceCounters remote;
@@ -369,6 +371,17 @@ void tracker_updateSocketOutputBuffer(Tracker* tracker, gint handle, gsize outpu
     }
 }
 
+void tracker_updateSocketQueueMemory(Tracker* tracker, gint handle, gsize queueAllocatedBytes) {
+    MAGIC_ASSERT(tracker);
+
+    if(tracker->loginfo & LOG_INFO_FLAGS_SOCKET) {
+        SocketStats* ss = g_hash_table_lookup(tracker->socketStats, &handle);
+        if(ss) {
+            ss->queueAllocatedBytes = queueAllocatedBytes;
+        }
+    }
+}
+
 void tracker_removeSocket(Tracker* tracker, gint handle) {
     MAGIC_ASSERT(tracker);
 
@@ -469,7 +482,7 @@ static void _tracker_logSocket(Tracker* tracker, LogLevel level, SimulationTime
         tracker->didLogSocketHeader = TRUE;
         logger_log(logger_getDefault(), level, __FILE__, __FUNCTION__, __LINE__,
                 "[shadow-heartbeat] [socket-header] descriptor-number,protocol-string,hostname:port-peer;"
-                "inbuflen-bytes,inbufsize-bytes,outbuflen-bytes,outbufsize-bytes;recv-bytes,send-bytes;"
+                "inbuflen-bytes,inbufsize-bytes,outbuflen-bytes,outbufsize-bytes,queuemem-bytes;recv-bytes,send-bytes;"
                 "inbound-localhost-counters;outbound-localhost-counters;"
                 "inbound-remote-counters;outbound-remote-counters|..." // for each socket
                 "where counters are: %s", _tracker_getCounterHeaderString());
@@ -510,7 +523,7 @@ static void _tracker_logSocket(Tracker* tracker, LogLevel level, SimulationTime
 
         socketLogCount++;
         g_string_append_printf(msg, "%d,%s,%s:%u;"
-                "%"G_GSIZE_FORMAT",%"G_GSIZE_FORMAT",%"G_GSIZE_FORMAT",%"G_GSIZE_FORMAT";"
+                "%"G_GSIZE_FORMAT",%"G_GSIZE_FORMAT",%"G_GSIZE_FORMAT",%"G_GSIZE_FORMAT",%"G_GSIZE_FORMAT";"
                 "%"G_GSIZE_FORMAT",%"G_GSIZE_FORMAT";"
                 "%s;%s;%s;%s",
                 ss->handle, /*inet_ntoa((struct in_addr){socket->peerIP})*/
@@ -518,7 +531,7 @@ static void _tracker_logSocket(Tracker* tracker, LogLevel level, SimulationTime
                     ss->type == PLOCAL ? "LOCAL" : "UNKNOWN",
                 ss->peerHostname, ss->peerPort,
                 ss->inputBufferLength, ss->inputBufferSize,
-                ss->outputBufferLength, ss->outputBufferSize,
+                ss->outputBufferLength, ss->outputBufferSize, ss->queueAllocatedBytes,
                 totalRecvBytes, totalSendBytes,
                 inLocal, outLocal, inRemote, outRemote);
 
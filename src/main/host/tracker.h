@@ -31,6 +31,7 @@ void tracker_addSocket(Tracker* tracker, gint handle, ProtocolType type, gsize i
 void tracker_updateSocketPeer(Tracker* tracker, gint handle, in_addr_t peerIP, in_port_t peerPort);
 void tracker_updateSocketInputBuffer(Tracker* tracker, gint handle, gsize inputBufferLength, gsize inputBufferSize);
 void tracker_updateSocketOutputBuffer(Tracker* tracker, gint handle, gsize outputBufferLength, gsize outputBufferSize);
+void tracker_updateSocketQueueMemory(Tracker* tracker, gint handle, gsize queueAllocatedBytes);
 void tracker_removeSocket(Tracker* tracker, gint handle);
 void tracker_heartbeat(Tracker* tracker, gpointer userData);
 
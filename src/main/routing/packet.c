@@ -12,13 +12,16 @@
 #include "main/host/host.h"
 #include "main/routing/address.h"
 #include "main/routing/packet.h"
+#include "main/routing/packet_trace.h"
 #include "main/routing/payload.h"
 #include "main/utility/utility.h"
-#include "support/logger/log_level.h"
 #include "support/logger/logger.h"
 
 /* thread-safe structure representing a data/network packet */
 
+/* set once before the workers start, so reading it needs no synchronization */
+static gboolean packetTracingEnabled = FALSE;
+
 typedef struct _PacketLocalHeader PacketLocalHeader;
 struct _PacketLocalHeader {
     enum ProtocolLocalFlags flags;
@@ -57,7 +60,6 @@ struct _Packet {
     gdouble priority;
 
     PacketDeliveryStatusFlags allStatus;
-    GQueue* orderedStatus;
 
     MAGIC_DECLARE;
 };
@@ -71,8 +73,9 @@ const gchar* protocol_toString(ProtocolType type) {
     }
 }
 
-Packet* packet_new(gconstpointer payload, gsize payloadLength, guint hostID, guint64 packetID) {
-    Packet* packet = g_new0(Packet, 1);
+/* takes the caller's reference to the payload, which may be NULL */
+static Packet* _packet_new(Payload* payload, guint hostID, guint64 packetID) {
+    Packet* packet = worker_newObject(OBJECT_TYPE_PACKET, sizeof(Packet));
     MAGIC_INIT(packet);
 
     packet->referenceCount = 1;
@@ -80,27 +83,35 @@ Packet* packet_new(gconstpointer payload, gsize payloadLength, guint hostID, gui
     packet->hostID = hostID;
     packet->packetID = packetID;
 
-    if(payload != NULL && payloadLength > 0) {
-        /* the payload starts with 1 ref, which we hold */
-        packet->payload = payload_new(payload, payloadLength);
+    if(payload != NULL) {
+        packet->payload = payload;
 
         /* application data needs a priority ordering for FIFO onto the wire */
         packet->priority = host_getNextPacketPriority(worker_getActiveHost());
     }
 
-    packet->orderedStatus = g_queue_new();
-
     worker_countObject(OBJECT_TYPE_PACKET, COUNTER_TYPE_NEW);
     return packet;
 }
 
+Packet* packet_new(gconstpointer payload, gsize payloadLength, guint hostID, guint64 packetID) {
+    /* the payload starts with 1 ref, which the packet holds */
+    Payload* packetPayload = (payload != NULL && payloadLength > 0) ? payload_new(payload, payloadLength) : NULL;
+    return _packet_new(packetPayload, hostID, packetID);
+}
+
+Packet* packet_newSlice(PayloadBuffer* buffer, gsize offset, gsize length, guint hostID, guint64 packetID) {
+    Payload* packetPayload = (buffer != NULL && length > 0) ? payload_newSlice(buffer, offset, length) : NULL;
+    return _packet_new(packetPayload, hostID, packetID);
+}
+
 /* copy everything except the payload.
  * the payload will point to the same payload as the original packet.
  * the payload is protected so it is safe to send the copied packet to a different host. */
 Packet* packet_copy(Packet* packet) {
     MAGIC_ASSERT(packet);
 
-    Packet* copy = g_new0(Packet, 1);
+    Packet* copy = worker_newObject(OBJECT_TYPE_PACKET, sizeof(Packet));
     MAGIC_INIT(copy);
 
     copy->referenceCount = 1;
@@ -116,11 +127,6 @@ Packet* packet_copy(Packet* packet) {
 
     copy->allStatus = packet->allStatus;
 
-    if(packet->orderedStatus) {
-        /* this is ok because we store ints in the pointers, not objects */
-        copy->orderedStatus = g_queue_copy(packet->orderedStatus);
-    }
-
     copy->protocol = packet->protocol;
     if(packet->header) {
         switch (packet->protocol) {
@@ -176,12 +182,9 @@ static void _packet_free(Packet* packet) {
     if(packet->payload) {
         payload_unref(packet->payload);
     }
-    if(packet->orderedStatus) {
-        g_queue_free(packet->orderedStatus);
-    }
 
     MAGIC_CLEAR(packet);
-    g_free(packet);
+    worker_freeObject(OBJECT_TYPE_PACKET, packet);
 
     worker_countObject(OBJECT_TYPE_PACKET, COUNTER_TYPE_FREE);
 }
@@ -466,6 +469,18 @@ guint packet_copyPayload(Packet* packet, gsize payloadOffset, gpointer buffer, g
     }
 }
 
+guint packet_copyPayloadVector(Packet* packet, gsize payloadOffset, const struct iovec* iov,
+        gint iovcnt, gsize iovOffset, gsize length) {
+    MAGIC_ASSERT(packet);
+
+    if(packet->payload) {
+        return (guint) payload_getDataVector(packet->payload, payloadOffset, iov, iovcnt,
+                iovOffset, length);
+    } else {
+        return 0;
+    }
+}
+
 GList* packet_copyTCPSelectiveACKs(Packet* packet) {
     MAGIC_ASSERT(packet);
     utility_assert(packet->protocol == PTCP);
@@ -619,22 +634,19 @@ gchar* packet_toString(Packet* packet) {
             break;
         }
     }
-    
-    guint statusLength = g_queue_get_length(packet->orderedStatus);
-    if(statusLength > 0) {
-        g_string_append_printf(packetString, " status=");
-    }
-    for(int i = 0; i < statusLength; i++) {
-        gpointer statusPtr = g_queue_pop_head(packet->orderedStatus);
-        PacketDeliveryStatusFlags status = (PacketDeliveryStatusFlags) GPOINTER_TO_UINT(statusPtr);
 
-        if(i < statusLength - 1) {
-            g_string_append_printf(packetString, "%s,", _packet_deliveryStatusToAscii(status));
-        } else {
-            g_string_append_printf(packetString, "%s", _packet_deliveryStatusToAscii(status));
+    /* we only know the order of the status changes from a packet trace, so list
+     * them in the order they are defined */
+    if(packet->allStatus != PDS_NONE) {
+        g_string_append_printf(packetString, " status=");
+        gboolean isFirst = TRUE;
+        for(guint bit = 0; bit < 32; bit++) {
+            PacketDeliveryStatusFlags status = (PacketDeliveryStatusFlags)(1u << bit);
+            if(packet->allStatus & status) {
+                g_string_append_printf(packetString, isFirst ? "%s" : ",%s", _packet_deliveryStatusToAscii(status));
+                isFirst = FALSE;
+            }
         }
-
-        g_queue_push_tail(packet->orderedStatus, statusPtr);
     }
 
     return g_string_free(packetString, FALSE);
@@ -644,17 +656,106 @@ gchar* _packet_getString(Packet* packet) {
     return packet_toString(packet);
 }
 
+void packet_setTracingEnabled(gboolean enabled) {
+    packetTracingEnabled = enabled;
+}
+
+static void _packet_traceSelectiveACKRange(PacketTraceRecord* record, gint firstSack, gint lastSack) {
+    if(record->numSackRanges < PACKET_TRACE_MAX_SACK_RANGES) {
+        record->sackRanges[record->numSackRanges][0] = (guint32)firstSack;
+        record->sackRanges[record->numSackRanges][1] =
+                (lastSack == -1) ? PACKET_TRACE_NO_SACK_END : (guint32)lastSack;
+        record->numSackRanges++;
+    }
+}
+
+static void _packet_traceSelectiveACKs(PacketTraceRecord* record, GList* selectiveACKs) {
+    /* group the sequence numbers into ranges the same way packet_toString does */
+    gint firstSack = -1;
+    gint lastSack = -1;
+    for(GList *iter = selectiveACKs; iter; iter = g_list_next(iter)) {
+        gint seq = GPOINTER_TO_INT(iter->data);
+        if(firstSack == -1) {
+            firstSack = seq;
+        } else if(lastSack == -1 || seq == lastSack + 1) {
+            lastSack = seq;
+        } else {
+            _packet_traceSelectiveACKRange(record, firstSack, lastSack);
+            firstSack = seq;
+            lastSack = -1;
+        }
+    }
+
+    if(firstSack != -1) {
+        _packet_traceSelectiveACKRange(record, firstSack, lastSack);
+    }
+}
+
+static void _packet_trace(Packet* packet, PacketDeliveryStatusFlags status) {
+    /* the slave thread frees some packets after the workers are gone */
+    PacketTrace* trace = worker_getPacketTrace();
+    if(!trace) {
+        return;
+    }
+
+    PacketTraceRecord* record = packettrace_nextRecord(trace);
+    record->time = (guint64)worker_getCurrentTime();
+    record->hostID = packet->hostID;
+    record->packetID = packet->packetID;
+    record->status = (guint32)status;
+    record->payloadLength = (packet->payload) ? (guint32)payload_getLength(packet->payload) : 0;
+
+    if(!packet->header) {
+        return;
+    }
+    record->protocol = (guint8)packet->protocol;
+
+    switch (packet->protocol) {
+        case PLOCAL: {
+            PacketLocalHeader* header = packet->header;
+            record->sourceIP = (guint32)header->sourceDescriptorHandle;
+            record->destinationIP = (guint32)header->destinationDescriptorHandle;
+            break;
+        }
+
+        case PUDP: {
+            PacketUDPHeader* header = packet->header;
+            record->sourceIP = header->sourceIP;
+            record->sourcePort = header->sourcePort;
+            record->destinationIP = header->destinationIP;
+            record->destinationPort = header->destinationPort;
+            break;
+        }
+
+        case PTCP: {
+            PacketTCPHeader* header = packet->header;
+            record->sourceIP = header->sourceIP;
+            record->sourcePort = header->sourcePort;
+            record->destinationIP = header->destinationIP;
+            record->destinationPort = header->destinationPort;
+            record->tcpFlags = (guint8)header->flags;
+            record->sequence = header->sequence;
+            record->acknowledgment = header->acknowledgment;
+            record->window = header->window;
+            record->timestampValue = header->timestampValue;
+            record->timestampEcho = header->timestampEcho;
+            _packet_traceSelectiveACKs(record, header->selectiveACKs);
+            break;
+        }
+
+        default: {
+            break;
+        }
+    }
+}
+
 void packet_addDeliveryStatus(Packet* packet, PacketDeliveryStatusFlags status) {
     MAGIC_ASSERT(packet);
 
     packet->allStatus |= status;
 
-    gboolean skipDebug = worker_isFiltered(LOGLEVEL_DEBUG);
-    if(!skipDebug) {
-        g_queue_push_tail(packet->orderedStatus, GUINT_TO_POINTER(status));
-        gchar* packetStr = packet_toString(packet);
-        message("[%s] %s", _packet_deliveryStatusToAscii(status), packetStr);
-        g_free(packetStr);
+    if(G_UNLIKELY(packetTracingEnabled)) {
+        _packet_trace(packet, status);
     }
 }
 
@@ -12,6 +12,7 @@
 
 #include "main/core/support/definitions.h"
 #include "main/host/protocol.h"
+#include "main/routing/payload.h"
 
 typedef struct _Packet Packet;
 
@@ -58,6 +59,9 @@ struct _PacketTCPHeader {
 const gchar* protocol_toString(ProtocolType type);
 
 Packet* packet_new(gconstpointer payload, gsize payloadLength, guint hostID, guint64 packetID);
+/* like packet_new, but the payload references the given range of the buffer instead
+ * of copying it */
+Packet* packet_newSlice(PayloadBuffer* buffer, gsize offset, gsize length, guint hostID, guint64 packetID);
 Packet* packet_copy(Packet* packet);
 
 void packet_ref(Packet* packet);
@@ -88,10 +92,15 @@ in_port_t packet_getSourcePort(Packet* packet);
 ProtocolType packet_getProtocol(Packet* packet);
 
 guint packet_copyPayload(Packet* packet, gsize payloadOffset, gpointer buffer, gsize bufferLength);
+guint packet_copyPayloadVector(Packet* packet, gsize payloadOffset, const struct iovec* iov,
+        gint iovcnt, gsize iovOffset, gsize length);
 GList* packet_copyTCPSelectiveACKs(Packet* packet);
 PacketTCPHeader* packet_getTCPHeader(Packet* packet);
 gint packet_compareTCPSequence(Packet* packet1, Packet* packet2, gpointer user_data);
 
+/* if enabled, every delivery status change is recorded to the worker's packet trace;
+ * otherwise, only the set of all statuses the packet reached is kept */
+void packet_setTracingEnabled(gboolean enabled);
 void packet_addDeliveryStatus(Packet* packet, PacketDeliveryStatusFlags status);
 PacketDeliveryStatusFlags packet_getDeliveryStatus(Packet* packet);
 
@@ -0,0 +1,106 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include "main/routing/packet_trace.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "main/utility/utility.h"
+#include "support/logger/logger.h"
+
+#define PACKET_TRACE_MAGIC "SHDPKTTR"
+#define PACKET_TRACE_VERSION 1
+/* about 850 KiB per worker */
+#define PACKET_TRACE_RING_LENGTH 8192
+
+G_STATIC_ASSERT(sizeof(PacketTraceRecord) == 104);
+
+/* written once at the start of every trace file */
+typedef struct _PacketTraceFileHeader PacketTraceFileHeader;
+struct _PacketTraceFileHeader {
+    gchar magic[8];
+    guint32 version;
+    guint32 recordSize;
+};
+
+struct _PacketTrace {
+    FILE* file;
+    gchar* path;
+
+    PacketTraceRecord* ring;
+    guint numRecords;
+
+    guint64 numWritten;
+
+    MAGIC_DECLARE;
+};
+
+PacketTrace* packettrace_new(const gchar* path) {
+    utility_assert(path);
+
+    FILE* file = fopen(path, "wb");
+    if(!file) {
+        warning("unable to open packet trace file '%s': %s", path, g_strerror(errno));
+        return NULL;
+    }
+
+    PacketTraceFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PACKET_TRACE_MAGIC, sizeof(header.magic));
+    header.version = PACKET_TRACE_VERSION;
+    header.recordSize = (guint32)sizeof(PacketTraceRecord);
+    fwrite(&header, sizeof(header), 1, file);
+
+    PacketTrace* trace = g_new0(PacketTrace, 1);
+    MAGIC_INIT(trace);
+
+    trace->file = file;
+    trace->path = g_strdup(path);
+    trace->ring = g_new(PacketTraceRecord, PACKET_TRACE_RING_LENGTH);
+
+    return trace;
+}
+
+static void _packettrace_flush(PacketTrace* trace) {
+    MAGIC_ASSERT(trace);
+
+    if(trace->numRecords > 0) {
+        size_t written = fwrite(trace->ring, sizeof(PacketTraceRecord), trace->numRecords, trace->file);
+        if(written != trace->numRecords) {
+            warning("lost %u packet trace records writing to '%s'", trace->numRecords - (guint)written, trace->path);
+        }
+        trace->numWritten += written;
+        trace->numRecords = 0;
+    }
+}
+
+void packettrace_free(PacketTrace* trace) {
+    MAGIC_ASSERT(trace);
+
+    _packettrace_flush(trace);
+    fclose(trace->file);
+
+    message("wrote %"G_GUINT64_FORMAT" packet trace records to '%s'", trace->numWritten, trace->path);
+
+    g_free(trace->ring);
+    g_free(trace->path);
+
+    MAGIC_CLEAR(trace);
+    g_free(trace);
+}
+
+PacketTraceRecord* packettrace_nextRecord(PacketTrace* trace) {
+    MAGIC_ASSERT(trace);
+
+    if(trace->numRecords == PACKET_TRACE_RING_LENGTH) {
+        _packettrace_flush(trace);
+    }
+
+    PacketTraceRecord* record = &trace->ring[trace->numRecords++];
+    memset(record, 0, sizeof(PacketTraceRecord));
+    return record;
+}
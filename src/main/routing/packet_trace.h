@@ -0,0 +1,55 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#ifndef SHD_PACKET_TRACE_H_
+#define SHD_PACKET_TRACE_H_
+
+#include <glib.h>
+
+/* the number of SACK ranges stored per record; later ranges are dropped */
+#define PACKET_TRACE_MAX_SACK_RANGES 4
+/* marks a SACK range of a single sequence number */
+#define PACKET_TRACE_NO_SACK_END G_MAXUINT32
+
+/* One packet delivery status change. The layout is fixed and free of padding,
+ * since src/tools/decode_packet_trace.py reads it back; change both together and
+ * bump PACKET_TRACE_VERSION. */
+typedef struct _PacketTraceRecord PacketTraceRecord;
+struct _PacketTraceRecord {
+    guint64 time;
+    guint64 packetID;
+    guint64 timestampValue;
+    guint64 timestampEcho;
+    guint32 hostID;
+    guint32 status;
+    /* the descriptor handles instead of addresses for local packets */
+    guint32 sourceIP;
+    guint32 destinationIP;
+    guint32 payloadLength;
+    guint32 sequence;
+    guint32 acknowledgment;
+    guint32 window;
+    /* pairs of first and last sequence numbers */
+    guint32 sackRanges[PACKET_TRACE_MAX_SACK_RANGES][2];
+    guint16 sourcePort;
+    guint16 destinationPort;
+    guint8 protocol;
+    guint8 tcpFlags;
+    guint8 numSackRanges;
+    guint8 unused;
+};
+
+/* Buffers the binary records of one worker in a ring, which is written to the
+ * worker's trace file whenever it wraps around, and when the trace is freed. */
+typedef struct _PacketTrace PacketTrace;
+
+/* returns NULL if the file can not be opened */
+PacketTrace* packettrace_new(const gchar* path);
+void packettrace_free(PacketTrace* trace);
+
+/* returns a zeroed record to fill in, which is valid until the next call */
+PacketTraceRecord* packettrace_nextRecord(PacketTrace* trace);
+
+#endif /* SHD_PACKET_TRACE_H_ */
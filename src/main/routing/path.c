@@ -16,12 +16,17 @@ struct _Path {
     gint64 dstVertexIndex;
     gdouble latency;
     gdouble reliability;
-    guint64 packetCount;
     MAGIC_DECLARE;
+    /* each worker counts its packets in its own shard, so counting needs no
+     * atomic operations. they are summed when the count is read. */
+    guint numPacketCountShards;
+    guint64 packetCounts[];
 };
 
-Path* path_new(gboolean isDirect, gint64 srcVertexIndex, gint64 dstVertexIndex, gdouble latency, gdouble reliability) {
-    Path* path = g_new0(Path, 1);
+Path* path_new(gboolean isDirect, gint64 srcVertexIndex, gint64 dstVertexIndex, gdouble latency, gdouble reliability,
+        guint numPacketCountShards) {
+    utility_assert(numPacketCountShards > 0);
+    Path* path = g_malloc0(sizeof(Path) + numPacketCountShards * sizeof(guint64));
     MAGIC_INIT(path);
 
     /* a path representing a single edge in the graph.
@@ -33,6 +38,7 @@ Path* path_new(gboolean isDirect, gint64 srcVertexIndex, gint64 dstVertexIndex,
     path->dstVertexIndex = dstVertexIndex;
     path->latency = latency;
     path->reliability = reliability;
+    path->numPacketCountShards = numPacketCountShards;
 
     return path;
 }
@@ -54,9 +60,19 @@ gdouble path_getReliability(Path* path) {
     return path->reliability;
 }
 
-void path_incrementPacketCount(Path* path) {
+void path_incrementPacketCount(Path* path, guint shard) {
     MAGIC_ASSERT(path);
-    path->packetCount++;
+    utility_assert(shard < path->numPacketCountShards);
+    path->packetCounts[shard]++;
+}
+
+guint64 path_getPacketCount(Path* path) {
+    MAGIC_ASSERT(path);
+    guint64 packetCount = 0;
+    for(guint i = 0; i < path->numPacketCountShards; i++) {
+        packetCount += path->packetCounts[i];
+    }
+    return packetCount;
 }
 
 gchar* path_toString(Path* path) {
@@ -68,7 +84,7 @@ gchar* path_toString(Path* path) {
             "SourceIndex=%"G_GINT64_FORMAT" DestinationIndex=%"G_GINT64_FORMAT" "
             "Latency=%f Reliability=%f PacketCount=%"G_GUINT64_FORMAT" isDirect=%s",
             path->srcVertexIndex, path->dstVertexIndex,
-            path->latency, path->reliability, path->packetCount,
+            path->latency, path->reliability, path_getPacketCount(path),
             path->isDirect ? "True" : "False");
 
     return g_string_free(pathStringBuffer, FALSE);
@@ -11,13 +11,16 @@
 
 typedef struct _Path Path;
 
-Path* path_new(gboolean isDirect, gint64 srcVertexIndex, gint64 dstVertexIndex, gdouble latency, gdouble reliability);
+Path* path_new(gboolean isDirect, gint64 srcVertexIndex, gint64 dstVertexIndex, gdouble latency, gdouble reliability,
+        guint numPacketCountShards);
 void path_free(Path* path);
 
 gdouble path_getLatency(Path* path);
 gdouble path_getReliability(Path* path);
 
-void path_incrementPacketCount(Path* path);
+/* the shard must be below the number given to path_new, e.g. the worker's thread id */
+void path_incrementPacketCount(Path* path, guint shard);
+guint64 path_getPacketCount(Path* path);
 
 gchar* path_toString(Path* path);
 
@@ -13,100 +13,158 @@
 #include "main/core/worker.h"
 #include "main/utility/utility.h"
 
-/* packet payloads may be shared across hosts, so we must lock access to them */
+/* packet payloads may be shared across hosts, so reference counts are atomic. the
+ * data is never written after the buffer is created, so reading needs no lock. */
+struct _PayloadBuffer {
+    gint referenceCount;
+    gsize length;
+    MAGIC_DECLARE;
+    /* the data is stored inline, so a buffer is a single allocation */
+    guchar data[];
+};
+
 struct _Payload {
-    GMutex lock;
-    guint referenceCount;
-    gpointer data;
+    gint referenceCount;
+    PayloadBuffer* buffer;
+    gsize offset;
     gsize length;
     MAGIC_DECLARE;
 };
 
-Payload* payload_new(gconstpointer data, gsize dataLength) {
-    Payload* payload = g_new0(Payload, 1);
-    MAGIC_INIT(payload);
+PayloadBuffer* payloadbuffer_new(gconstpointer data, gsize dataLength) {
+    utility_assert(data != NULL || dataLength == 0);
 
-    g_mutex_init(&(payload->lock));
-    payload->referenceCount = 1;
+    PayloadBuffer* buffer = g_malloc(sizeof(PayloadBuffer) + dataLength);
+    MAGIC_INIT(buffer);
 
-    if(data && dataLength > 0) {
-        payload->data = g_malloc0(dataLength);
-        memmove(payload->data, data, dataLength);
-        utility_assert(payload->data != NULL);
-        payload->length = dataLength;
+    buffer->referenceCount = 1;
+    buffer->length = dataLength;
+    if(dataLength > 0) {
+        memcpy(buffer->data, data, dataLength);
+        worker_countCopiedBytes(COPY_TYPE_IN, dataLength);
     }
 
-    worker_countObject(OBJECT_TYPE_PAYLOAD, COUNTER_TYPE_NEW);
-
-    return payload;
+    return buffer;
 }
 
-static void _payload_free(Payload* payload) {
-    MAGIC_ASSERT(payload);
+PayloadBuffer* payloadbuffer_newVector(const struct iovec* iov, gint iovcnt, gsize offset,
+        gsize dataLength) {
+    utility_assert(iov != NULL || dataLength == 0);
 
-    g_mutex_clear(&(payload->lock));
+    PayloadBuffer* buffer = g_malloc(sizeof(PayloadBuffer) + dataLength);
+    MAGIC_INIT(buffer);
 
-    if(payload->data) {
-        g_free(payload->data);
+    buffer->referenceCount = 1;
+    /* the vector may hold fewer bytes than asked for */
+    buffer->length = utility_iovecGather(iov, iovcnt, offset, buffer->data, dataLength);
+    if(buffer->length > 0) {
+        worker_countCopiedBytes(COPY_TYPE_IN, buffer->length);
     }
 
-    MAGIC_CLEAR(payload);
-    g_free(payload);
+    return buffer;
+}
 
-    worker_countObject(OBJECT_TYPE_PAYLOAD, COUNTER_TYPE_FREE);
+void payloadbuffer_ref(PayloadBuffer* buffer) {
+    MAGIC_ASSERT(buffer);
+    g_atomic_int_inc(&(buffer->referenceCount));
 }
 
-static void _payload_lock(Payload* payload) {
-    MAGIC_ASSERT(payload);
-    g_mutex_lock(&(payload->lock));
+void payloadbuffer_unref(PayloadBuffer* buffer) {
+    MAGIC_ASSERT(buffer);
+    if(g_atomic_int_dec_and_test(&(buffer->referenceCount))) {
+        MAGIC_CLEAR(buffer);
+        g_free(buffer);
+    }
+}
+
+gsize payloadbuffer_getLength(PayloadBuffer* buffer) {
+    MAGIC_ASSERT(buffer);
+    return buffer->length;
+}
+
+Payload* payload_newSlice(PayloadBuffer* buffer, gsize offset, gsize length) {
+    MAGIC_ASSERT(buffer);
+    utility_assert(offset + length <= buffer->length);
+
+    Payload* payload = worker_newObject(OBJECT_TYPE_PAYLOAD, sizeof(Payload));
+    MAGIC_INIT(payload);
+
+    payload->referenceCount = 1;
+    payload->buffer = buffer;
+    payloadbuffer_ref(buffer);
+    payload->offset = offset;
+    payload->length = length;
+
+    worker_countObject(OBJECT_TYPE_PAYLOAD, COUNTER_TYPE_NEW);
+
+    return payload;
 }
 
-static void _payload_unlock(Payload* payload) {
+Payload* payload_new(gconstpointer data, gsize dataLength) {
+    PayloadBuffer* buffer = payloadbuffer_new(data, dataLength);
+    Payload* payload = payload_newSlice(buffer, 0, dataLength);
+    /* the payload holds the only reference now */
+    payloadbuffer_unref(buffer);
+    return payload;
+}
+
+static void _payload_free(Payload* payload) {
     MAGIC_ASSERT(payload);
-    g_mutex_unlock(&(payload->lock));
+
+    payloadbuffer_unref(payload->buffer);
+
+    MAGIC_CLEAR(payload);
+    worker_freeObject(OBJECT_TYPE_PAYLOAD, payload);
+
+    worker_countObject(OBJECT_TYPE_PAYLOAD, COUNTER_TYPE_FREE);
 }
 
 void payload_ref(Payload* payload) {
     MAGIC_ASSERT(payload);
-    _payload_lock(payload);
-    (payload->referenceCount)++;
-    _payload_unlock(payload);
+    g_atomic_int_inc(&(payload->referenceCount));
 }
 
 void payload_unref(Payload* payload) {
     MAGIC_ASSERT(payload);
-    _payload_lock(payload);
-    (payload->referenceCount)--;
-    gboolean needsFree = (payload->referenceCount == 0) ? TRUE : FALSE;
-    _payload_unlock(payload);
-    if(needsFree) {
+    if(g_atomic_int_dec_and_test(&(payload->referenceCount))) {
         _payload_free(payload);
     }
 }
 
 gsize payload_getLength(Payload* payload) {
     MAGIC_ASSERT(payload);
-    _payload_lock(payload);
-    gsize length = payload->length;
-    _payload_unlock(payload);
-    return length;
+    return payload->length;
 }
 
 gsize payload_getData(Payload* payload, gsize offset, gpointer destBuffer, gsize destBufferLength) {
     MAGIC_ASSERT(payload);
 
-    _payload_lock(payload);
-
     utility_assert(offset <= payload->length);
 
     gsize targetLength = payload->length - offset;
     gsize copyLength = MIN(targetLength, destBufferLength);
 
     if(copyLength > 0) {
-        g_memmove(destBuffer, payload->data + offset, copyLength);
+        memcpy(destBuffer, payload->buffer->data + payload->offset + offset, copyLength);
+        worker_countCopiedBytes(COPY_TYPE_OUT, copyLength);
     }
 
-    _payload_unlock(payload);
+    return copyLength;
+}
+
+gsize payload_getDataVector(Payload* payload, gsize offset, const struct iovec* iov, gint iovcnt,
+        gsize iovOffset, gsize length) {
+    MAGIC_ASSERT(payload);
+
+    utility_assert(offset <= payload->length);
+
+    gsize copyLength = MIN(payload->length - offset, length);
+    copyLength = utility_iovecScatter(iov, iovcnt, iovOffset,
+            payload->buffer->data + payload->offset + offset, copyLength);
+
+    if(copyLength > 0) {
+        worker_countCopiedBytes(COPY_TYPE_OUT, copyLength);
+    }
 
     return copyLength;
 }
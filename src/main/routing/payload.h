@@ -8,15 +8,38 @@
 #define SRC_MAIN_ROUTING_SHD_PAYLOAD_H_
 
 #include <glib.h>
+#include <sys/uio.h>
 
+/* A PayloadBuffer holds one copy of application data, for example everything from
+ * one send call. A Payload is a slice of a buffer, so that the packets cut from one
+ * write reference the same copy of the data by offset and length instead of holding
+ * copies of their own. Both are immutable after creation and reference counted with
+ * atomic operations, so they can be shared across hosts and threads without locks. */
+typedef struct _PayloadBuffer PayloadBuffer;
 typedef struct _Payload Payload;
 
+/* copies the data into a new buffer, which starts with 1 reference held by the caller */
+PayloadBuffer* payloadbuffer_new(gconstpointer data, gsize dataLength);
+/* gathers dataLength bytes starting offset bytes into the vector into a new buffer */
+PayloadBuffer* payloadbuffer_newVector(const struct iovec* iov, gint iovcnt, gsize offset,
+        gsize dataLength);
+void payloadbuffer_ref(PayloadBuffer* buffer);
+void payloadbuffer_unref(PayloadBuffer* buffer);
+gsize payloadbuffer_getLength(PayloadBuffer* buffer);
+
+/* copies the data into a new buffer of its own */
 Payload* payload_new(gconstpointer data, gsize dataLength);
+/* references the given range of the buffer without copying it */
+Payload* payload_newSlice(PayloadBuffer* buffer, gsize offset, gsize length);
 
 void payload_ref(Payload* payload);
 void payload_unref(Payload* payload);
 
 gsize payload_getLength(Payload* payload);
 gsize payload_getData(Payload* payload, gsize offset, gpointer destBuffer, gsize destBufferLength);
+/* scatters at most length bytes of the payload from offset into the vector, starting
+ * iovOffset bytes into it */
+gsize payload_getDataVector(Payload* payload, gsize offset, const struct iovec* iov, gint iovcnt,
+        gsize iovOffset, gsize length);
 
 #endif /* SRC_MAIN_ROUTING_SHD_PAYLOAD_H_ */
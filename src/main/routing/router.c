@@ -101,6 +101,11 @@ void router_forward(Router* router, Packet* packet) {
     worker_sendPacket(packet);
 }
 
+void router_forwardPackets(Router* router, Packet** packets, guint numPackets) {
+    MAGIC_ASSERT(router);
+    worker_sendPackets(packets, numPackets);
+}
+
 void router_enqueue(Router* router, Packet* packet) {
     MAGIC_ASSERT(router);
     utility_assert(packet);
@@ -131,3 +136,8 @@ Packet* router_dequeue(Router* router) {
 
     return packet;
 }
+
+Packet* router_peek(Router* router) {
+    MAGIC_ASSERT(router);
+    return router->queueHooks->peek(router->queueManager);
+}
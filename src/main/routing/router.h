@@ -42,10 +42,15 @@ void router_unref(Router* router);
 
 /* forward an outgoing packet to the destination's upstream router */
 void router_forward(Router* router, Packet* packet);
+/* forward outgoing packets that were sent to the same address at the same time, which
+ * arrive together at the destination's upstream router */
+void router_forwardPackets(Router* router, Packet** packets, guint numPackets);
 
 /* enqueue a downstream packet, i.e., buffer it until the host can receive it */
 void router_enqueue(Router* router, Packet* packet);
 /* dequeue a downstream packet, i.e., receive it from the network */
 Packet* router_dequeue(Router* router);
+/* returns the downstream packet that router_dequeue would return next, or NULL */
+Packet* router_peek(Router* router);
 
 #endif /* SRC_MAIN_ROUTING_SHD_ROUTER_H_ */
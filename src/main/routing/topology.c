@@ -18,6 +18,7 @@
 #include "main/routing/path.h"
 #include "main/routing/topology.h"
 #include "main/utility/random.h"
+#include "main/utility/rcu_hash_table.h"
 #include "main/utility/utility.h"
 #include "support/logger/logger.h"
 
@@ -34,17 +35,31 @@ struct _Topology {
 
     /* each connected virtual host is assigned to a PoI vertex. we store the mapping to the
      * vertex index so we can correctly lookup the assigned edge when computing latency.
-     * virtualIP->vertexIndex (stored as pointer) */
-    GHashTable* virtualIP;
+     * virtualIP->vertexIndex (stored as pointer). it is read without locks;
+     * the lock serializes the writers and protects verticesWithAttachedHosts. */
+    RCUHashTable* virtualIP;
     GHashTable* verticesWithAttachedHosts;
     GRWLock virtualIPLock;
 
+    /* when paths are precomputed, the path between the attached vertices with dense ids
+     * i and j is at pathMatrix[i * pathMatrixSize + j], and pathMatrixIDs maps each vertex
+     * index to its dense id or -1. they are only written before the simulation starts,
+     * so they are read without locks. the paths themselves are owned by the pathCache. */
+    Path** pathMatrix;
+    gint* pathMatrixIDs;
+    guint pathMatrixSize;
+
     /* cached latencies to avoid excessive shortest path lookups
      * store a cache table for every connected address
-     * fromAddress->toAddress->Path* */
-    GHashTable* pathCache;
+     * fromAddress->toAddress->Path*
+     * the tables are read without locks; the lock serializes the writers
+     * and protects the minimum latency. */
+    RCUHashTable* pathCache;
     gdouble minimumPathLatency;
-    GRWLock pathCacheLock;
+    GMutex pathCacheLock;
+
+    /* the number of per-worker packet counters in each path */
+    guint numPacketCountShards;
 
     /******/
     /* START - items protected by a global topology lock */
@@ -1265,12 +1280,12 @@ static gboolean _topology_verticesAreAdjacent(Topology* top, igraph_integer_t sr
 
 static void _topology_clearCache(Topology* top) {
     MAGIC_ASSERT(top);
-    g_rw_lock_writer_lock(&(top->pathCacheLock));
+    g_mutex_lock(&(top->pathCacheLock));
     if(top->pathCache) {
-        g_hash_table_destroy(top->pathCache);
+        rcuhashtable_free(top->pathCache);
         top->pathCache = NULL;
     }
-    g_rw_lock_writer_unlock(&(top->pathCacheLock));
+    g_mutex_unlock(&(top->pathCacheLock));
 
     /* lock the read on the shortest path info */
     g_mutex_lock(&(top->topologyLock));
@@ -1281,26 +1296,32 @@ static void _topology_clearCache(Topology* top) {
     g_mutex_unlock(&(top->topologyLock));
 }
 
-static Path* _topology_getPathFromCache(Topology* top, igraph_integer_t srcVertexIndex,
-        igraph_integer_t dstVertexIndex) {
+/* the pathCacheLock must be held when calling this function */
+static RCUHashTable* _topology_getSourceCacheForWriting(Topology* top, igraph_integer_t srcVertexIndex) {
     MAGIC_ASSERT(top);
 
-    Path* path = NULL;
-    g_rw_lock_reader_lock(&(top->pathCacheLock));
+    RCUHashTable* srcCache = NULL;
+    if(!rcuhashtable_lookup(top->pathCache, (guint)srcVertexIndex, (gpointer*)&srcCache)) {
+        /* dont have a cache for this source yet, create one now */
+        srcCache = rcuhashtable_new((GDestroyNotify)path_free);
+        rcuhashtable_replace(top->pathCache, (guint)srcVertexIndex, srcCache);
+    }
+    return srcCache;
+}
 
-    if(top->pathCache) {
-        /* look for the source first level cache */
-        gpointer sourceCache = g_hash_table_lookup(top->pathCache, GINT_TO_POINTER(srcVertexIndex));
+static Path* _topology_getPathFromCache(Topology* top, igraph_integer_t srcVertexIndex,
+        igraph_integer_t dstVertexIndex) {
+    MAGIC_ASSERT(top);
 
-        if(sourceCache) {
-            /* check for the path to destination in source cache */
-            path = g_hash_table_lookup(sourceCache, GINT_TO_POINTER(dstVertexIndex));
-        }
+    /* look for the source first level cache */
+    RCUHashTable* sourceCache = NULL;
+    if(!rcuhashtable_lookup(top->pathCache, (guint)srcVertexIndex, (gpointer*)&sourceCache)) {
+        return NULL;
     }
 
-    g_rw_lock_reader_unlock(&(top->pathCacheLock));
-
-    /* NULL if cache miss */
+    /* check for the path to destination in source cache, NULL if cache miss */
+    Path* path = NULL;
+    rcuhashtable_lookup(sourceCache, (guint)dstVertexIndex, (gpointer*)&path);
     return path;
 }
 
@@ -1349,27 +1370,24 @@ static void _topology_storePathInCache(Topology* top, gboolean isDirectPath,
     gdouble reliability = (gdouble) totalReliability;
     gboolean wasUpdated = FALSE;
 
-    g_rw_lock_writer_lock(&(top->pathCacheLock));
+    g_mutex_lock(&(top->pathCacheLock));
 
-    /* create latency cache on the fly */
-    if(!top->pathCache) {
-        /* stores hash tables for source address caches */
-        top->pathCache = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)g_hash_table_destroy);
-    }
+    RCUHashTable* srcCache = _topology_getSourceCacheForWriting(top, srcVertexIndex);
 
-    GHashTable* srcCache = g_hash_table_lookup(top->pathCache, GINT_TO_POINTER(srcVertexIndex));
-    if(!srcCache) {
-        /* dont have a cache for this source yet, create one now */
-        srcCache = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)path_free);
-        g_hash_table_replace(top->pathCache, GINT_TO_POINTER(srcVertexIndex), srcCache);
+    /* another worker may have stored the same path since we checked, and readers
+     * may already be using it */
+    if(rcuhashtable_lookup(srcCache, (guint)dstVertexIndex, NULL)) {
+        g_mutex_unlock(&(top->pathCacheLock));
+        return;
     }
 
     /* create the path */
-    Path* path = path_new(isDirectPath, (gint64)srcVertexIndex, (gint64)dstVertexIndex, latencyMS, reliability);
+    Path* path = path_new(isDirectPath, (gint64)srcVertexIndex, (gint64)dstVertexIndex, latencyMS, reliability,
+            top->numPacketCountShards);
 
     /* store it in the cache. don't bother storing the path for the reverse direction,
      * because we can check both directions for this cached path later. */
-    g_hash_table_replace(srcCache, GINT_TO_POINTER(dstVertexIndex), path);
+    rcuhashtable_replace(srcCache, (guint)dstVertexIndex, path);
 
     /* track the minimum network latency in the entire graph */
     if(top->minimumPathLatency == 0 || latencyMS < top->minimumPathLatency) {
@@ -1377,7 +1395,7 @@ static void _topology_storePathInCache(Topology* top, gboolean isDirectPath,
         wasUpdated = TRUE;
     }
 
-    g_rw_lock_writer_unlock(&(top->pathCacheLock));
+    g_mutex_unlock(&(top->pathCacheLock));
 
     /* make sure the worker knows the new min latency */
     if(wasUpdated) {
@@ -1392,9 +1410,7 @@ static igraph_integer_t _topology_getConnectedVertexIndex(Topology* top, Address
     gpointer vertexIndexPtr = NULL;
     in_addr_t ip = address_toNetworkIP(address);
 
-    g_rw_lock_reader_lock(&(top->virtualIPLock));
-    gboolean found = g_hash_table_lookup_extended(top->virtualIP, GUINT_TO_POINTER(ip), NULL, &vertexIndexPtr);
-    g_rw_lock_reader_unlock(&(top->virtualIPLock));
+    gboolean found = rcuhashtable_lookup(top->virtualIP, (guint)ip, &vertexIndexPtr);
 
     if(!found) {
         warning("address %s is not connected to the topology", address_toHostIPString(address));
@@ -1926,6 +1942,455 @@ static gboolean _topology_lookupDirectPath(Topology* top, igraph_integer_t srcVe
     return TRUE;
 }
 
+typedef struct _PathGraph PathGraph;
+/* a read-only copy of the graph as adjacency arrays, so that many threads can compute
+ * shortest paths at once without going through igraph */
+struct _PathGraph {
+    igraph_integer_t vertexCount;
+    /* the out-edges of vertex v are at positions edgeStart[v] to edgeStart[v+1]-1 */
+    gint* edgeStart;
+    igraph_integer_t* edgeTarget;
+    gdouble* edgeLatency;
+    gdouble* edgeReliability;
+    /* the probability that a packet is not dropped at each vertex */
+    gdouble* vertexReliability;
+};
+
+typedef struct _PathHeapEntry PathHeapEntry;
+struct _PathHeapEntry {
+    gdouble distance;
+    igraph_integer_t vertexIndex;
+};
+
+typedef struct _PathMatrixBuild PathMatrixBuild;
+struct _PathMatrixBuild {
+    Topology* top;
+    PathGraph* graph;
+
+    /* the vertex index of each dense id */
+    igraph_integer_t* vertices;
+    guint n;
+
+    /* the next row that a thread should compute, taken atomically */
+    gint nextRow;
+
+    /* the computed n*n path properties, each row written by a single thread.
+     * latency is 0 where the lazy lookup must find the path. */
+    gdouble* latency;
+    gdouble* reliability;
+    gboolean* isDirect;
+};
+
+static PathGraph* _topology_newPathGraph(Topology* top) {
+    MAGIC_ASSERT(top);
+
+    _topology_lockGraph(top);
+    g_rw_lock_reader_lock(&(top->edgeWeightsLock));
+
+    igraph_integer_t vertexCount = igraph_vcount(&top->graph);
+    igraph_integer_t edgeCount = igraph_ecount(&top->graph);
+    igraph_integer_t* edgeFrom = g_new0(igraph_integer_t, edgeCount);
+    igraph_integer_t* edgeTo = g_new0(igraph_integer_t, edgeCount);
+
+    PathGraph* graph = g_new0(PathGraph, 1);
+    graph->vertexCount = vertexCount;
+    graph->edgeStart = g_new0(gint, vertexCount + 1);
+    graph->vertexReliability = g_new0(gdouble, vertexCount);
+
+    for(igraph_integer_t v = 0; v < vertexCount; v++) {
+        gdouble packetLoss = 0;
+        _topology_findVertexAttributeDouble(top, v, VERTEX_ATTR_PACKETLOSS, &packetLoss);
+        graph->vertexReliability[v] = 1.0f - packetLoss;
+    }
+
+    /* count the out-degrees first; undirected edges go both ways */
+    for(igraph_integer_t e = 0; e < edgeCount; e++) {
+        igraph_edge(&top->graph, e, &edgeFrom[e], &edgeTo[e]);
+        graph->edgeStart[edgeFrom[e] + 1]++;
+        if(!top->isDirected && edgeFrom[e] != edgeTo[e]) {
+            graph->edgeStart[edgeTo[e] + 1]++;
+        }
+    }
+    for(igraph_integer_t v = 0; v < vertexCount; v++) {
+        graph->edgeStart[v + 1] += graph->edgeStart[v];
+    }
+
+    gint nEntries = graph->edgeStart[vertexCount];
+    graph->edgeTarget = g_new0(igraph_integer_t, nEntries);
+    graph->edgeLatency = g_new0(gdouble, nEntries);
+    graph->edgeReliability = g_new0(gdouble, nEntries);
+    gint* fill = g_new0(gint, vertexCount);
+    memcpy(fill, graph->edgeStart, vertexCount * sizeof(gint));
+
+    for(igraph_integer_t e = 0; e < edgeCount; e++) {
+        gdouble latency = (gdouble) VECTOR(*top->edgeWeights)[e];
+        gdouble packetLoss = 0;
+        gboolean found = _topology_findEdgeAttributeDouble(top, e, EDGE_ATTR_PACKETLOSS, &packetLoss);
+        utility_assert(found);
+
+        gint position = fill[edgeFrom[e]]++;
+        graph->edgeTarget[position] = edgeTo[e];
+        graph->edgeLatency[position] = latency;
+        graph->edgeReliability[position] = 1.0f - packetLoss;
+
+        if(!top->isDirected && edgeFrom[e] != edgeTo[e]) {
+            position = fill[edgeTo[e]]++;
+            graph->edgeTarget[position] = edgeFrom[e];
+            graph->edgeLatency[position] = latency;
+            graph->edgeReliability[position] = 1.0f - packetLoss;
+        }
+    }
+
+    g_rw_lock_reader_unlock(&(top->edgeWeightsLock));
+    _topology_unlockGraph(top);
+
+    g_free(fill);
+    g_free(edgeFrom);
+    g_free(edgeTo);
+
+    return graph;
+}
+
+static void _topology_freePathGraph(PathGraph* graph) {
+    g_free(graph->edgeStart);
+    g_free(graph->edgeTarget);
+    g_free(graph->edgeLatency);
+    g_free(graph->edgeReliability);
+    g_free(graph->vertexReliability);
+    g_free(graph);
+}
+
+/* returns the position of the first edge from src to dst, or -1 if there is none */
+static gint _topology_findPathGraphEdge(PathGraph* graph, igraph_integer_t srcVertexIndex,
+        igraph_integer_t dstVertexIndex) {
+    for(gint i = graph->edgeStart[srcVertexIndex]; i < graph->edgeStart[srcVertexIndex + 1]; i++) {
+        if(graph->edgeTarget[i] == dstVertexIndex) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void _topology_pushPathHeap(PathHeapEntry* heap, gint* heapSize, gdouble distance,
+        igraph_integer_t vertexIndex) {
+    gint i = (*heapSize)++;
+    while(i > 0 && heap[(i - 1) / 2].distance > distance) {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i].distance = distance;
+    heap[i].vertexIndex = vertexIndex;
+}
+
+static PathHeapEntry _topology_popPathHeap(PathHeapEntry* heap, gint* heapSize) {
+    PathHeapEntry top = heap[0];
+    PathHeapEntry last = heap[--(*heapSize)];
+    gint i = 0;
+    while(2 * i + 1 < *heapSize) {
+        gint child = 2 * i + 1;
+        if(child + 1 < *heapSize && heap[child + 1].distance < heap[child].distance) {
+            child++;
+        }
+        if(last.distance <= heap[child].distance) {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+    return top;
+}
+
+/* TRUE if two path latencies are equal up to rounding, so igraph could take either path */
+static gboolean _topology_isSamePathLatency(gdouble a, gdouble b) {
+    if(isinf(a) || isinf(b)) {
+        return FALSE;
+    }
+    return fabs(a - b) <= 1e-9 * MAX(fabs(a), fabs(b));
+}
+
+/* dijkstra over the latency of the edges. previousEdge holds the position of the edge
+ * that reaches each vertex on its shortest path, or -1 if it was not reached. isTied is
+ * set for vertices that more than one edge reaches at the shortest distance, where we
+ * can not know which one igraph picks. */
+static void _topology_runPathGraphDijkstra(PathGraph* graph, igraph_integer_t srcVertexIndex,
+        gdouble* distance, igraph_integer_t* previousVertex, gint* previousEdge, gboolean* isTied,
+        PathHeapEntry* heap) {
+    for(igraph_integer_t v = 0; v < graph->vertexCount; v++) {
+        distance[v] = INFINITY;
+        previousVertex[v] = -1;
+        previousEdge[v] = -1;
+        isTied[v] = FALSE;
+    }
+
+    gint heapSize = 0;
+    distance[srcVertexIndex] = 0;
+    _topology_pushPathHeap(heap, &heapSize, 0, srcVertexIndex);
+
+    while(heapSize > 0) {
+        PathHeapEntry entry = _topology_popPathHeap(heap, &heapSize);
+        igraph_integer_t u = entry.vertexIndex;
+        if(entry.distance > distance[u]) {
+            /* a stale entry, we already found a shorter way to u */
+            continue;
+        }
+
+        for(gint i = graph->edgeStart[u]; i < graph->edgeStart[u + 1]; i++) {
+            igraph_integer_t v = graph->edgeTarget[i];
+            gdouble d = distance[u] + graph->edgeLatency[i];
+            if(v == srcVertexIndex) {
+                continue;
+            } else if(_topology_isSamePathLatency(d, distance[v])) {
+                isTied[v] = TRUE;
+            } else if(d < distance[v]) {
+                distance[v] = d;
+                previousVertex[v] = u;
+                previousEdge[v] = i;
+                isTied[v] = FALSE;
+                _topology_pushPathHeap(heap, &heapSize, d, v);
+            }
+        }
+    }
+}
+
+/* computes the same path that the lazy lookup in _topology_getPathEntry would pick
+ * for the pair, from the results of a dijkstra run from the source. the shortest
+ * latency is unique, but which of several equally short paths igraph returns depends
+ * on its internal order, and their reliability may differ. so if the path is not the
+ * only shortest one, we return FALSE and leave the pair to the lazy lookup. */
+static gboolean _topology_computeMatrixEntry(PathMatrixBuild* build, igraph_integer_t srcVertexIndex,
+        igraph_integer_t dstVertexIndex, gdouble* distance, igraph_integer_t* previousVertex, gint* previousEdge,
+        gboolean* isTied, gdouble* latencyOut, gdouble* reliabilityOut, gboolean* isDirectOut) {
+    Topology* top = build->top;
+    PathGraph* graph = build->graph;
+
+    gint directEdge = _topology_findPathGraphEdge(graph, srcVertexIndex, dstVertexIndex);
+
+    if(top->isComplete || (top->prefersDirectPaths && directEdge >= 0)) {
+        /* like _topology_lookupDirectPath */
+        if(directEdge < 0) {
+            return FALSE;
+        }
+        *latencyOut = graph->edgeLatency[directEdge];
+        *reliabilityOut = graph->vertexReliability[srcVertexIndex] *
+                graph->vertexReliability[dstVertexIndex] * graph->edgeReliability[directEdge];
+        *isDirectOut = TRUE;
+        return TRUE;
+    }
+
+    *isDirectOut = FALSE;
+
+    if(srcVertexIndex == dstVertexIndex) {
+        /* like _topology_computeShortestPathToSelf, use the shortest edge twice */
+        gint minEdge = -1;
+        gboolean isMinTied = FALSE;
+        for(gint i = graph->edgeStart[srcVertexIndex]; i < graph->edgeStart[srcVertexIndex + 1]; i++) {
+            if(minEdge < 0 || graph->edgeLatency[i] < graph->edgeLatency[minEdge]) {
+                minEdge = i;
+                isMinTied = FALSE;
+            } else if(graph->edgeLatency[i] == graph->edgeLatency[minEdge] &&
+                    graph->edgeReliability[i] != graph->edgeReliability[minEdge]) {
+                isMinTied = TRUE;
+            }
+        }
+        if(minEdge < 0 || isMinTied) {
+            return FALSE;
+        }
+        *latencyOut = 2.0f * graph->edgeLatency[minEdge];
+        *reliabilityOut = graph->edgeReliability[minEdge] * graph->edgeReliability[minEdge];
+        return TRUE;
+    }
+
+    if(previousEdge[dstVertexIndex] < 0) {
+        /* unreachable */
+        return FALSE;
+    }
+
+    /* like _topology_computePathProperties */
+    gdouble reliability = graph->vertexReliability[srcVertexIndex] * graph->vertexReliability[dstVertexIndex];
+    for(igraph_integer_t v = dstVertexIndex; v != srcVertexIndex; v = previousVertex[v]) {
+        if(isTied[v]) {
+            return FALSE;
+        }
+        reliability *= graph->edgeReliability[previousEdge[v]];
+    }
+
+    gdouble latency = distance[dstVertexIndex];
+    if(latency == 0) {
+        warning("found shortest path latency of 0 ms between source vertex %i and destination vertex %i, "
+                "using 1 ms instead", (gint)srcVertexIndex, (gint)dstVertexIndex);
+        latency = 1;
+    }
+
+    *latencyOut = latency;
+    *reliabilityOut = reliability;
+    return TRUE;
+}
+
+static gpointer _topology_runPathMatrixThread(PathMatrixBuild* build) {
+    PathGraph* graph = build->graph;
+    guint n = build->n;
+
+    gdouble* distance = g_new0(gdouble, graph->vertexCount);
+    igraph_integer_t* previousVertex = g_new0(igraph_integer_t, graph->vertexCount);
+    gint* previousEdge = g_new0(gint, graph->vertexCount);
+    gboolean* isTied = g_new0(gboolean, graph->vertexCount);
+    /* every edge relaxation pushes at most one entry */
+    PathHeapEntry* heap = g_new0(PathHeapEntry, graph->edgeStart[graph->vertexCount] + 1);
+
+    while(TRUE) {
+        gint row = g_atomic_int_add(&build->nextRow, 1);
+        if(row >= (gint)n) {
+            break;
+        }
+
+        igraph_integer_t srcVertexIndex = build->vertices[row];
+        _topology_runPathGraphDijkstra(graph, srcVertexIndex, distance, previousVertex, previousEdge, isTied, heap);
+
+        /* undirected paths are the same both ways, so we only need half of the matrix */
+        for(guint column = build->top->isDirected ? 0 : (guint)row; column < n; column++) {
+            gsize position = (gsize)row * n + column;
+            if(!_topology_computeMatrixEntry(build, srcVertexIndex, build->vertices[column],
+                    distance, previousVertex, previousEdge, isTied, &build->latency[position],
+                    &build->reliability[position], &build->isDirect[position])) {
+                build->latency[position] = 0;
+            }
+        }
+    }
+
+    g_free(distance);
+    g_free(previousVertex);
+    g_free(previousEdge);
+    g_free(isTied);
+    g_free(heap);
+
+    return NULL;
+}
+
+static gint _topology_compareVertexIndices(gconstpointer a, gconstpointer b, gpointer userData) {
+    gint ia = GPOINTER_TO_INT(a), ib = GPOINTER_TO_INT(b);
+    return ia < ib ? -1 : (ia > ib ? 1 : 0);
+}
+
+gdouble topology_precomputePaths(Topology* top, guint nThreads) {
+    MAGIC_ASSERT(top);
+    utility_assert(top->pathMatrix == NULL);
+
+    GTimer* buildTimer = g_timer_new();
+
+    /* give the attached vertices dense ids, in vertex order to keep the run deterministic */
+    GQueue* attachedVertices = _topology_getUniqueVertexTargets(top);
+    g_queue_sort(attachedVertices, _topology_compareVertexIndices, NULL);
+
+    PathMatrixBuild build;
+    memset(&build, 0, sizeof(PathMatrixBuild));
+    build.top = top;
+    build.graph = _topology_newPathGraph(top);
+    build.n = g_queue_get_length(attachedVertices);
+    build.vertices = g_new0(igraph_integer_t, build.n);
+    build.latency = g_new0(gdouble, (gsize)build.n * build.n);
+    build.reliability = g_new0(gdouble, (gsize)build.n * build.n);
+    build.isDirect = g_new0(gboolean, (gsize)build.n * build.n);
+
+    gint* ids = g_new(gint, build.graph->vertexCount);
+    for(igraph_integer_t v = 0; v < build.graph->vertexCount; v++) {
+        ids[v] = -1;
+    }
+    for(guint i = 0; i < build.n; i++) {
+        build.vertices[i] = (igraph_integer_t) GPOINTER_TO_INT(g_queue_pop_head(attachedVertices));
+        ids[build.vertices[i]] = (gint) i;
+    }
+    g_queue_free(attachedVertices);
+
+    /* each thread takes the next source row until all are done */
+    nThreads = MAX(1, MIN(nThreads, build.n));
+    GThread** threads = g_new0(GThread*, nThreads);
+    for(guint i = 0; i < nThreads; i++) {
+        gchar* name = g_strdup_printf("path-matrix-%u", i);
+        threads[i] = g_thread_new(name, (GThreadFunc)_topology_runPathMatrixThread, &build);
+        g_free(name);
+    }
+    for(guint i = 0; i < nThreads; i++) {
+        g_thread_join(threads[i]);
+    }
+    g_free(threads);
+
+    Path** matrix = g_new0(Path*, (gsize)build.n * build.n);
+    guint nPaths = 0, nMissing = 0;
+
+    g_mutex_lock(&(top->pathCacheLock));
+
+    for(guint row = 0; row < build.n; row++) {
+        igraph_integer_t srcVertexIndex = build.vertices[row];
+        RCUHashTable* srcCache = _topology_getSourceCacheForWriting(top, srcVertexIndex);
+
+        for(guint column = top->isDirected ? 0 : row; column < build.n; column++) {
+            gsize position = (gsize)row * build.n + column;
+            if(build.latency[position] == 0) {
+                nMissing++;
+                continue;
+            }
+
+            igraph_integer_t dstVertexIndex = build.vertices[column];
+
+            /* keep a path that was already looked up lazily, so its packet count stays */
+            Path* path = _topology_getPathFromCache(top, srcVertexIndex, dstVertexIndex);
+            if(!path && !top->isDirected) {
+                path = _topology_getPathFromCache(top, dstVertexIndex, srcVertexIndex);
+            }
+            if(!path) {
+                path = path_new(build.isDirect[position], (gint64)srcVertexIndex, (gint64)dstVertexIndex,
+                        build.latency[position], build.reliability[position], top->numPacketCountShards);
+                rcuhashtable_replace(srcCache, (guint)dstVertexIndex, path);
+            }
+
+            matrix[position] = path;
+            if(!top->isDirected) {
+                matrix[(gsize)column * build.n + row] = path;
+            }
+            nPaths++;
+
+            gdouble latencyMS = path_getLatency(path);
+            if(top->minimumPathLatency == 0 || latencyMS < top->minimumPathLatency) {
+                top->minimumPathLatency = latencyMS;
+            }
+        }
+    }
+
+    top->pathMatrix = matrix;
+    top->pathMatrixIDs = ids;
+    top->pathMatrixSize = build.n;
+    gdouble minimumPathLatency = top->minimumPathLatency;
+
+    g_mutex_unlock(&(top->pathCacheLock));
+
+    gdouble elapsedSeconds = g_timer_elapsed(buildTimer, NULL);
+    g_timer_destroy(buildTimer);
+
+    gsize matrixBytes = (gsize)build.n * build.n * sizeof(Path*) + build.graph->vertexCount * sizeof(gint);
+    message("precomputed %u paths between %u attached vertices using %u threads in %f seconds, "
+            "the path matrix takes %"G_GSIZE_FORMAT" bytes; %u pairs have no path or several equally "
+            "short ones and will be looked up on demand", nPaths, build.n, nThreads, elapsedSeconds, matrixBytes, nMissing);
+
+    _topology_freePathGraph(build.graph);
+    g_free(build.vertices);
+    g_free(build.latency);
+    g_free(build.reliability);
+    g_free(build.isDirect);
+
+    return minimumPathLatency;
+}
+
+static Path* _topology_getPathFromMatrix(Topology* top, igraph_integer_t srcVertexIndex,
+        igraph_integer_t dstVertexIndex) {
+    gint srcID = top->pathMatrixIDs[srcVertexIndex];
+    gint dstID = top->pathMatrixIDs[dstVertexIndex];
+    if(srcID < 0 || dstID < 0) {
+        return NULL;
+    }
+    return top->pathMatrix[(gsize)srcID * top->pathMatrixSize + dstID];
+}
+
 static void _topology_logAllCachedPathsHelper2(gpointer dstIndexKey, Path* path, Topology* top) {
     if(path) {
 
@@ -1953,16 +2418,16 @@ static void _topology_logAllCachedPathsHelper2(gpointer dstIndexKey, Path* path,
     }
 }
 
-static void _topology_logAllCachedPathsHelper1(gpointer srcIndexKey, GHashTable* sourceCache, Topology* top) {
+static void _topology_logAllCachedPathsHelper1(gpointer srcIndexKey, RCUHashTable* sourceCache, Topology* top) {
     if(sourceCache) {
-        g_hash_table_foreach(sourceCache, (GHFunc)_topology_logAllCachedPathsHelper2, top);
+        rcuhashtable_foreach(sourceCache, (GHFunc)_topology_logAllCachedPathsHelper2, top);
     }
 }
 
 static void _topology_logAllCachedPaths(Topology* top) {
     MAGIC_ASSERT(top);
     if(top->pathCache) {
-        g_hash_table_foreach(top->pathCache, (GHFunc)_topology_logAllCachedPathsHelper1, top);
+        rcuhashtable_foreach(top->pathCache, (GHFunc)_topology_logAllCachedPathsHelper1, top);
     }
 }
 
@@ -1983,6 +2448,14 @@ static Path* _topology_getPathEntry(Topology* top, Address* srcAddress, Address*
         return FALSE;
     }
 
+    /* precomputed paths need no locks */
+    if(top->pathMatrix) {
+        Path* path = _topology_getPathFromMatrix(top, srcVertexIndex, dstVertexIndex);
+        if(path) {
+            return path;
+        }
+    }
+
     /* check for a cache hit */
     Path* path = _topology_getPathFromCache(top, srcVertexIndex, dstVertexIndex);
     if(!path && !top->isDirected) {
@@ -2050,12 +2523,17 @@ static Path* _topology_getPathEntry(Topology* top, Address* srcAddress, Address*
     return path;
 }
 
+Path* topology_getPath(Topology* top, Address* srcAddress, Address* dstAddress) {
+    MAGIC_ASSERT(top);
+    return _topology_getPathEntry(top, srcAddress, dstAddress);
+}
+
 void topology_incrementPathPacketCounter(Topology* top, Address* srcAddress, Address* dstAddress) {
     MAGIC_ASSERT(top);
 
     Path* path = _topology_getPathEntry(top, srcAddress, dstAddress);
     if(path != NULL) {
-        path_incrementPacketCount(path);
+        path_incrementPacketCount(path, (guint)worker_getThreadID());
     } else {
         error("unable to find path between node %s and node %s",
                 address_toString(srcAddress), address_toString(dstAddress));
@@ -2086,6 +2564,11 @@ gdouble topology_getReliability(Topology* top, Address* srcAddress, Address* dst
     }
 }
 
+gint topology_getAttachedVertexIndex(Topology* top, Address* address) {
+    MAGIC_ASSERT(top);
+    return (gint) _topology_getConnectedVertexIndex(top, address);
+}
+
 gboolean topology_isRoutable(Topology* top, Address* srcAddress, Address* dstAddress) {
     MAGIC_ASSERT(top);
     return (topology_getLatency(top, srcAddress, dstAddress) > -1) ? TRUE : FALSE;
@@ -2380,7 +2863,7 @@ void topology_attach(Topology* top, Address* address, Random* randomSourcePool,
 
     /* attach it, i.e. store the mapping so we can route later */
     g_rw_lock_writer_lock(&(top->virtualIPLock));
-    g_hash_table_replace(top->virtualIP, GUINT_TO_POINTER(nodeIP), GINT_TO_POINTER(vertexIndex));
+    rcuhashtable_replace(top->virtualIP, (guint)nodeIP, GINT_TO_POINTER(vertexIndex));
     g_hash_table_replace(top->verticesWithAttachedHosts, GUINT_TO_POINTER(vertexIndex), GINT_TO_POINTER(vertexIndex));
     g_rw_lock_writer_unlock(&(top->virtualIPLock));
 
@@ -2434,7 +2917,7 @@ void topology_detach(Topology* top, Address* address) {
     in_addr_t ip = address_toNetworkIP(address);
 
     g_rw_lock_writer_lock(&(top->virtualIPLock));
-    g_hash_table_remove(top->virtualIP, GUINT_TO_POINTER(ip));
+    rcuhashtable_remove(top->virtualIP, (guint)ip);
     g_rw_lock_writer_unlock(&(top->virtualIPLock));
 }
 
@@ -2447,7 +2930,7 @@ void topology_free(Topology* top) {
     /* clear the virtual ip table */
     g_rw_lock_writer_lock(&(top->virtualIPLock));
     if(top->virtualIP) {
-        g_hash_table_destroy(top->virtualIP);
+        rcuhashtable_free(top->virtualIP);
         top->virtualIP = NULL;
     }
     if(top->verticesWithAttachedHosts) {
@@ -2457,9 +2940,19 @@ void topology_free(Topology* top) {
     g_rw_lock_writer_unlock(&(top->virtualIPLock));
     g_rw_lock_clear(&(top->virtualIPLock));
 
+    /* the matrix only borrows the paths from the cache */
+    if(top->pathMatrix) {
+        g_free(top->pathMatrix);
+        top->pathMatrix = NULL;
+    }
+    if(top->pathMatrixIDs) {
+        g_free(top->pathMatrixIDs);
+        top->pathMatrixIDs = NULL;
+    }
+
     /* this functions grabs and releases the pathCache write lock */
     _topology_clearCache(top);
-    g_rw_lock_clear(&(top->pathCacheLock));
+    g_mutex_clear(&(top->pathCacheLock));
 
     /* clear the stored edge weights */
     g_rw_lock_writer_lock(&(top->edgeWeightsLock));
@@ -2483,19 +2976,23 @@ void topology_free(Topology* top) {
     g_free(top);
 }
 
-Topology* topology_new(const gchar* graphPath) {
+Topology* topology_new(const gchar* graphPath, guint numPacketCountShards) {
     utility_assert(graphPath);
+    utility_assert(numPacketCountShards > 0);
     Topology* top = g_new0(Topology, 1);
     MAGIC_INIT(top);
 
-    top->virtualIP = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, NULL);
+    top->numPacketCountShards = numPacketCountShards;
+    top->virtualIP = rcuhashtable_new(NULL);
+    /* stores hash tables for source address caches */
+    top->pathCache = rcuhashtable_new((GDestroyNotify)rcuhashtable_free);
     top->verticesWithAttachedHosts = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, NULL);
 
     _topology_initGraphLock(&(top->graphLock));
     g_mutex_init(&(top->topologyLock));
     g_rw_lock_init(&(top->edgeWeightsLock));
     g_rw_lock_init(&(top->virtualIPLock));
-    g_rw_lock_init(&(top->pathCacheLock));
+    g_mutex_init(&(top->pathCacheLock));
 
     /* first read in the graph and make sure its formed correctly,
      * then setup our edge weights for shortest path */
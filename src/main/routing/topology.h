@@ -10,11 +10,13 @@
 #include <glib.h>
 
 #include "main/routing/address.h"
+#include "main/routing/path.h"
 #include "main/utility/random.h"
 
 typedef struct _Topology Topology;
 
-Topology* topology_new(const gchar* graphPath);
+/* each path counts its packets in numPacketCountShards counters, one per worker */
+Topology* topology_new(const gchar* graphPath, guint numPacketCountShards);
 void topology_free(Topology* top);
 
 void topology_attach(Topology* top, Address* address, Random* randomSourcePool,
@@ -22,9 +24,22 @@ void topology_attach(Topology* top, Address* address, Random* randomSourcePool,
         guint64* bwDownOut, guint64* bwUpOut);
 void topology_detach(Topology* top, Address* address);
 
+/* computes the paths between all pairs of vertices with attached hosts using nThreads
+ * threads, so that later lookups need no locks. call it once all hosts are attached,
+ * before the simulation starts. returns the minimum path latency in milliseconds. */
+gdouble topology_precomputePaths(Topology* top, guint nThreads);
+
 gboolean topology_isRoutable(Topology* top, Address* srcAddress, Address* dstAddress);
+/* looks up the path between the addresses once, so that the caller can read its latency
+ * and reliability and count its packets without further lookups. the path stays valid
+ * until the topology is freed. returns NULL if there is no path. lookups of paths that
+ * were already computed take no locks. */
+Path* topology_getPath(Topology* top, Address* srcAddress, Address* dstAddress);
 gdouble topology_getLatency(Topology* top, Address* srcAddress, Address* dstAddress);
 gdouble topology_getReliability(Topology* top, Address* srcAddress, Address* dstAddress);
 void topology_incrementPathPacketCounter(Topology* top, Address* srcAddress, Address* dstAddress);
 
+/* returns the index of the graph vertex to which the address was attached, or -1 */
+gint topology_getAttachedVertexIndex(Topology* top, Address* address);
+
 #endif /* SHD_TOPOLOGY_H_ */
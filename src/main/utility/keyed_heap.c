@@ -0,0 +1,201 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include "main/utility/keyed_heap.h"
+
+#include <glib.h>
+#include <stddef.h>
+
+#include "main/utility/utility.h"
+
+/* Each node has this many children. With 32-byte entries, all children of a
+ * node fit in two cache lines, and the tree is half as deep as a binary heap. */
+#define KEYED_HEAP_ARITY 4
+
+static const gsize INITIAL_SIZE = 128;
+
+typedef struct _KeyedHeapEntry KeyedHeapEntry;
+struct _KeyedHeapEntry {
+    KeyedHeapKey key;
+    gpointer data;
+};
+
+struct _KeyedHeap {
+    KeyedHeapEntry* entries;
+    gsize size;
+    gsize capacity;
+    GDestroyNotify freeFunc;
+};
+
+KeyedHeap* keyedheap_new(GDestroyNotify freeFunc) {
+    KeyedHeap* heap = g_slice_new(KeyedHeap);
+    heap->entries = g_new(KeyedHeapEntry, INITIAL_SIZE);
+    heap->size = 0;
+    heap->capacity = INITIAL_SIZE;
+    heap->freeFunc = freeFunc;
+    return heap;
+}
+
+void keyedheap_clear(KeyedHeap* heap) {
+    utility_assert(heap);
+    if(heap->freeFunc) {
+        for(gsize i = 0; i < heap->size; i++) {
+            heap->freeFunc(heap->entries[i].data);
+        }
+    }
+    heap->size = 0;
+}
+
+void keyedheap_free(KeyedHeap* heap) {
+    utility_assert(heap);
+    keyedheap_clear(heap);
+    g_free(heap->entries);
+    g_slice_free(KeyedHeap, heap);
+}
+
+gsize keyedheap_getLength(KeyedHeap* heap) {
+    utility_assert(heap);
+    return heap->size;
+}
+
+gboolean keyedheap_isEmpty(KeyedHeap* heap) {
+    utility_assert(heap);
+    return heap->size == 0;
+}
+
+static inline gboolean _keyedheap_isSmaller(const KeyedHeapKey* a, const KeyedHeapKey* b) {
+    if(a->primary != b->primary) {
+        return a->primary < b->primary;
+    } else if(a->secondary != b->secondary) {
+        return a->secondary < b->secondary;
+    } else {
+        return a->tertiary < b->tertiary;
+    }
+}
+
+gint keyedheap_compareKeys(const KeyedHeapKey* a, const KeyedHeapKey* b) {
+    if(_keyedheap_isSmaller(a, b)) {
+        return -1;
+    } else if(_keyedheap_isSmaller(b, a)) {
+        return 1;
+    } else {
+        return 0;
+    }
+}
+
+/* move the hole at index up until entry fits, then store entry there */
+static void _keyedheap_siftUp(KeyedHeap* heap, gsize index, const KeyedHeapEntry* entry) {
+    while(index > 0) {
+        gsize parent = (index - 1) / KEYED_HEAP_ARITY;
+        if(!_keyedheap_isSmaller(&entry->key, &heap->entries[parent].key)) {
+            break;
+        }
+        heap->entries[index] = heap->entries[parent];
+        index = parent;
+    }
+    heap->entries[index] = *entry;
+}
+
+/* move the hole at index down until entry fits, then store entry there */
+static void _keyedheap_siftDown(KeyedHeap* heap, gsize index, const KeyedHeapEntry* entry) {
+    while(TRUE) {
+        gsize first = index * KEYED_HEAP_ARITY + 1;
+        if(first >= heap->size) {
+            break;
+        }
+
+        /* find the smallest child */
+        gsize last = MIN(first + KEYED_HEAP_ARITY, heap->size);
+        gsize smallest = first;
+        for(gsize child = first + 1; child < last; child++) {
+            if(_keyedheap_isSmaller(&heap->entries[child].key, &heap->entries[smallest].key)) {
+                smallest = child;
+            }
+        }
+
+        if(!_keyedheap_isSmaller(&heap->entries[smallest].key, &entry->key)) {
+            break;
+        }
+        heap->entries[index] = heap->entries[smallest];
+        index = smallest;
+    }
+    heap->entries[index] = *entry;
+}
+
+void keyedheap_push(KeyedHeap* heap, const KeyedHeapKey* key, gpointer data) {
+    utility_assert(heap && key);
+
+    if(heap->size >= heap->capacity) {
+        heap->capacity *= 2;
+        heap->entries = g_renew(KeyedHeapEntry, heap->entries, heap->capacity);
+    }
+
+    KeyedHeapEntry entry = {.key = *key, .data = data};
+    heap->size++;
+    _keyedheap_siftUp(heap, heap->size - 1, &entry);
+}
+
+gpointer keyedheap_peek(KeyedHeap* heap) {
+    utility_assert(heap);
+    return (heap->size > 0) ? heap->entries[0].data : NULL;
+}
+
+const KeyedHeapKey* keyedheap_peekKey(KeyedHeap* heap) {
+    utility_assert(heap);
+    return (heap->size > 0) ? &(heap->entries[0].key) : NULL;
+}
+
+static void _keyedheap_shrinkIfSparse(KeyedHeap* heap) {
+    while((heap->capacity > INITIAL_SIZE) && (heap->size * 4 < heap->capacity)) {
+        heap->capacity /= 2;
+        heap->entries = g_renew(KeyedHeapEntry, heap->entries, heap->capacity);
+    }
+}
+
+gsize keyedheap_removeIf(KeyedHeap* heap, KeyedHeapPredicateFunc predicate, gpointer userData) {
+    utility_assert(heap && predicate);
+
+    /* compact the kept entries to the front */
+    gsize kept = 0;
+    for(gsize i = 0; i < heap->size; i++) {
+        if(!predicate(heap->entries[i].data, userData)) {
+            heap->entries[kept++] = heap->entries[i];
+        }
+    }
+
+    gsize numRemoved = heap->size - kept;
+    heap->size = kept;
+
+    if(numRemoved > 0 && kept > 1) {
+        /* restore the heap property bottom-up, starting at the last parent */
+        gsize index = ((kept - 2) / KEYED_HEAP_ARITY) + 1;
+        while(index > 0) {
+            index--;
+            KeyedHeapEntry entry = heap->entries[index];
+            _keyedheap_siftDown(heap, index, &entry);
+        }
+    }
+
+    _keyedheap_shrinkIfSparse(heap);
+    return numRemoved;
+}
+
+gpointer keyedheap_pop(KeyedHeap* heap) {
+    utility_assert(heap);
+
+    if(heap->size == 0) {
+        return NULL;
+    }
+
+    gpointer data = heap->entries[0].data;
+    heap->size--;
+    if(heap->size > 0) {
+        KeyedHeapEntry last = heap->entries[heap->size];
+        _keyedheap_siftDown(heap, 0, &last);
+    }
+
+    _keyedheap_shrinkIfSparse(heap);
+    return data;
+}
@@ -0,0 +1,48 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#ifndef SHD_KEYED_HEAP_H_
+#define SHD_KEYED_HEAP_H_
+
+#include <glib.h>
+
+/* The sort key is stored inline in each heap entry, so comparisons never have to
+ * dereference the stored data. Keys are compared lexicographically: first by
+ * primary, then by secondary, then by tertiary. */
+typedef struct _KeyedHeapKey KeyedHeapKey;
+struct _KeyedHeapKey {
+    guint64 primary;
+    guint64 secondary;
+    guint64 tertiary;
+};
+
+/* returns TRUE if the entry with the given data should be removed */
+typedef gboolean (*KeyedHeapPredicateFunc)(gpointer data, gpointer userData);
+
+/* A d-ary min-heap of (key, data) entries. Unlike PriorityQueue, it does not keep
+ * a map from data to heap position, so it does not support finding items or
+ * detecting duplicate pushes. */
+typedef struct _KeyedHeap KeyedHeap;
+
+/* returns a negative value if a sorts before b, a positive value if after, or 0 */
+gint keyedheap_compareKeys(const KeyedHeapKey* a, const KeyedHeapKey* b);
+
+KeyedHeap* keyedheap_new(GDestroyNotify freeFunc);
+void keyedheap_clear(KeyedHeap* heap);
+void keyedheap_free(KeyedHeap* heap);
+
+gsize keyedheap_getLength(KeyedHeap* heap);
+gboolean keyedheap_isEmpty(KeyedHeap* heap);
+void keyedheap_push(KeyedHeap* heap, const KeyedHeapKey* key, gpointer data);
+gpointer keyedheap_peek(KeyedHeap* heap);
+/* returns the key of the entry that peek would return, or NULL if the heap is empty.
+ * the key is only valid until the next push or pop. */
+const KeyedHeapKey* keyedheap_peekKey(KeyedHeap* heap);
+gpointer keyedheap_pop(KeyedHeap* heap);
+/* removes all entries for which predicate returns TRUE in O(n) time, and returns how
+ * many were removed. the free function is not called on removed entries. */
+gsize keyedheap_removeIf(KeyedHeap* heap, KeyedHeapPredicateFunc predicate, gpointer userData);
+
+#endif /* SHD_KEYED_HEAP_H_ */
@@ -0,0 +1,62 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include "main/utility/mpsc_inbox.h"
+
+#include <glib.h>
+#include <stddef.h>
+
+#include "main/utility/utility.h"
+
+struct _MPSCInbox {
+    /* a singly-linked stack of pushed items, newest first */
+    GSList* head;
+    GDestroyNotify freeFunc;
+};
+
+MPSCInbox* mpscinbox_new(GDestroyNotify freeFunc) {
+    MPSCInbox* inbox = g_new0(MPSCInbox, 1);
+    inbox->freeFunc = freeFunc;
+    return inbox;
+}
+
+void mpscinbox_free(MPSCInbox* inbox) {
+    utility_assert(inbox);
+    GSList* items = mpscinbox_takeAll(inbox);
+    if(inbox->freeFunc) {
+        g_slist_free_full(items, inbox->freeFunc);
+    } else {
+        g_slist_free(items);
+    }
+    g_free(inbox);
+}
+
+void mpscinbox_push(MPSCInbox* inbox, gpointer data) {
+    utility_assert(inbox);
+
+    /* the node is allocated from the calling thread's slice magazine, so
+     * this does not contend with other producers */
+    GSList* node = g_slist_alloc();
+    node->data = data;
+
+    do {
+        node->next = g_atomic_pointer_get(&inbox->head);
+    } while(!g_atomic_pointer_compare_and_exchange(&inbox->head, node->next, node));
+}
+
+GSList* mpscinbox_takeAll(MPSCInbox* inbox) {
+    utility_assert(inbox);
+
+    /* detach the whole stack; producers that race with us simply start a new one */
+    GSList* items = NULL;
+    do {
+        items = g_atomic_pointer_get(&inbox->head);
+        if(items == NULL) {
+            return NULL;
+        }
+    } while(!g_atomic_pointer_compare_and_exchange(&inbox->head, items, NULL));
+
+    return items;
+}
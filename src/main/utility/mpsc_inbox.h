@@ -0,0 +1,27 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#ifndef SHD_MPSC_INBOX_H_
+#define SHD_MPSC_INBOX_H_
+
+#include <glib.h>
+
+/* A lock-free multi-producer single-consumer inbox. Any thread may push items
+ * without taking a lock; only the owning thread may take items out, and it
+ * always takes everything that is currently in the inbox at once. Items are
+ * NOT returned in any particular order, so the consumer is expected to sort
+ * them (e.g., by merging them into a PriorityQueue). */
+typedef struct _MPSCInbox MPSCInbox;
+
+MPSCInbox* mpscinbox_new(GDestroyNotify freeFunc);
+void mpscinbox_free(MPSCInbox* inbox);
+
+void mpscinbox_push(MPSCInbox* inbox, gpointer data);
+
+/* removes all items from the inbox and returns them as a list that the
+ * caller owns and should free with g_slist_free. returns NULL if empty. */
+GSList* mpscinbox_takeAll(MPSCInbox* inbox);
+
+#endif /* SHD_MPSC_INBOX_H_ */
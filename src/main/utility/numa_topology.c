@@ -0,0 +1,169 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include "main/utility/numa_topology.h"
+
+#include <glib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+
+#include "main/utility/utility.h"
+
+#define NUMA_TOPOLOGY_SYSFS_NODES "/sys/devices/system/node"
+
+typedef struct _NumaTopologyNode NumaTopologyNode;
+struct _NumaTopologyNode {
+    /* the system's id of the node, which need not be contiguous */
+    guint sysID;
+    cpu_set_t cpus;
+};
+
+struct _NumaTopology {
+    /* NumaTopologyNode entries, sorted by sysID */
+    GArray* nodes;
+    /* for each CPU index, the index of its node and its system CPU id */
+    GArray* cpuNodes;
+    GArray* cpuIDs;
+};
+
+/* parses a sysfs CPU list like "0-3,8,10-11" into set, keeping only allowed CPUs */
+static void _numatopology_parseCPUList(const gchar* list, const cpu_set_t* allowed, cpu_set_t* set) {
+    gchar** ranges = g_strsplit(g_strstrip((gchar*)list), ",", -1);
+
+    for(gint i = 0; ranges[i] != NULL; i++) {
+        if(ranges[i][0] == '\0') {
+            continue;
+        }
+
+        gchar* end = NULL;
+        glong first = strtol(ranges[i], &end, 10);
+        glong last = first;
+        if(end && *end == '-') {
+            last = strtol(end + 1, NULL, 10);
+        }
+
+        for(glong cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+            if(cpu >= 0 && CPU_ISSET((gint)cpu, allowed)) {
+                CPU_SET((gint)cpu, set);
+            }
+        }
+    }
+
+    g_strfreev(ranges);
+}
+
+static gint _numatopology_compareNodes(gconstpointer a, gconstpointer b) {
+    const NumaTopologyNode* na = a;
+    const NumaTopologyNode* nb = b;
+    return (na->sysID > nb->sysID) ? 1 : ((na->sysID < nb->sysID) ? -1 : 0);
+}
+
+static void _numatopology_readNodes(NumaTopology* topology, const cpu_set_t* allowed) {
+    GDir* dir = g_dir_open(NUMA_TOPOLOGY_SYSFS_NODES, 0, NULL);
+    if(dir == NULL) {
+        return;
+    }
+
+    const gchar* name = NULL;
+    while((name = g_dir_read_name(dir)) != NULL) {
+        if(!g_str_has_prefix(name, "node") || !g_ascii_isdigit(name[4])) {
+            continue;
+        }
+
+        gchar* path = g_strdup_printf("%s/%s/cpulist", NUMA_TOPOLOGY_SYSFS_NODES, name);
+        gchar* contents = NULL;
+        if(g_file_get_contents(path, &contents, NULL, NULL)) {
+            NumaTopologyNode node;
+            node.sysID = (guint)atoi(&name[4]);
+            CPU_ZERO(&node.cpus);
+            _numatopology_parseCPUList(contents, allowed, &node.cpus);
+
+            /* memory-only nodes have no CPUs we could run workers on */
+            if(CPU_COUNT(&node.cpus) > 0) {
+                g_array_append_val(topology->nodes, node);
+            }
+            g_free(contents);
+        }
+        g_free(path);
+    }
+
+    g_dir_close(dir);
+    g_array_sort(topology->nodes, _numatopology_compareNodes);
+}
+
+NumaTopology* numatopology_new() {
+    NumaTopology* topology = g_new0(NumaTopology, 1);
+    topology->nodes = g_array_new(FALSE, FALSE, sizeof(NumaTopologyNode));
+    topology->cpuNodes = g_array_new(FALSE, FALSE, sizeof(guint));
+    topology->cpuIDs = g_array_new(FALSE, FALSE, sizeof(gint));
+
+    /* we can only pin to CPUs that we are allowed to run on */
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if(sched_getaffinity(0, sizeof(cpu_set_t), &allowed) != 0) {
+        for(gint cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            CPU_SET(cpu, &allowed);
+        }
+    }
+
+    _numatopology_readNodes(topology, &allowed);
+
+    if(topology->nodes->len == 0) {
+        /* no NUMA information, so everything is one node */
+        NumaTopologyNode node;
+        node.sysID = 0;
+        node.cpus = allowed;
+        g_array_append_val(topology->nodes, node);
+    }
+
+    for(guint i = 0; i < topology->nodes->len; i++) {
+        NumaTopologyNode* node = &g_array_index(topology->nodes, NumaTopologyNode, i);
+        for(gint cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if(CPU_ISSET(cpu, &node->cpus)) {
+                g_array_append_val(topology->cpuNodes, i);
+                g_array_append_val(topology->cpuIDs, cpu);
+            }
+        }
+    }
+
+    return topology;
+}
+
+void numatopology_free(NumaTopology* topology) {
+    utility_assert(topology);
+    g_array_free(topology->nodes, TRUE);
+    g_array_free(topology->cpuNodes, TRUE);
+    g_array_free(topology->cpuIDs, TRUE);
+    g_free(topology);
+}
+
+guint numatopology_getNumNodes(NumaTopology* topology) {
+    utility_assert(topology);
+    return topology->nodes->len;
+}
+
+guint numatopology_getNumCPUs(NumaTopology* topology) {
+    utility_assert(topology);
+    return topology->cpuIDs->len;
+}
+
+guint numatopology_getNodeOfIndex(NumaTopology* topology, guint cpuIndex) {
+    utility_assert(topology);
+    utility_assert(cpuIndex < topology->cpuNodes->len);
+    return g_array_index(topology->cpuNodes, guint, cpuIndex);
+}
+
+gint numatopology_getCPUOfIndex(NumaTopology* topology, guint cpuIndex) {
+    utility_assert(topology);
+    utility_assert(cpuIndex < topology->cpuIDs->len);
+    return g_array_index(topology->cpuIDs, gint, cpuIndex);
+}
+
+const cpu_set_t* numatopology_getNodeCPUSet(NumaTopology* topology, guint node) {
+    utility_assert(topology);
+    utility_assert(node < topology->nodes->len);
+    return &(g_array_index(topology->nodes, NumaTopologyNode, node).cpus);
+}
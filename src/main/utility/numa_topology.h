@@ -0,0 +1,32 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#ifndef SHD_NUMA_TOPOLOGY_H_
+#define SHD_NUMA_TOPOLOGY_H_
+
+#include <glib.h>
+#include <sched.h>
+
+/* The NUMA nodes of the machine we run on and the CPUs that belong to each of them,
+ * as reported by sysfs. If the machine does not report any nodes, all CPUs that
+ * we are allowed to run on are treated as a single node. */
+typedef struct _NumaTopology NumaTopology;
+
+NumaTopology* numatopology_new();
+void numatopology_free(NumaTopology* topology);
+
+guint numatopology_getNumNodes(NumaTopology* topology);
+/* the total number of CPUs over all nodes */
+guint numatopology_getNumCPUs(NumaTopology* topology);
+
+/* numbers all CPUs so that the CPUs of each node are contiguous, in the order of the
+ * nodes, and returns the node and the system CPU id of the CPU with the given index */
+guint numatopology_getNodeOfIndex(NumaTopology* topology, guint cpuIndex);
+gint numatopology_getCPUOfIndex(NumaTopology* topology, guint cpuIndex);
+
+/* returns a CPU set with all CPUs of the node, for use with the affinity functions */
+const cpu_set_t* numatopology_getNodeCPUSet(NumaTopology* topology, guint node);
+
+#endif /* SHD_NUMA_TOPOLOGY_H_ */
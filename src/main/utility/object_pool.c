@@ -0,0 +1,217 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include "main/utility/object_pool.h"
+
+#include <glib.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "main/utility/utility.h"
+
+/* the target size of each slab of objects */
+#define OBJECT_POOL_SLAB_BYTES 65536
+/* how many objects we collect for another pool before handing them back */
+#define OBJECT_POOL_BATCH_LENGTH 64
+#define OBJECT_POOL_ALIGNMENT 16
+
+/* precedes every object handed out by the pool */
+typedef struct _ObjectPoolHeader ObjectPoolHeader;
+struct _ObjectPoolHeader {
+    /* the pool whose slab holds this object, or NULL if it is on the heap */
+    ObjectPool* owner;
+    /* links released objects into free lists */
+    ObjectPoolHeader* next;
+} __attribute__((aligned(OBJECT_POOL_ALIGNMENT)));
+
+/* objects released by this pool's thread that belong to another pool */
+typedef struct _ObjectPoolBatch ObjectPoolBatch;
+struct _ObjectPoolBatch {
+    ObjectPoolHeader* head;
+    ObjectPoolHeader* tail;
+    guint length;
+};
+
+struct _ObjectPool {
+    gsize objectSize;
+    /* the distance between consecutive objects in a slab, including the header */
+    gsize stride;
+    guint objectsPerSlab;
+
+    /* all slabs we allocated, and the unused space in the newest one */
+    GSList* slabs;
+    guchar* slabCursor;
+    guint slabRemaining;
+
+    /* objects released by the owner, only touched by the owner */
+    ObjectPoolHeader* freeList;
+    /* objects released by other threads; they push whole batches with a CAS, and
+     * the owner takes everything at once when its own free list runs out */
+    ObjectPoolHeader* remoteFreeList;
+
+    /* maps the owning ObjectPool* to the ObjectPoolBatch we are collecting for it */
+    GHashTable* pendingBatches;
+
+    guint64 numInUse;
+    ObjectPoolStats stats;
+};
+
+ObjectPool* objectpool_new(gsize objectSize) {
+    utility_assert(objectSize > 0);
+
+    ObjectPool* pool = g_new0(ObjectPool, 1);
+
+    pool->objectSize = objectSize;
+    gsize unaligned = sizeof(ObjectPoolHeader) + objectSize;
+    pool->stride = ((unaligned + OBJECT_POOL_ALIGNMENT - 1) / OBJECT_POOL_ALIGNMENT) * OBJECT_POOL_ALIGNMENT;
+    pool->objectsPerSlab = (guint) MAX(1, OBJECT_POOL_SLAB_BYTES / pool->stride);
+    pool->pendingBatches = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+
+    return pool;
+}
+
+void objectpool_free(ObjectPool* pool) {
+    utility_assert(pool);
+
+    /* batched objects live in other pools' slabs, which are freed along with those pools */
+    g_hash_table_destroy(pool->pendingBatches);
+    g_slist_free_full(pool->slabs, g_free);
+    g_free(pool);
+}
+
+static void _objectpool_pushRemote(ObjectPool* owner, ObjectPoolHeader* head, ObjectPoolHeader* tail) {
+    do {
+        tail->next = g_atomic_pointer_get(&owner->remoteFreeList);
+    } while(!g_atomic_pointer_compare_and_exchange(&owner->remoteFreeList, tail->next, head));
+}
+
+static void _objectpool_takeRemote(ObjectPool* pool) {
+    ObjectPoolHeader* head = NULL;
+    do {
+        head = g_atomic_pointer_get(&pool->remoteFreeList);
+        if(head == NULL) {
+            return;
+        }
+    } while(!g_atomic_pointer_compare_and_exchange(&pool->remoteFreeList, head, NULL));
+
+    /* the owner's free list is empty whenever we get here, so just find the end */
+    ObjectPoolHeader* tail = head;
+    guint64 numTaken = 1;
+    while(tail->next != NULL) {
+        tail = tail->next;
+        numTaken++;
+    }
+
+    tail->next = pool->freeList;
+    pool->freeList = head;
+    pool->numInUse -= MIN(numTaken, pool->numInUse);
+}
+
+static ObjectPoolHeader* _objectpool_carve(ObjectPool* pool) {
+    if(pool->slabRemaining == 0) {
+        gsize slabBytes = pool->stride * pool->objectsPerSlab;
+        guchar* slab = g_malloc(slabBytes);
+        pool->slabs = g_slist_prepend(pool->slabs, slab);
+        pool->slabCursor = slab;
+        pool->slabRemaining = pool->objectsPerSlab;
+        pool->stats.bytesRetained += slabBytes;
+    }
+
+    ObjectPoolHeader* header = (ObjectPoolHeader*) pool->slabCursor;
+    pool->slabCursor += pool->stride;
+    pool->slabRemaining--;
+    return header;
+}
+
+gpointer objectpool_alloc(ObjectPool* pool) {
+    utility_assert(pool);
+
+    if(pool->freeList == NULL) {
+        _objectpool_takeRemote(pool);
+    }
+
+    ObjectPoolHeader* header = NULL;
+    if(pool->freeList != NULL) {
+        header = pool->freeList;
+        pool->freeList = header->next;
+        pool->stats.hits++;
+    } else {
+        header = _objectpool_carve(pool);
+        pool->stats.misses++;
+    }
+
+    header->owner = pool;
+    header->next = NULL;
+
+    pool->numInUse++;
+    pool->stats.highWater = MAX(pool->stats.highWater, pool->numInUse);
+
+    gpointer object = header + 1;
+    memset(object, 0, pool->objectSize);
+    return object;
+}
+
+gpointer objectpool_allocUnpooled(gsize objectSize) {
+    ObjectPoolHeader* header = g_malloc0(sizeof(ObjectPoolHeader) + objectSize);
+    return header + 1;
+}
+
+void objectpool_release(ObjectPool* callerPool, gpointer object) {
+    if(object == NULL) {
+        return;
+    }
+
+    ObjectPoolHeader* header = ((ObjectPoolHeader*) object) - 1;
+    ObjectPool* owner = header->owner;
+
+    if(owner == NULL) {
+        g_free(header);
+    } else if(owner == callerPool) {
+        header->next = callerPool->freeList;
+        callerPool->freeList = header;
+        callerPool->numInUse--;
+    } else if(callerPool == NULL) {
+        _objectpool_pushRemote(owner, header, header);
+    } else {
+        ObjectPoolBatch* batch = g_hash_table_lookup(callerPool->pendingBatches, owner);
+        if(batch == NULL) {
+            batch = g_new0(ObjectPoolBatch, 1);
+            g_hash_table_insert(callerPool->pendingBatches, owner, batch);
+        }
+
+        header->next = batch->head;
+        batch->head = header;
+        if(batch->tail == NULL) {
+            batch->tail = header;
+        }
+        batch->length++;
+
+        if(batch->length >= OBJECT_POOL_BATCH_LENGTH) {
+            _objectpool_pushRemote(owner, batch->head, batch->tail);
+            memset(batch, 0, sizeof(ObjectPoolBatch));
+        }
+    }
+}
+
+void objectpool_flush(ObjectPool* pool) {
+    utility_assert(pool);
+
+    GHashTableIter iter;
+    gpointer key = NULL, value = NULL;
+    g_hash_table_iter_init(&iter, pool->pendingBatches);
+    while(g_hash_table_iter_next(&iter, &key, &value)) {
+        ObjectPool* owner = key;
+        ObjectPoolBatch* batch = value;
+        if(batch->length > 0) {
+            _objectpool_pushRemote(owner, batch->head, batch->tail);
+            memset(batch, 0, sizeof(ObjectPoolBatch));
+        }
+    }
+}
+
+void objectpool_getStats(ObjectPool* pool, ObjectPoolStats* stats) {
+    utility_assert(pool && stats);
+    *stats = pool->stats;
+}
@@ -0,0 +1,51 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#ifndef SHD_OBJECT_POOL_H_
+#define SHD_OBJECT_POOL_H_
+
+#include <glib.h>
+
+/* A slab allocator for objects of one fixed size, owned by a single thread.
+ * Only the owning thread may allocate from a pool. Any thread may release an
+ * object: releases by the owner go straight back onto the pool's free list, while
+ * releases by other threads are collected in the releasing pool and handed back
+ * to the owner in batches without taking a lock. Slabs are only returned to the
+ * system when the pool is freed, so all pools that may hold each other's objects
+ * should be freed together, after the last object was released. */
+typedef struct _ObjectPool ObjectPool;
+
+typedef struct _ObjectPoolStats ObjectPoolStats;
+struct _ObjectPoolStats {
+    /* allocations served by recycling a released object */
+    guint64 hits;
+    /* allocations that needed fresh slab memory */
+    guint64 misses;
+    /* the largest number of objects allocated at once; objects released by
+     * other threads are only subtracted once the owner takes them back */
+    guint64 highWater;
+    /* the number of slab bytes held by the pool */
+    guint64 bytesRetained;
+};
+
+ObjectPool* objectpool_new(gsize objectSize);
+void objectpool_free(ObjectPool* pool);
+
+/* returns a zeroed object of the pool's object size */
+gpointer objectpool_alloc(ObjectPool* pool);
+/* returns a zeroed object from the heap, for threads that do not have a pool.
+ * it must still be released with objectpool_release. */
+gpointer objectpool_allocUnpooled(gsize objectSize);
+
+/* returns object to the pool it came from. callerPool is the releasing thread's
+ * own pool for this object size, or NULL if it does not have one. */
+void objectpool_release(ObjectPool* callerPool, gpointer object);
+
+/* hands all batched releases back to their owners */
+void objectpool_flush(ObjectPool* pool);
+
+void objectpool_getStats(ObjectPool* pool, ObjectPoolStats* stats);
+
+#endif /* SHD_OBJECT_POOL_H_ */
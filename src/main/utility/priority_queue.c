@@ -173,3 +173,34 @@ gpointer priorityqueue_pop(PriorityQueue *q) {
     }
     return NULL;
 }
+
+gsize priorityqueue_removeIf(PriorityQueue *q, PriorityQueuePredicateFunc predicate, gpointer userData) {
+    utility_assert(q && predicate);
+
+    /* compact the kept entries to the front */
+    gsize kept = 0;
+    for (gsize i = 0; i < q->size; i++) {
+        if (!predicate(q->heap[i], userData)) {
+            q->heap[kept++] = q->heap[i];
+        }
+    }
+
+    gsize numRemoved = q->size - kept;
+    if (numRemoved == 0) {
+        return 0;
+    }
+    q->size = kept;
+
+    while ((q->heapSize > INITIAL_SIZE) && (q->size * 4 < q->heapSize)) {
+        q->heapSize /= 2;
+    }
+    q->heap = g_renew(gpointer, q->heap, q->heapSize);
+    _priorityqueue_refresh_map(q);
+
+    /* restore the heap property bottom-up, starting at the last parent */
+    for (gsize index = q->size / 2; index > 0; index--) {
+        _priorityqueue_heapify_down(q, index - 1);
+    }
+
+    return numRemoved;
+}
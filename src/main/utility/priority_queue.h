@@ -11,6 +11,9 @@
 
 typedef struct _PriorityQueue PriorityQueue;
 
+/* returns TRUE if data should be removed by priorityqueue_removeIf */
+typedef gboolean (*PriorityQueuePredicateFunc)(gpointer data, gpointer userData);
+
 PriorityQueue* priorityqueue_new(GCompareDataFunc compareFunc,
         gpointer compareData, GDestroyNotify freeFunc);
 void priorityqueue_clear(PriorityQueue *q);
@@ -22,5 +25,8 @@ gboolean priorityqueue_push(PriorityQueue *q, gpointer data);
 gpointer priorityqueue_peek(PriorityQueue *q);
 gpointer priorityqueue_find(PriorityQueue *q, gpointer data);
 gpointer priorityqueue_pop(PriorityQueue *q);
+/* removes every entry for which predicate returns TRUE, without calling the free
+ * function, and returns how many were removed; linear in the queue length */
+gsize priorityqueue_removeIf(PriorityQueue *q, PriorityQueuePredicateFunc predicate, gpointer userData);
 
 #endif /* SHD_PRIORITY_QUEUE_H */
@@ -0,0 +1,187 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include "main/utility/rcu_hash_table.h"
+
+#include <glib.h>
+#include <stddef.h>
+
+#include "main/utility/utility.h"
+
+#define RCU_HASH_TABLE_INITIAL_CAPACITY 16
+
+typedef enum _RCUSlotState RCUSlotState;
+enum _RCUSlotState {
+    RCU_SLOT_EMPTY = 0,
+    RCU_SLOT_STORED = 1,
+    RCU_SLOT_REMOVED = 2,
+};
+
+typedef struct _RCUSlot RCUSlot;
+struct _RCUSlot {
+    /* written once before the state first leaves RCU_SLOT_EMPTY */
+    guint key;
+    /* an RCUSlotState; readers read it before the value */
+    gint state;
+    gpointer value;
+};
+
+typedef struct _RCUSlotArray RCUSlotArray;
+struct _RCUSlotArray {
+    /* a power of 2 */
+    guint capacity;
+    RCUSlot slots[];
+};
+
+struct _RCUHashTable {
+    /* the published slots that readers load */
+    RCUSlotArray* current;
+    /* the arrays that current replaced, which readers may still hold */
+    GSList* retired;
+
+    /* slots that are stored or removed, which count toward the load */
+    guint numUsed;
+    guint numStored;
+
+    GDestroyNotify valueDestroyFunc;
+    MAGIC_DECLARE;
+};
+
+static RCUSlotArray* _rcuhashtable_newArray(guint capacity) {
+    RCUSlotArray* array = g_malloc0(sizeof(RCUSlotArray) + capacity * sizeof(RCUSlot));
+    array->capacity = capacity;
+    return array;
+}
+
+static inline guint _rcuhashtable_hash(guint key, guint capacity) {
+    /* fibonacci hashing spreads consecutive keys like vertex indices */
+    return (key * 2654435761u) & (capacity - 1);
+}
+
+/* returns the slot that holds the key, or the empty slot where it belongs */
+static RCUSlot* _rcuhashtable_findSlot(RCUSlotArray* array, guint key) {
+    guint i = _rcuhashtable_hash(key, array->capacity);
+    while(TRUE) {
+        RCUSlot* slot = &array->slots[i];
+        if(g_atomic_int_get(&slot->state) == RCU_SLOT_EMPTY || slot->key == key) {
+            return slot;
+        }
+        i = (i + 1) & (array->capacity - 1);
+    }
+}
+
+static void _rcuhashtable_grow(RCUHashTable* table) {
+    RCUSlotArray* old = table->current;
+    RCUSlotArray* array = _rcuhashtable_newArray(old->capacity * 2);
+
+    /* removed keys are dropped from the copy, they only needed to hold their place */
+    table->numUsed = 0;
+    for(guint i = 0; i < old->capacity; i++) {
+        RCUSlot* oldSlot = &old->slots[i];
+        if(oldSlot->state == RCU_SLOT_STORED) {
+            RCUSlot* slot = _rcuhashtable_findSlot(array, oldSlot->key);
+            slot->key = oldSlot->key;
+            slot->value = oldSlot->value;
+            slot->state = RCU_SLOT_STORED;
+            table->numUsed++;
+        }
+    }
+
+    /* the array is complete before readers can see it */
+    g_atomic_pointer_set(&table->current, array);
+    table->retired = g_slist_prepend(table->retired, old);
+}
+
+RCUHashTable* rcuhashtable_new(GDestroyNotify valueDestroyFunc) {
+    RCUHashTable* table = g_new0(RCUHashTable, 1);
+    MAGIC_INIT(table);
+    table->current = _rcuhashtable_newArray(RCU_HASH_TABLE_INITIAL_CAPACITY);
+    table->valueDestroyFunc = valueDestroyFunc;
+    return table;
+}
+
+void rcuhashtable_free(RCUHashTable* table) {
+    MAGIC_ASSERT(table);
+
+    RCUSlotArray* array = table->current;
+    if(table->valueDestroyFunc) {
+        for(guint i = 0; i < array->capacity; i++) {
+            if(array->slots[i].state == RCU_SLOT_STORED) {
+                table->valueDestroyFunc(array->slots[i].value);
+            }
+        }
+    }
+
+    g_free(array);
+    g_slist_free_full(table->retired, g_free);
+
+    MAGIC_CLEAR(table);
+    g_free(table);
+}
+
+guint rcuhashtable_getLength(RCUHashTable* table) {
+    MAGIC_ASSERT(table);
+    return table->numStored;
+}
+
+gboolean rcuhashtable_lookup(RCUHashTable* table, guint key, gpointer* valueOut) {
+    MAGIC_ASSERT(table);
+
+    RCUSlotArray* array = g_atomic_pointer_get(&table->current);
+    RCUSlot* slot = _rcuhashtable_findSlot(array, key);
+
+    if(g_atomic_int_get(&slot->state) != RCU_SLOT_STORED) {
+        return FALSE;
+    }
+    if(valueOut) {
+        *valueOut = g_atomic_pointer_get(&slot->value);
+    }
+    return TRUE;
+}
+
+void rcuhashtable_replace(RCUHashTable* table, guint key, gpointer value) {
+    MAGIC_ASSERT(table);
+
+    /* keep the load under a half so that probes stay short */
+    if((table->numUsed + 1) * 2 > table->current->capacity) {
+        _rcuhashtable_grow(table);
+    }
+
+    RCUSlot* slot = _rcuhashtable_findSlot(table->current, key);
+
+    if(slot->state == RCU_SLOT_EMPTY) {
+        slot->key = key;
+        table->numUsed++;
+    }
+    if(slot->state != RCU_SLOT_STORED) {
+        table->numStored++;
+    }
+
+    /* the value must be visible before the state that says it is there */
+    g_atomic_pointer_set(&slot->value, value);
+    g_atomic_int_set(&slot->state, RCU_SLOT_STORED);
+}
+
+void rcuhashtable_remove(RCUHashTable* table, guint key) {
+    MAGIC_ASSERT(table);
+
+    RCUSlot* slot = _rcuhashtable_findSlot(table->current, key);
+    if(slot->state == RCU_SLOT_STORED) {
+        g_atomic_int_set(&slot->state, RCU_SLOT_REMOVED);
+        table->numStored--;
+    }
+}
+
+void rcuhashtable_foreach(RCUHashTable* table, GHFunc func, gpointer userData) {
+    MAGIC_ASSERT(table);
+    utility_assert(func);
+
+    RCUSlotArray* array = table->current;
+    for(guint i = 0; i < array->capacity; i++) {
+        if(array->slots[i].state == RCU_SLOT_STORED) {
+            func(GUINT_TO_POINTER(array->slots[i].key), array->slots[i].value, userData);
+        }
+    }
+}
@@ -0,0 +1,42 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#ifndef SHD_RCU_HASH_TABLE_H_
+#define SHD_RCU_HASH_TABLE_H_
+
+#include <glib.h>
+
+/* A hash table from integer keys to pointers that any number of threads may read
+ * without taking a lock, while writers serialize among themselves with a lock of
+ * their own. Writers publish each entry with an atomic store after filling it in,
+ * and grow the table by copying it into a larger one and publishing that, like
+ * read-copy-update. Readers that still hold an old copy see the entries that
+ * existed when it was replaced. The old copies are kept until the table is freed;
+ * since each one is half the size of the next, they never take more memory than
+ * the current one. Removed keys keep their slot, so the table suits maps that
+ * rarely remove anything. */
+typedef struct _RCUHashTable RCUHashTable;
+
+RCUHashTable* rcuhashtable_new(GDestroyNotify valueDestroyFunc);
+/* calls the destroy function on all values that are still stored */
+void rcuhashtable_free(RCUHashTable* table);
+
+/* the number of stored values */
+guint rcuhashtable_getLength(RCUHashTable* table);
+
+/* safe to call from any thread at any time. returns TRUE and sets valueOut if the
+ * key is stored. */
+gboolean rcuhashtable_lookup(RCUHashTable* table, guint key, gpointer* valueOut);
+
+/* the callers of these functions must hold the same lock. replacing or removing a
+ * value does not call the destroy function on the old one, since readers may
+ * still be using it. */
+void rcuhashtable_replace(RCUHashTable* table, guint key, gpointer value);
+void rcuhashtable_remove(RCUHashTable* table, guint key);
+
+/* calls func on every stored value, from the thread that writes the table */
+void rcuhashtable_foreach(RCUHashTable* table, GHFunc func, gpointer userData);
+
+#endif /* SHD_RCU_HASH_TABLE_H_ */
@@ -0,0 +1,247 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include "main/utility/round_barrier.h"
+
+#include <glib.h>
+#include <linux/futex.h>
+#include <stddef.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "main/utility/utility.h"
+
+/* the number of children that arrive at each node of the combining tree */
+#define ROUND_BARRIER_FANIN 4
+/* how many times a waiter checks the sense flag before it sleeps on the futex */
+#define ROUND_BARRIER_SPIN_COUNT 4096
+/* wait times are bucketed by powers of two nanoseconds, the last bucket is open-ended */
+#define ROUND_BARRIER_HISTOGRAM_BUCKETS 32
+
+typedef struct _RoundBarrierNode RoundBarrierNode;
+struct _RoundBarrierNode {
+    /* children that did not arrive yet in this round */
+    volatile gint remaining;
+    gint numChildren;
+    /* the minimum value contributed by the children that arrived */
+    volatile guint64 minValue;
+    RoundBarrierNode* parent;
+} __attribute__((aligned(64)));
+
+typedef struct _RoundBarrierParticipant RoundBarrierParticipant;
+struct _RoundBarrierParticipant {
+    /* the sense value that marks the end of this participant's current round */
+    gint localSense;
+    guint64 waitHistogram[ROUND_BARRIER_HISTOGRAM_BUCKETS];
+    guint64 numSleeps;
+} __attribute__((aligned(64)));
+
+struct _RoundBarrier {
+    guint nParticipants;
+
+    /* leaves come first, participant i arrives at leaf i / ROUND_BARRIER_FANIN */
+    RoundBarrierNode* nodes;
+    guint numNodes;
+
+    RoundBarrierParticipant* participants;
+
+    /* flipped by the last arrival of every round; waiters sleep on it as a futex */
+    volatile gint globalSense __attribute__((aligned(64)));
+    volatile gint numSleepers;
+    /* the minimum of the round that was just released */
+    volatile guint64 result;
+};
+
+static guint _roundbarrier_numParents(guint numChildren) {
+    return (numChildren + ROUND_BARRIER_FANIN - 1) / ROUND_BARRIER_FANIN;
+}
+
+RoundBarrier* roundbarrier_new(guint nParticipants) {
+    utility_assert(nParticipants > 0);
+
+    RoundBarrier* barrier = g_new0(RoundBarrier, 1);
+    barrier->nParticipants = nParticipants;
+    barrier->participants = g_new0(RoundBarrierParticipant, nParticipants);
+
+    /* count the nodes in all levels of the tree */
+    barrier->numNodes = 0;
+    guint levelWidth = nParticipants;
+    do {
+        levelWidth = _roundbarrier_numParents(levelWidth);
+        barrier->numNodes += levelWidth;
+    } while(levelWidth > 1);
+
+    barrier->nodes = g_new0(RoundBarrierNode, barrier->numNodes);
+
+    /* link each level to the next one up */
+    guint levelStart = 0;
+    guint numChildren = nParticipants;
+    levelWidth = _roundbarrier_numParents(numChildren);
+    while(TRUE) {
+        for(guint i = 0; i < levelWidth; i++) {
+            RoundBarrierNode* node = &barrier->nodes[levelStart + i];
+            guint firstChild = i * ROUND_BARRIER_FANIN;
+            node->numChildren = (gint)MIN(ROUND_BARRIER_FANIN, numChildren - firstChild);
+            node->remaining = node->numChildren;
+            node->minValue = G_MAXUINT64;
+        }
+
+        if(levelWidth == 1) {
+            break;
+        }
+
+        guint parentStart = levelStart + levelWidth;
+        for(guint i = 0; i < levelWidth; i++) {
+            barrier->nodes[levelStart + i].parent = &barrier->nodes[parentStart + (i / ROUND_BARRIER_FANIN)];
+        }
+
+        levelStart = parentStart;
+        numChildren = levelWidth;
+        levelWidth = _roundbarrier_numParents(numChildren);
+    }
+
+    return barrier;
+}
+
+void roundbarrier_free(RoundBarrier* barrier) {
+    utility_assert(barrier);
+    g_free(barrier->nodes);
+    g_free(barrier->participants);
+    g_free(barrier);
+}
+
+static void _roundbarrier_foldMin(volatile guint64* target, guint64 value) {
+    guint64 current = 0;
+    do {
+        current = __atomic_load_n(target, __ATOMIC_ACQUIRE);
+        if(value >= current) {
+            return;
+        }
+    } while(!__atomic_compare_exchange_n(target, &current, value, FALSE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+}
+
+/* returns TRUE if the caller was the last arrival at the root */
+static gboolean _roundbarrier_arrive(RoundBarrier* barrier, RoundBarrierNode* node, guint64 value) {
+    while(node != NULL) {
+        _roundbarrier_foldMin(&node->minValue, value);
+
+        if(!g_atomic_int_dec_and_test(&node->remaining)) {
+            /* somebody else will carry this node's minimum up the tree */
+            return FALSE;
+        }
+
+        /* we are the last child; nobody touches this node again until the
+         * release, so we can reset it for the next round before moving up */
+        value = __atomic_load_n(&node->minValue, __ATOMIC_ACQUIRE);
+        node->minValue = G_MAXUINT64;
+        g_atomic_int_set(&node->remaining, node->numChildren);
+        node = node->parent;
+    }
+
+    barrier->result = value;
+    return TRUE;
+}
+
+static void _roundbarrier_release(RoundBarrier* barrier, gint newSense) {
+    g_atomic_int_set(&barrier->globalSense, newSense);
+    if(g_atomic_int_get(&barrier->numSleepers) > 0) {
+        syscall(SYS_futex, &barrier->globalSense, FUTEX_WAKE_PRIVATE, G_MAXINT, NULL, NULL, 0);
+    }
+}
+
+static gboolean _roundbarrier_wait(RoundBarrier* barrier, gint newSense) {
+    for(guint i = 0; i < ROUND_BARRIER_SPIN_COUNT; i++) {
+        if(g_atomic_int_get(&barrier->globalSense) == newSense) {
+            return FALSE;
+        }
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+
+    /* the releaser flips the sense before checking for sleepers, and the futex only
+     * sleeps while the sense is still the old one, so we can not miss the wakeup */
+    g_atomic_int_inc(&barrier->numSleepers);
+    while(g_atomic_int_get(&barrier->globalSense) != newSense) {
+        syscall(SYS_futex, &barrier->globalSense, FUTEX_WAIT_PRIVATE, !newSense, NULL, NULL, 0);
+    }
+    g_atomic_int_add(&barrier->numSleepers, -1);
+    return TRUE;
+}
+
+static guint64 _roundbarrier_now() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((guint64)now.tv_sec * G_GUINT64_CONSTANT(1000000000)) + (guint64)now.tv_nsec;
+}
+
+static guint _roundbarrier_getBucket(guint64 nanos) {
+    guint bucket = 0;
+    while(nanos > 1 && bucket < ROUND_BARRIER_HISTOGRAM_BUCKETS - 1) {
+        nanos >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+guint64 roundbarrier_await(RoundBarrier* barrier, guint participantID, guint64 value) {
+    utility_assert(barrier);
+    utility_assert(participantID < barrier->nParticipants);
+
+    RoundBarrierParticipant* participant = &barrier->participants[participantID];
+    participant->localSense = !participant->localSense;
+    gint newSense = participant->localSense;
+
+    guint64 start = _roundbarrier_now();
+
+    RoundBarrierNode* leaf = &barrier->nodes[participantID / ROUND_BARRIER_FANIN];
+    if(_roundbarrier_arrive(barrier, leaf, value)) {
+        _roundbarrier_release(barrier, newSense);
+    } else if(_roundbarrier_wait(barrier, newSense)) {
+        participant->numSleeps++;
+    }
+
+    guint64 waited = _roundbarrier_now() - start;
+    participant->waitHistogram[_roundbarrier_getBucket(waited)]++;
+
+    return barrier->result;
+}
+
+gchar* roundbarrier_waitHistogramToString(RoundBarrier* barrier) {
+    utility_assert(barrier);
+
+    guint64 histogram[ROUND_BARRIER_HISTOGRAM_BUCKETS] = {0};
+    guint64 numWaits = 0, numSleeps = 0;
+
+    for(guint i = 0; i < barrier->nParticipants; i++) {
+        RoundBarrierParticipant* participant = &barrier->participants[i];
+        for(guint j = 0; j < ROUND_BARRIER_HISTOGRAM_BUCKETS; j++) {
+            histogram[j] += participant->waitHistogram[j];
+            numWaits += participant->waitHistogram[j];
+        }
+        numSleeps += participant->numSleeps;
+    }
+
+    GString* string = g_string_new(NULL);
+    g_string_printf(string, "%"G_GUINT64_FORMAT" waits, %"G_GUINT64_FORMAT" slept on futex;",
+            numWaits, numSleeps);
+
+    for(guint j = 0; j < ROUND_BARRIER_HISTOGRAM_BUCKETS; j++) {
+        if(histogram[j] == 0) {
+            continue;
+        }
+        if(j < ROUND_BARRIER_HISTOGRAM_BUCKETS - 1) {
+            /* bucket j holds waits of less than 2^(j+1) nanoseconds */
+            g_string_append_printf(string, " <%"G_GUINT64_FORMAT"ns=%"G_GUINT64_FORMAT,
+                    G_GUINT64_CONSTANT(1) << (j + 1), histogram[j]);
+        } else {
+            g_string_append_printf(string, " >=%"G_GUINT64_FORMAT"ns=%"G_GUINT64_FORMAT,
+                    G_GUINT64_CONSTANT(1) << j, histogram[j]);
+        }
+    }
+
+    return g_string_free(string, FALSE);
+}
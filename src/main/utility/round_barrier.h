@@ -0,0 +1,35 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#ifndef SHD_ROUND_BARRIER_H_
+#define SHD_ROUND_BARRIER_H_
+
+#include <glib.h>
+
+/* A reusable barrier for a fixed set of participants that meet over and over,
+ * e.g. once per scheduling round. Participants arrive through a combining tree so
+ * that no single counter is contended by all threads, and the last arrival
+ * releases everyone by reversing a shared sense flag. Waiters spin for a short
+ * while before sleeping on a futex, so short waits never enter the kernel.
+ *
+ * Each arrival also contributes a value, and every participant leaves with the
+ * minimum of the values contributed in that round.
+ *
+ * Unlike CountDownLatch, the barrier never needs to be reset between rounds. */
+typedef struct _RoundBarrier RoundBarrier;
+
+RoundBarrier* roundbarrier_new(guint nParticipants);
+void roundbarrier_free(RoundBarrier* barrier);
+
+/* blocks until all participants arrived. participantID must be unique among the
+ * participants and less than nParticipants. returns the minimum value that was
+ * passed in by any participant in this round. */
+guint64 roundbarrier_await(RoundBarrier* barrier, guint participantID, guint64 value);
+
+/* returns a newly allocated string describing how long participants waited in
+ * each round, bucketed by powers of two; the caller should g_free it. */
+gchar* roundbarrier_waitHistogramToString(RoundBarrier* barrier);
+
+#endif /* SHD_ROUND_BARRIER_H_ */
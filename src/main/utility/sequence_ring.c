@@ -0,0 +1,216 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include "main/utility/sequence_ring.h"
+
+#include <glib.h>
+
+#include "main/utility/utility.h"
+
+/* must be a power of 2 */
+#define SEQUENCE_RING_MIN_CAPACITY 16
+
+struct _SequenceRing {
+    /* a power of 2 number of slots; the value for sequence s is in slot s & (capacity-1) */
+    gpointer* slots;
+    guint capacity;
+    guint length;
+
+    /* all stored sequences are in [base, end), and end - base <= capacity */
+    guint32 base;
+    guint32 end;
+    /* no values are stored in [base, first) */
+    guint32 first;
+
+    GDestroyNotify valueDestroyFunc;
+
+    MAGIC_DECLARE;
+};
+
+static inline gpointer* _sequencering_getSlot(SequenceRing* ring, guint32 sequence) {
+    return &ring->slots[sequence & (ring->capacity - 1)];
+}
+
+static void _sequencering_resize(SequenceRing* ring, guint capacity) {
+    gpointer* oldSlots = ring->slots;
+    guint oldMask = ring->capacity - 1;
+
+    ring->slots = g_new0(gpointer, capacity);
+    ring->capacity = capacity;
+
+    if(ring->length > 0) {
+        for(guint32 sequence = ring->base; sequence < ring->end; sequence++) {
+            *_sequencering_getSlot(ring, sequence) = oldSlots[sequence & oldMask];
+        }
+    }
+
+    g_free(oldSlots);
+}
+
+static guint _sequencering_getCapacityFor(guint64 span) {
+    guint capacity = SEQUENCE_RING_MIN_CAPACITY;
+    while(capacity < span) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+SequenceRing* sequencering_new(guint32 base, GDestroyNotify valueDestroyFunc) {
+    SequenceRing* ring = g_new0(SequenceRing, 1);
+    MAGIC_INIT(ring);
+
+    ring->capacity = SEQUENCE_RING_MIN_CAPACITY;
+    ring->slots = g_new0(gpointer, ring->capacity);
+    ring->base = base;
+    ring->end = base;
+    ring->first = base;
+    ring->valueDestroyFunc = valueDestroyFunc;
+
+    return ring;
+}
+
+void sequencering_free(SequenceRing* ring) {
+    MAGIC_ASSERT(ring);
+
+    if(ring->valueDestroyFunc && ring->length > 0) {
+        for(guint32 sequence = ring->base; sequence < ring->end; sequence++) {
+            gpointer value = *_sequencering_getSlot(ring, sequence);
+            if(value != NULL) {
+                ring->valueDestroyFunc(value);
+            }
+        }
+    }
+
+    g_free(ring->slots);
+
+    MAGIC_CLEAR(ring);
+    g_free(ring);
+}
+
+guint sequencering_getLength(SequenceRing* ring) {
+    MAGIC_ASSERT(ring);
+    return ring->length;
+}
+
+guint32 sequencering_getBase(SequenceRing* ring) {
+    MAGIC_ASSERT(ring);
+    return ring->base;
+}
+
+guint32 sequencering_getEnd(SequenceRing* ring) {
+    MAGIC_ASSERT(ring);
+    return ring->end;
+}
+
+gsize sequencering_getAllocatedBytes(SequenceRing* ring) {
+    MAGIC_ASSERT(ring);
+    return sizeof(SequenceRing) + ring->capacity * sizeof(gpointer);
+}
+
+gboolean sequencering_insert(SequenceRing* ring, guint32 sequence, gpointer value) {
+    MAGIC_ASSERT(ring);
+    utility_assert(value != NULL);
+
+    if(sequence < ring->base) {
+        return FALSE;
+    }
+
+    guint64 span = ((guint64)sequence) - ring->base + 1;
+    if(span > ring->capacity) {
+        _sequencering_resize(ring, _sequencering_getCapacityFor(span));
+    }
+
+    gpointer* slot = _sequencering_getSlot(ring, sequence);
+    if(*slot != NULL) {
+        return FALSE;
+    }
+
+    *slot = value;
+    ring->length++;
+    if(sequence >= ring->end) {
+        ring->end = sequence + 1;
+    }
+    if(sequence < ring->first) {
+        ring->first = sequence;
+    }
+
+    return TRUE;
+}
+
+gpointer sequencering_get(SequenceRing* ring, guint32 sequence) {
+    MAGIC_ASSERT(ring);
+    if(sequence < ring->base || sequence >= ring->end) {
+        return NULL;
+    }
+    return *_sequencering_getSlot(ring, sequence);
+}
+
+gpointer sequencering_peekFirst(SequenceRing* ring) {
+    MAGIC_ASSERT(ring);
+
+    if(ring->length == 0) {
+        return NULL;
+    }
+
+    if(ring->first < ring->base) {
+        ring->first = ring->base;
+    }
+    while(*_sequencering_getSlot(ring, ring->first) == NULL) {
+        ring->first++;
+        utility_assert(ring->first < ring->end);
+    }
+
+    return *_sequencering_getSlot(ring, ring->first);
+}
+
+gpointer sequencering_steal(SequenceRing* ring, guint32 sequence) {
+    MAGIC_ASSERT(ring);
+    if(sequence < ring->base || sequence >= ring->end) {
+        return NULL;
+    }
+
+    gpointer* slot = _sequencering_getSlot(ring, sequence);
+    gpointer value = *slot;
+    if(value != NULL) {
+        *slot = NULL;
+        ring->length--;
+    }
+    return value;
+}
+
+gpointer sequencering_stealBelow(SequenceRing* ring, guint32 sequence) {
+    MAGIC_ASSERT(ring);
+
+    while(ring->length > 0 && ring->base < sequence) {
+        gpointer* slot = _sequencering_getSlot(ring, ring->base);
+        ring->base++;
+
+        gpointer value = *slot;
+        if(value != NULL) {
+            *slot = NULL;
+            ring->length--;
+            return value;
+        }
+    }
+
+    /* nothing is stored below the sequence anymore */
+    if(ring->base < sequence) {
+        ring->base = sequence;
+    }
+    if(ring->end < ring->base) {
+        ring->end = ring->base;
+    }
+    if(ring->first < ring->base) {
+        ring->first = ring->base;
+    }
+
+    /* give back the slots of a window that drained after a burst */
+    guint64 span = ((guint64)ring->end) - ring->base;
+    if(ring->capacity > SEQUENCE_RING_MIN_CAPACITY && span * 8 < ring->capacity) {
+        _sequencering_resize(ring, _sequencering_getCapacityFor(span * 2));
+    }
+
+    return NULL;
+}
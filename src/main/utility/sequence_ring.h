@@ -0,0 +1,53 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#ifndef SHD_SEQUENCE_RING_H_
+#define SHD_SEQUENCE_RING_H_
+
+#include <glib.h>
+
+/* Stores values by sequence number in a ring of slots indexed by the sequence
+ * modulo a power of 2 capacity, for windows of consecutive sequence numbers like
+ * the packets of a TCP connection. The window starts at the base sequence: values
+ * below it are rejected, and stealing values from the bottom moves the base up.
+ * The ring grows to fit the span between the base and the highest sequence
+ * inserted, so it is meant for spans that are about as large as the number of
+ * stored values. Sequence numbers are not expected to wrap around. Values must not
+ * be NULL, since NULL marks an empty slot. */
+typedef struct _SequenceRing SequenceRing;
+
+SequenceRing* sequencering_new(guint32 base, GDestroyNotify valueDestroyFunc);
+/* calls the destroy function on all values that are still stored */
+void sequencering_free(SequenceRing* ring);
+
+/* the number of stored values */
+guint sequencering_getLength(SequenceRing* ring);
+/* the lowest sequence number that may still be stored */
+guint32 sequencering_getBase(SequenceRing* ring);
+/* one past the highest sequence number that was ever stored, or the base if that is higher */
+guint32 sequencering_getEnd(SequenceRing* ring);
+/* the number of bytes allocated for slots */
+gsize sequencering_getAllocatedBytes(SequenceRing* ring);
+
+/* returns FALSE, and does not take the value, if the sequence is already stored or
+ * is below the base */
+gboolean sequencering_insert(SequenceRing* ring, guint32 sequence, gpointer value);
+/* returns the value stored for the sequence, or NULL */
+gpointer sequencering_get(SequenceRing* ring, guint32 sequence);
+/* returns the value with the lowest stored sequence number, or NULL if there is none.
+ * it scans forward from the previous lowest value, so draining the ring in order takes
+ * amortized constant time per value. */
+gpointer sequencering_peekFirst(SequenceRing* ring);
+/* removes the value stored for the sequence and returns it without calling the destroy
+ * function, or returns NULL */
+gpointer sequencering_steal(SequenceRing* ring, guint32 sequence);
+/* removes and returns the value with the lowest sequence number below the given one,
+ * and moves the base just past it. if there is no such value, moves the base up to the
+ * given sequence and returns NULL. so calling it until it returns NULL removes all
+ * values below the sequence, in time proportional to the removed values and the empty
+ * slots between them. */
+gpointer sequencering_stealBelow(SequenceRing* ring, guint32 sequence);
+
+#endif /* SHD_SEQUENCE_RING_H_ */
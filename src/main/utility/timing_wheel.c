@@ -0,0 +1,251 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include "main/utility/timing_wheel.h"
+
+#include <glib.h>
+#include <stddef.h>
+
+#include "main/utility/keyed_heap.h"
+#include "main/utility/utility.h"
+
+/* level 0 slots are 2^16 ns (about 65 microseconds) wide */
+#define TIMING_WHEEL_RESOLUTION_BITS 16
+/* each level has 64 slots, so that one bit per slot fits in a guint64 */
+#define TIMING_WHEEL_SLOT_BITS 6
+#define TIMING_WHEEL_NUM_SLOTS (1 << TIMING_WHEEL_SLOT_BITS)
+#define TIMING_WHEEL_SLOT_MASK (TIMING_WHEEL_NUM_SLOTS - 1)
+/* four levels cover 2^40 ns (about 18 minutes) ahead of the cursor */
+#define TIMING_WHEEL_NUM_LEVELS 4
+
+typedef struct _TimingWheelEntry TimingWheelEntry;
+struct _TimingWheelEntry {
+    KeyedHeapKey key;
+    gpointer data;
+};
+
+struct _TimingWheel {
+    /* the time the wheel has advanced to; slot indices are relative to it */
+    guint64 cursor;
+
+    /* all entries in the cursor's level 0 slot or earlier, in sorted order */
+    KeyedHeap* ready;
+    /* slots hold arrays of TimingWheelEntry; they are allocated on first use */
+    GArray* slots[TIMING_WHEEL_NUM_LEVELS][TIMING_WHEEL_NUM_SLOTS];
+    /* bit i is set if slot i of the level is not empty */
+    guint64 occupied[TIMING_WHEEL_NUM_LEVELS];
+    /* entries too far ahead of the cursor for any level */
+    KeyedHeap* overflow;
+
+    gsize length;
+    GDestroyNotify freeFunc;
+};
+
+static inline guint _timingwheel_shift(guint level) {
+    return TIMING_WHEEL_RESOLUTION_BITS + (TIMING_WHEEL_SLOT_BITS * level);
+}
+
+TimingWheel* timingwheel_new(GDestroyNotify freeFunc) {
+    TimingWheel* wheel = g_new0(TimingWheel, 1);
+    wheel->freeFunc = freeFunc;
+    wheel->ready = keyedheap_new(freeFunc);
+    wheel->overflow = keyedheap_new(freeFunc);
+    return wheel;
+}
+
+void timingwheel_free(TimingWheel* wheel) {
+    utility_assert(wheel);
+
+    for(guint level = 0; level < TIMING_WHEEL_NUM_LEVELS; level++) {
+        for(guint slot = 0; slot < TIMING_WHEEL_NUM_SLOTS; slot++) {
+            GArray* entries = wheel->slots[level][slot];
+            if(!entries) {
+                continue;
+            }
+            if(wheel->freeFunc) {
+                for(guint i = 0; i < entries->len; i++) {
+                    wheel->freeFunc(g_array_index(entries, TimingWheelEntry, i).data);
+                }
+            }
+            g_array_free(entries, TRUE);
+        }
+    }
+
+    keyedheap_free(wheel->ready);
+    keyedheap_free(wheel->overflow);
+    g_free(wheel);
+}
+
+gsize timingwheel_getLength(TimingWheel* wheel) {
+    utility_assert(wheel);
+    return wheel->length;
+}
+
+gboolean timingwheel_isEmpty(TimingWheel* wheel) {
+    utility_assert(wheel);
+    return wheel->length == 0;
+}
+
+/* places the entry relative to the cursor, without changing the length */
+static void _timingwheel_insert(TimingWheel* wheel, const KeyedHeapKey* key, gpointer data) {
+    guint64 time = key->primary;
+
+    if((time >> TIMING_WHEEL_RESOLUTION_BITS) <= (wheel->cursor >> TIMING_WHEEL_RESOLUTION_BITS)) {
+        keyedheap_push(wheel->ready, key, data);
+        return;
+    }
+
+    /* use the lowest level on which the time falls into the cursor's rotation, so
+     * its slot lies ahead of the cursor's slot on that level */
+    for(guint level = 0; level < TIMING_WHEEL_NUM_LEVELS; level++) {
+        guint aboveShift = _timingwheel_shift(level + 1);
+        if((time >> aboveShift) != (wheel->cursor >> aboveShift)) {
+            continue;
+        }
+
+        guint slot = (guint)((time >> _timingwheel_shift(level)) & TIMING_WHEEL_SLOT_MASK);
+        if(!wheel->slots[level][slot]) {
+            wheel->slots[level][slot] = g_array_new(FALSE, FALSE, sizeof(TimingWheelEntry));
+        }
+
+        TimingWheelEntry entry = {*key, data};
+        g_array_append_val(wheel->slots[level][slot], entry);
+        wheel->occupied[level] |= G_GUINT64_CONSTANT(1) << slot;
+        return;
+    }
+
+    keyedheap_push(wheel->overflow, key, data);
+}
+
+void timingwheel_push(TimingWheel* wheel, const KeyedHeapKey* key, gpointer data) {
+    utility_assert(wheel && key);
+    _timingwheel_insert(wheel, key, data);
+    wheel->length++;
+}
+
+/* finds the first occupied slot after the cursor's slot, on the lowest level that has
+ * one; every slot on a higher level starts after all remaining slots on lower levels */
+static gboolean _timingwheel_findNextSlot(TimingWheel* wheel, guint* levelOut, guint* slotOut) {
+    for(guint level = 0; level < TIMING_WHEEL_NUM_LEVELS; level++) {
+        guint current = (guint)((wheel->cursor >> _timingwheel_shift(level)) & TIMING_WHEEL_SLOT_MASK);
+        /* clear the bits of the current slot and all slots before it */
+        guint64 ahead = wheel->occupied[level] & ~((G_GUINT64_CONSTANT(2) << current) - 1);
+        if(ahead != 0) {
+            *levelOut = level;
+            *slotOut = (guint)__builtin_ctzll(ahead);
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static guint64 _timingwheel_getSlotStart(TimingWheel* wheel, guint level, guint slot) {
+    guint aboveShift = _timingwheel_shift(level + 1);
+    return ((wheel->cursor >> aboveShift) << aboveShift) | (((guint64)slot) << _timingwheel_shift(level));
+}
+
+/* returns a lower bound on the time of every entry outside of the ready heap */
+static guint64 _timingwheel_getNextTime(TimingWheel* wheel) {
+    guint level = 0, slot = 0;
+    if(_timingwheel_findNextSlot(wheel, &level, &slot)) {
+        return _timingwheel_getSlotStart(wheel, level, slot);
+    }
+    const KeyedHeapKey* key = keyedheap_peekKey(wheel->overflow);
+    return key ? key->primary : G_MAXUINT64;
+}
+
+/* moves the cursor to the next occupied slot and spreads its entries over the lower
+ * levels, or into the ready heap for level 0 slots */
+static void _timingwheel_advance(TimingWheel* wheel) {
+    guint level = 0, slot = 0;
+
+    if(_timingwheel_findNextSlot(wheel, &level, &slot)) {
+        wheel->cursor = _timingwheel_getSlotStart(wheel, level, slot);
+
+        GArray* entries = wheel->slots[level][slot];
+        wheel->occupied[level] &= ~(G_GUINT64_CONSTANT(1) << slot);
+
+        for(guint i = 0; i < entries->len; i++) {
+            TimingWheelEntry* entry = &g_array_index(entries, TimingWheelEntry, i);
+            _timingwheel_insert(wheel, &entry->key, entry->data);
+        }
+        g_array_set_size(entries, 0);
+    } else if(!keyedheap_isEmpty(wheel->overflow)) {
+        /* the wheel itself is empty, so jump to the earliest overflow entry and
+         * pull in everything that now falls into the wheel's range */
+        wheel->cursor = keyedheap_peekKey(wheel->overflow)->primary;
+        guint topShift = _timingwheel_shift(TIMING_WHEEL_NUM_LEVELS);
+
+        while(!keyedheap_isEmpty(wheel->overflow)) {
+            KeyedHeapKey key = *keyedheap_peekKey(wheel->overflow);
+            if((key.primary >> topShift) != (wheel->cursor >> topShift)) {
+                break;
+            }
+            gpointer data = keyedheap_pop(wheel->overflow);
+            _timingwheel_insert(wheel, &key, data);
+        }
+    }
+}
+
+gsize timingwheel_removeIf(TimingWheel* wheel, KeyedHeapPredicateFunc predicate, gpointer userData) {
+    utility_assert(wheel && predicate);
+
+    gsize numRemoved = keyedheap_removeIf(wheel->ready, predicate, userData);
+    numRemoved += keyedheap_removeIf(wheel->overflow, predicate, userData);
+
+    for(guint level = 0; level < TIMING_WHEEL_NUM_LEVELS; level++) {
+        guint64 occupied = wheel->occupied[level];
+        while(occupied != 0) {
+            guint slot = (guint)__builtin_ctzll(occupied);
+            occupied &= occupied - 1;
+
+            /* entries within a slot are unordered, so we can fill holes from the back */
+            GArray* entries = wheel->slots[level][slot];
+            for(guint i = entries->len; i > 0; i--) {
+                if(predicate(g_array_index(entries, TimingWheelEntry, i - 1).data, userData)) {
+                    g_array_remove_index_fast(entries, i - 1);
+                    numRemoved++;
+                }
+            }
+
+            if(entries->len == 0) {
+                wheel->occupied[level] &= ~(G_GUINT64_CONSTANT(1) << slot);
+            }
+        }
+    }
+
+    wheel->length -= numRemoved;
+    return numRemoved;
+}
+
+const KeyedHeapKey* timingwheel_peekKeyBefore(TimingWheel* wheel, guint64 limit) {
+    utility_assert(wheel);
+
+    while(keyedheap_isEmpty(wheel->ready) && wheel->length > 0) {
+        if(_timingwheel_getNextTime(wheel) > limit) {
+            return NULL;
+        }
+        _timingwheel_advance(wheel);
+    }
+
+    return keyedheap_peekKey(wheel->ready);
+}
+
+gpointer timingwheel_peek(TimingWheel* wheel) {
+    utility_assert(wheel);
+    timingwheel_peekKeyBefore(wheel, G_MAXUINT64);
+    return keyedheap_peek(wheel->ready);
+}
+
+gpointer timingwheel_pop(TimingWheel* wheel) {
+    utility_assert(wheel);
+    timingwheel_peekKeyBefore(wheel, G_MAXUINT64);
+
+    gpointer data = keyedheap_pop(wheel->ready);
+    if(data) {
+        wheel->length--;
+    }
+    return data;
+}
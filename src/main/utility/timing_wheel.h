@@ -0,0 +1,41 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#ifndef SHD_TIMING_WHEEL_H_
+#define SHD_TIMING_WHEEL_H_
+
+#include <glib.h>
+
+#include "main/utility/keyed_heap.h"
+
+/* A hierarchical timing wheel of (key, data) entries, where the primary key is a
+ * time in nanoseconds. Entries are hashed into coarse time slots in O(1), and a
+ * slot is only sorted when the wheel's cursor reaches it, by moving its entries
+ * into a small KeyedHeap. Entries therefore come out in exactly the same order as
+ * from a KeyedHeap, including ties on the secondary and tertiary keys.
+ *
+ * The wheel works best for timers that are scheduled a short, bounded time into
+ * the future; entries beyond the range of the wheel are kept in an overflow heap. */
+typedef struct _TimingWheel TimingWheel;
+
+TimingWheel* timingwheel_new(GDestroyNotify freeFunc);
+void timingwheel_free(TimingWheel* wheel);
+
+gsize timingwheel_getLength(TimingWheel* wheel);
+gboolean timingwheel_isEmpty(TimingWheel* wheel);
+void timingwheel_push(TimingWheel* wheel, const KeyedHeapKey* key, gpointer data);
+
+/* returns the key of the smallest entry, or NULL if the wheel is empty. if the
+ * smallest entry is known to have a primary key larger than limit, this may return
+ * NULL instead, which saves sorting slots that the caller would not use anyway.
+ * the key is only valid until the next push or pop. */
+const KeyedHeapKey* timingwheel_peekKeyBefore(TimingWheel* wheel, guint64 limit);
+gpointer timingwheel_peek(TimingWheel* wheel);
+gpointer timingwheel_pop(TimingWheel* wheel);
+/* removes all entries for which predicate returns TRUE, and returns how many were
+ * removed. the free function is not called on removed entries. */
+gsize timingwheel_removeIf(TimingWheel* wheel, KeyedHeapPredicateFunc predicate, gpointer userData);
+
+#endif /* SHD_TIMING_WHEEL_H_ */
@@ -333,3 +333,46 @@ gboolean utility_copyFile(const gchar* fromPath, const gchar* toPath) {
     g_free(contents);
     return TRUE;
 }
+
+gsize utility_iovecLength(const struct iovec* iov, gint iovcnt) {
+    gsize length = 0;
+    for(gint i = 0; i < iovcnt; i++) {
+        length += iov[i].iov_len;
+    }
+    return length;
+}
+
+gsize utility_iovecGather(const struct iovec* iov, gint iovcnt, gsize offset,
+        gpointer buffer, gsize length) {
+    gsize copied = 0;
+    for(gint i = 0; i < iovcnt && copied < length; i++) {
+        /* skip the buffers before the offset */
+        if(offset >= iov[i].iov_len) {
+            offset -= iov[i].iov_len;
+            continue;
+        }
+
+        gsize n = MIN(iov[i].iov_len - offset, length - copied);
+        memcpy((gchar*)buffer + copied, (const gchar*)iov[i].iov_base + offset, n);
+        copied += n;
+        offset = 0;
+    }
+    return copied;
+}
+
+gsize utility_iovecScatter(const struct iovec* iov, gint iovcnt, gsize offset,
+        gconstpointer buffer, gsize length) {
+    gsize copied = 0;
+    for(gint i = 0; i < iovcnt && copied < length; i++) {
+        if(offset >= iov[i].iov_len) {
+            offset -= iov[i].iov_len;
+            continue;
+        }
+
+        gsize n = MIN(iov[i].iov_len - offset, length - copied);
+        memcpy((gchar*)iov[i].iov_base + offset, (const gchar*)buffer + copied, n);
+        copied += n;
+        offset = 0;
+    }
+    return copied;
+}
@@ -9,6 +9,7 @@
 
 #include <glib.h>
 #include <netinet/in.h>
+#include <sys/uio.h>
 
 #include "main/core/support/definitions.h"
 
@@ -88,6 +89,17 @@ GString* utility_getFileContents(const gchar* fileName);
 gchar* utility_getNewTemporaryFilename(const gchar* templateStr);
 gboolean utility_copyFile(const gchar* fromPath, const gchar* toPath);
 
+/* the total number of bytes in the buffers of the vector */
+gsize utility_iovecLength(const struct iovec* iov, gint iovcnt);
+/* copy length bytes that start offset bytes into the vector into buffer, returning how
+ * many there were */
+gsize utility_iovecGather(const struct iovec* iov, gint iovcnt, gsize offset,
+        gpointer buffer, gsize length);
+/* copy length bytes from buffer into the vector, starting offset bytes into it, returning
+ * how many fit */
+gsize utility_iovecScatter(const struct iovec* iov, gint iovcnt, gsize offset,
+        gconstpointer buffer, gsize length);
+
 void utility_handleError(const gchar* file, gint line, const gchar* funtcion, const gchar* message);
 
 #endif /* SHD_UTILITY_H_ */
@@ -34,9 +34,11 @@ PRELOADDEF(return, int, getpeername, (int a, struct sockaddr* b, socklen_t* c),
 PRELOADDEF(return, ssize_t, send, (int a, const void *b, size_t c, int d), a, b, c, d);
 PRELOADDEF(return, ssize_t, sendto, (int a, const void *b, size_t c, int d, const struct sockaddr* e, socklen_t f), a, b, c, d, e, f);
 PRELOADDEF(return, ssize_t, sendmsg, (int a, const struct msghdr *b, int c), a, b, c);
+PRELOADDEF(return, int, sendmmsg, (int a, struct mmsghdr *b, unsigned int c, int d), a, b, c, d);
 PRELOADDEF(return, ssize_t, recv, (int a, void *b, size_t c, int d), a, b, c, d);
 PRELOADDEF(return, ssize_t, recvfrom, (int a, void *b, size_t c, int d, struct sockaddr* e, socklen_t *f), a, b, c, d, e, f);
 PRELOADDEF(return, ssize_t, recvmsg, (int a, struct msghdr *b, int c), a, b, c);
+PRELOADDEF(return, int, recvmmsg, (int a, struct mmsghdr *b, unsigned int c, int d, struct timespec *e), a, b, c, d, e);
 PRELOADDEF(return, int, getsockopt, (int a, int b, int c, void* d, socklen_t* e), a, b, c, d, e);
 PRELOADDEF(return, int, setsockopt, (int a, int b, int c, const void *d, socklen_t e), a, b, c, d, e);
 PRELOADDEF(return, int, listen, (int a, int b), a, b);
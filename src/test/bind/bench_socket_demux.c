@@ -0,0 +1,203 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+/* Compares the receive-path socket lookup of the network interface before and after
+ * the binary demux table: the old path printed one or two string keys per packet and
+ * looked them up in a string-keyed GHashTable, while SocketDemux hashes the binary
+ * tuple in place. The synthetic host has a few listening servers and many connected
+ * TCP and UDP sockets, and receives packets for random sockets; the first argument
+ * sets how many. */
+
+#include <glib.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "main/host/protocol.h"
+#include "main/host/socket_demux.h"
+
+#define BENCH_NUM_SOCKETS 10000
+#define BENCH_NUM_LISTENERS 10
+#define BENCH_DEFAULT_PACKETS 5000000
+/* the fraction of packets that go to a listening server instead of a connection */
+#define BENCH_LISTENER_FRACTION 0.05
+#define BENCH_SEED 1
+
+typedef struct _BenchSocket BenchSocket;
+struct _BenchSocket {
+    ProtocolType protocol;
+    in_port_t localPort;
+    in_addr_t peerIP;
+    in_port_t peerPort;
+    guint id;
+};
+
+typedef struct _BenchPacket BenchPacket;
+struct _BenchPacket {
+    ProtocolType protocol;
+    in_port_t destinationPort;
+    in_addr_t sourceIP;
+    in_port_t sourcePort;
+};
+
+/* socket_demux.c asserts through the utility module in debug builds */
+void utility_handleError(const gchar* file, gint line, const gchar* function, const gchar* message) {
+    g_printerr("**ERROR encountered**\n\tAt file: %s\n\tAt line: %i\n\tAt function: %s\n\tMessage: %s\n",
+            file, line, function, message);
+    abort();
+}
+
+static const gchar* _bench_protocolToString(ProtocolType type) {
+    return type == PTCP ? "TCP" : type == PUDP ? "UDP" : "LOCAL";
+}
+
+/* the key format the network interface used before the demux table */
+static gchar* _bench_getAssociationKey(in_addr_t localIP, ProtocolType type, in_port_t port,
+        in_addr_t peerAddr, in_port_t peerPort) {
+    GString* strBuffer = g_string_new(NULL);
+    g_string_printf(strBuffer,
+            "%s|%"G_GUINT32_FORMAT":%"G_GUINT16_FORMAT"|%"G_GUINT32_FORMAT":%"G_GUINT16_FORMAT,
+            _bench_protocolToString(type), (guint)localIP, port, peerAddr, peerPort);
+    return g_string_free(strBuffer, FALSE);
+}
+
+static BenchSocket* _bench_generateSockets(GRand* rand) {
+    BenchSocket* sockets = g_new0(BenchSocket, BENCH_NUM_SOCKETS);
+
+    for(guint i = 0; i < BENCH_NUM_SOCKETS; i++) {
+        BenchSocket* socket = &sockets[i];
+        socket->id = i + 1;
+        if(i < BENCH_NUM_LISTENERS) {
+            socket->protocol = PTCP;
+            socket->localPort = htons((in_port_t)(8000 + i));
+        } else {
+            /* each connection gets its own ephemeral port, like the host assigns them */
+            socket->protocol = g_rand_boolean(rand) ? PTCP : PUDP;
+            socket->localPort = htons((in_port_t)(10000 + i));
+            socket->peerIP = htonl(0x0B000000u + (guint32)g_rand_int_range(rand, 0, 1 << 16));
+            socket->peerPort = htons((in_port_t)g_rand_int_range(rand, 1, 1 << 16));
+        }
+    }
+
+    return sockets;
+}
+
+static BenchPacket* _bench_generatePackets(GRand* rand, BenchSocket* sockets, guint numPackets) {
+    BenchPacket* packets = g_new0(BenchPacket, numPackets);
+
+    for(guint i = 0; i < numPackets; i++) {
+        BenchPacket* packet = &packets[i];
+        if(g_rand_double(rand) < BENCH_LISTENER_FRACTION) {
+            BenchSocket* server = &sockets[g_rand_int_range(rand, 0, BENCH_NUM_LISTENERS)];
+            packet->protocol = server->protocol;
+            packet->destinationPort = server->localPort;
+            packet->sourceIP = htonl(0x0C000000u + (guint32)g_rand_int_range(rand, 0, 1 << 16));
+            packet->sourcePort = htons((in_port_t)g_rand_int_range(rand, 1, 1 << 16));
+        } else {
+            BenchSocket* socket = &sockets[g_rand_int_range(rand, BENCH_NUM_LISTENERS, BENCH_NUM_SOCKETS)];
+            packet->protocol = socket->protocol;
+            packet->destinationPort = socket->localPort;
+            packet->sourceIP = socket->peerIP;
+            packet->sourcePort = socket->peerPort;
+        }
+    }
+
+    return packets;
+}
+
+static guint64 _bench_runStringKeys(BenchSocket* sockets, BenchPacket* packets, guint numPackets, gdouble* seconds) {
+    in_addr_t localIP = htonl(0x0A000001u);
+    GHashTable* boundSockets = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    for(guint i = 0; i < BENCH_NUM_SOCKETS; i++) {
+        BenchSocket* socket = &sockets[i];
+        g_hash_table_replace(boundSockets, _bench_getAssociationKey(localIP, socket->protocol,
+                socket->localPort, socket->peerIP, socket->peerPort), socket);
+    }
+
+    guint64 checksum = 0;
+    GTimer* timer = g_timer_new();
+    for(guint i = 0; i < numPackets; i++) {
+        BenchPacket* packet = &packets[i];
+
+        gchar* key = _bench_getAssociationKey(localIP, packet->protocol, packet->destinationPort, 0, 0);
+        BenchSocket* socket = g_hash_table_lookup(boundSockets, key);
+        g_free(key);
+
+        if(!socket) {
+            key = _bench_getAssociationKey(localIP, packet->protocol, packet->destinationPort,
+                    packet->sourceIP, packet->sourcePort);
+            socket = g_hash_table_lookup(boundSockets, key);
+            g_free(key);
+        }
+
+        checksum = (checksum * 31) + (socket ? socket->id : 0);
+    }
+    *seconds = g_timer_elapsed(timer, NULL);
+    g_timer_destroy(timer);
+
+    g_hash_table_destroy(boundSockets);
+    return checksum;
+}
+
+static guint64 _bench_runSocketDemux(BenchSocket* sockets, BenchPacket* packets, guint numPackets, gdouble* seconds) {
+    SocketDemux* boundSockets = socketdemux_new(NULL);
+    for(guint i = 0; i < BENCH_NUM_SOCKETS; i++) {
+        BenchSocket* socket = &sockets[i];
+        socketdemux_insert(boundSockets, socket->protocol, socket->localPort,
+                socket->peerIP, socket->peerPort, socket);
+    }
+
+    guint64 checksum = 0;
+    GTimer* timer = g_timer_new();
+    for(guint i = 0; i < numPackets; i++) {
+        BenchPacket* packet = &packets[i];
+        BenchSocket* socket = socketdemux_lookup(boundSockets, packet->protocol,
+                packet->destinationPort, packet->sourceIP, packet->sourcePort);
+        checksum = (checksum * 31) + (socket ? socket->id : 0);
+    }
+    *seconds = g_timer_elapsed(timer, NULL);
+    g_timer_destroy(timer);
+
+    /* removing every socket exercises the backward shifts and the shrinking */
+    gboolean allRemoved = TRUE;
+    for(guint i = 0; i < BENCH_NUM_SOCKETS; i++) {
+        BenchSocket* socket = &sockets[i];
+        allRemoved &= socketdemux_remove(boundSockets, socket->protocol, socket->localPort,
+                socket->peerIP, socket->peerPort);
+    }
+    if(!allRemoved || socketdemux_getLength(boundSockets) != 0) {
+        g_printerr("sockets were lost from the demux table\n");
+        checksum = 0;
+    }
+
+    socketdemux_free(boundSockets);
+    return checksum;
+}
+
+int main(int argc, char* argv[]) {
+    guint numPackets = argc > 1 ? (guint)atol(argv[1]) : BENCH_DEFAULT_PACKETS;
+
+    GRand* rand = g_rand_new_with_seed(BENCH_SEED);
+    BenchSocket* sockets = _bench_generateSockets(rand);
+    BenchPacket* packets = _bench_generatePackets(rand, sockets, numPackets);
+    g_rand_free(rand);
+
+    gdouble stringSeconds = 0, demuxSeconds = 0;
+    guint64 stringChecksum = _bench_runStringKeys(sockets, packets, numPackets, &stringSeconds);
+    guint64 demuxChecksum = _bench_runSocketDemux(sockets, packets, numPackets, &demuxSeconds);
+
+    g_print("received %u packets on a host with %u sockets\n", numPackets, BENCH_NUM_SOCKETS);
+    g_print("string keys: %f seconds, %f packets/s\n", stringSeconds, numPackets / stringSeconds);
+    g_print("demux table: %f seconds, %f packets/s\n", demuxSeconds, numPackets / demuxSeconds);
+
+    g_free(packets);
+    g_free(sockets);
+
+    if(stringChecksum != demuxChecksum) {
+        g_printerr("the demux table delivered packets to different sockets\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
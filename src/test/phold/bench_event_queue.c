@@ -0,0 +1,270 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+/* Compares the pointer-based PriorityQueue against the inline-key KeyedHeap, and
+ * against a KeyedHeap merged with a TimingWheel for host-local events, on an event
+ * push/pop workload. By default a synthetic phold-style hold workload is generated,
+ * in which half of the events are short host-local timers; pass a number to change
+ * how many events it holds. Alternatively, pass the path to a shadow log that was
+ * produced by a debug build run with '-l debug' (e.g. the phold test), and the
+ * 'event-trace' push/pop lines in that log are replayed instead. The trace interleaves the
+ * operations of all of the simulation's queues, and is replayed into a single queue. */
+
+#include <glib.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "main/utility/keyed_heap.h"
+#include "main/utility/priority_queue.h"
+#include "main/utility/timing_wheel.h"
+
+#define BENCH_NUM_HOSTS 1000
+#define BENCH_EVENTS_PER_HOST 10
+#define BENCH_DEFAULT_HOLDS 2000000
+#define BENCH_MEAN_DELAY 50000000.0
+#define BENCH_SEED 1
+/* the fraction of held events that are timers a host schedules for itself */
+#define BENCH_TIMER_FRACTION 0.5
+/* timers fire at most this many nanoseconds later, like the 1 ms interface refills */
+#define BENCH_MAX_TIMER_DELAY 1000000
+
+typedef struct _BenchEvent BenchEvent;
+struct _BenchEvent {
+    KeyedHeapKey key;
+    /* padding so that the comparator pays for touching a separate cache line,
+     * like event_compare does when it follows the event's host pointers */
+    gchar unused[64];
+};
+
+typedef struct _BenchOp BenchOp;
+struct _BenchOp {
+    /* NULL means pop */
+    BenchEvent* pushed;
+};
+
+/* priority_queue.c asserts through the utility module in debug builds */
+void utility_handleError(const gchar* file, gint line, const gchar* function, const gchar* message) {
+    g_printerr("**ERROR encountered**\n\tAt file: %s\n\tAt line: %i\n\tAt function: %s\n\tMessage: %s\n",
+            file, line, function, message);
+    abort();
+}
+
+static gint _bench_compare(const BenchEvent* a, const BenchEvent* b, gpointer userData) {
+    if(a->key.primary != b->key.primary) {
+        return a->key.primary > b->key.primary ? +1 : -1;
+    } else if(a->key.secondary != b->key.secondary) {
+        return a->key.secondary > b->key.secondary ? +1 : -1;
+    } else if(a->key.tertiary != b->key.tertiary) {
+        return a->key.tertiary > b->key.tertiary ? +1 : -1;
+    } else {
+        return 0;
+    }
+}
+
+static BenchEvent* _bench_newEvent(guint64 time, guint32 dst, guint32 src, guint64 seq) {
+    BenchEvent* event = g_new0(BenchEvent, 1);
+    event->key.primary = time;
+    event->key.secondary = (((guint64)dst) << 32) | src;
+    event->key.tertiary = seq;
+    return event;
+}
+
+/* a hold model: every popped event schedules one new event at a random later time,
+ * so the queue size stays constant like in the phold test */
+static GArray* _bench_generateHoldWorkload(guint numHolds) {
+    GArray* ops = g_array_new(FALSE, FALSE, sizeof(BenchOp));
+    GRand* rand = g_rand_new_with_seed(BENCH_SEED);
+    guint64* nextSeq = g_new0(guint64, BENCH_NUM_HOSTS);
+
+    /* a shadow model of the queue, so we know the time of each popped event */
+    PriorityQueue* model = priorityqueue_new((GCompareDataFunc)_bench_compare, NULL, NULL);
+
+    for(guint32 host = 0; host < BENCH_NUM_HOSTS; host++) {
+        for(guint i = 0; i < BENCH_EVENTS_PER_HOST; i++) {
+            guint64 time = (guint64)g_rand_int_range(rand, 0, (gint32)BENCH_MEAN_DELAY);
+            BenchOp op = {_bench_newEvent(time, host, host, nextSeq[host]++)};
+            priorityqueue_push(model, op.pushed);
+            g_array_append_val(ops, op);
+        }
+    }
+
+    for(guint i = 0; i < numHolds; i++) {
+        BenchEvent* popped = priorityqueue_pop(model);
+        BenchOp pop = {NULL};
+        g_array_append_val(ops, pop);
+
+        guint32 src = (guint32)(popped->key.secondary >> 32);
+        guint32 dst = 0;
+        gdouble delay = 0;
+        if(g_rand_double(rand) < BENCH_TIMER_FRACTION) {
+            dst = src;
+            delay = (gdouble)g_rand_int_range(rand, 0, BENCH_MAX_TIMER_DELAY);
+        } else {
+            dst = (guint32)g_rand_int_range(rand, 0, BENCH_NUM_HOSTS);
+            delay = -BENCH_MEAN_DELAY * log1p(-g_rand_double(rand));
+        }
+        BenchOp push = {_bench_newEvent(popped->key.primary + 1 + (guint64)delay, dst, src, nextSeq[src]++)};
+        priorityqueue_push(model, push.pushed);
+        g_array_append_val(ops, push);
+    }
+
+    priorityqueue_free(model);
+    g_free(nextSeq);
+    g_rand_free(rand);
+    return ops;
+}
+
+static GArray* _bench_loadTraceWorkload(const gchar* path) {
+    gchar* contents = NULL;
+    GError* error = NULL;
+    if(!g_file_get_contents(path, &contents, NULL, &error)) {
+        g_printerr("unable to read trace file '%s': %s\n", path, error->message);
+        g_error_free(error);
+        return NULL;
+    }
+
+    GArray* ops = g_array_new(FALSE, FALSE, sizeof(BenchOp));
+    gchar** lines = g_strsplit(contents, "\n", 0);
+    for(gint i = 0; lines[i] != NULL; i++) {
+        gchar* trace = strstr(lines[i], "event-trace ");
+        if(!trace) {
+            continue;
+        }
+
+        guint64 primary = 0, secondary = 0, tertiary = 0;
+        if(sscanf(trace, "event-trace push %"G_GUINT64_FORMAT" %"G_GUINT64_FORMAT" %"G_GUINT64_FORMAT,
+                &primary, &secondary, &tertiary) == 3) {
+            BenchOp op = {_bench_newEvent(primary, 0, 0, tertiary)};
+            op.pushed->key.secondary = secondary;
+            g_array_append_val(ops, op);
+        } else if(g_str_has_prefix(trace, "event-trace pop")) {
+            BenchOp op = {NULL};
+            g_array_append_val(ops, op);
+        }
+    }
+
+    g_strfreev(lines);
+    g_free(contents);
+    return ops;
+}
+
+/* returns a hash of the popped key sequence, so the two runs can be checked against each other */
+static guint64 _bench_runPriorityQueue(GArray* ops, gdouble* seconds) {
+    PriorityQueue* pq = priorityqueue_new((GCompareDataFunc)_bench_compare, NULL, NULL);
+    guint64 checksum = 0;
+
+    GTimer* timer = g_timer_new();
+    for(guint i = 0; i < ops->len; i++) {
+        BenchOp* op = &g_array_index(ops, BenchOp, i);
+        if(op->pushed) {
+            priorityqueue_push(pq, op->pushed);
+        } else {
+            BenchEvent* event = priorityqueue_pop(pq);
+            if(event) {
+                checksum = (checksum * 31) + event->key.primary + event->key.tertiary;
+            }
+        }
+    }
+    *seconds = g_timer_elapsed(timer, NULL);
+    g_timer_destroy(timer);
+
+    priorityqueue_free(pq);
+    return checksum;
+}
+
+static guint64 _bench_runKeyedHeap(GArray* ops, gdouble* seconds) {
+    KeyedHeap* heap = keyedheap_new(NULL);
+    guint64 checksum = 0;
+
+    GTimer* timer = g_timer_new();
+    for(guint i = 0; i < ops->len; i++) {
+        BenchOp* op = &g_array_index(ops, BenchOp, i);
+        if(op->pushed) {
+            keyedheap_push(heap, &op->pushed->key, op->pushed);
+        } else {
+            BenchEvent* event = keyedheap_pop(heap);
+            if(event) {
+                checksum = (checksum * 31) + event->key.primary + event->key.tertiary;
+            }
+        }
+    }
+    *seconds = g_timer_elapsed(timer, NULL);
+    g_timer_destroy(timer);
+
+    keyedheap_free(heap);
+    return checksum;
+}
+
+static gboolean _bench_isHostLocal(BenchEvent* event) {
+    return (event->key.secondary >> 32) == (event->key.secondary & G_MAXUINT32);
+}
+
+/* mirrors what eventqueue does for EQ_TIMING_WHEEL */
+static guint64 _bench_runTimingWheel(GArray* ops, gdouble* seconds) {
+    KeyedHeap* heap = keyedheap_new(NULL);
+    TimingWheel* wheel = timingwheel_new(NULL);
+    guint64 checksum = 0;
+
+    GTimer* timer = g_timer_new();
+    for(guint i = 0; i < ops->len; i++) {
+        BenchOp* op = &g_array_index(ops, BenchOp, i);
+        if(op->pushed) {
+            if(_bench_isHostLocal(op->pushed)) {
+                timingwheel_push(wheel, &op->pushed->key, op->pushed);
+            } else {
+                keyedheap_push(heap, &op->pushed->key, op->pushed);
+            }
+        } else {
+            const KeyedHeapKey* heapKey = keyedheap_peekKey(heap);
+            const KeyedHeapKey* wheelKey = timingwheel_peekKeyBefore(wheel, heapKey ? heapKey->primary : G_MAXUINT64);
+            gboolean useWheel = wheelKey && (!heapKey || keyedheap_compareKeys(wheelKey, heapKey) < 0);
+            BenchEvent* event = useWheel ? timingwheel_pop(wheel) : keyedheap_pop(heap);
+            if(event) {
+                checksum = (checksum * 31) + event->key.primary + event->key.tertiary;
+            }
+        }
+    }
+    *seconds = g_timer_elapsed(timer, NULL);
+    g_timer_destroy(timer);
+
+    timingwheel_free(wheel);
+    keyedheap_free(heap);
+    return checksum;
+}
+
+int main(int argc, char* argv[]) {
+    /* a numeric argument is the number of holds, anything else a trace to replay */
+    gchar* end = NULL;
+    guint numHolds = (argc > 1) ? (guint)strtoul(argv[1], &end, 10) : BENCH_DEFAULT_HOLDS;
+    gboolean isTrace = (argc > 1) && (end == argv[1] || *end != '\0');
+
+    GArray* ops = isTrace ? _bench_loadTraceWorkload(argv[1]) : _bench_generateHoldWorkload(numHolds);
+    if(!ops) {
+        return EXIT_FAILURE;
+    }
+
+    gdouble pqSeconds = 0, heapSeconds = 0, wheelSeconds = 0;
+    guint64 pqChecksum = _bench_runPriorityQueue(ops, &pqSeconds);
+    guint64 heapChecksum = _bench_runKeyedHeap(ops, &heapSeconds);
+    guint64 wheelChecksum = _bench_runTimingWheel(ops, &wheelSeconds);
+
+    g_print("replayed %u event queue operations from %s\n", ops->len, isTrace ? argv[1] : "a synthetic hold workload");
+    g_print("pqueue: %f seconds, %f ns/op\n", pqSeconds, (pqSeconds * 1e9) / ops->len);
+    g_print("heap: %f seconds, %f ns/op\n", heapSeconds, (heapSeconds * 1e9) / ops->len);
+    g_print("wheel: %f seconds, %f ns/op\n", wheelSeconds, (wheelSeconds * 1e9) / ops->len);
+
+    for(guint i = 0; i < ops->len; i++) {
+        g_free(g_array_index(ops, BenchOp, i).pushed);
+    }
+    g_array_free(ops, TRUE);
+
+    if(pqChecksum != heapChecksum || pqChecksum != wheelChecksum) {
+        g_printerr("pop order differs between the queues\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
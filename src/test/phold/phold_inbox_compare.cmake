@@ -0,0 +1,21 @@
+## runs phold with the locked host queues and with the lock-free host inboxes, and
+## prints the total time the scheduler threads spent waiting to push events in each
+macro(RUN_PHOLD NAME RESULT_TOTAL)
+    execute_process(COMMAND ${SHADOW} -d phold-threaded-${NAME}.shadow.data -w 2 -t steal ${ARGN} ${CONFIG}
+        RESULT_VARIABLE RESULT OUTPUT_VARIABLE OUTPUT ERROR_VARIABLE OUTPUT)
+    if(RESULT)
+        message(FATAL_ERROR "phold with ${NAME} host queues failed: ${OUTPUT}")
+    endif()
+    string(REGEX MATCHALL "total push wait time was [0-9.]+ seconds" WAIT_LINES "${OUTPUT}")
+    set(${RESULT_TOTAL} 0)
+    foreach(WAIT_LINE ${WAIT_LINES})
+        string(REGEX REPLACE ".* was ([0-9]+)\\.([0-9]+) seconds" "\\1\\2" MICROS "${WAIT_LINE}")
+        math(EXPR ${RESULT_TOTAL} "${${RESULT_TOTAL}} + ${MICROS}")
+    endforeach()
+endmacro()
+
+run_phold(locked LOCKED_MICROS)
+run_phold(inbox INBOX_MICROS --scheduler-inbox)
+
+message("total push wait time with locked host queues: ${LOCKED_MICROS} us")
+message("total push wait time with lock-free host inboxes: ${INBOX_MICROS} us")
@@ -0,0 +1,186 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+/* Context switches between rpth threads while many other threads wait on fds, as
+ * happens in plugins with large thread pools. Two threads pass a byte back and forth
+ * over a pair of pipes, so that each round trip goes through the scheduler's event
+ * manager twice, while the idle threads each block in a read on a pipe that stays
+ * empty until the end. A second phase passes control back and forth with pth_yield()
+ * alone, which isolates the cost of the machine context switch itself, and a third
+ * one spawns and joins short-lived threads with the stack size that shadow gives
+ * plugin threads, which reuse the stacks of the threads before them. This runs
+ * outside of shadow, with rpth's blocking scheduler. */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "external/rpth/rpth.h"
+
+/* the mctx method that the linked rpth was built with, set by the build */
+#ifndef BENCH_MCTX_METHOD
+#define BENCH_MCTX_METHOD "default"
+#endif
+
+#define BENCH_DEFAULT_IDLE_THREADS 200
+#define BENCH_DEFAULT_ROUNDS 10000
+#define BENCH_SPAWN_STACK_SIZE (128 * 1024)
+
+typedef struct _BenchPipes BenchPipes;
+struct _BenchPipes {
+    int ping[2];
+    int pong[2];
+    long rounds;
+};
+
+static double _bench_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+static void* _bench_runIdle(void* arg) {
+    int fd = *(int*)arg;
+    char c;
+    if(pth_read(fd, &c, 1) != 1) {
+        fprintf(stderr, "error: idle read: %s\n", strerror(errno));
+        return (void*)-1;
+    }
+    return NULL;
+}
+
+static void* _bench_runPonger(void* arg) {
+    BenchPipes* pipes = arg;
+    char c;
+    for(long i = 0; i < pipes->rounds; i++) {
+        if(pth_read(pipes->ping[0], &c, 1) != 1 || pth_write(pipes->pong[1], &c, 1) != 1) {
+            fprintf(stderr, "error: ponger: %s\n", strerror(errno));
+            return (void*)-1;
+        }
+    }
+    return NULL;
+}
+
+static void* _bench_runYielder(void* arg) {
+    long rounds = *(long*)arg;
+    for(long i = 0; i < rounds; i++) {
+        pth_yield(NULL);
+    }
+    return NULL;
+}
+
+static void* _bench_runShortLived(void* arg) {
+    /* touch a few pages of the stack, like a thread doing some work would */
+    volatile char buffer[16 * 1024];
+    memset((char*)buffer, 1, sizeof(buffer));
+    return NULL;
+}
+
+int main(int argc, char* argv[]) {
+    int numIdle = argc > 1 ? atoi(argv[1]) : BENCH_DEFAULT_IDLE_THREADS;
+    long rounds = argc > 2 ? atol(argv[2]) : BENCH_DEFAULT_ROUNDS;
+
+    if(!pth_init()) {
+        fprintf(stderr, "error: pth_init failed\n");
+        return EXIT_FAILURE;
+    }
+    printf("rpth switches contexts with the %s mctx method\n", BENCH_MCTX_METHOD);
+
+    pth_attr_t attr = pth_attr_new();
+    pth_attr_set(attr, PTH_ATTR_JOINABLE, TRUE);
+    pth_attr_set(attr, PTH_ATTR_STACK_SIZE, 16 * 1024);
+
+    int* idlePipes = calloc(2 * numIdle, sizeof(int));
+    pth_t* idleThreads = calloc(numIdle, sizeof(pth_t));
+    for(int i = 0; i < numIdle; i++) {
+        if(pipe(&idlePipes[2 * i]) < 0) {
+            fprintf(stderr, "error: pipe: %s\n", strerror(errno));
+            return EXIT_FAILURE;
+        }
+        idleThreads[i] = pth_spawn(attr, _bench_runIdle, &idlePipes[2 * i]);
+    }
+
+    BenchPipes pipes;
+    pipes.rounds = rounds;
+    if(pipe(pipes.ping) < 0 || pipe(pipes.pong) < 0) {
+        fprintf(stderr, "error: pipe: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    pth_t ponger = pth_spawn(attr, _bench_runPonger, &pipes);
+
+    /* let all of the idle threads block first */
+    pth_yield(NULL);
+
+    double start = _bench_now();
+    char c = 'x';
+    for(long i = 0; i < rounds; i++) {
+        if(pth_write(pipes.ping[1], &c, 1) != 1 || pth_read(pipes.pong[0], &c, 1) != 1) {
+            fprintf(stderr, "error: pinger: %s\n", strerror(errno));
+            return EXIT_FAILURE;
+        }
+    }
+    double seconds = _bench_now() - start;
+
+    int failed = 0;
+    void* result = NULL;
+    pth_join(ponger, &result);
+    failed |= result != NULL;
+
+    for(int i = 0; i < numIdle; i++) {
+        if(pth_write(idlePipes[2 * i + 1], &c, 1) != 1) {
+            failed = 1;
+        }
+    }
+    for(int i = 0; i < numIdle; i++) {
+        pth_join(idleThreads[i], &result);
+        failed |= result != NULL;
+        close(idlePipes[2 * i]);
+        close(idlePipes[2 * i + 1]);
+    }
+
+    printf("%ld round trips with %d idle threads in %f seconds, %f context switches per second\n",
+           rounds, numIdle, seconds, seconds > 0 ? 2 * rounds / seconds : 0);
+
+    pth_t yielder = pth_spawn(attr, _bench_runYielder, &rounds);
+    start = _bench_now();
+    for(long i = 0; i < rounds; i++) {
+        pth_yield(NULL);
+    }
+    pth_join(yielder, &result);
+    seconds = _bench_now() - start;
+    failed |= result != NULL;
+
+    printf("%ld yield round trips in %f seconds, %f context switches per second\n",
+           rounds, seconds, seconds > 0 ? 2 * rounds / seconds : 0);
+
+    pth_attr_set(attr, PTH_ATTR_STACK_SIZE, BENCH_SPAWN_STACK_SIZE);
+    start = _bench_now();
+    for(long i = 0; i < rounds; i++) {
+        pth_t thread = pth_spawn(attr, _bench_runShortLived, NULL);
+        if(thread == NULL || !pth_join(thread, &result) || result != NULL) {
+            failed = 1;
+            break;
+        }
+    }
+    seconds = _bench_now() - start;
+
+    pth_stackpool_stats_t stats;
+    pth_stackpool_stats(&stats);
+    printf("%ld thread spawns and joins in %f seconds, %f per second; %lu new stacks, "
+           "%lu reused, mean create %f us, mean exit %f us\n", rounds, seconds,
+           seconds > 0 ? rounds / seconds : 0, stats.created, stats.reused,
+           stats.created + stats.reused > 0 ? stats.create_ns / 1000.0 / (stats.created + stats.reused) : 0,
+           stats.exited > 0 ? stats.exit_ns / 1000.0 / stats.exited : 0);
+
+    free(idleThreads);
+    free(idlePipes);
+    pth_attr_destroy(attr);
+    pth_kill();
+    pth_stackpool_free();
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
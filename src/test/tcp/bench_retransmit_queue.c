@@ -0,0 +1,254 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+/* Measures the sender's per-ACK retransmit bookkeeping on a long fat pipe, before and
+ * after the sequence-indexed retransmit queue. The old queue was a GHashTable keyed by
+ * sequence number that kept sacked packets until they were cumulatively acked; the new
+ * one is a SequenceRing that releases the blocks the retransmit tally reports as newly
+ * sacked. Both run the same tally, the same lossy pipe and the same ACK stream.
+ *
+ * The pipe holds a full window of packets, and one new packet enters it for every
+ * packet that leaves it. Each arrival is acked. An arrival after a hole is reported in
+ * the SACK list of its own ACK only, like the first SACK block of a real receiver, so
+ * that copying the receiver's whole SACK list does not dominate the ACK cost. The first
+ * argument sets how many packets are sent. */
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "main/host/descriptor/tcp_retransmit_tally.h"
+#include "main/utility/sequence_ring.h"
+
+/* about 10 Gbit/s with a 20 ms round trip and 1460 byte packets */
+#define BENCH_WINDOW 16384
+#define BENCH_DEFAULT_PACKETS 2000000
+/* the fraction of first transmissions that the pipe drops */
+#define BENCH_LOSS_RATE 0.0005
+#define BENCH_SEED 1
+
+typedef struct _BenchQueue BenchQueue;
+struct _BenchQueue {
+    const gchar* name;
+    gpointer queue;
+    /* adds the packet if it is not queued yet */
+    void (*add)(BenchQueue* bq, guint32 sequence, gpointer packet);
+    /* removes the packet to retransmit it, or returns NULL */
+    gpointer (*steal)(BenchQueue* bq, guint32 sequence);
+    /* releases the packets cumulatively acked by the ack, given the previous ack */
+    void (*ack)(BenchQueue* bq, guint32 lastAcknowledgment, guint32 acknowledgment);
+    /* called by the tally with newly sacked blocks, or NULL if they are kept */
+    void (*sack)(void* bq, guint32 begin, guint32 end);
+    guint (*getLength)(BenchQueue* bq);
+};
+
+/* sequence_ring.c asserts through the utility module in debug builds */
+void utility_handleError(const gchar* file, gint line, const gchar* function, const gchar* message) {
+    g_printerr("**ERROR encountered**\n\tAt file: %s\n\tAt line: %i\n\tAt function: %s\n\tMessage: %s\n",
+            file, line, function, message);
+    abort();
+}
+
+/* the hash table queue, as tcp.c used it before */
+
+static void _bench_hashAdd(BenchQueue* bq, guint32 sequence, gpointer packet) {
+    gpointer key = GINT_TO_POINTER(sequence);
+    if(g_hash_table_lookup(bq->queue, key) == NULL) {
+        g_hash_table_insert(bq->queue, key, packet);
+    }
+}
+
+static gpointer _bench_hashSteal(BenchQueue* bq, guint32 sequence) {
+    gpointer key = GINT_TO_POINTER(sequence);
+    gpointer packet = g_hash_table_lookup(bq->queue, key);
+    if(packet) {
+        g_hash_table_steal(bq->queue, key);
+    }
+    return packet;
+}
+
+static void _bench_hashAck(BenchQueue* bq, guint32 lastAcknowledgment, guint32 acknowledgment) {
+    for(guint32 sequence = lastAcknowledgment; sequence < acknowledgment; sequence++) {
+        if(g_hash_table_lookup(bq->queue, GINT_TO_POINTER(sequence)) != NULL) {
+            g_hash_table_remove(bq->queue, GINT_TO_POINTER(sequence));
+        }
+    }
+}
+
+static guint _bench_hashGetLength(BenchQueue* bq) {
+    return g_hash_table_size(bq->queue);
+}
+
+/* the sequence ring queue */
+
+static void _bench_ringAdd(BenchQueue* bq, guint32 sequence, gpointer packet) {
+    sequencering_insert(bq->queue, sequence, packet);
+}
+
+static gpointer _bench_ringSteal(BenchQueue* bq, guint32 sequence) {
+    return sequencering_steal(bq->queue, sequence);
+}
+
+static void _bench_ringAck(BenchQueue* bq, guint32 lastAcknowledgment, guint32 acknowledgment) {
+    while(sequencering_stealBelow(bq->queue, acknowledgment) != NULL);
+}
+
+static void _bench_ringSack(void* bq, guint32 begin, guint32 end) {
+    for(guint32 sequence = begin; sequence < end; sequence++) {
+        sequencering_steal(((BenchQueue*)bq)->queue, sequence);
+    }
+}
+
+static guint _bench_ringGetLength(BenchQueue* bq) {
+    return sequencering_getLength(bq->queue);
+}
+
+/* runs the pipe, and returns a checksum of the retransmitted sequence numbers */
+static guint64 _bench_run(BenchQueue* bq, guint numPackets, gdouble* seconds, gdouble* meanQueued) {
+    GRand* rand = g_rand_new_with_seed(BENCH_SEED);
+    /* the queues only store pointers, so all packets can share one */
+    static gchar packet;
+
+    void* tally = NULL;
+    retransmit_tally_init(&tally);
+
+    /* sequence numbers in flight, in the order they will arrive */
+    GQueue* pipe = g_queue_new();
+    /* whether the receiver holds each sequence, so it can move past filled holes */
+    guint8* received = g_new0(guint8, numPackets + BENCH_WINDOW + 1);
+    guint32 receiveNext = 1;
+
+    guint32 sendNext = 1;
+    guint32 lastAcknowledgment = 1;
+    guint64 checksum = 0;
+    guint64 queuedSum = 0;
+    guint numACKs = 0;
+
+    GTimer* timer = g_timer_new();
+
+    while(sendNext <= numPackets) {
+        /* the sender puts a new packet in flight */
+        bq->add(bq, sendNext, &packet);
+        if(g_rand_double(rand) >= BENCH_LOSS_RATE) {
+            g_queue_push_tail(pipe, GUINT_TO_POINTER(sendNext));
+        }
+        sendNext++;
+
+        while(g_queue_get_length(pipe) > BENCH_WINDOW) {
+            /* the receiver gets a packet and acks it */
+            guint32 sequence = GPOINTER_TO_UINT(g_queue_pop_head(pipe));
+            GList* selectiveACKs = NULL;
+            gboolean isDuplicate = TRUE;
+
+            if(sequence >= receiveNext && !received[sequence]) {
+                received[sequence] = 1;
+                if(sequence == receiveNext) {
+                    while(received[receiveNext]) {
+                        receiveNext++;
+                    }
+                    isDuplicate = FALSE;
+                } else {
+                    selectiveACKs = g_list_append(NULL, GUINT_TO_POINTER(sequence));
+                }
+            }
+
+            /* the sender processes the ack, in the order tcp.c does */
+            guint32 acknowledgment = receiveNext;
+            gint flags = retransmit_tally_update(tally, acknowledgment, sendNext, isDuplicate);
+
+            if(acknowledgment > lastAcknowledgment) {
+                bq->ack(bq, lastAcknowledgment, acknowledgment);
+                lastAcknowledgment = acknowledgment;
+            }
+
+            if(selectiveACKs) {
+                retransmit_tally_mark_sacked(tally, selectiveACKs, bq->sack, bq);
+                g_list_free(selectiveACKs);
+            }
+
+            if(flags & TCP_PF_DATA_LOST_) {
+                size_t numLostRanges = retransmit_tally_num_lost_ranges(tally);
+                uint32_t* lostRanges = g_new(uint32_t, 2 * numLostRanges);
+                retransmit_tally_populate_lost_ranges(tally, lostRanges);
+
+                for(size_t i = 0; i < numLostRanges; i++) {
+                    for(guint32 lost = lostRanges[2*i]; lost < lostRanges[2*i + 1]; lost++) {
+                        gpointer retransmit = bq->steal(bq, lost);
+                        if(retransmit) {
+                            /* sending it puts it back into the queue; it is not lost again */
+                            bq->add(bq, lost, retransmit);
+                            g_queue_push_tail(pipe, GUINT_TO_POINTER(lost));
+                            checksum = (checksum * 31) + lost;
+                        }
+                    }
+                    retransmit_tally_mark_retransmitted(tally, lostRanges[2*i], lostRanges[2*i + 1]);
+                }
+
+                g_free(lostRanges);
+            }
+
+            queuedSum += bq->getLength(bq);
+            numACKs++;
+        }
+    }
+
+    *seconds = g_timer_elapsed(timer, NULL);
+    g_timer_destroy(timer);
+
+    g_print("%s: %u acks in %f seconds, %f ns per ack, %f packets queued on average\n",
+            bq->name, numACKs, *seconds, (*seconds * 1e9) / numACKs, ((gdouble)queuedSum) / numACKs);
+    *meanQueued = ((gdouble)queuedSum) / numACKs;
+
+    checksum = (checksum * 31) + lastAcknowledgment;
+
+    g_free(received);
+    g_queue_free(pipe);
+    retransmit_tally_destroy(tally);
+    g_rand_free(rand);
+    return checksum;
+}
+
+int main(int argc, char* argv[]) {
+    guint numPackets = argc > 1 ? (guint)atol(argv[1]) : BENCH_DEFAULT_PACKETS;
+
+    BenchQueue hashQueue = {
+        .name = "hash table",
+        .queue = g_hash_table_new(g_direct_hash, g_direct_equal),
+        .add = _bench_hashAdd,
+        .steal = _bench_hashSteal,
+        .ack = _bench_hashAck,
+        .sack = NULL,
+        .getLength = _bench_hashGetLength,
+    };
+    BenchQueue ringQueue = {
+        .name = "sequence ring",
+        .queue = sequencering_new(0, NULL),
+        .add = _bench_ringAdd,
+        .steal = _bench_ringSteal,
+        .ack = _bench_ringAck,
+        .sack = _bench_ringSack,
+        .getLength = _bench_ringGetLength,
+    };
+
+    g_print("sending %u packets through a pipe of %u packets with a loss rate of %f\n",
+            numPackets, BENCH_WINDOW, BENCH_LOSS_RATE);
+
+    gdouble hashSeconds = 0, ringSeconds = 0, hashQueued = 0, ringQueued = 0;
+    guint64 hashChecksum = _bench_run(&hashQueue, numPackets, &hashSeconds, &hashQueued);
+    guint64 ringChecksum = _bench_run(&ringQueue, numPackets, &ringSeconds, &ringQueued);
+
+    g_hash_table_destroy(hashQueue.queue);
+    sequencering_free(ringQueue.queue);
+
+    if(hashChecksum != ringChecksum) {
+        g_printerr("the queues retransmitted different packets\n");
+        return EXIT_FAILURE;
+    }
+    if(ringQueued > hashQueued) {
+        g_printerr("the sequence ring kept sacked packets\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
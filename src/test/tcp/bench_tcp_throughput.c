@@ -0,0 +1,165 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+/* A bulk transfer over one TCP connection, to compare the throughput that the TCP
+ * congestion control algorithms reach on a long fat pipe. The client writes the
+ * given number of MiB as fast as it can, and the server reports how long it took
+ * to read them in simulated time. In vectored mode both ends move the data with
+ * sendmsg and recvmsg through many small buffers, like event loops that queue their
+ * output as chains of chunks do, so that the payload copy counts that shadow logs at
+ * the end show what scatter-gather I/O costs. */
+
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_PORT 11111
+#define BENCH_BUFFER_SIZE 65536
+#define BENCH_IOV_COUNT 64
+
+static double _bench_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+/* points the vector at the first length bytes of the buffer, in equal chunks */
+static int _bench_fillVector(struct iovec* iov, char* buffer, size_t length) {
+    size_t chunk = BENCH_BUFFER_SIZE / BENCH_IOV_COUNT;
+    int count = 0;
+    for(size_t offset = 0; offset < length; offset += chunk) {
+        iov[count].iov_base = buffer + offset;
+        iov[count].iov_len = length - offset < chunk ? length - offset : chunk;
+        count++;
+    }
+    return count;
+}
+
+static int _bench_runServer(int vectored) {
+    int listenfd = socket(AF_INET, SOCK_STREAM, 0);
+    if(listenfd < 0) {
+        fprintf(stderr, "error: socket: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(BENCH_PORT);
+
+    if(bind(listenfd, (struct sockaddr*)&address, sizeof(address)) < 0 ||
+            listen(listenfd, 1) < 0) {
+        fprintf(stderr, "error: bind or listen: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    int fd = accept(listenfd, NULL, NULL);
+    if(fd < 0) {
+        fprintf(stderr, "error: accept: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    static char buffer[BENCH_BUFFER_SIZE];
+    size_t total = 0;
+    double start = 0;
+
+    struct iovec iov[BENCH_IOV_COUNT];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = _bench_fillVector(iov, buffer, sizeof(buffer));
+
+    while(1) {
+        ssize_t n = vectored ? recvmsg(fd, &msg, 0) : read(fd, buffer, sizeof(buffer));
+        if(n < 0) {
+            fprintf(stderr, "error: read: %s\n", strerror(errno));
+            return EXIT_FAILURE;
+        } else if(n == 0) {
+            break;
+        }
+        if(total == 0) {
+            start = _bench_now();
+        }
+        total += (size_t)n;
+    }
+
+    double seconds = _bench_now() - start;
+    printf("received %zu bytes in %f seconds, %f MiB/s\n", total, seconds,
+           seconds > 0 ? total / seconds / (1024 * 1024) : 0);
+
+    close(fd);
+    close(listenfd);
+    return total > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int _bench_runClient(const char* serverName, size_t numMiB, int vectored) {
+    struct addrinfo* info = NULL;
+    if(getaddrinfo(serverName, NULL, NULL, &info) != 0 || !info) {
+        fprintf(stderr, "error: unable to resolve %s\n", serverName);
+        return EXIT_FAILURE;
+    }
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = ((struct sockaddr_in*)info->ai_addr)->sin_addr.s_addr;
+    address.sin_port = htons(BENCH_PORT);
+    freeaddrinfo(info);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if(fd < 0 || connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        fprintf(stderr, "error: socket or connect: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    static char buffer[BENCH_BUFFER_SIZE];
+    memset(buffer, 'x', sizeof(buffer));
+
+    struct iovec iov[BENCH_IOV_COUNT];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+
+    size_t remaining = numMiB * 1024 * 1024;
+    while(remaining > 0) {
+        size_t length = remaining < sizeof(buffer) ? remaining : sizeof(buffer);
+        ssize_t n;
+        if(vectored) {
+            /* every byte is the same, so a short write needs no bookkeeping */
+            msg.msg_iovlen = _bench_fillVector(iov, buffer, length);
+            n = sendmsg(fd, &msg, 0);
+        } else {
+            n = write(fd, buffer, length);
+        }
+        if(n < 0) {
+            fprintf(stderr, "error: write: %s\n", strerror(errno));
+            return EXIT_FAILURE;
+        }
+        remaining -= (size_t)n;
+    }
+
+    printf("sent %zu MiB\n", numMiB);
+    close(fd);
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char* argv[]) {
+    if((argc == 2 || argc == 3) && !strcmp(argv[1], "server")) {
+        return _bench_runServer(argc == 3 && !strcmp(argv[2], "vectored"));
+    } else if((argc == 4 || argc == 5) && !strcmp(argv[1], "client")) {
+        return _bench_runClient(argv[2], (size_t)atol(argv[3]), argc == 5 && !strcmp(argv[4], "vectored"));
+    }
+
+    fprintf(stderr, "USAGE: %s server [vectored] | client <server> <MiB> [vectored]\n", argv[0]);
+    return EXIT_FAILURE;
+}
@@ -530,6 +530,32 @@ static int _test_iov_client(int serverfd)
             "expected rv: %zu, actual: %d", sizeof syncbuf, rv);
     }
 
+    // write one block gathered from three bases with sendmsg()
+    const char block_4_a[] = "scatter", block_4_b[] = " and ", block_4_c[] = "gather";
+    struct iovec msg_iov[3] = {
+        {(void*)block_4_a, strlen(block_4_a)},
+        {(void*)block_4_b, strlen(block_4_b)},
+        {(void*)block_4_c, strlen(block_4_c)}
+    };
+    struct msghdr msg = {.msg_iov = msg_iov, .msg_iovlen = ARRAY_LENGTH(msg_iov)};
+
+    rv = sendmsg(serverfd, &msg, 0);
+    expected_rv = strlen(block_4_a) + strlen(block_4_b) + strlen(block_4_c);
+    if (rv != expected_rv) {
+        LOG_ERROR_AND_RETURN(
+            "expected rv: %d, actual: %d", expected_rv, rv);
+    }
+
+    MYLOG("sent one message. now wait for sever's OK... ");
+    /* read to sync with server */
+    memset(syncbuf, 0, sizeof syncbuf);
+    rv = read(serverfd, syncbuf, sizeof syncbuf);
+    MYLOG("got rv= %d", rv);
+    if (rv != sizeof (syncbuf) || memcmp(syncbuf, "OK", sizeof syncbuf)) {
+        LOG_ERROR_AND_RETURN(
+            "expected rv: %zu, actual: %d", sizeof syncbuf, rv);
+    }
+
     MYLOG("all good");
 
 #undef LOG_ERROR_AND_RETURN
@@ -703,6 +729,37 @@ static int _test_iov_server(int clientfd)
     // send "OK" cuz client is waiting for it
     write(clientfd, "OK", 2);
 
+    /****
+     **** scatter one message into two bases with recvmsg()
+     ****/
+    char msgbuf1[7] = {[0 ... 6] = 'P'};
+    char msgbuf2[16] = {[0 ... 15] = 'Q'};
+    struct iovec msg_iov[2] = {{msgbuf1, sizeof msgbuf1}, {msgbuf2, sizeof msgbuf2}};
+    struct msghdr msg = {.msg_iov = msg_iov, .msg_iovlen = ARRAY_LENGTH(msg_iov)};
+
+    MYLOG("start recvmsg()ing... ");
+    rv = recvmsg(clientfd, &msg, 0);
+    MYLOG("got rv= %d", rv);
+
+    expected_rv = strlen("scatter and gather");
+    if (rv != expected_rv) {
+        LOG_ERROR_AND_RETURN(
+            "expected rv: %d, actual: %d; errno: %d",
+            expected_rv, rv, errno);
+    }
+    if (msg_iov[0].iov_len != sizeof msgbuf1 || msg_iov[1].iov_len != sizeof msgbuf2) {
+        LOG_ERROR_AND_RETURN("recvmsg() changed the iov_len");
+    }
+    if (memcmp(msgbuf1, "scatter", 7) || memcmp(msgbuf2, " and gather", 11)) {
+        LOG_ERROR_AND_RETURN("read data has incorrect bytes");
+    }
+    if (memcmp(msgbuf2 + 11, "QQQQQ", 5)) {
+        LOG_ERROR_AND_RETURN("recvmsg() touched more memory than it should have");
+    }
+
+    // send "OK" cuz client is waiting for it
+    write(clientfd, "OK", 2);
+
     MYLOG("all good");
 
 #undef LOG_ERROR_AND_RETURN
@@ -0,0 +1,316 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+/* Drives the cubic and bbr congestion control hooks with synthetic ACK streams, outside
+ * of shadow. The path model sends the packets that the window and the pacing rate allow
+ * into a bottleneck link with an unbounded queue, and acks each one a fixed propagation
+ * delay after it leaves the link. */
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "main/core/support/definitions.h"
+#include "main/host/descriptor/tcp.h"
+#include "main/host/descriptor/tcp_cong.h"
+#include "main/host/descriptor/tcp_cong_bbr.h"
+#include "main/host/descriptor/tcp_cong_cubic.h"
+
+/* 18 MB/s with a 50 ms round trip, a bandwidth-delay product of 600 packets */
+#define PATH_PACKETS_PER_SECOND 12000
+#define PATH_RTT (50 * SIMTIME_ONE_MILLISECOND)
+#define PATH_MAX_IN_FLIGHT (1 << 16)
+
+#define check(c)                                                               \
+    if (!(c)) {                                                                \
+        g_printerr("%s:%d: check failed: %s\n", __FILE__, __LINE__, #c);      \
+        return EXIT_FAILURE;                                                   \
+    }
+
+/* stands in for the host's random source, and counts the draws so that a test can
+ * tell when bbr made a random choice */
+struct _Random {
+    guint state;
+    guint draws;
+};
+
+guint random_nextUInt(Random* random) {
+    random->draws++;
+    random->state = random->state * 1103515245 + 12345;
+    return random->state >> 16;
+}
+
+typedef struct _PathModel PathModel;
+struct _PathModel {
+    /* first, so that the model is the TCP that tcp_cong() returns */
+    TCPCong cong;
+    Random random;
+
+    SimulationTime now;
+    SimulationTime lastDeparture;
+    SimulationTime nextSendTime;
+
+    /* the send and ack times of the packets in flight, oldest at head */
+    SimulationTime sendTimes[PATH_MAX_IN_FLIGHT];
+    SimulationTime ackTimes[PATH_MAX_IN_FLIGHT];
+    guint32 head;
+    guint32 inFlight;
+
+    guint64 delivered;
+    /* the sum of the rtt samples and how many there were, since the last reset */
+    SimulationTime rttSum;
+    guint64 rttSamples;
+};
+
+/* the hooks reach the congestion state through the tcp, which is our model here */
+TCPCong* tcp_cong(TCP* tcp) {
+    return (TCPCong*)tcp;
+}
+
+static void _path_send(PathModel* path) {
+    g_assert(path->inFlight < PATH_MAX_IN_FLIGHT);
+
+    SimulationTime transmit = SIMTIME_ONE_SECOND / PATH_PACKETS_PER_SECOND;
+    path->lastDeparture = MAX(path->now, path->lastDeparture) + transmit;
+
+    guint32 tail = (path->head + path->inFlight) % PATH_MAX_IN_FLIGHT;
+    path->sendTimes[tail] = path->now;
+    path->ackTimes[tail] = path->lastDeparture + PATH_RTT;
+    path->inFlight++;
+
+    if(path->cong.pacingRate > 0) {
+        SimulationTime start = MAX(path->now, path->nextSendTime);
+        path->nextSendTime = start + (CONFIG_MTU * SIMTIME_ONE_SECOND) / path->cong.pacingRate;
+    }
+}
+
+static void _path_ack(PathModel* path) {
+    SimulationTime sent = path->sendTimes[path->head];
+    path->head = (path->head + 1) % PATH_MAX_IN_FLIGHT;
+
+    path->cong.now = path->now;
+    path->cong.rttSample = path->now - sent;
+    path->cong.packetsInFlight = path->inFlight;
+    path->cong.hooks->tcp_cong_new_ack_ev((TCP*)path, 1);
+
+    path->inFlight--;
+    path->delivered++;
+    path->rttSum += path->now - sent;
+    path->rttSamples++;
+}
+
+/* runs the events of the path until the given time */
+static void _path_run(PathModel* path, SimulationTime until) {
+    while(path->now < until) {
+        SimulationTime nextAck = path->inFlight > 0 ? path->ackTimes[path->head] : SIMTIME_MAX;
+        SimulationTime nextSend = SIMTIME_MAX;
+        if(path->inFlight < path->cong.cwnd) {
+            nextSend = path->cong.pacingRate > 0 ? MAX(path->now, path->nextSendTime) : path->now;
+        }
+
+        SimulationTime next = MIN(nextAck, nextSend);
+        if(next > until) {
+            path->now = until;
+            break;
+        }
+
+        path->now = next;
+        if(nextSend <= nextAck) {
+            _path_send(path);
+        } else {
+            _path_ack(path);
+        }
+    }
+}
+
+static PathModel* _path_new(void (*init)(TCP* tcp)) {
+    PathModel* path = calloc(1, sizeof(PathModel));
+    path->cong.random = &path->random;
+    init((TCP*)path);
+    return path;
+}
+
+static void _path_free(PathModel* path) {
+    path->cong.hooks->tcp_cong_delete((TCP*)path);
+    free(path);
+}
+
+/* acks one packet, spaced out from the previous ack enough to not look like a train */
+static void _cong_ack(PathModel* path, SimulationTime rtt, guint32 inFlight) {
+    path->now += 5 * SIMTIME_ONE_MILLISECOND;
+    path->cong.now = path->now;
+    path->cong.rttSample = rtt;
+    path->cong.packetsInFlight = inFlight;
+    path->cong.hooks->tcp_cong_new_ack_ev((TCP*)path, 1);
+}
+
+/* acks a round of one window */
+static void _cong_ackRound(PathModel* path, SimulationTime rtt) {
+    guint32 window = path->cong.cwnd;
+    for(guint32 i = 0; i < window; i++) {
+        _cong_ack(path, rtt, window - i);
+    }
+}
+
+static int _test_cubicHyStartDelay() {
+    PathModel* path = _path_new(tcp_cong_cubic_init);
+    TCPCong* cong = &path->cong;
+
+    /* the rtt grows once the window passes 64 packets */
+    while(cong->hooks->tcp_cong_ssthresh((TCP*)path) == INT32_MAX && cong->cwnd < 10000) {
+        _cong_ackRound(path, cong->cwnd < 64 ? PATH_RTT : PATH_RTT + 20 * SIMTIME_ONE_MILLISECOND);
+    }
+
+    guint32 ssthresh = cong->hooks->tcp_cong_ssthresh((TCP*)path);
+    g_print("cubic hystart left slow start at %u packets\n", ssthresh);
+    check(ssthresh >= 64 && ssthresh <= 256);
+
+    _path_free(path);
+    return EXIT_SUCCESS;
+}
+
+static int _test_cubicReduction() {
+    PathModel* path = _path_new(tcp_cong_cubic_init);
+    TCPCong* cong = &path->cong;
+
+    /* a loss at a window of 100 packets */
+    cong->cwnd = 100;
+    for(int i = 0; i < 3; i++) {
+        cong->hooks->tcp_cong_duplicate_ack_ev((TCP*)path);
+    }
+    check(cong->hooks->tcp_cong_fast_recovery((TCP*)path));
+    check(cong->hooks->tcp_cong_ssthresh((TCP*)path) == 70);
+
+    path->now = SIMTIME_ONE_SECOND;
+    _cong_ack(path, PATH_RTT, 100);
+    check(!cong->hooks->tcp_cong_fast_recovery((TCP*)path));
+    check(cong->cwnd == 70);
+
+    /* the window grows back to where it lost along a concave curve, and reaches it
+     * after k = cbrt(30 / 0.4) seconds */
+    SimulationTime epoch = path->now;
+    guint32 cwndAfterOneSecond = 0;
+    while(path->now < epoch + 4 * SIMTIME_ONE_SECOND) {
+        _cong_ackRound(path, PATH_RTT);
+        if(!cwndAfterOneSecond && path->now >= epoch + SIMTIME_ONE_SECOND) {
+            cwndAfterOneSecond = cong->cwnd;
+        }
+    }
+    g_print("cubic window grew from 70 to %u after 1 second and to %u after 4 seconds\n",
+            cwndAfterOneSecond, cong->cwnd);
+    check(cwndAfterOneSecond > 80 && cwndAfterOneSecond < 100);
+    check(cong->cwnd >= 95 && cong->cwnd <= 110);
+
+    _path_free(path);
+    return EXIT_SUCCESS;
+}
+
+static int _test_bbrPath() {
+    PathModel* path = _path_new(tcp_cong_bbr_init);
+    TCPCong* cong = &path->cong;
+    check(cong->pacingRate > 0);
+
+    _path_run(path, 6 * SIMTIME_ONE_SECOND);
+
+    /* average over several gain cycles */
+    path->delivered = 0;
+    path->rttSum = 0;
+    path->rttSamples = 0;
+    gdouble pacingSum = 0;
+    guint64 pacingSamples = 0;
+    SimulationTime start = path->now;
+    SimulationTime end = start + 2 * SIMTIME_ONE_SECOND;
+    while(path->now < end) {
+        _path_run(path, path->now + SIMTIME_ONE_MILLISECOND);
+        pacingSum += cong->pacingRate;
+        pacingSamples++;
+    }
+
+    gdouble seconds = (gdouble)(end - start) / SIMTIME_ONE_SECOND;
+    gdouble throughput = path->delivered / seconds;
+    gdouble pacing = pacingSum / pacingSamples / CONFIG_MTU;
+    SimulationTime meanRTT = path->rttSum / path->rttSamples;
+
+    g_print("bbr delivered %f packets/s through a %d packets/s link, paced at %f packets/s, "
+            "with a mean rtt of %f ms and a window of %u\n", throughput, PATH_PACKETS_PER_SECOND,
+            pacing, (gdouble)meanRTT / SIMTIME_ONE_MILLISECOND, cong->cwnd);
+
+    /* bbr keeps the link busy, */
+    check(throughput > 0.9 * PATH_PACKETS_PER_SECOND);
+    /* paces at about the bottleneck rate, */
+    check(pacing > 0.9 * PATH_PACKETS_PER_SECOND && pacing < 1.2 * PATH_PACKETS_PER_SECOND);
+    /* and left startup, so that the queue it built there drained */
+    check(meanRTT < PATH_RTT + PATH_RTT / 2);
+
+    _path_free(path);
+    return EXIT_SUCCESS;
+}
+
+static int _test_bbrLoss() {
+    PathModel* path = _path_new(tcp_cong_bbr_init);
+    TCPCong* cong = &path->cong;
+
+    _path_run(path, 4 * SIMTIME_ONE_SECOND);
+    guint32 cwnd = cong->cwnd;
+    guint64 pacingRate = cong->pacingRate;
+
+    /* a loss does not cut the sending rate, and the window comes back after recovery */
+    for(int i = 0; i < 3; i++) {
+        cong->hooks->tcp_cong_duplicate_ack_ev((TCP*)path);
+    }
+    check(cong->hooks->tcp_cong_fast_recovery((TCP*)path));
+    check(cong->pacingRate == pacingRate);
+
+    _path_run(path, path->now + SIMTIME_ONE_MILLISECOND);
+    check(!cong->hooks->tcp_cong_fast_recovery((TCP*)path));
+    check(cong->cwnd + 2 >= cwnd);
+
+    _path_free(path);
+    return EXIT_SUCCESS;
+}
+
+static int _test_bbrCycleStart() {
+    guint starts[8] = {0};
+
+    for(guint seed = 1; seed <= 16; seed++) {
+        PathModel* path = _path_new(tcp_cong_bbr_init);
+        path->random.state = seed;
+
+        /* bbr draws the starting phase when it leaves drain, and stays in a phase for at
+         * least the rtt, so the phase right after the draw is the one it started in */
+        while(path->random.draws == 0 && path->now < 4 * SIMTIME_ONE_SECOND) {
+            _path_run(path, path->now + SIMTIME_ONE_MILLISECOND);
+        }
+        check(path->random.draws == 1);
+
+        guint32 start = tcp_cong_bbr_cycle_index((TCP*)path);
+        check(start < 8);
+        /* never in the draining phase, which has nothing to drain yet */
+        check(start != 1);
+        starts[start]++;
+
+        _path_free(path);
+    }
+
+    guint distinct = 0;
+    for(guint i = 0; i < 8; i++) {
+        distinct += starts[i] > 0 ? 1 : 0;
+    }
+    g_print("bbr started probe_bw in %u different phases over 16 connections\n", distinct);
+    check(distinct > 1);
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char* argv[]) {
+    if(_test_cubicHyStartDelay() != EXIT_SUCCESS ||
+            _test_cubicReduction() != EXIT_SUCCESS ||
+            _test_bbrPath() != EXIT_SUCCESS ||
+            _test_bbrLoss() != EXIT_SUCCESS ||
+            _test_bbrCycleStart() != EXIT_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
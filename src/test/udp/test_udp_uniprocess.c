@@ -12,6 +12,7 @@
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include "test/test_glib_helpers.h"
@@ -138,6 +139,129 @@ static void test_echo() {
     assert_nonneg_errno(close(client_sock));
 }
 
+static void test_sendmsg_recvmsg() {
+    int client_sock, server_sock;
+    struct sockaddr_in addr = {0};
+    _udp_socketpair(&client_sock, &server_sock, &addr);
+
+    /* the datagram is gathered from, and scattered into, buffers of different sizes */
+    char head[] = "head:", body[] = "the body", tail[] = ":tail";
+    struct iovec send_iov[] = {{head, strlen(head)}, {body, strlen(body)}, {tail, strlen(tail)}};
+    struct msghdr send_msg = {.msg_name = &addr,
+                              .msg_namelen = sizeof(addr),
+                              .msg_iov = send_iov,
+                              .msg_iovlen = 3};
+    ssize_t sent;
+    assert_nonneg_errno(sent = sendmsg(client_sock, &send_msg, 0));
+    g_assert_cmpint(sent, ==, strlen(head) + strlen(body) + strlen(tail));
+
+    char first[3], second[64];
+    struct iovec recv_iov[] = {{first, sizeof(first)}, {second, sizeof(second)}};
+    struct sockaddr_in from = {0};
+    struct msghdr recv_msg = {.msg_name = &from,
+                              .msg_namelen = sizeof(from),
+                              .msg_iov = recv_iov,
+                              .msg_iovlen = 2};
+    ssize_t recvd;
+    assert_nonneg_errno(recvd = recvmsg(server_sock, &recv_msg, 0));
+    g_assert_cmpint(recvd, ==, sent);
+    g_assert_cmpmem(first, sizeof(first), "hea", 3);
+    g_assert_cmpmem(second, recvd - sizeof(first), "d:the body:tail", recvd - sizeof(first));
+
+    /* the sender is the client's implicitly bound address */
+    struct sockaddr_in client_addr = {0};
+    socklen_t client_addr_len = sizeof(client_addr);
+    assert_nonneg_errno(getsockname(client_sock, &client_addr, &client_addr_len));
+    g_assert_cmpint(recv_msg.msg_namelen, ==, sizeof(from));
+    g_assert_cmpint(from.sin_family, ==, AF_INET);
+    g_assert_cmpint(from.sin_port, ==, client_addr.sin_port);
+
+    assert_nonneg_errno(close(server_sock));
+    assert_nonneg_errno(close(client_sock));
+}
+
+static void test_sendmmsg_recvmmsg() {
+    int client_sock, server_sock;
+    struct sockaddr_in addr = {0};
+    _udp_socketpair(&client_sock, &server_sock, &addr);
+
+    enum { NUM_MSGS = 4 };
+    char send_bufs[NUM_MSGS][16];
+    struct iovec send_iov[NUM_MSGS];
+    struct mmsghdr send_msgs[NUM_MSGS];
+    memset(send_msgs, 0, sizeof(send_msgs));
+    for (int i = 0; i < NUM_MSGS; i++) {
+        memset(send_bufs[i], 'a' + i, sizeof(send_bufs[i]));
+        send_iov[i] = (struct iovec){send_bufs[i], i + 1};
+        send_msgs[i].msg_hdr = (struct msghdr){.msg_name = &addr,
+                                               .msg_namelen = sizeof(addr),
+                                               .msg_iov = &send_iov[i],
+                                               .msg_iovlen = 1};
+    }
+
+    int sent;
+    assert_nonneg_errno(sent = sendmmsg(client_sock, send_msgs, NUM_MSGS, 0));
+    g_assert_cmpint(sent, ==, NUM_MSGS);
+    for (int i = 0; i < NUM_MSGS; i++) {
+        g_assert_cmpint(send_msgs[i].msg_len, ==, i + 1);
+    }
+
+    /* each datagram lands in its own message */
+    char recv_bufs[NUM_MSGS][16];
+    struct iovec recv_iov[NUM_MSGS];
+    struct mmsghdr recv_msgs[NUM_MSGS];
+    memset(recv_msgs, 0, sizeof(recv_msgs));
+    for (int i = 0; i < NUM_MSGS; i++) {
+        recv_iov[i] = (struct iovec){recv_bufs[i], sizeof(recv_bufs[i])};
+        recv_msgs[i].msg_hdr = (struct msghdr){.msg_iov = &recv_iov[i], .msg_iovlen = 1};
+    }
+
+    int recvd = 0;
+    while (recvd < NUM_MSGS) {
+        int n;
+        assert_nonneg_errno(n = recvmmsg(server_sock, &recv_msgs[recvd], NUM_MSGS - recvd,
+                                         MSG_WAITFORONE, NULL));
+        g_assert_cmpint(n, >, 0);
+        recvd += n;
+    }
+    for (int i = 0; i < NUM_MSGS; i++) {
+        g_assert_cmpmem(recv_bufs[i], recv_msgs[i].msg_len, send_bufs[i], i + 1);
+    }
+
+    assert_nonneg_errno(close(server_sock));
+    assert_nonneg_errno(close(client_sock));
+}
+
+static void test_recvmmsg_waitall() {
+    int client_sock, server_sock;
+    struct sockaddr_in addr = {0};
+    _udp_socketpair(&client_sock, &server_sock, &addr);
+
+    /* an empty datagram does not end the batch, and without MSG_WAITFORONE the call
+     * waits until every message has one */
+    const char data[] = {42};
+    assert_nonneg_errno(sendto(client_sock, data, 0, 0, &addr, sizeof(addr)));
+    assert_nonneg_errno(sendto(client_sock, data, sizeof(data), 0, &addr, sizeof(addr)));
+
+    char recv_bufs[2][4];
+    struct iovec recv_iov[2] = {{recv_bufs[0], sizeof(recv_bufs[0])},
+                                {recv_bufs[1], sizeof(recv_bufs[1])}};
+    struct mmsghdr recv_msgs[2];
+    memset(recv_msgs, 0, sizeof(recv_msgs));
+    for (int i = 0; i < 2; i++) {
+        recv_msgs[i].msg_hdr = (struct msghdr){.msg_iov = &recv_iov[i], .msg_iovlen = 1};
+    }
+
+    int recvd;
+    assert_nonneg_errno(recvd = recvmmsg(server_sock, recv_msgs, 2, 0, NULL));
+    g_assert_cmpint(recvd, ==, 2);
+    g_assert_cmpint(recv_msgs[0].msg_len, ==, 0);
+    g_assert_cmpmem(recv_bufs[1], recv_msgs[1].msg_len, data, sizeof(data));
+
+    assert_nonneg_errno(close(server_sock));
+    assert_nonneg_errno(close(client_sock));
+}
+
 int main(int argc, char* argv[]) {
     g_test_init(&argc, &argv, NULL);
     g_test_add_func("/udp_uniprocess/create_socket", test_create_socket);
@@ -145,6 +269,9 @@ int main(int argc, char* argv[]) {
     g_test_add_func("/udp_uniprocess/getaddrinfo", test_getaddrinfo);
     g_test_add_func("/udp_uniprocess/sendto_one_byte", test_sendto_one_byte);
     g_test_add_func("/udp_uniprocess/echo", test_echo);
+    g_test_add_func("/udp_uniprocess/sendmsg_recvmsg", test_sendmsg_recvmsg);
+    g_test_add_func("/udp_uniprocess/sendmmsg_recvmmsg", test_sendmmsg_recvmmsg);
+    g_test_add_func("/udp_uniprocess/recvmmsg_waitall", test_recvmmsg_waitall);
     g_test_run();
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,157 @@
+#!/usr/bin/python
+
+'''
+Decode the binary packet-trace-N.bin files that shadow writes to its data directory
+when run with '--packet-trace'. The records of all given files are merged in order
+of simulation time and printed in the packet_toString format, one line per packet
+delivery status change, like the debug log lines that shadow used to print.
+
+Copies of a packet share its id, so the status list of a copy includes the statuses
+of the original up to the point it was copied. At most 4 SACK ranges are recorded
+per packet, so longer SACK lists end early.
+'''
+
+from __future__ import print_function
+import socket
+import struct
+import sys
+
+# must match PacketTraceFileHeader and PacketTraceRecord in src/main/routing/packet_trace.h
+HEADER_FORMAT = '<8sII'
+HEADER_MAGIC = b'SHDPKTTR'
+TRACE_VERSION = 1
+RECORD_FORMAT = '<QQQQIIIIIIII8IHHBBBB'
+MAX_SACK_RANGES = 4
+NO_SACK_END = 0xFFFFFFFF
+
+PLOCAL, PTCP, PUDP = 1, 2, 3
+PTCP_RST, PTCP_SYN, PTCP_ACK, PTCP_FIN, PTCP_DUPACK = 1 << 1, 1 << 2, 1 << 3, 1 << 5, 1 << 6
+PDS_DESTROYED = 1 << 20
+
+STATUS_NAMES = {
+    0: "NONE",
+    1 << 1: "SND_CREATED",
+    1 << 2: "SND_TCP_ENQUEUE_THROTTLED",
+    1 << 3: "SND_TCP_ENQUEUE_RETRANSMIT",
+    1 << 4: "SND_TCP_DEQUEUE_RETRANSMIT",
+    1 << 5: "SND_TCP_RETRANSMITTED",
+    1 << 6: "SND_SOCKET_BUFFERED",
+    1 << 7: "SND_INTERFACE_SENT",
+    1 << 8: "INET_SENT",
+    1 << 9: "INET_DROPPED",
+    1 << 10: "ROUTER_ENQUEUED",
+    1 << 11: "ROUTER_DEQUEUED",
+    1 << 12: "ROUTER_DROPPED",
+    1 << 13: "RCV_INTERFACE_RECEIVED",
+    1 << 14: "RCV_INTERFACE_DROPPED",
+    1 << 15: "RCV_SOCKET_PROCESSED",
+    1 << 16: "RCV_SOCKET_DROPPED",
+    1 << 17: "RCV_TCP_ENQUEUE_UNORDERED",
+    1 << 18: "RCV_SOCKET_BUFFERED",
+    1 << 19: "RCV_SOCKET_DELIVERED",
+    PDS_DESTROYED: "PDS_DESTROYED",
+}
+
+def status_name(status):
+    return STATUS_NAMES.get(status, "UKNOWN")
+
+def ip_string(ip):
+    # addresses are stored in network byte order
+    return socket.inet_ntoa(struct.pack('<I', ip))
+
+def port_number(port):
+    return struct.unpack('>H', struct.pack('<H', port))[0]
+
+def to_signed(value):
+    return value - (1 << 32) if value >= (1 << 31) else value
+
+def read_records(path):
+    record_size = struct.calcsize(RECORD_FORMAT)
+    with open(path, 'rb') as f:
+        header = f.read(struct.calcsize(HEADER_FORMAT))
+        magic, version, size = struct.unpack(HEADER_FORMAT, header)
+        if magic != HEADER_MAGIC or version != TRACE_VERSION or size != record_size:
+            print("{0} is not a version {1} packet trace".format(path, TRACE_VERSION), file=sys.stderr)
+            return
+        while True:
+            data = f.read(record_size)
+            if len(data) < record_size:
+                break
+            yield struct.unpack(RECORD_FORMAT, data)
+
+def sort_keys(records, file_index):
+    # ties go to the earlier file, then keep the order within the file
+    for i, r in enumerate(records):
+        yield (r[0], file_index, i, r)
+
+def format_packet(r, statuses):
+    (time, packet_id, tsval, tsecho, host_id, status, src_ip, dst_ip, length,
+        seq, ack, window) = r[:12]
+    sacks = r[12:20]
+    src_port, dst_port, protocol, flags, num_sacks = r[20:25]
+
+    s = "packetID={0}:{1} ".format(host_id, packet_id)
+
+    if protocol == PLOCAL:
+        s += "{0} -> {1} bytes={2}".format(to_signed(src_ip), to_signed(dst_ip), length)
+    elif protocol == PUDP:
+        s += "{0}:{1} -> {2}:{3} bytes={4}".format(ip_string(src_ip), port_number(src_port),
+            ip_string(dst_ip), port_number(dst_port), length)
+    elif protocol == PTCP:
+        s += "{0}:{1} -> {2}:{3} seq={4} ack={5} sack=".format(ip_string(src_ip), port_number(src_port),
+            ip_string(dst_ip), port_number(dst_port), seq, ack)
+        if num_sacks == 0:
+            s += "NA"
+        for i in range(min(num_sacks, MAX_SACK_RANGES)):
+            first, last = to_signed(sacks[2 * i]), sacks[2 * i + 1]
+            if i < num_sacks - 1:
+                s += "{0}-{1} ".format(first, to_signed(last))
+            else:
+                s += "{0}".format(first)
+                if last != NO_SACK_END:
+                    s += "-{0}".format(to_signed(last))
+        s += " window={0} bytes={1}".format(window, length)
+        s += " header="
+        if flags & PTCP_RST: s += "RST"
+        if flags & PTCP_SYN: s += "SYN"
+        if flags & PTCP_FIN: s += "FIN"
+        if flags & PTCP_ACK: s += "ACK"
+        if flags & PTCP_DUPACK: s += "DUPACK"
+        s += " tsval={0} tsechoreply={1}".format(tsval, tsecho)
+
+    if len(statuses) > 0:
+        s += " status=" + ",".join(status_name(st) for st in statuses)
+
+    return s
+
+def main():
+    if len(sys.argv) < 2:
+        print("USAGE: {0} packet-trace-0.bin [packet-trace-1.bin ...]".format(sys.argv[0]), file=sys.stderr)
+        exit(1)
+
+    # a worker runs the events of its hosts one round at a time, so its records are
+    # only roughly sorted by time
+    merged = []
+    for i, path in enumerate(sys.argv[1:]):
+        merged.extend(sort_keys(read_records(path), i))
+    merged.sort(key=lambda k: k[:3])
+
+    history = {}
+    n = 0
+    for _, _, _, r in merged:
+        time, packet_id, host_id, status = r[0], r[1], r[4], r[5]
+        statuses = history.setdefault((host_id, packet_id), [])
+        statuses.append(status)
+
+        print("{0}.{1:09d} [{2}] {3}".format(time // 1000000000, time % 1000000000,
+            status_name(status), format_packet(r, statuses)))
+
+        if status == PDS_DESTROYED:
+            # copies that are still alive keep the statuses from before
+            statuses.pop()
+        n += 1
+
+    print("Done! Decoded {0} records.".format(n), file=sys.stderr)
+
+if __name__ == '__main__':
+    main()